@@ -15,8 +15,19 @@
 #define AT_COMMAND_H
 
 #include <stdint.h>
+#include "ble_gatt_resolve.h"
 
-#define AT_CMD_MAX_LEN      128
+/* Carries a 512-byte value as hex plus command prefix */
+#define AT_CMD_MAX_LEN      1088
+
+/* Command latency, in CPU cycles */
+typedef struct {
+    uint32_t commands;
+    uint64_t wait_cycles;           /* Line terminator received to dispatch */
+    uint32_t wait_max;
+    uint64_t run_cycles;            /* Dispatch to handler return, reply included */
+    uint32_t run_max;
+} AT_LatencyStats_t;
 
 /**
   * @brief Initialize AT command handler
@@ -45,6 +56,21 @@ void AT_Command_ProcessReady(void);
   */
 void AT_Response_Send(const char *fmt, ...);
 
+/**
+  * @brief Get bytes sent on LPUART1 since reset
+  */
+uint32_t AT_Response_GetTxBytes(void);
+
+/**
+  * @brief Get command latency statistics
+  */
+const AT_LatencyStats_t* AT_Command_GetLatency(void);
+
+/**
+  * @brief Reset command latency statistics
+  */
+void AT_Command_ClearLatency(void);
+
 /* ============ AT Command Handlers ============ */
 
 /**
@@ -77,6 +103,38 @@ int AT_LIST_Handler(void);
   */
 int AT_READ_Handler(uint8_t dev_idx, uint16_t char_handle);
 
+/**
+  * @brief Read characteristic addressed by UUID
+  * @param dev_idx Device index
+  * @param uuid Characteristic UUID
+  */
+int AT_READUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid);
+
+/**
+  * @brief Read several characteristics in one batch
+  * @param dev_idx Device index
+  * @param handles Value handles
+  * @param count Number of handles (max GATT_READM_MAX_HANDLES)
+  */
+int AT_READM_Handler(uint8_t dev_idx, const uint16_t *handles, uint8_t count);
+
+/**
+  * @brief Compare sequential and batched reads of a handle set
+  * @param dev_idx Device index
+  * @param rounds Batches per method
+  * @param handles Value handles
+  * @param count Number of handles
+  */
+int AT_READMBENCH_Handler(uint8_t dev_idx, uint16_t rounds, const uint16_t *handles,
+                          uint8_t count);
+
+/**
+  * @brief Read long characteristic value
+  * @param dev_idx Device index
+  * @param char_handle Characteristic handle
+  */
+int AT_READLONG_Handler(uint8_t dev_idx, uint16_t char_handle);
+
 /**
   * @brief Write characteristic
   * @param dev_idx Device index
@@ -86,23 +144,314 @@ int AT_READ_Handler(uint8_t dev_idx, uint16_t char_handle);
 int AT_WRITE_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data);
 
 /**
-  * @brief Enable/disable notification
+  * @brief Write characteristic addressed by UUID
+  * @param dev_idx Device index
+  * @param uuid Characteristic UUID
+  * @param data Hex string data
+  */
+int AT_WRITEUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid, const char *data);
+
+/**
+  * @brief Reliable write of one or more attributes
+  * @param dev_idx Device index
+  * @param args "handle,hex[,handle,hex...]"
+  */
+int AT_WRITEREL_Handler(uint8_t dev_idx, const char *args);
+
+/**
+  * @brief Queue Write Without Response data for streaming
+  * @param dev_idx Device index
+  * @param char_handle Characteristic handle
+  * @param data Hex string data
+  */
+int AT_WRITENR_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data);
+
+/**
+  * @brief Receive a raw binary block for Write Without Response streaming
+  * @param dev_idx Device index
+  * @param char_handle Characteristic handle
+  * @param len Block length in bytes
+  */
+int AT_WRITEBIN_Handler(uint8_t dev_idx, uint16_t char_handle, uint16_t len);
+
+/**
+  * @brief Report stream buffer and per-link throughput
+  */
+int AT_STREAM_Query_Handler(void);
+
+/**
+  * @brief Confirm the pending indication of a device (AT+IND=1 mode)
+  * @param dev_idx Device index
+  */
+int AT_INDACK_Handler(uint8_t dev_idx);
+
+/**
+  * @brief Report indication confirmation mode and per-link latency
+  */
+int AT_IND_Query_Handler(void);
+
+/**
+  * @brief Enable/disable notification or indication
   * @param dev_idx Device index
   * @param desc_handle Descriptor handle
-  * @param enable 1 to enable, 0 to disable
+  * @param enable 1 for notification, 2 for indication, 0 to disable
   */
 int AT_NOTIFY_Handler(uint8_t dev_idx, uint16_t desc_handle, uint8_t enable);
 
+/**
+  * @brief Enable/disable notification of a characteristic addressed by UUID
+  * @param dev_idx Device index
+  * @param uuid Characteristic UUID (not the CCCD)
+  * @param enable 1 for notification, 2 for indication, 0 to disable
+  */
+int AT_NOTIFYUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid, uint8_t enable);
+
 /**
   * @brief Discover services
   * @param dev_idx Device index
   */
 int AT_DISC_Handler(uint8_t dev_idx);
 
+/**
+  * @brief Print stored attribute table of a discovered device
+  * @param dev_idx Device index
+  */
+int AT_DB_Handler(uint8_t dev_idx);
+
 /**
   * @brief Get device info
   * @param dev_idx Device index
   */
 int AT_INFO_Handler(uint8_t dev_idx);
 
+/**
+  * @brief Set connection parameters
+  * @param dev_idx Device index, or 0xFF for defaults of new connections
+  * @param params interval_min, interval_max, latency, supervision_timeout
+  */
+int AT_CONNPARAM_Handler(uint8_t dev_idx, const uint16_t *params);
+
+/**
+  * @brief Set peer connection update policy
+  * @param dev_idx Device index
+  * @param policy 0 = reject, 1 = accept, 2 = accept inside default interval window
+  */
+int AT_CONNPOLICY_Handler(uint8_t dev_idx, uint8_t policy);
+
+/**
+  * @brief Select post-connect negotiation steps
+  * @param dev_idx Device index
+  * @param mask Bit 0 = MTU exchange, bit 1 = data length, bit 2 = 2M PHY
+  */
+int AT_NEGO_Handler(uint8_t dev_idx, uint8_t mask);
+
+/**
+  * @brief Enable adaptive connection interval
+  * @param enable 1 = enable, 0 = disable
+  * @param bounds stream interval, idle interval, idle latency (NULL keeps current)
+  */
+int AT_ADAPT_Handler(uint8_t enable, const uint16_t *bounds);
+
+/**
+  * @brief Report adaptive controller state and per-link airtime
+  */
+int AT_ADAPT_Query_Handler(void);
+
+/**
+  * @brief Configure link quality monitor
+  * @param enable 1 = enable, 0 = disable
+  * @param period_ms Poll period (one link per period)
+  * @param warn_dbm Smoothed RSSI warning threshold
+  */
+int AT_LINKMON_Handler(uint8_t enable, uint16_t period_ms, int8_t warn_dbm);
+
+/**
+  * @brief Report link quality of all connected links
+  */
+int AT_LINKMON_Query_Handler(void);
+
+/**
+  * @brief Set GATT queue operation timeout
+  */
+int AT_GATTQ_Handler(uint16_t timeout_ms);
+
+/**
+  * @brief Report GATT queue depth and latency per link
+  */
+int AT_GATTQ_Query_Handler(void);
+
+/**
+  * @brief Enable or disable GATT cache restore/discovery on connect
+  */
+int AT_GATTCACHE_Handler(uint8_t enable);
+
+/**
+  * @brief Erase all GATT cache records
+  */
+int AT_GATTCACHE_Clear_Handler(void);
+
+/**
+  * @brief Report GATT cache statistics
+  */
+int AT_GATTCACHE_Query_Handler(void);
+
+/**
+  * @brief Set the notification output policy of a subscription
+  * @param dev_idx Device index
+  * @param value_handle Characteristic value handle
+  * @param policy BLE_GattSubPolicy_t
+  * @param param Interval ms, N, threshold or window ms (by policy)
+  * @param fmt BLE_GattSubFmt_t of the compared field
+  * @param offset Byte offset of the compared field
+  */
+int AT_NOTIFYPOL_Handler(uint8_t dev_idx, uint16_t value_handle, uint8_t policy,
+                        uint16_t param, uint8_t fmt, uint8_t offset);
+
+/**
+  * @brief Report output policies and suppressed notification counts
+  */
+int AT_NOTIFYPOL_Query_Handler(void);
+
+/**
+  * @brief Open an L2CAP connection-oriented channel to a peer SPSM
+  */
+int AT_COCOPEN_Handler(uint8_t dev_idx, uint16_t spsm);
+
+/**
+  * @brief Send one SDU on an open channel
+  * @param channel Stack channel index from +COCOPEN
+  * @param data Hex string
+  */
+int AT_COCSEND_Handler(uint8_t channel, const char *data);
+
+/**
+  * @brief Report listening SPSM and open channels
+  */
+int AT_COC_Query_Handler(void);
+
+/**
+  * @brief Enable or disable CCCD restore when a known device reconnects
+  */
+int AT_SUBS_Handler(uint8_t enable);
+
+/**
+  * @brief Forget all remembered subscriptions
+  */
+int AT_SUBS_Clear_Handler(void);
+
+/**
+  * @brief Report remembered subscriptions
+  */
+int AT_SUBS_Query_Handler(void);
+
+/**
+  * @brief Report event dispatch cost per event class
+  */
+int AT_EVTSTAT_Query_Handler(void);
+
+/**
+  * @brief Reset event dispatch statistics
+  */
+int AT_EVTSTAT_Clear_Handler(void);
+
+/**
+  * @brief Report the GATT server service set footprint and boot-to-ready time
+  */
+int AT_GATTSRV_Query_Handler(void);
+
+/**
+  * @brief Report transport layer event queue and buffer statistics
+  */
+int AT_TLSTAT_Query_Handler(void);
+
+/**
+  * @brief Reset transport layer statistics
+  */
+int AT_TLSTAT_Clear_Handler(void);
+
+/**
+  * @brief Enable or disable deferred stack event handling
+  */
+int AT_EVTDEFER_Handler(uint8_t enable);
+
+/**
+  * @brief Report event bus subscribers, filters and delivery cost
+  */
+int AT_EVTBUS_Query_Handler(void);
+
+/**
+  * @brief Reset event bus subscriber statistics
+  */
+int AT_EVTBUS_Clear_Handler(void);
+
+/**
+  * @brief Set the connection and attribute filter of an event bus subscriber
+  */
+int AT_EVTBUS_Handler(uint8_t id, uint16_t conn_handle, uint16_t attr_handle);
+
+/**
+  * @brief Set HCI trace mode, class filter and snap length
+  */
+int AT_HCITRACE_Handler(uint8_t mode, uint8_t filter, uint16_t snaplen);
+
+/**
+  * @brief Report HCI trace settings, ring usage and recorder overhead
+  */
+int AT_HCITRACE_Query_Handler(void);
+
+/**
+  * @brief Discard recorded HCI packets and reset recorder statistics
+  */
+int AT_HCITRACE_Clear_Handler(void);
+
+/**
+  * @brief Send recorded HCI packets as a btsnoop file over USB CDC
+  */
+int AT_HCIDUMP_Handler(void);
+
+/**
+  * @brief Report AT command wait and run times
+  */
+int AT_ATLAT_Query_Handler(void);
+
+/**
+  * @brief Reset AT command latency statistics
+  */
+int AT_ATLAT_Clear_Handler(void);
+
+/**
+  * @brief Start the advertising storm self-test
+  */
+int AT_ADVSTORM_Handler(uint16_t devices, uint16_t rate, uint8_t batch, uint16_t count, uint8_t ad_len);
+
+/**
+  * @brief Stop the advertising storm self-test
+  */
+int AT_ADVSTORM_Stop_Handler(void);
+
+/**
+  * @brief Report advertising storm configuration and results
+  */
+int AT_ADVSTORM_Query_Handler(void);
+
+/**
+  * @brief Report CPU load and per task sequencer statistics
+  */
+int AT_SEQSTAT_Query_Handler(void);
+
+/**
+  * @brief Reset sequencer statistics
+  */
+int AT_SEQSTAT_Clear_Handler(void);
+
+/**
+  * @brief Set the periodic sequencer report period, 0 = off
+  */
+int AT_SEQREPORT_Handler(uint16_t period_ms);
+
+/**
+  * @brief Report the sequencer report period
+  */
+int AT_SEQREPORT_Query_Handler(void);
+
 #endif /* AT_COMMAND_H */
@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    ble_adv_storm.h
+  * @brief   Synthetic advertising report generator for scan path load tests
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_ADV_STORM_H
+#define BLE_ADV_STORM_H
+
+#include <stdint.h>
+
+/* AD bytes per report: flags only, up to a full legacy advertising payload */
+#define ADVSTORM_AD_MIN             3U
+#define ADVSTORM_AD_MAX             31U
+#define ADVSTORM_AD_DEFAULT         20U
+
+/* Report size in an LE advertising report event, AD bytes excluded */
+#define ADVSTORM_REPORT_HDR         10U
+/* Event parameters left for reports after subevent code and report count */
+#define ADVSTORM_EVT_ROOM           253U
+
+/* H4 packet: type, event code, length, parameters */
+#define ADVSTORM_PKT_MAX            258U
+
+/* Self-test pacing */
+#define ADVSTORM_TICK_MS            10U     /* Rate timer period */
+#define ADVSTORM_BURST              8U      /* Events injected per task run */
+
+/* Load configuration */
+typedef struct {
+    uint16_t devices;               /* Advertiser population, 1..65535 */
+    uint16_t rate;                  /* Events per second, 0 = as fast as the gateway takes them */
+    uint8_t batch;                  /* Reports per event */
+    uint8_t ad_len;                 /* AD bytes per report: flags, name, manufacturer data */
+    uint16_t count;                 /* Reports to send, 0 = until stopped */
+    uint32_t seed;                  /* Address and order seed */
+} BLE_AdvStormConfig_t;
+
+/* Generator state, one event at a time */
+typedef struct {
+    BLE_AdvStormConfig_t cfg;
+    uint32_t rng;
+    uint32_t reports;               /* Reports built */
+    uint32_t events;                /* Events built */
+} BLE_AdvStormGen_t;
+
+/* Self-test results; scan path figures are deltas since the start */
+typedef struct {
+    uint32_t events;                /* Events injected */
+    uint32_t reports;               /* Reports in these events */
+    uint32_t flow_drops;            /* Reports in events refused with the ring full (rate > 0) */
+    uint32_t ingested;              /* Reports decoded by the scan path */
+    uint32_t new_devices;           /* Device table insertions */
+    uint32_t table_full;            /* Reports of unknown devices, table full */
+    uint32_t host_reports;          /* +SCAN lines */
+    uint32_t uart_bytes;            /* AT output on LPUART1 */
+    uint32_t elapsed_ms;
+} BLE_AdvStormStats_t;
+
+/**
+  * @brief Check a configuration
+  * @return 0 if valid, -1 otherwise (batch too large for ad_len, zero devices...)
+  */
+int BLE_AdvStorm_CheckConfig(const BLE_AdvStormConfig_t *cfg);
+
+/**
+  * @brief Start a generator
+  * @note  Same configuration and seed give the same events, on target and host
+  */
+void BLE_AdvStorm_GenInit(BLE_AdvStormGen_t *gen, const BLE_AdvStormConfig_t *cfg);
+
+/**
+  * @brief Build the next HCI LE advertising report event
+  * @param pkt Buffer of ADVSTORM_PKT_MAX bytes, filled with an H4 event packet
+  * @return Packet length, or 0 once count reports are built
+  */
+uint16_t BLE_AdvStorm_GenEvent(BLE_AdvStormGen_t *gen, uint8_t *pkt);
+
+/**
+  * @brief Initialize the self-test (stopped)
+  */
+void BLE_AdvStorm_Init(void);
+
+/**
+  * @brief Start the self-test: inject events into the stack event path, radio bypassed
+  * @return 0 on success, -1 if the configuration is invalid or a test is running
+  * @note  Scan path, device table and AT output see the reports as real ones;
+  *        +ADVSTORM:DONE follows once count reports are handled
+  */
+int BLE_AdvStorm_Start(const BLE_AdvStormConfig_t *cfg);
+
+/**
+  * @brief Stop the self-test and freeze its results
+  */
+void BLE_AdvStorm_Stop(void);
+
+/**
+  * @brief Check whether the self-test is running
+  */
+uint8_t BLE_AdvStorm_IsRunning(void);
+
+/**
+  * @brief Get the configuration of the last self-test
+  */
+void BLE_AdvStorm_GetConfig(BLE_AdvStormConfig_t *cfg);
+
+/**
+  * @brief Get self-test results, live while running
+  */
+void BLE_AdvStorm_GetStats(BLE_AdvStormStats_t *stats);
+
+/**
+  * @brief Sequencer task: inject the events due
+  */
+void BLE_AdvStorm_Process(void);
+
+#endif /* BLE_ADV_STORM_H */
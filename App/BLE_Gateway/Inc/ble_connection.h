@@ -23,6 +23,62 @@ typedef enum {
     CONN_STATE_DISCONNECTING,
 } BLE_ConnectionState_t;
 
+/* Post-connect negotiation steps (per device mask) */
+#define BLE_NEGO_MTU        0x01U   /* ATT MTU exchange */
+#define BLE_NEGO_DLE        0x02U   /* LL Data Length Extension */
+#define BLE_NEGO_PHY_2M     0x04U   /* LE 2M PHY */
+#define BLE_NEGO_ALL        (BLE_NEGO_MTU | BLE_NEGO_DLE | BLE_NEGO_PHY_2M)
+
+/* DLE and PHY steps still unresolved this long after connecting are dropped: the
+   controller reports no change event when the values stay the same */
+#define BLE_NEGO_TIMEOUT_MS 5000U
+
+/* Policy applied to peer connection parameter update requests */
+typedef enum {
+    CONN_UPDATE_POLICY_REJECT = 0,  /* Reject every peer request */
+    CONN_UPDATE_POLICY_ACCEPT,      /* Accept every valid peer request */
+    CONN_UPDATE_POLICY_RANGE,       /* Accept only inside default interval window */
+} BLE_ConnUpdatePolicy_t;
+
+/* Requested connection parameters (HCI units) */
+typedef struct {
+    uint16_t interval_min;          /* 1.25 ms units */
+    uint16_t interval_max;          /* 1.25 ms units */
+    uint16_t latency;               /* Connection events */
+    uint16_t supervision_timeout;   /* 10 ms units */
+} BLE_ConnParams_t;
+
+/* Per-link context */
+typedef struct {
+    uint16_t conn_handle;
+    BLE_ConnectionState_t state;
+    uint8_t mac_addr[BLE_MAC_LEN];
+    uint16_t conn_interval;         /* Effective interval, 1.25 ms units */
+    uint16_t conn_latency;          /* Effective peripheral latency */
+    uint16_t supervision_timeout;   /* Effective timeout, 10 ms units */
+    BLE_ConnUpdatePolicy_t update_policy;
+    uint16_t att_mtu;               /* Negotiated ATT MTU */
+    uint16_t max_tx_octets;         /* LL payload TX */
+    uint16_t max_rx_octets;         /* LL payload RX */
+    uint8_t tx_phy;                 /* 1 = 1M, 2 = 2M, 3 = Coded */
+    uint8_t rx_phy;
+    uint8_t nego_pending;           /* BLE_NEGO_* steps still awaiting result */
+    uint8_t encrypted;              /* LL encryption on */
+    uint32_t rx_packets;            /* Notifications received */
+    uint32_t rx_bytes;
+    uint32_t tx_packets;            /* Writes sent */
+    uint32_t tx_bytes;
+    uint32_t connect_tick;          /* HAL tick at connection complete */
+} BLE_ConnectionInfo_t;
+
+/* Scan path counters, one per advertising report */
+typedef struct {
+    uint32_t reports;               /* Reports decoded from advertising events */
+    uint32_t new_devices;           /* Device table insertions */
+    uint32_t table_full;            /* Reports of unknown devices, table full */
+    uint32_t host_reports;          /* +SCAN lines sent */
+} BLE_ScanStats_t;
+
 /**
   * @brief Initialize connection manager
   */
@@ -68,6 +124,64 @@ BLE_ConnectionState_t BLE_Connection_GetState(uint16_t conn_handle);
   */
 uint8_t BLE_Connection_IsConnected(uint16_t conn_handle);
 
+/**
+  * @brief Get link context
+  * @param conn_handle Connection handle
+  * @return Link context, or NULL if not connected
+  */
+BLE_ConnectionInfo_t* BLE_Connection_GetInfo(uint16_t conn_handle);
+
+/**
+  * @brief Get link context by slot
+  * @param slot Slot index (0..MAX_BLE_CONNECTIONS-1)
+  * @return Slot context (conn_handle 0xFFFF when unused), or NULL if out of range
+  */
+BLE_ConnectionInfo_t* BLE_Connection_GetSlot(uint8_t slot);
+
+/**
+  * @brief Account application traffic on a link
+  * @param conn_handle Connection handle
+  * @param is_tx 1 = write sent, 0 = notification received
+  * @param len Payload length
+  */
+void BLE_Connection_CountTraffic(uint16_t conn_handle, uint8_t is_tx, uint16_t len);
+
+/**
+  * @brief Get scan path counters
+  */
+const BLE_ScanStats_t* BLE_Connection_GetScanStats(void);
+
+/**
+  * @brief Reset scan path counters
+  */
+void BLE_Connection_ClearScanStats(void);
+
+/**
+  * @brief Set parameters used for new connections
+  * @return 0 if success, -1 if parameters invalid
+  */
+int BLE_Connection_SetDefaultParams(const BLE_ConnParams_t *params);
+
+/**
+  * @brief Get parameters used for new connections
+  */
+void BLE_Connection_GetDefaultParams(BLE_ConnParams_t *params);
+
+/**
+  * @brief Request new parameters on a live connection
+  * @param conn_handle Connection handle
+  * @param params Requested parameters
+  * @return 0 if success, -1 if error
+  * @note Result reported async via +CONNUPDATE
+  */
+int BLE_Connection_UpdateParams(uint16_t conn_handle, const BLE_ConnParams_t *params);
+
+/**
+  * @brief Set policy for peer connection update requests
+  * @return 0 if success, -1 if not connected
+  */
+int BLE_Connection_SetUpdatePolicy(uint16_t conn_handle, BLE_ConnUpdatePolicy_t policy);
+
 /**
   * @brief Callback when scan discovers device
   * @param mac MAC address
@@ -92,4 +206,65 @@ void BLE_Connection_OnConnected(const uint8_t *mac, uint16_t conn_handle, uint8_
   */
 void BLE_Connection_OnDisconnected(uint16_t conn_handle, uint8_t reason);
 
+/**
+  * @brief Store parameters reported by connection complete event
+  */
+void BLE_Connection_OnLinkParams(uint16_t conn_handle, uint16_t interval,
+                                 uint16_t latency, uint16_t timeout);
+
+/**
+  * @brief Callback when ATT MTU exchange response received
+  */
+void BLE_Connection_OnMtuExchanged(uint16_t conn_handle, uint16_t server_mtu);
+
+/**
+  * @brief Callback when LL data length changed
+  */
+void BLE_Connection_OnDataLengthChange(uint16_t conn_handle, uint16_t max_tx_octets,
+                                       uint16_t max_rx_octets);
+
+/**
+  * @brief Callback when PHY update procedure completes
+  */
+void BLE_Connection_OnPhyUpdate(uint16_t conn_handle, uint8_t status,
+                                uint8_t tx_phy, uint8_t rx_phy);
+
+/**
+  * @brief Callback when the queued MTU exchange finished
+  * @param error_code 0 on success, ATT/stack error or queue timeout
+  */
+void BLE_Connection_OnMtuDone(uint16_t conn_handle, uint8_t error_code);
+
+/**
+  * @brief Callback when link encryption changed
+  * @param status HCI status
+  * @param enabled 0 = off, else on
+  */
+void BLE_Connection_OnEncryptionChange(uint16_t conn_handle, uint8_t status, uint8_t enabled);
+
+/**
+  * @brief Callback when peer requests a connection parameter update
+  * @param conn_handle Connection handle
+  * @param identifier L2CAP signaling identifier
+  * @param params Parameters requested by peer
+  */
+void BLE_Connection_OnUpdateRequest(uint16_t conn_handle, uint8_t identifier,
+                                    const BLE_ConnParams_t *params);
+
+/**
+  * @brief Callback when connection update procedure completes
+  * @param conn_handle Connection handle
+  * @param status HCI status
+  * @param interval Effective interval (1.25 ms units)
+  * @param latency Effective peripheral latency
+  * @param timeout Effective supervision timeout (10 ms units)
+  */
+void BLE_Connection_OnUpdateComplete(uint16_t conn_handle, uint8_t status, uint16_t interval,
+                                     uint16_t latency, uint16_t timeout);
+
+/**
+  * @brief Sequencer task: resolve DLE and PHY steps past BLE_NEGO_TIMEOUT_MS
+  */
+void BLE_Connection_NegoProcess(void);
+
 #endif /* BLE_CONNECTION_H */
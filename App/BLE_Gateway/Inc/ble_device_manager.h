@@ -25,6 +25,7 @@ typedef struct {
     uint8_t addr_type;                  // Address type
     char name[BLE_DEVICE_NAME_MAX_LEN];
     uint8_t reported_in_scan;
+    uint8_t nego_mask;                  // Post-connect negotiation steps (BLE_NEGO_*)
 } BLE_Device_t;
 
 typedef struct {
@@ -103,6 +104,11 @@ void BLE_DeviceManager_UpdateAddrType(int dev_idx, uint8_t addr_type);
   */
 void BLE_DeviceManager_UpdateName(int dev_idx, const char *name);
 
+/**
+  * @brief Set post-connect negotiation steps for device
+  */
+void BLE_DeviceManager_SetNegoMask(int dev_idx, uint8_t mask);
+
 /**
 * @brief Reset reported_in_scan flags for all devices
 */
@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    ble_event_bus.h
+  * @brief   BLE Event Bus - gateway events fanned out to filtered subscribers
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_EVENT_BUS_H
+#define BLE_EVENT_BUS_H
+
+#include <stdint.h>
+
+/* Subscribers, all event types together */
+#define EVTBUS_MAX_SUBSCRIBERS      16U
+
+/* Set to 0 to drop the DWT cycle counters from the publish path */
+#define EVTBUS_CYCLE_STATS          1
+
+/* Filter wildcards */
+#define EVTBUS_ANY_CONN             0xFFFFU
+#define EVTBUS_ANY_ATTR             0x0000U
+
+/* Gateway events */
+typedef enum {
+    EVTBUS_EVT_SCAN_REPORT = 0,
+    EVTBUS_EVT_CONNECTED,           /* Connection complete, failed ones included */
+    EVTBUS_EVT_DISCONNECTED,
+    EVTBUS_EVT_NOTIFICATION,        /* After the subscription output policy */
+    EVTBUS_EVT_INDICATION,          /* Confirmation is sent after all subscribers return */
+    EVTBUS_EVT_READ_RSP,
+    EVTBUS_EVT_WRITE_RSP,
+    EVTBUS_EVT_COUNT
+} BLE_EventBusType_t;
+
+#define EVTBUS_MASK(type)           (1UL << (type))
+#define EVTBUS_MASK_LINK            (EVTBUS_MASK(EVTBUS_EVT_CONNECTED) | \
+                                     EVTBUS_MASK(EVTBUS_EVT_DISCONNECTED))
+#define EVTBUS_MASK_GATT            (EVTBUS_MASK(EVTBUS_EVT_NOTIFICATION) | \
+                                     EVTBUS_MASK(EVTBUS_EVT_INDICATION) | \
+                                     EVTBUS_MASK(EVTBUS_EVT_READ_RSP) | \
+                                     EVTBUS_MASK(EVTBUS_EVT_WRITE_RSP))
+#define EVTBUS_MASK_ALL             ((1UL << EVTBUS_EVT_COUNT) - 1UL)
+
+/* One published event; pointers are only valid during the call */
+typedef struct {
+    uint8_t type;                   /* BLE_EventBusType_t */
+    uint8_t status;                 /* Connected: HCI status, disconnected: reason,
+                                       write response: ATT status */
+    uint8_t addr_type;              /* Scan report */
+    int8_t rssi;                    /* Scan report */
+    uint16_t conn_handle;           /* EVTBUS_ANY_CONN for scan reports */
+    uint16_t attr_handle;           /* EVTBUS_ANY_ATTR if the event has none */
+    const uint8_t *mac;             /* Scan report and connected, NULL otherwise */
+    const char *name;               /* Scan report, NULL if not advertised */
+    const uint8_t *data;            /* Notification, indication, read response */
+    uint16_t len;
+} BLE_EventBusEvt_t;
+
+/* Per-subscriber filter; each field applies to events that carry it */
+typedef struct {
+    uint16_t conn_handle;           /* EVTBUS_ANY_CONN = all links */
+    uint16_t attr_handle;           /* EVTBUS_ANY_ATTR = all attributes */
+    uint8_t match_mac;              /* 1 = only events of the device below */
+    uint8_t mac[6];
+} BLE_EventBusFilter_t;
+
+/* Subscriber and its delivery cost, in CPU cycles */
+typedef struct {
+    const char *name;
+    uint32_t mask;                  /* EVTBUS_MASK() of subscribed types */
+    BLE_EventBusFilter_t filter;
+    uint32_t calls;
+    uint32_t filtered;              /* Events of a subscribed type the filter dropped */
+    uint64_t cycles;
+    uint32_t cycles_max;
+} BLE_EventBusSub_t;
+
+/**
+  * @brief Subscriber callback
+  */
+typedef void (*BLE_EventBusHandler_t)(const BLE_EventBusEvt_t *evt);
+
+/**
+  * @brief Initialize event bus (no subscribers)
+  * @note  Call after BLE_EvtDispatch_Init, which enables the cycle counter
+  */
+void BLE_EventBus_Init(void);
+
+/**
+  * @brief Subscribe to one or more event types
+  * @param name Label for statistics (static string)
+  * @param mask EVTBUS_MASK() of the event types
+  * @param filter Filter, or NULL for all events of these types
+  * @param handler Callback
+  * @return Subscriber id, or -1 if the table is full or arguments invalid
+  * @note  Subscribers of one event type run in subscription order
+  */
+int BLE_EventBus_Subscribe(const char *name, uint32_t mask, const BLE_EventBusFilter_t *filter,
+                           BLE_EventBusHandler_t handler);
+
+/**
+  * @brief Replace the filter of a subscriber
+  * @param filter Filter, or NULL for all events
+  * @return 0 on success, -1 if unknown subscriber
+  */
+int BLE_EventBus_SetFilter(uint8_t id, const BLE_EventBusFilter_t *filter);
+
+/**
+  * @brief Deliver one event to the subscribers of its type
+  * @return Number of subscribers called
+  */
+uint8_t BLE_EventBus_Publish(const BLE_EventBusEvt_t *evt);
+
+/**
+  * @brief Get subscribers in use
+  */
+uint8_t BLE_EventBus_GetCount(void);
+
+/**
+  * @brief Get a subscriber and its statistics
+  * @return Subscriber, or NULL if id out of range
+  */
+const BLE_EventBusSub_t* BLE_EventBus_GetSub(uint8_t id);
+
+/**
+  * @brief Reset subscriber statistics
+  */
+void BLE_EventBus_ClearStats(void);
+
+/* ============ Event Sources ============ */
+
+/**
+  * @brief Publish scan report event
+  */
+void BLE_EventBus_OnScanReport(const uint8_t *mac, int8_t rssi, const char *name, uint8_t addr_type);
+
+/**
+  * @brief Publish connection complete event
+  */
+void BLE_EventBus_OnConnectionComplete(const uint8_t *mac, uint16_t conn_handle, uint8_t status);
+
+/**
+  * @brief Publish disconnection event
+  */
+void BLE_EventBus_OnDisconnectionComplete(uint16_t conn_handle, uint8_t reason);
+
+/**
+  * @brief Publish notification event (subject to the subscription's output policy)
+  */
+void BLE_EventBus_OnNotification(uint16_t conn_handle, uint16_t handle,
+                                 const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Publish a notification, bypassing output policies
+  */
+void BLE_EventBus_DeliverNotification(uint16_t conn_handle, uint16_t handle,
+                                      const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Publish indication event
+  */
+void BLE_EventBus_OnIndication(uint16_t conn_handle, uint16_t handle,
+                               const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Publish read response event
+  */
+void BLE_EventBus_OnReadResponse(uint16_t conn_handle, uint16_t handle,
+                                 const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Publish write response event
+  */
+void BLE_EventBus_OnWriteResponse(uint16_t conn_handle, uint8_t status);
+
+#endif /* BLE_EVENT_BUS_H */
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file    ble_evt_dispatch.h
+  * @brief   BLE event dispatcher - routes stack events to registered handlers
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_EVT_DISPATCH_H
+#define BLE_EVT_DISPATCH_H
+
+#include <stdint.h>
+
+/* Handler registrations, all keys together */
+#define EVTDISP_MAX_HANDLERS        64U
+
+/* Direct-indexed key ranges */
+#define EVTDISP_LE_SUBEVT_COUNT     0x40U   /* LE meta subevents 0x00-0x3F */
+#define EVTDISP_VS_GROUP_COUNT      4U      /* Vendor ecode group: HCI, GAP, L2CAP, GATT */
+#define EVTDISP_VS_CODE_COUNT       0x20U   /* Vendor ecode within a group 0x00-0x1F */
+
+/* Set to 0 to drop the DWT cycle counters from the dispatch path */
+#define EVTDISP_CYCLE_STATS         1
+
+/* Deferred event ring: events wait here once their TL buffer is released */
+#define EVTDISP_RING_SIZE           2048U
+#define EVTDISP_RECORD_HDR          6U      /* Length (2) + receive timestamp (4) */
+#define EVTDISP_RECORD_MAX          (EVTDISP_RECORD_HDR + 3U + 255U)
+
+/* Deferred events handled per task run before yielding */
+#define EVTDISP_DEFER_BURST         4U
+
+/* Event classes for statistics */
+typedef enum {
+    EVTDISP_CLASS_HCI = 0,          /* Plain HCI events */
+    EVTDISP_CLASS_LE_META,          /* HCI LE meta subevents */
+    EVTDISP_CLASS_VENDOR,           /* ACI vendor specific events */
+    EVTDISP_CLASS_COUNT
+} BLE_EvtDispatchClass_t;
+
+/* Dispatch cost of one event class, in CPU cycles */
+typedef struct {
+    uint32_t events;
+    uint32_t unhandled;             /* Events without a registered handler */
+    uint64_t lookup_cycles;         /* Key decode and table lookup */
+    uint32_t lookup_max;
+    uint64_t handler_cycles;        /* Registered handlers */
+    uint32_t handler_max;
+} BLE_EvtDispatchStats_t;
+
+/* Transport buffer hold time and deferred ring usage */
+typedef struct {
+    uint32_t events;                /* Events received from the transport layer */
+    uint64_t hold_cycles;           /* Entry to buffer release, all events */
+    uint32_t hold_max;
+    uint32_t deferred;              /* Events copied to the ring */
+    uint32_t flow_off;              /* Ring full: event flow stopped until space frees */
+    uint16_t peak;                  /* Ring bytes in use, high-water mark */
+    uint64_t wait_cycles;           /* Ring entry to dispatch, deferred events */
+    uint32_t wait_max;
+} BLE_EvtDispatchRingStats_t;
+
+/* Transport layer queue and event buffer statistics (hci_tl.c, tl_mbox.c) */
+typedef struct {
+    uint32_t events;                /* Asynchronous events received */
+    uint8_t queue_depth;            /* Events in the HCI queue, now */
+    uint8_t queue_max;
+    uint8_t flow_off;               /* User event flow disabled, now */
+    uint32_t flow_off_count;
+    uint64_t flow_off_cycles;       /* Completed flow off periods */
+    uint32_t flow_off_max;
+    uint32_t pool_size;             /* Event pool given to CPU2, bytes */
+    uint8_t held;                   /* Buffers not yet returned to CPU2, now */
+    uint8_t held_max;
+    uint8_t local_free_max;         /* Buffers waiting for the release channel */
+    uint32_t returned;              /* Timed buffers returned */
+    uint64_t return_cycles;         /* Reception to return to CPU2 */
+    uint32_t return_max;
+} BLE_EvtDispatchTlStats_t;
+
+/**
+  * @brief Event handler
+  * @param evt Event parameters: after the subevent code for LE meta events,
+  *            after the ecode for vendor events, after the length otherwise
+  */
+typedef void (*BLE_EvtDispatchHandler_t)(void *evt);
+
+/**
+  * @brief Initialize dispatcher (no handlers) and the DWT cycle counter
+  * @note  Call before any module registers its handlers
+  */
+void BLE_EvtDispatch_Init(void);
+
+/**
+  * @brief Subscribe a handler to one event
+  * @param evt HCI event code
+  * @param code Subevent for HCI_LE_META_EVT_CODE, ecode for
+  *             HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ignored otherwise
+  * @return 0 on success, -1 if the key is out of range or no slot is free
+  * @note  Handlers of one key run in registration order
+  */
+int BLE_EvtDispatch_Register(uint8_t evt, uint16_t code, BLE_EvtDispatchHandler_t handler);
+
+/**
+  * @brief Route one HCI event packet to its handlers
+  * @param pckt hci_uart_pckt from the transport layer
+  * @return Number of handlers called
+  */
+uint8_t BLE_EvtDispatch_Process(void *pckt);
+
+/**
+  * @brief Parameter length of the event being handled, counted from the evt pointer
+  *        its handlers receive
+  * @note  Only valid inside a handler
+  */
+uint8_t BLE_EvtDispatch_GetParamLen(void);
+
+/**
+  * @brief Sequencer task: dispatch events waiting in the ring
+  */
+void BLE_EvtDispatch_ProcessDeferred(void);
+
+/**
+  * @brief Enable or disable deferred dispatch (default enabled)
+  * @note  Disabled, handlers run in transport layer context and hold the
+  *        event buffer; events already in the ring are still drained first
+  */
+void BLE_EvtDispatch_EnableDefer(uint8_t enable);
+
+/**
+  * @brief Check whether deferred dispatch is enabled
+  */
+uint8_t BLE_EvtDispatch_IsDeferEnabled(void);
+
+/**
+  * @brief Get ring bytes in use
+  */
+uint16_t BLE_EvtDispatch_GetRingUsed(void);
+
+/**
+  * @brief Get buffer hold time and ring statistics
+  */
+const BLE_EvtDispatchRingStats_t* BLE_EvtDispatch_GetRingStats(void);
+
+/**
+  * @brief Get transport layer statistics (all zero with CFG_TL_STATS at 0)
+  */
+void BLE_EvtDispatch_GetTlStats(BLE_EvtDispatchTlStats_t *stats);
+
+/**
+  * @brief Reset transport layer statistics
+  */
+void BLE_EvtDispatch_ClearTlStats(void);
+
+/**
+  * @brief Get handler registrations in use
+  */
+uint8_t BLE_EvtDispatch_GetUsed(void);
+
+/**
+  * @brief Get dispatch statistics of one event class
+  * @return Statistics, or NULL if class out of range
+  */
+const BLE_EvtDispatchStats_t* BLE_EvtDispatch_GetStats(BLE_EvtDispatchClass_t cls);
+
+/**
+  * @brief Reset dispatch, hold time and ring statistics
+  */
+void BLE_EvtDispatch_ClearStats(void);
+
+#endif /* BLE_EVT_DISPATCH_H */
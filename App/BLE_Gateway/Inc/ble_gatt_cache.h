@@ -0,0 +1,83 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_cache.h
+  * @brief   Persistent GATT discovery cache - attribute tables in flash
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_CACHE_H
+#define BLE_GATT_CACHE_H
+
+#include <stdint.h>
+
+/* Flash layout: GATT_CACHE region of the linker script */
+#define GATT_CACHE_PAGE_SIZE        4096U
+#define GATT_CACHE_SLOT_SIZE        1024U
+#define GATT_CACHE_SLOTS_PER_PAGE   (GATT_CACHE_PAGE_SIZE / GATT_CACHE_SLOT_SIZE)
+#define GATT_CACHE_PAGES            2U
+#define GATT_CACHE_MAX_ENTRIES      (GATT_CACHE_PAGES * GATT_CACHE_SLOTS_PER_PAGE)
+
+/* Database Hash characteristic (Core spec Vol 3, Part G, 7.3) */
+#define GATT_UUID_DATABASE_HASH     0x2B2AU
+#define GATT_DB_HASH_LEN            16
+
+/* How a link became ready */
+typedef enum {
+    GATT_READY_CACHE = 0,           /* Table restored from flash */
+    GATT_READY_DISC,                /* Full discovery */
+} BLE_GattReadySource_t;
+
+/* Cache statistics since boot */
+typedef struct {
+    uint8_t entries;                /* Valid records in flash */
+    uint16_t hits;
+    uint16_t misses;
+    uint32_t hit_ms_total;          /* Connect-to-ready time, cache path */
+    uint32_t disc_ms_total;         /* Connect-to-ready time, discovery path */
+} BLE_GattCacheStats_t;
+
+/**
+  * @brief Initialize cache: scan flash records
+  */
+void BLE_GattCache_Init(void);
+
+/**
+  * @brief Enable or disable automatic restore / discovery on connect
+  */
+void BLE_GattCache_Enable(uint8_t enable);
+
+/**
+  * @brief Get enable state
+  */
+uint8_t BLE_GattCache_IsEnabled(void);
+
+/**
+  * @brief Erase all records
+  * @return 0 on success, -1 if flash busy
+  */
+int BLE_GattCache_Clear(void);
+
+/**
+  * @brief Read statistics
+  */
+void BLE_GattCache_GetStats(BLE_GattCacheStats_t *stats);
+
+/**
+  * @brief Link negotiation finished: validate cached table or discover
+  * @note  Called once per connection when the ATT bearer is free
+  */
+void BLE_GattCache_OnLinkUp(uint16_t conn_handle);
+
+/* Event hooks (forwarded from GATT client event handler) */
+void BLE_GattCache_OnReadByUuid(uint16_t conn_handle, uint16_t attr_handle,
+                                const uint8_t *value, uint8_t len);
+void BLE_GattCache_OnProcComplete(uint16_t conn_handle, uint8_t error_code);
+void BLE_GattCache_OnDisconnected(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: write pending records to flash
+  */
+void BLE_GattCache_Process(void);
+
+#endif /* BLE_GATT_CACHE_H */
@@ -10,6 +10,7 @@
 #define BLE_GATT_CLIENT_H
 
 #include <stdint.h>
+#include "ble_gatt_queue.h"
 
 /**
   * @brief Initialize GATT client
@@ -37,22 +38,44 @@ int BLE_GATT_DiscoverCharacteristics(uint16_t conn_handle, uint16_t start_handle
   * @brief Read characteristic value
   * @param conn_handle Connection handle
   * @param char_handle Characteristic handle
-  * @return 0 if success
-  * @note Response will be async via ACI_GATT_NOTIFICATION_VSEVT_CODE or read response
+  * @return 0 if queued, -1 if GATT queue full
+  * @note Runs through the link's GATT queue; value arrives async as +READ
   */
 int BLE_GATT_ReadCharacteristic(uint16_t conn_handle, uint16_t char_handle);
 
+/**
+  * @brief Read characteristic value longer than ATT_MTU - 1
+  * @param conn_handle Connection handle
+  * @param char_handle Characteristic handle
+  * @return 0 if queued, -1 if GATT queue full or no long buffer free
+  * @note Value (up to GATT_LONG_MAX_LEN) arrives async as +READ
+  */
+int BLE_GATT_ReadLongCharacteristic(uint16_t conn_handle, uint16_t char_handle);
+
 /**
   * @brief Write characteristic value
   * @param conn_handle Connection handle
   * @param char_handle Characteristic handle
   * @param data Data to write
   * @param len Data length
-  * @return 0 if success
+  * @return 0 if queued, -1 if GATT queue full or invalid data
+  * @note Runs through the link's GATT queue; result arrives as +WRITE_DONE / +WRITE_ERROR.
+  *       Values over ATT_MTU - 3 (up to GATT_LONG_MAX_LEN) use a long write
   */
 int BLE_GATT_WriteCharacteristic(uint16_t conn_handle, uint16_t char_handle,
                                  const uint8_t *data, uint16_t len);
 
+/**
+  * @brief Reliable write of one or more attributes
+  * @param conn_handle Connection handle
+  * @param entries Attributes to write
+  * @param count Number of entries
+  * @return 0 if queued, -1 if GATT queue full or invalid data
+  * @note Written only if every echoed part matches; result as +WRITE_DONE / +WRITE_ERROR
+  */
+int BLE_GATT_WriteReliable(uint16_t conn_handle, const BLE_GattWriteEntry_t *entries,
+                           uint8_t count);
+
 /**
   * @brief Write characteristic without response (Command)
   * @param conn_handle Connection handle
@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_discovery.h
+  * @brief   GATT discovery engine - per-connection attribute database
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_DISCOVERY_H
+#define BLE_GATT_DISCOVERY_H
+
+#include <stdint.h>
+
+#define GATT_DB_MAX_SERVICES    16
+#define GATT_DB_MAX_CHARS       40
+#define GATT_DB_MAX_UUID128     8
+#define GATT_UUID128_LEN        16
+
+/* Longest UUID string: 8-4-4-4-12 hex digits plus separators */
+#define GATT_UUID_STR_LEN       37
+
+#define GATT_UUID_CCCD          0x2902U
+
+/* Discovery progress of a link */
+typedef enum {
+    GATT_DISC_IDLE = 0,
+    GATT_DISC_SERVICES,
+    GATT_DISC_CHARS,
+    GATT_DISC_DESCRIPTORS,
+    GATT_DISC_SERVICES_DONE,    /* Services-only walk finished */
+    GATT_DISC_DONE,
+    GATT_DISC_FAILED,
+} BLE_GattDiscState_t;
+
+/* UUID: 16-bit value, or index into the link's 128-bit UUID pool */
+typedef struct {
+    uint16_t value;
+    uint8_t is_uuid128;
+} BLE_GattUuid_t;
+
+typedef struct {
+    uint16_t start_handle;
+    uint16_t end_handle;
+    BLE_GattUuid_t uuid;
+} BLE_GattService_t;
+
+typedef struct {
+    uint16_t decl_handle;
+    uint16_t value_handle;
+    uint16_t cccd_handle;       /* 0 if none */
+    BLE_GattUuid_t uuid;
+    uint8_t properties;
+    uint8_t service_idx;
+} BLE_GattChar_t;
+
+/* Attribute table of one link */
+typedef struct {
+    uint16_t conn_handle;
+    BLE_GattDiscState_t state;
+    uint8_t service_count;
+    uint8_t char_count;
+    uint8_t uuid128_count;
+    uint8_t cur_service;        /* Service being walked */
+    uint8_t overflow;           /* Entries dropped: table full */
+    uint8_t services_only;      /* Stop after primary services */
+    uint32_t start_tick;
+    uint32_t duration_ms;
+    BLE_GattService_t services[GATT_DB_MAX_SERVICES];
+    BLE_GattChar_t chars[GATT_DB_MAX_CHARS];
+    uint8_t uuid128[GATT_DB_MAX_UUID128][GATT_UUID128_LEN];
+} BLE_GattDb_t;
+
+/* Called when a discovery (or services-only walk) ends */
+typedef void (*BLE_GattDiscDoneCallback_t)(uint16_t conn_handle, BLE_GattDiscState_t state);
+
+/**
+  * @brief Initialize discovery engine
+  */
+void BLE_GattDisc_Init(void);
+
+/**
+  * @brief Register end-of-discovery callback
+  */
+void BLE_GattDisc_RegisterDoneCallback(BLE_GattDiscDoneCallback_t cb);
+
+/**
+  * @brief Start full discovery: services, characteristics, descriptors
+  * @param conn_handle Connection handle
+  * @return 0 if started, -1 on error (no free table or ATT busy)
+  * @note  Results stream as +SERVICE / +CHAR, then +DISC_DONE
+  */
+int BLE_GattDisc_Start(uint16_t conn_handle);
+
+/**
+  * @brief Discover primary services only
+  * @note  Ends in GATT_DISC_SERVICES_DONE; BLE_GattDisc_Continue completes the walk
+  */
+int BLE_GattDisc_StartServices(uint16_t conn_handle);
+
+/**
+  * @brief Continue a services-only walk with characteristics and descriptors
+  */
+int BLE_GattDisc_Continue(uint16_t conn_handle);
+
+/**
+  * @brief Fail a running discovery (+DISC_ERROR); its procedure in flight is ignored
+  */
+void BLE_GattDisc_Abort(uint16_t conn_handle);
+
+/**
+  * @brief Install a previously stored table for a link (no ATT traffic)
+  * @param conn_handle Connection handle
+  * @param src Table contents; runtime fields are ignored
+  */
+int BLE_GattDisc_Restore(uint16_t conn_handle, const BLE_GattDb_t *src);
+
+/**
+  * @brief Get attribute table of a link
+  * @return Table, or NULL if link never discovered
+  */
+const BLE_GattDb_t* BLE_GattDisc_GetDb(uint16_t conn_handle);
+
+/**
+  * @brief Print stored table as +SERVICE / +CHAR lines
+  * @return Number of characteristics printed, -1 if no table
+  */
+int BLE_GattDisc_Dump(uint16_t conn_handle);
+
+/**
+  * @brief Format a table UUID as "180D" or "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
+  */
+void BLE_GattDisc_FormatUuid(const BLE_GattDb_t *db, const BLE_GattUuid_t *uuid, char *buf);
+
+/* Event hooks (forwarded from GATT client event handler) */
+void BLE_GattDisc_OnServices(uint16_t conn_handle, uint8_t attr_len,
+                             const uint8_t *data, uint8_t data_len);
+void BLE_GattDisc_OnChars(uint16_t conn_handle, uint8_t pair_len,
+                          const uint8_t *data, uint8_t data_len);
+void BLE_GattDisc_OnDescriptors(uint16_t conn_handle, uint8_t format,
+                                const uint8_t *data, uint8_t data_len);
+void BLE_GattDisc_OnProcComplete(uint16_t conn_handle, uint8_t error_code);
+void BLE_GattDisc_OnProcTimeout(uint16_t conn_handle);
+void BLE_GattDisc_OnDisconnected(uint16_t conn_handle);
+
+#endif /* BLE_GATT_DISCOVERY_H */
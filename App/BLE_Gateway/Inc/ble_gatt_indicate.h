@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_indicate.h
+  * @brief   Indication delivery and confirmation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_INDICATE_H
+#define BLE_GATT_INDICATE_H
+
+#include <stdint.h>
+
+/* When the Handle Value Confirmation is sent */
+typedef enum {
+    GATT_IND_CONFIRM_AUTO = 0,      /* As soon as +INDICATION is written to the host */
+    GATT_IND_CONFIRM_HOST,          /* When the host acknowledges with AT+INDACK */
+} BLE_GattIndMode_t;
+
+/* Host mode: an indication left unacknowledged this long is confirmed anyway,
+   well inside the peer's 30 s ATT transaction timeout */
+#define GATT_IND_CONFIRM_TIMEOUT_MS     10000U
+
+/* Per-link indication metrics */
+typedef struct {
+    uint16_t conn_handle;
+    uint8_t pending;                /* Indication waiting for its confirmation */
+    uint32_t received;
+    uint32_t confirmed;
+    uint32_t errors;                /* Confirmation refused by the stack */
+    uint32_t timeouts;              /* Confirmed at the deadline, host never acknowledged */
+    uint32_t total_ms;              /* Reception to confirmation, summed */
+    uint32_t max_ms;
+} BLE_GattIndStats_t;
+
+/**
+  * @brief Initialize indication handling (auto confirmation)
+  */
+void BLE_GattInd_Init(void);
+
+/**
+  * @brief Select confirmation mode for all links
+  */
+void BLE_GattInd_SetMode(BLE_GattIndMode_t mode);
+
+/**
+  * @brief Get confirmation mode
+  */
+BLE_GattIndMode_t BLE_GattInd_GetMode(void);
+
+/**
+  * @brief Confirm the pending indication of a link (host acknowledged)
+  * @return 0 if confirmed, -1 if none pending or the stack refused
+  */
+int BLE_GattInd_Ack(uint16_t conn_handle);
+
+/**
+  * @brief Get indication metrics of a link
+  * @return Metrics, or NULL if link never received an indication
+  */
+const BLE_GattIndStats_t* BLE_GattInd_GetStats(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: confirm host mode indications past their deadline
+  */
+void BLE_GattInd_Process(void);
+
+/* Event hooks */
+void BLE_GattInd_OnIndication(uint16_t conn_handle, uint16_t handle,
+                              const uint8_t *data, uint16_t len);
+void BLE_GattInd_OnDisconnected(uint16_t conn_handle);
+
+#endif /* BLE_GATT_INDICATE_H */
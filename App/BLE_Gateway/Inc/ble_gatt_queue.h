@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_queue.h
+  * @brief   Per-connection GATT operation queue - one ATT procedure per link
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_QUEUE_H
+#define BLE_GATT_QUEUE_H
+
+#include <stdint.h>
+#include "ble_gatt_resolve.h"
+
+/* Operations waiting per link, running one included */
+#define GATT_QUEUE_DEPTH            8U
+#define GATT_QUEUE_MAX_DATA         64U     /* Inline; longer data uses a long buffer */
+
+/* Long values (ATT maximum attribute length) */
+#define GATT_LONG_MAX_LEN           512U
+
+/* Queue-to-completion limits */
+#define GATT_QUEUE_DEFAULT_TIMEOUT_MS   5000U
+#define GATT_QUEUE_DISC_TIMEOUT_MS      30000U
+#define GATT_QUEUE_LONG_TIMEOUT_MS      30000U
+#define GATT_QUEUE_MIN_TIMEOUT_MS       100U
+
+/* Error codes reported for local failures */
+#define GATT_QUEUE_ERR_TIMEOUT      0xFFU
+#define GATT_QUEUE_ERR_VERIFY       0xFEU   /* Reliable write echo mismatch */
+#define GATT_QUEUE_ERR_DISCONNECTED 0xFDU   /* Link lost with the operation queued */
+
+typedef enum {
+    GATT_OP_READ = 0,
+    GATT_OP_WRITE,
+    GATT_OP_WRITE_DESC,             /* CCCD and other descriptors */
+    GATT_OP_DISC,
+    GATT_OP_MTU,
+    GATT_OP_READ_LONG,              /* Read Blob reassembly */
+    GATT_OP_WRITE_LONG,             /* Prepare/Execute Write, one attribute */
+    GATT_OP_WRITE_REL,              /* Reliable write, one or more attributes */
+    GATT_OP_READ_MULTI,             /* Batched read, run by ble_gatt_readm */
+    GATT_OP_UUID,                   /* Resolve a UUID, then read, write or set CCCD */
+} BLE_GattOpType_t;
+
+/* One attribute of a reliable write */
+typedef struct {
+    uint16_t handle;
+    uint16_t len;
+    const uint8_t *data;
+} BLE_GattWriteEntry_t;
+
+/* Per-link queue metrics */
+typedef struct {
+    uint16_t conn_handle;
+    uint8_t depth;                  /* Queued now, running one included */
+    uint8_t max_depth;
+    uint32_t completed;
+    uint32_t failed;                /* ATT error, start error or link loss */
+    uint32_t timeouts;
+    uint32_t rejected;              /* Queue full */
+    uint32_t started;               /* Accepted by the stack */
+    uint32_t executed;              /* Started and finished */
+    uint32_t wait_ms_total;         /* Enqueue to start */
+    uint32_t exec_ms_total;         /* Start to completion */
+    uint32_t max_latency_ms;        /* Enqueue to completion */
+} BLE_GattQueueStats_t;
+
+/**
+  * @brief Initialize queues
+  */
+void BLE_GattQueue_Init(void);
+
+/**
+  * @brief Set timeout of read/write/descriptor/MTU operations, from their start (or from reaching
+  *        the head of the queue while the stack refuses the start)
+  * @return 0 on success, -1 if below GATT_QUEUE_MIN_TIMEOUT_MS
+  */
+int BLE_GattQueue_SetTimeout(uint16_t timeout_ms);
+
+/**
+  * @brief Get timeout of read/write/descriptor/MTU operations
+  */
+uint16_t BLE_GattQueue_GetTimeout(void);
+
+/**
+  * @brief Queue operations
+  * @return 0 if queued, -1 if queue full or invalid argument
+  * @note  Results: +READ, +WRITE_DONE / +WRITE_ERROR, +DISC_DONE, or +GATT_ERROR;
+  *        a descriptor value must fit one Write Request (ATT_MTU - 3)
+  */
+int BLE_GattQueue_Read(uint16_t conn_handle, uint16_t handle);
+int BLE_GattQueue_Write(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len);
+int BLE_GattQueue_WriteDesc(uint16_t conn_handle, uint16_t handle,
+                            const uint8_t *data, uint16_t len);
+int BLE_GattQueue_Discover(uint16_t conn_handle);
+int BLE_GattQueue_ExchangeMtu(uint16_t conn_handle);
+
+/**
+  * @brief Queue long value operations (up to GATT_LONG_MAX_LEN)
+  * @return 0 if queued, -1 if queue full, no long buffer free or invalid argument
+  * @note  Results: +READ, +WRITE_DONE / +WRITE_ERROR, or +GATT_ERROR
+  */
+int BLE_GattQueue_ReadLong(uint16_t conn_handle, uint16_t handle);
+int BLE_GattQueue_WriteLong(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Queue a batched read of up to GATT_READM_MAX_HANDLES values
+  * @param flags GATT_READM_FLAG_*
+  * @return 0 if queued, -1 if queue full or invalid argument
+  * @note  Results: +READM or +GATT_ERROR
+  */
+int BLE_GattQueue_ReadMulti(uint16_t conn_handle, const uint16_t *handles, uint8_t count,
+                            uint8_t flags);
+
+/**
+  * @brief Queue operations addressed by characteristic UUID
+  * @return 0 if queued, -1 if queue full or invalid argument
+  * @note  Cached handles are used directly; otherwise the UUID is resolved on the
+  *        link first. Results as for handle operations; +GATT_ERROR with handle
+  *        0x0000 if the UUID is not found. First match in handle order wins.
+  */
+int BLE_GattQueue_ReadUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key);
+int BLE_GattQueue_WriteUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                            const uint8_t *data, uint16_t len);
+int BLE_GattQueue_WriteCccdUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                                uint16_t value);
+
+/**
+  * @brief Queue a reliable write of several attributes, executed together
+  * @return 0 if queued, -1 if queue full, no long buffer free or entries exceed
+  *         GATT_LONG_MAX_LEN (4 bytes per entry included)
+  */
+int BLE_GattQueue_WriteReliable(uint16_t conn_handle, const BLE_GattWriteEntry_t *entries,
+                                uint8_t count);
+
+/**
+  * @brief Get queue metrics of a link
+  * @return Metrics, or NULL if link never queued an operation
+  */
+const BLE_GattQueueStats_t* BLE_GattQueue_GetStats(uint16_t conn_handle);
+
+/* Event hooks (forwarded from GATT client event handler) */
+void BLE_GattQueue_OnReadResp(uint16_t conn_handle, const uint8_t *data, uint16_t len);
+void BLE_GattQueue_OnReadBlobResp(uint16_t conn_handle, const uint8_t *data, uint16_t len);
+void BLE_GattQueue_OnPrepareWriteResp(uint16_t conn_handle, uint16_t attr_handle, uint16_t offset,
+                                      const uint8_t *data, uint16_t len);
+void BLE_GattQueue_OnReadByUuid(uint16_t conn_handle, uint16_t attr_handle,
+                                const uint8_t *value, uint16_t len);
+void BLE_GattQueue_OnFindInfo(uint16_t conn_handle, uint8_t format,
+                              const uint8_t *data, uint16_t len);
+void BLE_GattQueue_OnErrorResp(uint16_t conn_handle, uint16_t attr_handle, uint8_t error_code);
+void BLE_GattQueue_OnProcComplete(uint16_t conn_handle, uint8_t error_code);
+void BLE_GattQueue_OnProcTimeout(uint16_t conn_handle);
+void BLE_GattQueue_OnDisconnected(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: timeouts and deferred starts
+  */
+void BLE_GattQueue_Process(void);
+
+#endif /* BLE_GATT_QUEUE_H */
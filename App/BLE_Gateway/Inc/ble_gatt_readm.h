@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_readm.h
+  * @brief   Batched characteristic reads - Read Multiple with sequential fallback
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_READM_H
+#define BLE_GATT_READM_H
+
+#include <stdint.h>
+
+#define GATT_READM_MAX_HANDLES      8U
+
+/* Request flags */
+#define GATT_READM_FLAG_SEQ         0x01U   /* Force one Read Request per handle */
+#define GATT_READM_FLAG_QUIET       0x02U   /* No +READM line */
+#define GATT_READM_FLAG_BENCH       0x04U   /* Owned by the benchmark */
+
+/* ATT procedure used for a batch */
+typedef enum {
+    GATT_READM_VAR = 0,             /* Read Multiple Variable Length */
+    GATT_READM_MULTI,               /* Read Multiple, split by learned lengths */
+    GATT_READM_SEQ,                 /* Read Request per handle */
+} BLE_GattReadMMode_t;
+
+/**
+  * @brief Initialize engine
+  */
+void BLE_GattReadM_Init(void);
+
+/**
+  * @brief Start a batch (called by the GATT queue when the link is free)
+  * @param handles Handles, little endian
+  * @return BLE_STATUS_SUCCESS, or the refusal of the stack / BLE_STATUS_BUSY
+  * @note  Result: +READM, unless GATT_READM_FLAG_QUIET
+  */
+uint8_t BLE_GattReadM_Start(uint16_t conn_handle, uint8_t flags, const uint8_t *handles,
+                            uint8_t count);
+
+/**
+  * @brief Check whether the running batch has finished
+  * @param status Result of the batch, 0 on success
+  * @return 1 if finished (engine released), 0 if still running
+  */
+uint8_t BLE_GattReadM_IsDone(uint16_t conn_handle, uint8_t *status);
+
+/**
+  * @brief Drop the running batch (queue timeout)
+  */
+void BLE_GattReadM_Abort(uint16_t conn_handle);
+
+/**
+  * @brief Run a sequential vs batched round-trip benchmark
+  * @param rounds Batches per method
+  * @return 0 if started, -1 if a benchmark runs or the GATT queue is full
+  * @note  Result: +READMBENCH
+  */
+int BLE_GattReadM_Bench(uint16_t conn_handle, const uint16_t *handles, uint8_t count,
+                        uint16_t rounds);
+
+/* Event hooks (forwarded from GATT client event handler) */
+void BLE_GattReadM_OnReadResp(uint16_t conn_handle, const uint8_t *data, uint16_t len);
+void BLE_GattReadM_OnReadMultiResp(uint16_t conn_handle, const uint8_t *data, uint16_t len);
+void BLE_GattReadM_OnErrorResp(uint16_t conn_handle, uint8_t error_code);
+void BLE_GattReadM_OnProcComplete(uint16_t conn_handle, uint8_t error_code);
+void BLE_GattReadM_OnDisconnected(uint16_t conn_handle);
+
+#endif /* BLE_GATT_READM_H */
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_resolve.h
+  * @brief   UUID to attribute handle resolution with per-link LRU cache
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_RESOLVE_H
+#define BLE_GATT_RESOLVE_H
+
+#include <stdint.h>
+
+/* Resolved characteristics remembered across all links */
+#define GATT_RESOLVE_CACHE_SIZE     16U
+
+/* Characteristic UUID, little endian (len 2 or 16) */
+typedef struct {
+    uint8_t len;
+    uint8_t uuid[16];
+} BLE_GattUuidKey_t;
+
+/* Resolution metrics */
+typedef struct {
+    uint8_t entries;                /* Cache entries in use */
+    uint32_t cache_hits;
+    uint32_t db_hits;               /* Found in the discovered attribute table */
+    uint32_t lookups;               /* Resolved over the air */
+    uint32_t evictions;
+} BLE_GattResolveStats_t;
+
+/**
+  * @brief Initialize cache
+  */
+void BLE_GattResolve_Init(void);
+
+/**
+  * @brief Resolve a characteristic UUID without ATT traffic
+  * @param value_handle Value handle, out
+  * @param cccd_handle CCCD handle, out (0 if unknown or none)
+  * @return 0 if the value handle is known, -1 if it must be looked up
+  * @note  Checks the LRU cache, then the attribute table of the link
+  */
+int BLE_GattResolve_Lookup(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                           uint16_t *value_handle, uint16_t *cccd_handle);
+
+/**
+  * @brief Remember a resolved characteristic
+  * @param cccd_handle CCCD handle, 0 to keep the stored one
+  * @param lookup 1 if resolved over the air (counted)
+  */
+void BLE_GattResolve_Learn(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                           uint16_t value_handle, uint16_t cccd_handle, uint8_t lookup);
+
+/**
+  * @brief Get resolution metrics
+  */
+const BLE_GattResolveStats_t* BLE_GattResolve_GetStats(void);
+
+/* Event hooks */
+void BLE_GattResolve_OnDisconnected(uint16_t conn_handle);
+
+#endif /* BLE_GATT_RESOLVE_H */
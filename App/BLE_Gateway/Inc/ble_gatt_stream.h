@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_stream.h
+  * @brief   Write Without Response streaming with controller flow control
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_STREAM_H
+#define BLE_GATT_STREAM_H
+
+#include <stdint.h>
+
+/* Shared byte ring for all links (the stack TX pool is shared too) */
+#define GATT_STREAM_BUF_SIZE        4096U
+#define GATT_STREAM_MAX_SEGMENTS    16U
+
+/* Packets handed to the stack per task run before yielding */
+#define GATT_STREAM_BURST_PKTS      8U
+
+/* Per-link stream metrics */
+typedef struct {
+    uint16_t conn_handle;
+    uint32_t bytes;                 /* Payload accepted by the stack */
+    uint32_t packets;
+    uint32_t stalls;                /* TX pool full, waited for TX_POOL_AVAILABLE */
+    uint32_t errors;                /* Segments dropped on stack error or link loss */
+    uint32_t last_kbps;             /* Throughput of the last completed burst */
+} BLE_GattStreamStats_t;
+
+/**
+  * @brief Initialize stream buffer
+  */
+void BLE_GattStream_Init(void);
+
+/**
+  * @brief Queue a complete Write Without Response payload
+  * @return 0 if queued, -1 if buffer full or invalid argument
+  * @note  Split into ATT_MTU - 3 packets; +STREAM_DONE when the link drains
+  */
+int BLE_GattStream_Write(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Reserve buffer space for a payload filled byte by byte
+  * @return 0 if reserved, -1 if buffer full, invalid argument or reservation open
+  * @note  Fill with BLE_GattStream_PutByte, then Commit or Cancel
+  */
+int BLE_GattStream_Reserve(uint16_t conn_handle, uint16_t handle, uint16_t len);
+
+/**
+  * @brief Store next byte of the open reservation (ISR safe)
+  */
+void BLE_GattStream_PutByte(uint8_t byte);
+
+/**
+  * @brief Release the open reservation for transmission
+  */
+void BLE_GattStream_Commit(void);
+
+/**
+  * @brief Drop the open reservation
+  */
+void BLE_GattStream_Cancel(void);
+
+/**
+  * @brief Free buffer space in bytes
+  */
+uint16_t BLE_GattStream_GetFree(void);
+
+/**
+  * @brief Get stream metrics of a link
+  * @return Metrics, or NULL if link never streamed
+  */
+const BLE_GattStreamStats_t* BLE_GattStream_GetStats(uint16_t conn_handle);
+
+/* Event hooks */
+void BLE_GattStream_OnTxPoolAvailable(void);
+void BLE_GattStream_OnDisconnected(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: hand queued packets to the stack
+  */
+void BLE_GattStream_Process(void);
+
+#endif /* BLE_GATT_STREAM_H */
@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_subscribe.h
+  * @brief   Subscription manager - CCCD set per device, restored on reconnect
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_GATT_SUBSCRIBE_H
+#define BLE_GATT_SUBSCRIBE_H
+
+#include <stdint.h>
+#include "ble_device_manager.h"
+
+/* Subscriptions remembered across all devices */
+#define GATT_SUB_MAX_ENTRIES        16U
+
+/* CCCD values */
+#define GATT_SUB_NOTIFY             0x01U
+#define GATT_SUB_INDICATE           0x02U
+
+/* Longest value held back by GATT_SUB_POLICY_RATE */
+#define GATT_SUB_HOLD_LEN           32U
+
+/* Output policy applied to notifications before they reach the host */
+typedef enum {
+    GATT_SUB_POLICY_NONE = 0,       /* Forward everything */
+    GATT_SUB_POLICY_RATE,           /* param: minimum interval in ms, latest value wins */
+    GATT_SUB_POLICY_DECIMATE,       /* param: forward one of every N */
+    GATT_SUB_POLICY_DELTA,          /* param: forward when the value moved by more than this */
+    GATT_SUB_POLICY_WINDOW,         /* param: window in ms, +NOTIFYWIN min/max/avg instead */
+    GATT_SUB_POLICY_COUNT
+} BLE_GattSubPolicy_t;
+
+/* Little-endian field read by GATT_SUB_POLICY_DELTA / GATT_SUB_POLICY_WINDOW */
+typedef enum {
+    GATT_SUB_FMT_U8 = 0,
+    GATT_SUB_FMT_S8,
+    GATT_SUB_FMT_U16,
+    GATT_SUB_FMT_S16,
+    GATT_SUB_FMT_S32,
+    GATT_SUB_FMT_COUNT
+} BLE_GattSubFmt_t;
+
+/* One subscription, keyed by peer MAC and CCCD handle */
+typedef struct {
+    uint8_t mac_addr[BLE_MAC_LEN];
+    uint16_t value_handle;
+    uint16_t cccd_handle;
+    uint8_t cccd_value;             /* GATT_SUB_NOTIFY / GATT_SUB_INDICATE, 0 = free */
+    uint8_t policy;                 /* BLE_GattSubPolicy_t */
+    uint8_t fmt;                    /* BLE_GattSubFmt_t */
+    uint8_t offset;                 /* Byte offset of the field in the value */
+    uint16_t param;
+    uint32_t forwarded;             /* Notifications (or windows) sent to the host */
+    uint32_t suppressed;            /* Notifications the policy kept back */
+} BLE_GattSub_t;
+
+/**
+  * @brief Initialize subscription set (empty, restore enabled)
+  */
+void BLE_GattSub_Init(void);
+
+/**
+  * @brief Enable or disable automatic restore when a known device reconnects
+  */
+void BLE_GattSub_EnableRestore(uint8_t enable);
+
+/**
+  * @brief Get restore enable state
+  */
+uint8_t BLE_GattSub_IsRestoreEnabled(void);
+
+/**
+  * @brief Forget all subscriptions
+  */
+void BLE_GattSub_Clear(void);
+
+/**
+  * @brief Get a subscription slot
+  * @return Subscription, or NULL if slot free or out of range
+  */
+const BLE_GattSub_t* BLE_GattSub_Get(uint8_t slot);
+
+/**
+  * @brief Attribute table of a link is usable: write the device's CCCDs back
+  * @note  Result: one +SUBSCRIBED line once all writes finished
+  */
+void BLE_GattSub_OnLinkReady(uint16_t conn_handle);
+
+/**
+  * @brief A CCCD write finished (called by the GATT queue)
+  * @param value_handle Characteristic value handle, 0 if unknown
+  */
+void BLE_GattSub_OnCccdWritten(uint16_t conn_handle, uint16_t cccd_handle,
+                               uint16_t value_handle, uint16_t value, uint8_t status);
+
+/**
+  * @brief Set the output policy of a subscription (counters restart)
+  * @param mac Peer MAC
+  * @param value_handle Characteristic value handle of the subscription
+  * @return 0 on success, -1 if no such subscription or invalid argument
+  */
+int BLE_GattSub_SetPolicy(const uint8_t *mac, uint16_t value_handle, BLE_GattSubPolicy_t policy,
+                          uint16_t param, BLE_GattSubFmt_t fmt, uint8_t offset);
+
+/**
+  * @brief Apply the subscription's policy to a received notification
+  * @return 1 to forward it to the host now, 0 if kept back
+  */
+uint8_t BLE_GattSub_FilterNotification(uint16_t conn_handle, uint16_t handle,
+                                       const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Sequencer task: release held values and close windows
+  */
+void BLE_GattSub_Process(void);
+
+/* Event hooks */
+void BLE_GattSub_OnDisconnected(uint16_t conn_handle);
+
+#endif /* BLE_GATT_SUBSCRIBE_H */
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    ble_hci_trace.h
+  * @brief   HCI/ACI traffic recorder with btsnoop export over USB CDC
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_HCI_TRACE_H
+#define BLE_HCI_TRACE_H
+
+#include <stdint.h>
+
+/* Record ring: oldest records are overwritten when full */
+#define HCITRACE_RING_SIZE          4096U
+#define HCITRACE_RECORD_HDR         12U     /* Type, orig/incl length, ms tick, us */
+
+/* Bytes kept per packet by default (command/event header included) */
+#define HCITRACE_SNAPLEN_DEFAULT    64U
+#define HCITRACE_SNAPLEN_MAX        258U    /* Largest command: opcode, length, 255 bytes */
+
+/* USB CDC transfer size for export */
+#define HCITRACE_TX_CHUNK           512U
+
+/* Packet classes for filtering */
+#define HCITRACE_F_CMD              0x01U   /* Commands */
+#define HCITRACE_F_CMD_RSP          0x02U   /* Command complete / status */
+#define HCITRACE_F_HCI_EVT          0x04U   /* Other HCI events (disconnection, encryption...) */
+#define HCITRACE_F_LE_EVT           0x08U   /* LE meta events, advertising reports excluded */
+#define HCITRACE_F_ADV              0x10U   /* LE advertising reports */
+#define HCITRACE_F_VS_EVT           0x20U   /* ACI vendor events (GAP, GATT, L2CAP) */
+#define HCITRACE_F_ALL              0x3FU
+#define HCITRACE_F_DEFAULT          (HCITRACE_F_ALL & ~HCITRACE_F_ADV)
+
+typedef enum {
+    HCITRACE_MODE_OFF = 0,
+    HCITRACE_MODE_RECORD,           /* Record to the ring, export with BLE_HciTrace_Dump */
+    HCITRACE_MODE_LIVE,             /* Record and stream to USB CDC as packets arrive */
+} BLE_HciTraceMode_t;
+
+/* Recorder statistics; cycles are spent in the transport layer hook */
+typedef struct {
+    uint32_t captured;              /* Packets recorded */
+    uint32_t filtered;              /* Packets skipped by the class filter */
+    uint32_t overwritten;           /* Records lost to a full ring */
+    uint32_t truncated;             /* Packets cut to the snap length */
+    uint32_t exported;              /* Records sent over USB CDC */
+    uint32_t export_errors;         /* Exports aborted, USB not connected */
+    uint64_t hook_cycles;           /* All packets, filtered ones included */
+    uint32_t hook_max;
+    uint32_t hook_calls;
+} BLE_HciTraceStats_t;
+
+/**
+  * @brief Initialize recorder (off, default filter and snap length)
+  */
+void BLE_HciTrace_Init(void);
+
+/**
+  * @brief Set recording mode, class filter and bytes kept per packet
+  * @param filter HCITRACE_F_* mask
+  * @param snaplen Bytes kept per packet, 4 to HCITRACE_SNAPLEN_MAX
+  * @return 0 on success, -1 if arguments invalid or a dump is running
+  * @note  LIVE sends the btsnoop file header first, then each record
+  */
+int BLE_HciTrace_Config(BLE_HciTraceMode_t mode, uint8_t filter, uint16_t snaplen);
+
+/**
+  * @brief Start sending the recorded packets as a btsnoop file over USB CDC
+  * @param bytes Set to the file size, header included
+  * @return Number of records, or -1 if a dump or live stream is running
+  * @note  Recording pauses until the file is sent; the ring is empty afterwards
+  */
+int BLE_HciTrace_Dump(uint32_t *bytes);
+
+/**
+  * @brief Discard recorded packets and reset statistics
+  */
+void BLE_HciTrace_Clear(void);
+
+/**
+  * @brief Check whether USB CDC carries trace data (debug text is held back)
+  */
+uint8_t BLE_HciTrace_IsExporting(void);
+
+/**
+  * @brief Get recording mode, filter and snap length
+  */
+void BLE_HciTrace_GetConfig(BLE_HciTraceMode_t *mode, uint8_t *filter, uint16_t *snaplen);
+
+/**
+  * @brief Get ring bytes and records in use
+  */
+void BLE_HciTrace_GetUsage(uint16_t *used, uint16_t *records);
+
+/**
+  * @brief Get recorder statistics
+  */
+const BLE_HciTraceStats_t* BLE_HciTrace_GetStats(void);
+
+/**
+  * @brief USB CDC transfer complete hook (interrupt context)
+  */
+void BLE_HciTrace_OnUsbTxDone(void);
+
+/**
+  * @brief Sequencer task: send records over USB CDC
+  */
+void BLE_HciTrace_Process(void);
+
+#endif /* BLE_HCI_TRACE_H */
@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    ble_l2cap_coc.h
+  * @brief   L2CAP LE credit based connection-oriented channels (bulk data)
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_L2CAP_COC_H
+#define BLE_L2CAP_COC_H
+
+#include <stdint.h>
+
+/* Channels open at the same time, all links together */
+#define COC_MAX_CHANNELS            4U
+
+/* Local receive parameters announced to the peer */
+#define COC_LOCAL_MTU               512U
+#define COC_LOCAL_MPS               247U    /* One K-frame per 251-byte LL packet */
+#define COC_INITIAL_CREDITS         8U
+
+/* Largest SDU queued for transmission per channel */
+#define COC_SDU_MAX                 512U
+
+/* K-frames handed to the stack per task run before yielding */
+#define COC_BURST_FRAMES            8U
+
+typedef enum {
+    COC_STATE_FREE = 0,
+    COC_STATE_CONNECTING,           /* Credit Based Connection Request sent */
+    COC_STATE_OPEN,
+    COC_STATE_CLOSING,              /* Disconnection Request sent */
+} BLE_CocState_t;
+
+/* Channel context and metrics */
+typedef struct {
+    uint8_t state;                  /* BLE_CocState_t */
+    uint8_t index;                  /* Stack channel index */
+    uint16_t conn_handle;
+    uint16_t spsm;
+    uint16_t peer_mtu;              /* Largest SDU the peer accepts */
+    uint16_t peer_mps;              /* Largest K-frame payload the peer accepts */
+    uint16_t tx_credits;            /* K-frames the peer can still accept */
+    uint16_t rx_credits;            /* K-frames granted to the peer, not received yet */
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t tx_sdus;
+    uint32_t rx_sdus;
+    uint32_t stalls;                /* Out of credits or stack TX pool full */
+} BLE_CocChannel_t;
+
+/**
+  * @brief Initialize channel table (no listening SPSM)
+  */
+void BLE_L2capCoc_Init(void);
+
+/**
+  * @brief Request a channel to a peer SPSM
+  * @return 0 if requested, -1 if no slot free or stack refused
+  * @note  Result: +COCOPEN or +COCERROR
+  */
+int BLE_L2capCoc_Open(uint16_t conn_handle, uint16_t spsm);
+
+/**
+  * @brief Close a channel
+  * @return 0 if requested, -1 if unknown channel or stack refused
+  */
+int BLE_L2capCoc_Close(uint8_t index);
+
+/**
+  * @brief Queue one SDU on a channel
+  * @return 0 if queued, -1 if channel not open, previous SDU still sending or too long
+  */
+int BLE_L2capCoc_Send(uint8_t index, const uint8_t *data, uint16_t len);
+
+/**
+  * @brief Send a generated byte pattern as back-to-back SDUs and report throughput
+  * @return 0 if started, -1 if channel not open or busy
+  */
+int BLE_L2capCoc_StartTest(uint8_t index, uint32_t bytes);
+
+/**
+  * @brief Accept peer channel requests on one SPSM (0 = refuse all)
+  */
+void BLE_L2capCoc_SetListen(uint16_t spsm);
+
+/**
+  * @brief Get listening SPSM
+  */
+uint16_t BLE_L2capCoc_GetListen(void);
+
+/**
+  * @brief Get a channel slot
+  * @return Channel, or NULL if slot free or out of range
+  */
+const BLE_CocChannel_t* BLE_L2capCoc_GetChannel(uint8_t slot);
+
+/* Event hooks */
+void BLE_L2capCoc_OnConnectRequest(uint16_t conn_handle, uint16_t spsm, uint16_t mtu,
+                                   uint16_t mps, uint16_t credits);
+void BLE_L2capCoc_OnConnectConfirm(uint16_t conn_handle, uint16_t mtu, uint16_t mps,
+                                   uint16_t credits, uint16_t result, uint8_t count,
+                                   const uint8_t *indexes);
+void BLE_L2capCoc_OnChannelClosed(uint8_t index);
+void BLE_L2capCoc_OnFlowControl(uint8_t index, uint16_t credits);
+void BLE_L2capCoc_OnRxData(uint8_t index, const uint8_t *data, uint16_t len);
+void BLE_L2capCoc_OnTxPoolAvailable(void);
+void BLE_L2capCoc_OnDisconnected(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: hand queued K-frames to the stack
+  */
+void BLE_L2capCoc_Process(void);
+
+#endif /* BLE_L2CAP_COC_H */
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    ble_link_adapt.h
+  * @brief   Adaptive connection interval - retunes links from observed traffic
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_LINK_ADAPT_H
+#define BLE_LINK_ADAPT_H
+
+#include <stdint.h>
+
+/* Sampling period of the controller */
+#define LINK_ADAPT_PERIOD_MS        1000U
+
+/* Traffic class of a link */
+typedef enum {
+    LINK_CLASS_NORMAL = 0,      /* Default AT+CONNPARAM parameters */
+    LINK_CLASS_STREAM,          /* Shortest interval, no latency */
+    LINK_CLASS_IDLE,            /* Longest interval with latency */
+} BLE_LinkClass_t;
+
+/* Host-set bounds the controller may use */
+typedef struct {
+    uint16_t interval_min;      /* Streaming interval, 1.25 ms units */
+    uint16_t interval_max;      /* Idle interval, 1.25 ms units */
+    uint16_t latency_max;       /* Idle peripheral latency */
+} BLE_LinkAdaptBounds_t;
+
+/* Per-link controller state */
+typedef struct {
+    uint16_t conn_handle;
+    BLE_LinkClass_t link_class; /* Class of the parameters the link runs */
+    BLE_LinkClass_t candidate;  /* Class waiting for hysteresis */
+    BLE_LinkClass_t requested;  /* Class of the update in progress */
+    uint8_t update_pending;     /* Waiting for the update complete event */
+    uint8_t stable_count;       /* Periods candidate has been observed */
+    uint32_t last_update_tick;  /* HAL tick of last renegotiation */
+    uint32_t last_packets;      /* rx + tx packets at previous sample */
+    uint32_t last_bytes;
+    uint16_t rate_x10;          /* Packets per second * 10 */
+    uint16_t byte_rate;         /* Bytes per second */
+    uint32_t airtime_us;        /* Estimated radio time per second */
+} BLE_LinkAdaptInfo_t;
+
+/**
+  * @brief Initialize controller (disabled until BLE_LinkAdapt_Enable)
+  */
+void BLE_LinkAdapt_Init(void);
+
+/**
+  * @brief Enable or disable controller
+  * @note  Disabling keeps current link parameters
+  */
+void BLE_LinkAdapt_Enable(uint8_t enable);
+
+/**
+  * @brief Check if controller enabled
+  */
+uint8_t BLE_LinkAdapt_IsEnabled(void);
+
+/**
+  * @brief Set bounds
+  * @return 0 on success, -1 if bounds are invalid
+  */
+int BLE_LinkAdapt_SetBounds(const BLE_LinkAdaptBounds_t *bounds);
+
+/**
+  * @brief Get bounds
+  */
+void BLE_LinkAdapt_GetBounds(BLE_LinkAdaptBounds_t *bounds);
+
+/**
+  * @brief Get controller state of a link
+  * @return State, or NULL if link unknown
+  */
+const BLE_LinkAdaptInfo_t* BLE_LinkAdapt_GetInfo(uint16_t conn_handle);
+
+/**
+  * @brief Sequencer task: sample traffic and renegotiate links
+  */
+void BLE_LinkAdapt_Process(void);
+
+/* Event hooks */
+void BLE_LinkAdapt_OnUpdateComplete(uint16_t conn_handle, uint8_t status, uint16_t interval);
+
+#endif /* BLE_LINK_ADAPT_H */
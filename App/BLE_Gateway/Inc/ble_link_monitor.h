@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    ble_link_monitor.h
+  * @brief   Link quality monitor - periodic RSSI and link status per connection
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef BLE_LINK_MONITOR_H
+#define BLE_LINK_MONITOR_H
+
+#include <stdint.h>
+
+/* Default poll period: one link is read per period (round-robin) */
+#define LINK_MON_DEFAULT_PERIOD_MS  500U
+#define LINK_MON_MIN_PERIOD_MS      50U
+
+/* Default warning threshold on smoothed RSSI */
+#define LINK_MON_DEFAULT_WARN_DBM   (-85)
+
+/* Per-link quality state */
+typedef struct {
+    uint16_t conn_handle;
+    int8_t rssi_last;           /* Last read, dBm */
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int16_t rssi_ewma_x16;      /* Slow EWMA (1/8), dBm * 16 */
+    int16_t rssi_fast_x16;      /* Fast EWMA (1/2), dBm * 16 */
+    uint16_t samples;
+    uint8_t warned;             /* +LINKWARN raised and not yet cleared */
+} BLE_LinkQuality_t;
+
+/**
+  * @brief Initialize monitor and start polling timer
+  */
+void BLE_LinkMonitor_Init(void);
+
+/**
+  * @brief Configure monitor
+  * @param enable 1 = poll, 0 = stop
+  * @param period_ms Poll period per link read
+  * @param warn_dbm Smoothed RSSI below which +LINKWARN is raised
+  * @return 0 on success, -1 on invalid period
+  */
+int BLE_LinkMonitor_Config(uint8_t enable, uint16_t period_ms, int8_t warn_dbm);
+
+/**
+  * @brief Read configuration
+  */
+void BLE_LinkMonitor_GetConfig(uint8_t *enable, uint16_t *period_ms, int8_t *warn_dbm);
+
+/**
+  * @brief Get quality state of a link
+  * @return State, or NULL if link has no samples yet
+  */
+const BLE_LinkQuality_t* BLE_LinkMonitor_GetInfo(uint16_t conn_handle);
+
+/**
+  * @brief Trend of a link: fast minus slow EWMA, dBm * 16
+  */
+int16_t BLE_LinkMonitor_Trend(const BLE_LinkQuality_t *q);
+
+/**
+  * @brief Sequencer task: poll next link
+  */
+void BLE_LinkMonitor_Process(void);
+
+#endif /* BLE_LINK_MONITOR_H */
@@ -17,12 +17,30 @@ extern "C" {
   * @brief Initialize all BLE Gateway modules
   * @note  Call this function once during system initialization
   *        This will initialize:
+  *        - Stack event dispatcher
   *        - Device Manager
   *        - AT Command Parser
   *        - BLE Connection Manager
   *        - GATT Client
-  *        - Event Handler
-  *        - Register sequencer task for AT command processing
+  *        - GATT Discovery engine
+  *        - GATT discovery cache (flash)
+  *        - Batched read engine
+  *        - GATT operation queue
+  *        - Write Without Response stream
+  *        - UUID handle resolution cache
+  *        - Indication confirmation
+  *        - Subscription restore and notification output policies
+  *        - L2CAP connection-oriented channels
+  *        - Event bus
+  *        - HCI/ACI traffic recorder
+  *        - Adaptive connection interval controller
+  *        - Link quality monitor
+  *        - Advertising storm self-test
+  *        - Sequencer profile report
+  *        - Register sequencer tasks for AT commands, link adaptation, monitoring,
+  *          GATT queue, streaming, L2CAP channels, deferred stack events,
+  *          advertising storm injection, GATT cache writes, notification
+  *          policies, HCI trace export and the sequencer profile report
   */
 void module_ble_init(void);
 
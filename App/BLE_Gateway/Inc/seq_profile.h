@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    seq_profile.h
+  * @brief   Sequencer task profile and CPU load report
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef SEQ_PROFILE_H
+#define SEQ_PROFILE_H
+
+#include <stdint.h>
+
+/* Periodic USB CDC report, 0 = off */
+#define SEQ_REPORT_MIN_PERIOD_MS    100U
+
+/**
+  * @brief Initialize the report timer (report off)
+  */
+void SEQ_Profile_Init(void);
+
+/**
+  * @brief Set the periodic report period
+  * @param period_ms Report period, 0 = off
+  * @return 0 on success, -1 on invalid period
+  */
+int SEQ_Profile_SetReport(uint16_t period_ms);
+
+/**
+  * @brief Get the periodic report period, 0 = off
+  */
+uint16_t SEQ_Profile_GetReport(void);
+
+/**
+  * @brief Short name of a sequencer task
+  * @return Name, or "-" for an unused task number
+  */
+const char* SEQ_Profile_TaskName(uint32_t task_idx);
+
+/**
+  * @brief CPU load since the statistics were cleared
+  * @param busy_ms Time in tasks, may be NULL
+  * @param total_ms Time since the statistics were cleared, may be NULL
+  * @return Load in 0.1 %
+  */
+uint16_t SEQ_Profile_GetLoad(uint32_t *busy_ms, uint32_t *total_ms);
+
+/**
+  * @brief Reset task statistics and load, and the report interval
+  */
+void SEQ_Profile_Clear(void);
+
+/**
+  * @brief Sequencer task: print the load and task figures of the last interval
+  */
+void SEQ_Profile_Process(void);
+
+#endif /* SEQ_PROFILE_H */
@@ -10,9 +10,27 @@
 #include "ble_device_manager.h"
 #include "ble_connection.h"
 #include "ble_gatt_client.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_cache.h"
+#include "ble_gatt_queue.h"
+#include "ble_gatt_stream.h"
+#include "ble_gatt_readm.h"
+#include "ble_gatt_indicate.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_l2cap_coc.h"
+#include "ble_evt_dispatch.h"
+#include "ble_event_bus.h"
+#include "ble_hci_trace.h"
+#include "ble_link_adapt.h"
+#include "ble_link_monitor.h"
+#include "ble_adv_storm.h"
+#include "seq_profile.h"
 #include "debug_trace.h"
 #include "main.h"
+#include "app_common.h"
 #include "app_conf.h"
+#include "app_entry.h"
+#include "hw_if.h"
 #include "stm32_seq.h"
 #include <stdio.h>
 #include <string.h>
@@ -20,6 +38,10 @@
 
 extern UART_HandleTypeDef hlpuart1;
 
+/* app_ble.c (app_ble.h pulls in the transport layer headers) */
+extern uint32_t APP_BLE_GetReadyTime(void);
+extern uint32_t APP_BLE_GetSvcInitTime(void);
+
 /*============================================================================
  * Constants
  *============================================================================*/
@@ -30,6 +52,9 @@ extern UART_HandleTypeDef hlpuart1;
 #define ASCII_CR            0x0D
 #define ASCII_LF            0x0A
 
+/* DWT cycle counter, enabled by BLE_EvtDispatch_Init */
+#define AT_CYCLES()         (DWT->CYCCNT)
+
 /*============================================================================
  * AT Command Line Buffer (accessed by ISR)
  *============================================================================*/
@@ -44,12 +69,38 @@ static char at_cmd_buf[AT_CMD_MAX_LEN];
 /* Simple tick counter for timeout (incremented in ISR) */
 static volatile uint32_t at_rx_tick = 0;
 
+/* Drop the LF of a CR LF terminator */
+static volatile uint8_t at_skip_lf = 0;
+
+/* Binary block of AT+WRITEBIN: raw bytes go to the stream buffer */
+#define AT_BIN_NONE         0U
+#define AT_BIN_DONE         1U
+#define AT_BIN_ABORTED      2U
+static volatile uint16_t at_bin_left = 0;
+static volatile uint32_t at_bin_tick = 0;
+static volatile uint8_t at_bin_result = AT_BIN_NONE;
+
+/* Gap check period while a binary block is open: the host may stop sending */
+#define AT_BIN_TICK_MS      100U
+#define AT_MS_TO_TICKS(ms)  ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+static uint8_t at_bin_timer_id;
+static uint8_t at_bin_timer_on = 0;
+
+/* Bytes sent on LPUART1 since reset */
+static uint32_t at_tx_bytes = 0;
+
+/* Command latency: line terminator stamp taken in the ISR */
+static volatile uint32_t at_line_stamp = 0;
+static AT_LatencyStats_t at_latency;
+
 /*============================================================================
  * Static Helper Functions
  *============================================================================*/
 
+static uint8_t ParseHexNibble(char c);
+
 /**
- * @brief Parse unsigned decimal string to uint16_t
+ * @brief Parse unsigned decimal or "0x" prefixed hex string to uint16_t
  * @return Parsed value, or 0 if invalid
  */
 static uint16_t ParseUInt16(const char *str)
@@ -60,6 +111,19 @@ static uint16_t ParseUInt16(const char *str)
         return 0;
     }
     
+    /* Handles are printed as 0x%04X: accept them back the same way */
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        str += 2;
+        while (ParseHexNibble(*str) != 0xFFU) {
+            val = (val << 4) | ParseHexNibble(*str);
+            if (val > 0xFFFFU) {
+                return 0;  /* Overflow */
+            }
+            str++;
+        }
+        return (uint16_t)val;
+    }
+    
     while (*str >= '0' && *str <= '9') {
         val = val * 10U + (uint32_t)(*str - '0');
         if (val > 0xFFFFU) {
@@ -115,6 +179,25 @@ static const char* SkipToComma(const char *str)
     return NULL;
 }
 
+/**
+ * @brief Parse comma separated list "a,b,c" (decimal or 0x hex values)
+ * @param str Input string
+ * @param out Output values
+ * @param max_count Maximum number of values
+ * @return Number of values parsed
+ */
+static uint8_t ParseUInt16List(const char *str, uint16_t *out, uint8_t max_count)
+{
+    uint8_t count = 0;
+    
+    while (str != NULL && *str >= '0' && *str <= '9' && count < max_count) {
+        out[count++] = ParseUInt16(str);
+        str = SkipToComma(str);
+    }
+    
+    return count;
+}
+
 /**
  * @brief Parse hex nibble character to value
  * @return 0-15 if valid, 0xFF if invalid
@@ -172,6 +255,84 @@ static int ParseHexString(const char *hex_str, uint8_t *out_bytes, uint16_t max_
     return (int)i;
 }
 
+/**
+ * @brief Parse hex field "AABB..." ending at ',' or end of string
+ * @param end Set to the character after the field
+ * @return Number of bytes parsed, or -1 if error
+ */
+static int ParseHexField(const char *hex_str, uint8_t *out_bytes, uint16_t max_len,
+                         const char **end)
+{
+    uint16_t i = 0;
+    uint8_t hi, lo;
+    
+    while (hex_str[0] != '\0' && hex_str[0] != ',') {
+        if (i >= max_len) {
+            return -1;
+        }
+        hi = ParseHexNibble(hex_str[0]);
+        lo = ParseHexNibble(hex_str[1]);
+        if (hi == 0xFF || lo == 0xFF) {
+            return -1;  /* Invalid or unpaired hex character */
+        }
+        out_bytes[i++] = (hi << 4) | lo;
+        hex_str += 2;
+    }
+    
+    *end = hex_str;
+    return (int)i;
+}
+
+/**
+ * @brief Check for a UUID argument "U:2A37" or "U:6E400001-B5A3-..."
+ */
+static uint8_t IsUuidArg(const char *str)
+{
+    return (str != NULL && str[0] == 'U' && str[1] == ':') ? 1U : 0U;
+}
+
+/**
+ * @brief Parse UUID argument, up to the next comma
+ * @param str "U:" followed by 4 or 32 hex digits, dashes allowed
+ * @param key Output, little endian
+ * @return 0 on success, -1 on error
+ */
+static int ParseUuidArg(const char *str, BLE_GattUuidKey_t *key)
+{
+    uint8_t be[16];
+    uint8_t digits = 0;
+    uint8_t nibble;
+    uint8_t i;
+    
+    if (!IsUuidArg(str)) {
+        return -1;
+    }
+    str += 2;
+    
+    memset(be, 0, sizeof(be));
+    while (*str != '\0' && *str != ',') {
+        if (*str != '-') {
+            nibble = ParseHexNibble(*str);
+            if (nibble == 0xFFU || digits >= 32U) {
+                return -1;
+            }
+            be[digits / 2U] |= (uint8_t)((digits % 2U) ? nibble : (nibble << 4));
+            digits++;
+        }
+        str++;
+    }
+    if (digits != 4U && digits != 32U) {
+        return -1;
+    }
+    
+    /* Written big endian, sent little endian */
+    key->len = (uint8_t)(digits / 2U);
+    for (i = 0; i < key->len; i++) {
+        key->uuid[i] = be[key->len - 1U - i];
+    }
+    return 0;
+}
+
 /**
  * @brief Parse MAC string "AA:BB:CC:DD:EE:FF" to bytes
  * @note  Simple parser without sscanf for embedded efficiency
@@ -213,6 +374,14 @@ static int ParseMACString(const char *mac_str, uint8_t *mac_bytes)
     return 0;
 }
 
+/**
+ * @brief Timer callback (ISR context): check the binary block gap in the AT task
+ */
+static void AT_BinTimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_AT_CMD_PROC_ID, CFG_SCH_PRIO_HOST);
+}
+
 /*============================================================================
  * AT Command Initialization
  *============================================================================*/
@@ -222,6 +391,11 @@ void AT_Command_Init(void)
     at_cmd_ready = 0;
     at_garbage_count = 0;
     at_rx_tick = 0;
+    at_skip_lf = 0;
+    at_bin_left = 0;
+    at_bin_result = AT_BIN_NONE;
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &at_bin_timer_id, hw_ts_Repeated, AT_BinTimerCb);
+    at_bin_timer_on = 0;
     memset((void*)at_line_buf, 0, sizeof(at_line_buf));
     memset(at_cmd_buf, 0, sizeof(at_cmd_buf));
     DEBUG_INFO("AT Command initialized");
@@ -236,6 +410,31 @@ void AT_Command_ReceiveByte(uint8_t byte)
     /* Increment simple tick counter */
     at_rx_tick++;
     
+    if (at_skip_lf) {
+        at_skip_lf = 0;
+        if (byte == ASCII_LF) {
+            return;
+        }
+    }
+    
+    /* Binary block: no filtering, a gap over AT_RX_TIMEOUT_MS abandons it */
+    if (at_bin_left > 0U) {
+        uint32_t now = HAL_GetTick();
+        if ((now - at_bin_tick) <= AT_RX_TIMEOUT_MS) {
+            BLE_GattStream_PutByte(byte);
+            at_bin_tick = now;
+            at_bin_left--;
+            if (at_bin_left == 0U) {
+                at_bin_result = AT_BIN_DONE;
+                UTIL_SEQ_SetTask(1U << CFG_TASK_AT_CMD_PROC_ID, CFG_SCH_PRIO_HOST);
+            }
+            return;
+        }
+        at_bin_left = 0;
+        at_bin_result = AT_BIN_ABORTED;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_AT_CMD_PROC_ID, CFG_SCH_PRIO_HOST);
+    }
+    
     /* If previous command not processed yet, drop new bytes */
     if (at_cmd_ready) {
         return;
@@ -253,9 +452,11 @@ void AT_Command_ReceiveByte(uint8_t byte)
         if (at_line_idx >= 2U) {
             at_line_buf[at_line_idx] = '\0';
             at_cmd_ready = 1;
+            at_line_stamp = AT_CYCLES();
+            at_skip_lf = (byte == ASCII_CR) ? 1U : 0U;
             at_garbage_count = 0;
             at_rx_tick = 0;
-            UTIL_SEQ_SetTask(1U << CFG_TASK_AT_CMD_PROC_ID, CFG_SCH_PRIO_0);
+            UTIL_SEQ_SetTask(1U << CFG_TASK_AT_CMD_PROC_ID, CFG_SCH_PRIO_HOST);
         } else {
             at_line_idx = 0;
         }
@@ -284,12 +485,43 @@ void AT_Command_ReceiveByte(uint8_t byte)
  *============================================================================*/
 void AT_Command_ProcessReady(void)
 {
+    uint8_t bin_result;
+    uint32_t t0;
+    uint32_t wait;
+    uint32_t run;
+    
+    /* Finish a binary block before the next command; a host that stopped sending
+       hits the gap deadline here, not only when its next byte arrives */
+    __disable_irq();
+    if (at_bin_left > 0U && (HAL_GetTick() - at_bin_tick) > AT_RX_TIMEOUT_MS) {
+        at_bin_left = 0;
+        at_bin_result = AT_BIN_ABORTED;
+    }
+    bin_result = at_bin_result;
+    at_bin_result = AT_BIN_NONE;
+    __enable_irq();
+    
+    if (at_bin_left == 0U && at_bin_timer_on) {
+        HW_TS_Stop(at_bin_timer_id);
+        at_bin_timer_on = 0;
+    }
+    
+    if (bin_result == AT_BIN_DONE) {
+        BLE_GattStream_Commit();
+        AT_Response_Send("OK\r\n");
+    } else if (bin_result == AT_BIN_ABORTED) {
+        BLE_GattStream_Cancel();
+        AT_Response_Send("+ERROR:TIMEOUT\r\n");
+    }
+    
     if (!at_cmd_ready) {
         return;
     }
     
     /* Critical section: copy buffer then reset ISR state */
     __disable_irq();
+    t0 = AT_CYCLES();
+    wait = t0 - at_line_stamp;
     memcpy(at_cmd_buf, (const void*)at_line_buf, at_line_idx + 1);
     at_line_idx = 0;
     at_cmd_ready = 0;
@@ -297,6 +529,27 @@ void AT_Command_ProcessReady(void)
     
     /* Process command outside critical section */
     AT_Command_Process(at_cmd_buf);
+    run = AT_CYCLES() - t0;
+    
+    at_latency.commands++;
+    at_latency.wait_cycles += wait;
+    if (wait > at_latency.wait_max) {
+        at_latency.wait_max = wait;
+    }
+    at_latency.run_cycles += run;
+    if (run > at_latency.run_max) {
+        at_latency.run_max = run;
+    }
+}
+
+const AT_LatencyStats_t* AT_Command_GetLatency(void)
+{
+    return &at_latency;
+}
+
+void AT_Command_ClearLatency(void)
+{
+    memset(&at_latency, 0, sizeof(at_latency));
 }
 
 /*============================================================================
@@ -318,6 +571,12 @@ void AT_Response_Send(const char *fmt, ...)
     
     /* Send via UART - blocking */
     HAL_UART_Transmit(&hlpuart1, (uint8_t *)response_buf, len, 100);
+    at_tx_bytes += len;
+}
+
+uint32_t AT_Response_GetTxBytes(void)
+{
+    return at_tx_bytes;
 }
 
 /*============================================================================
@@ -401,8 +660,15 @@ void AT_Command_Process(const char *cmd_line)
     else if (strncmp(cmd, "AT+READ=", 8) == 0) {
         const char *p = &cmd[8];
         uint8_t idx = ParseUInt8(p);
+        BLE_GattUuidKey_t uuid;
         p = SkipToComma(p);
-        if (p != NULL && idx != 0xFFU) {
+        if (p != NULL && idx != 0xFFU && IsUuidArg(p)) {
+            if (ParseUuidArg(p, &uuid) == 0) {
+                AT_READUUID_Handler(idx, &uuid);
+            } else {
+                AT_Response_Send("+ERROR:INVALID_UUID\r\n");
+            }
+        } else if (p != NULL && idx != 0xFFU) {
             uint16_t handle = ParseUInt16(p);
             if (handle > 0) {
                 AT_READ_Handler(idx, handle);
@@ -413,11 +679,74 @@ void AT_Command_Process(const char *cmd_line)
             AT_Response_Send("ERROR\r\n");
         }
     }
-    else if (strncmp(cmd, "AT+WRITE=", 9) == 0) {
+    else if (strncmp(cmd, "AT+READMBENCH=", 14) == 0) {
+        const char *p = &cmd[14];
+        uint8_t idx = ParseUInt8(p);
+        uint16_t args[1U + GATT_READM_MAX_HANDLES];
+        uint8_t count;
+        p = SkipToComma(p);
+        count = ParseUInt16List(p, args, (uint8_t)(1U + GATT_READM_MAX_HANDLES));
+        if (idx != 0xFFU && count >= 2U && args[0] > 0U) {
+            AT_READMBENCH_Handler(idx, args[0], &args[1], (uint8_t)(count - 1U));
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+READM=", 9) == 0) {
         const char *p = &cmd[9];
         uint8_t idx = ParseUInt8(p);
+        uint16_t handles[GATT_READM_MAX_HANDLES];
+        uint8_t count;
+        p = SkipToComma(p);
+        count = ParseUInt16List(p, handles, GATT_READM_MAX_HANDLES);
+        if (idx != 0xFFU && count > 0U) {
+            AT_READM_Handler(idx, handles, count);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+READLONG=", 12) == 0) {
+        const char *p = &cmd[12];
+        uint8_t idx = ParseUInt8(p);
+        p = SkipToComma(p);
+        if (p != NULL && idx != 0xFFU) {
+            uint16_t handle = ParseUInt16(p);
+            if (handle > 0) {
+                AT_READLONG_Handler(idx, handle);
+            } else {
+                AT_Response_Send("ERROR\r\n");
+            }
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+WRITEREL=", 12) == 0) {
+        const char *p = &cmd[12];
+        uint8_t idx = ParseUInt8(p);
         p = SkipToComma(p);
         if (p != NULL && idx != 0xFFU) {
+            AT_WRITEREL_Handler(idx, p);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+WRITE=", 9) == 0) {
+        const char *p = &cmd[9];
+        uint8_t idx = ParseUInt8(p);
+        BLE_GattUuidKey_t uuid;
+        p = SkipToComma(p);
+        if (p != NULL && idx != 0xFFU && IsUuidArg(p)) {
+            if (ParseUuidArg(p, &uuid) != 0) {
+                AT_Response_Send("+ERROR:INVALID_UUID\r\n");
+            } else {
+                p = SkipToComma(p);
+                if (p != NULL && *p != '\0') {
+                    AT_WRITEUUID_Handler(idx, &uuid, p);
+                } else {
+                    AT_Response_Send("ERROR\r\n");
+                }
+            }
+        } else if (p != NULL && idx != 0xFFU) {
             uint16_t handle = ParseUInt16(p);
             p = SkipToComma(p);
             if (p != NULL && handle > 0 && *p != '\0') {
@@ -429,11 +758,81 @@ void AT_Command_Process(const char *cmd_line)
             AT_Response_Send("ERROR\r\n");
         }
     }
+    else if (strncmp(cmd, "AT+WRITENR=", 11) == 0) {
+        const char *p = &cmd[11];
+        uint8_t idx = ParseUInt8(p);
+        p = SkipToComma(p);
+        if (p != NULL && idx != 0xFFU) {
+            uint16_t handle = ParseUInt16(p);
+            p = SkipToComma(p);
+            if (p != NULL && handle > 0 && *p != '\0') {
+                AT_WRITENR_Handler(idx, handle, p);
+            } else {
+                AT_Response_Send("ERROR\r\n");
+            }
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+WRITEBIN=", 12) == 0) {
+        const char *p = &cmd[12];
+        uint8_t idx = ParseUInt8(p);
+        uint16_t args[2];
+        p = SkipToComma(p);
+        if (p != NULL && idx != 0xFFU && ParseUInt16List(p, args, 2) == 2U &&
+            args[0] > 0 && args[1] > 0) {
+            AT_WRITEBIN_Handler(idx, args[0], args[1]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+STREAM?") == 0) {
+        AT_STREAM_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+IND?") == 0) {
+        AT_IND_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+INDACK=", 10) == 0) {
+        uint8_t idx = ParseUInt8(&cmd[10]);
+        if (idx != 0xFFU) {
+            AT_INDACK_Handler(idx);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+IND=", 7) == 0) {
+        uint8_t mode = ParseUInt8(&cmd[7]);
+        if (mode <= (uint8_t)GATT_IND_CONFIRM_HOST) {
+            BLE_GattInd_SetMode((BLE_GattIndMode_t)mode);
+            AT_Response_Send("OK\r\n");
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+UUIDCACHE?") == 0) {
+        const BLE_GattResolveStats_t *rs = BLE_GattResolve_GetStats();
+        AT_Response_Send("+UUIDCACHE:%d,%d,%lu,%lu,%lu,%lu\r\n", rs->entries,
+                         GATT_RESOLVE_CACHE_SIZE, (unsigned long)rs->cache_hits,
+                         (unsigned long)rs->db_hits, (unsigned long)rs->lookups,
+                         (unsigned long)rs->evictions);
+        AT_Response_Send("OK\r\n");
+    }
     else if (strncmp(cmd, "AT+NOTIFY=", 10) == 0) {
         const char *p = &cmd[10];
         uint8_t idx = ParseUInt8(p);
+        BLE_GattUuidKey_t uuid;
         p = SkipToComma(p);
-        if (p != NULL && idx != 0xFFU) {
+        if (p != NULL && idx != 0xFFU && IsUuidArg(p)) {
+            const char *q = SkipToComma(p);
+            uint8_t enable = (q != NULL) ? ParseUInt8(q) : 0xFFU;
+            if (ParseUuidArg(p, &uuid) != 0) {
+                AT_Response_Send("+ERROR:INVALID_UUID\r\n");
+            } else if (enable != 0xFFU) {
+                AT_NOTIFYUUID_Handler(idx, &uuid, enable);
+            } else {
+                AT_Response_Send("ERROR\r\n");
+            }
+        } else if (p != NULL && idx != 0xFFU) {
             uint16_t handle = ParseUInt16(p);
             p = SkipToComma(p);
             if (p != NULL && handle > 0) {
@@ -458,6 +857,14 @@ void AT_Command_Process(const char *cmd_line)
             AT_Response_Send("ERROR\r\n");
         }
     }
+    else if (strncmp(cmd, "AT+DB=", 6) == 0) {
+        uint8_t idx = ParseUInt8(&cmd[6]);
+        if (idx != 0xFFU) {
+            AT_DB_Handler(idx);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
     else if (strncmp(cmd, "AT+INFO=", 8) == 0) {
         uint8_t idx = ParseUInt8(&cmd[8]);
         if (idx != 0xFFU) {
@@ -466,74 +873,334 @@ void AT_Command_Process(const char *cmd_line)
             AT_Response_Send("ERROR\r\n");
         }
     }
-    else {
-        /* Unknown AT command - log but don't spam ERROR */
-        DEBUG_WARN("Unknown AT cmd: %s", cmd);
+    else if (strcmp(cmd, "AT+CONNPARAM?") == 0) {
+        BLE_ConnParams_t params;
+        BLE_Connection_GetDefaultParams(&params);
+        AT_Response_Send("+CONNPARAM:%d,%d,%d,%d\r\n", params.interval_min,
+                         params.interval_max, params.latency, params.supervision_timeout);
+        AT_Response_Send("OK\r\n");
     }
-}
-
-// ==================== AT Handlers ====================
-
-int AT_SCAN_Handler(uint16_t duration_ms)
-{
-    int ret;
-    
-    DEBUG_INFO("AT+SCAN: duration=%dms", duration_ms);
-    
-    ret = BLE_Connection_StartScan(duration_ms);
-    if (ret != 0) {
-        AT_Response_Send("ERROR\r\n");
-        return -1;
+    else if (strncmp(cmd, "AT+CONNPARAM=", 13) == 0) {
+        uint16_t args[5];
+        uint8_t count = ParseUInt16List(&cmd[13], args, 5);
+        if (count == 4U) {
+            /* Defaults for new connections */
+            AT_CONNPARAM_Handler(0xFFU, args);
+        } else if (count == 5U && args[0] <= 0xFFU) {
+            /* Live update of a connected device */
+            AT_CONNPARAM_Handler((uint8_t)args[0], &args[1]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
     }
-    
-    AT_Response_Send("OK\r\n");
-    return 0;
-}
-
-int AT_CONNECT_Handler(const char *mac_str)
-{
-    uint8_t mac[6];
-    int dev_idx;
-    int ret;
-    
-    if (ParseMACString(mac_str, mac) != 0) {
-        AT_Response_Send("ERROR\r\n");
-        return -1;
+    else if (strncmp(cmd, "AT+CONNPOLICY=", 14) == 0) {
+        uint16_t args[2];
+        if (ParseUInt16List(&cmd[14], args, 2) == 2U && args[0] <= 0xFFU &&
+            args[1] <= (uint16_t)CONN_UPDATE_POLICY_RANGE) {
+            AT_CONNPOLICY_Handler((uint8_t)args[0], (uint8_t)args[1]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
     }
-    
-    /* Device must be discovered first via scan */
-    dev_idx = BLE_DeviceManager_FindDevice(mac);
-    if (dev_idx < 0) {
-        AT_Response_Send("+ERROR:NOT_FOUND\r\n");
-        return -1;
+    else if (strncmp(cmd, "AT+NEGO=", 8) == 0) {
+        uint16_t args[2];
+        if (ParseUInt16List(&cmd[8], args, 2) == 2U && args[0] <= 0xFFU &&
+            args[1] <= (uint16_t)BLE_NEGO_ALL) {
+            AT_NEGO_Handler((uint8_t)args[0], (uint8_t)args[1]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
     }
-    
-    DEBUG_INFO("AT+CONNECT: device %d", dev_idx);
-    
-    ret = BLE_Connection_CreateConnection(mac);
-    if (ret != 0) {
-        AT_Response_Send("ERROR\r\n");
-        return -1;
+    else if (strcmp(cmd, "AT+ADAPT?") == 0) {
+        AT_ADAPT_Query_Handler();
     }
-    
-    /* OK sent immediately, +CONNECTED will follow after HCI event */
-    AT_Response_Send("OK\r\n");
-    return 0;
-}
-
-int AT_DISCONNECT_Handler(uint8_t dev_idx)
-{
-    BLE_Device_t *dev;
-    int ret;
-    
-    dev = BLE_DeviceManager_GetDevice(dev_idx);
-    if (dev == NULL || !dev->is_connected) {
-        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
-        return -1;
+    else if (strncmp(cmd, "AT+ADAPT=", 9) == 0) {
+        uint16_t args[4];
+        uint8_t count = ParseUInt16List(&cmd[9], args, 4);
+        if ((count == 1U || count == 4U) && args[0] <= 1U) {
+            AT_ADAPT_Handler((uint8_t)args[0], (count == 4U) ? &args[1] : NULL);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
     }
-    
-    DEBUG_INFO("AT+DISCONNECT: device %d, hdl=0x%04X", dev_idx, dev->conn_handle);
-    
+    else if (strcmp(cmd, "AT+LINKMON?") == 0) {
+        AT_LINKMON_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+LINKMON=", 11) == 0) {
+        /* AT+LINKMON=<enable>,<period_ms>[,<warn_dbm>], warn given as positive dB */
+        uint16_t args[3];
+        uint8_t count = ParseUInt16List(&cmd[11], args, 3);
+        if ((count == 2U || count == 3U) && args[0] <= 1U && (count == 2U || args[2] <= 127U)) {
+            AT_LINKMON_Handler((uint8_t)args[0], args[1],
+                               (count == 3U) ? (int8_t)(-(int16_t)args[2]) : LINK_MON_DEFAULT_WARN_DBM);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+GATTQ?") == 0) {
+        AT_GATTQ_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+GATTQ=", 9) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[9], args, 1) == 1U) {
+            AT_GATTQ_Handler(args[0]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+GATTCACHE?") == 0) {
+        AT_GATTCACHE_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+GATTCACHE=CLEAR") == 0) {
+        AT_GATTCACHE_Clear_Handler();
+    }
+    else if (strncmp(cmd, "AT+GATTCACHE=", 13) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[13], args, 1) == 1U && args[0] <= 1U) {
+            AT_GATTCACHE_Handler((uint8_t)args[0]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+NOTIFYPOL?") == 0) {
+        AT_NOTIFYPOL_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+NOTIFYPOL=", 13) == 0) {
+        uint16_t args[6] = { 0, 0, 0, 0, 0, 0 };
+        uint8_t count = ParseUInt16List(&cmd[13], args, 6);
+        if ((count == 3U || count == 4U || count == 6U) && args[0] <= 0xFFU &&
+            args[2] < (uint16_t)GATT_SUB_POLICY_COUNT && args[4] < (uint16_t)GATT_SUB_FMT_COUNT &&
+            args[5] <= 0xFFU) {
+            AT_NOTIFYPOL_Handler((uint8_t)args[0], args[1], (uint8_t)args[2], args[3],
+                                 (uint8_t)args[4], (uint8_t)args[5]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+COC?") == 0) {
+        AT_COC_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+COCOPEN=", 11) == 0) {
+        uint16_t args[2];
+        if (ParseUInt16List(&cmd[11], args, 2) == 2U && args[0] <= 0xFFU && args[1] > 0U) {
+            AT_COCOPEN_Handler((uint8_t)args[0], args[1]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+COCLISTEN=", 13) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[13], args, 1) == 1U) {
+            BLE_L2capCoc_SetListen(args[0]);
+            AT_Response_Send("OK\r\n");
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+COCCLOSE=", 12) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[12], args, 1) == 1U && args[0] <= 0xFFU &&
+            BLE_L2capCoc_Close((uint8_t)args[0]) == 0) {
+            AT_Response_Send("OK\r\n");
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+COCSEND=", 11) == 0) {
+        const char *p = &cmd[11];
+        uint8_t ch = ParseUInt8(p);
+        p = SkipToComma(p);
+        if (p != NULL && ch != 0xFFU) {
+            AT_COCSEND_Handler(ch, p);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strncmp(cmd, "AT+COCTEST=", 11) == 0) {
+        uint16_t args[2];
+        /* Test size in KiB */
+        if (ParseUInt16List(&cmd[11], args, 2) == 2U && args[0] <= 0xFFU && args[1] > 0U &&
+            BLE_L2capCoc_StartTest((uint8_t)args[0], (uint32_t)args[1] * 1024U) == 0) {
+            AT_Response_Send("OK\r\n");
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+SUBS?") == 0) {
+        AT_SUBS_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+SUBS=CLEAR") == 0) {
+        AT_SUBS_Clear_Handler();
+    }
+    else if (strncmp(cmd, "AT+SUBS=", 8) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[8], args, 1) == 1U && args[0] <= 1U) {
+            AT_SUBS_Handler((uint8_t)args[0]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+EVTSTAT?") == 0) {
+        AT_EVTSTAT_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+EVTSTAT=CLEAR") == 0) {
+        AT_EVTSTAT_Clear_Handler();
+    }
+    else if (strcmp(cmd, "AT+GATTSRV?") == 0) {
+        AT_GATTSRV_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+TLSTAT?") == 0) {
+        AT_TLSTAT_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+TLSTAT=CLEAR") == 0) {
+        AT_TLSTAT_Clear_Handler();
+    }
+    else if (strncmp(cmd, "AT+EVTDEFER=", 12) == 0) {
+        uint16_t args[1];
+        if (ParseUInt16List(&cmd[12], args, 1) == 1U && args[0] <= 1U) {
+            AT_EVTDEFER_Handler((uint8_t)args[0]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+EVTBUS?") == 0) {
+        AT_EVTBUS_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+EVTBUS=CLEAR") == 0) {
+        AT_EVTBUS_Clear_Handler();
+    }
+    else if (strncmp(cmd, "AT+EVTBUS=", 10) == 0) {
+        uint16_t args[3];
+        if (ParseUInt16List(&cmd[10], args, 3) == 3U && args[0] <= 0xFFU) {
+            AT_EVTBUS_Handler((uint8_t)args[0], args[1], args[2]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+HCITRACE?") == 0) {
+        AT_HCITRACE_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+HCITRACE=CLEAR") == 0) {
+        AT_HCITRACE_Clear_Handler();
+    }
+    else if (strncmp(cmd, "AT+HCITRACE=", 12) == 0) {
+        uint16_t args[3] = { 0, HCITRACE_F_DEFAULT, HCITRACE_SNAPLEN_DEFAULT };
+        if (ParseUInt16List(&cmd[12], args, 3) >= 1U && args[0] <= HCITRACE_MODE_LIVE &&
+            args[1] <= 0xFFU) {
+            AT_HCITRACE_Handler((uint8_t)args[0], (uint8_t)args[1], args[2]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+HCIDUMP") == 0) {
+        AT_HCIDUMP_Handler();
+    }
+    else if (strcmp(cmd, "AT+ATLAT?") == 0) {
+        AT_ATLAT_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+ATLAT=CLEAR") == 0) {
+        AT_ATLAT_Clear_Handler();
+    }
+    else if (strcmp(cmd, "AT+ADVSTORM?") == 0) {
+        AT_ADVSTORM_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+ADVSTORM=STOP") == 0) {
+        AT_ADVSTORM_Stop_Handler();
+    }
+    else if (strncmp(cmd, "AT+ADVSTORM=", 12) == 0) {
+        /* AT+ADVSTORM=<devices>,<rate>,<batch>,<count>[,<ad_len>] */
+        uint16_t args[5] = { 0, 0, 0, 0, ADVSTORM_AD_DEFAULT };
+        if (ParseUInt16List(&cmd[12], args, 5) >= 4U && args[2] <= 0xFFU && args[4] <= 0xFFU) {
+            AT_ADVSTORM_Handler(args[0], args[1], (uint8_t)args[2], args[3], (uint8_t)args[4]);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else if (strcmp(cmd, "AT+SEQSTAT?") == 0) {
+        AT_SEQSTAT_Query_Handler();
+    }
+    else if (strcmp(cmd, "AT+SEQSTAT=CLEAR") == 0) {
+        AT_SEQSTAT_Clear_Handler();
+    }
+    else if (strcmp(cmd, "AT+SEQREPORT?") == 0) {
+        AT_SEQREPORT_Query_Handler();
+    }
+    else if (strncmp(cmd, "AT+SEQREPORT=", 13) == 0) {
+        uint16_t period_ms;
+        if (ParseUInt16List(&cmd[13], &period_ms, 1) == 1U) {
+            AT_SEQREPORT_Handler(period_ms);
+        } else {
+            AT_Response_Send("ERROR\r\n");
+        }
+    }
+    else {
+        /* Unknown AT command - log but don't spam ERROR */
+        DEBUG_WARN("Unknown AT cmd: %s", cmd);
+    }
+}
+
+// ==================== AT Handlers ====================
+
+int AT_SCAN_Handler(uint16_t duration_ms)
+{
+    int ret;
+    
+    DEBUG_INFO("AT+SCAN: duration=%dms", duration_ms);
+    
+    ret = BLE_Connection_StartScan(duration_ms);
+    if (ret != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_CONNECT_Handler(const char *mac_str)
+{
+    uint8_t mac[6];
+    int dev_idx;
+    int ret;
+    
+    if (ParseMACString(mac_str, mac) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* Device must be discovered first via scan */
+    dev_idx = BLE_DeviceManager_FindDevice(mac);
+    if (dev_idx < 0) {
+        AT_Response_Send("+ERROR:NOT_FOUND\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+CONNECT: device %d", dev_idx);
+    
+    ret = BLE_Connection_CreateConnection(mac);
+    if (ret != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* OK sent immediately, +CONNECTED will follow after HCI event */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_DISCONNECT_Handler(uint8_t dev_idx)
+{
+    BLE_Device_t *dev;
+    int ret;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+DISCONNECT: device %d, hdl=0x%04X", dev_idx, dev->conn_handle);
+    
     ret = BLE_Connection_TerminateConnection(dev->conn_handle);
     if (ret != 0) {
         AT_Response_Send("ERROR\r\n");
@@ -597,14 +1264,9 @@ int AT_READ_Handler(uint8_t dev_idx, uint16_t char_handle)
     return 0;
 }
 
-#define AT_WRITE_MAX_DATA_LEN  64U
-
-int AT_WRITE_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data)
+int AT_READUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid)
 {
     BLE_Device_t *dev;
-    uint8_t write_buf[AT_WRITE_MAX_DATA_LEN];
-    int data_len;
-    int ret;
     
     dev = BLE_DeviceManager_GetDevice(dev_idx);
     if (dev == NULL || !dev->is_connected) {
@@ -612,35 +1274,52 @@ int AT_WRITE_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data)
         return -1;
     }
     
-    if (data == NULL || data[0] == '\0') {
-        AT_Response_Send("+ERROR:NO_DATA\r\n");
+    DEBUG_INFO("AT+READ: dev=%d, uuid len=%d", dev_idx, uuid->len);
+    
+    if (BLE_GattQueue_ReadUuid(dev->conn_handle, uuid) != 0) {
+        AT_Response_Send("ERROR\r\n");
         return -1;
     }
     
-    /* Parse hex string to bytes */
-    data_len = ParseHexString(data, write_buf, AT_WRITE_MAX_DATA_LEN);
-    if (data_len <= 0) {
-        AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+    /* OK sent immediately, +READ carries the resolved handle */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_READM_Handler(uint8_t dev_idx, const uint16_t *handles, uint8_t count)
+{
+    BLE_Device_t *dev;
+    uint8_t i;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
         return -1;
     }
     
-    DEBUG_INFO("AT+WRITE: dev=%d, handle=0x%04X, len=%d", dev_idx, char_handle, data_len);
+    for (i = 0; i < count; i++) {
+        if (handles[i] == 0U) {
+            AT_Response_Send("ERROR\r\n");
+            return -1;
+        }
+    }
     
-    ret = BLE_GATT_WriteCharacteristic(dev->conn_handle, char_handle, write_buf, (uint16_t)data_len);
-    if (ret != 0) {
+    DEBUG_INFO("AT+READM: dev=%d, handles=%d", dev_idx, count);
+    
+    if (BLE_GattQueue_ReadMulti(dev->conn_handle, handles, count, 0) != 0) {
         AT_Response_Send("ERROR\r\n");
         return -1;
     }
     
-    /* OK sent immediately, +WRITE response will follow after GATT proc complete */
+    /* OK sent immediately, one +READM line follows */
     AT_Response_Send("OK\r\n");
     return 0;
 }
 
-int AT_NOTIFY_Handler(uint8_t dev_idx, uint16_t desc_handle, uint8_t enable)
+int AT_READMBENCH_Handler(uint8_t dev_idx, uint16_t rounds, const uint16_t *handles,
+                          uint8_t count)
 {
     BLE_Device_t *dev;
-    int ret;
     
     dev = BLE_DeviceManager_GetDevice(dev_idx);
     if (dev == NULL || !dev->is_connected) {
@@ -648,26 +1327,49 @@ int AT_NOTIFY_Handler(uint8_t dev_idx, uint16_t desc_handle, uint8_t enable)
         return -1;
     }
     
-    DEBUG_INFO("AT+NOTIFY: dev=%d, handle=0x%04X, enable=%d", dev_idx, desc_handle, enable);
+    DEBUG_INFO("AT+READMBENCH: dev=%d, rounds=%d, handles=%d", dev_idx, rounds, count);
     
-    if (enable) {
-        ret = BLE_GATT_EnableNotification(dev->conn_handle, desc_handle);
-    } else {
-        ret = BLE_GATT_DisableNotification(dev->conn_handle, desc_handle);
+    if (BLE_GattReadM_Bench(dev->conn_handle, handles, count, rounds) != 0) {
+        AT_Response_Send("+ERROR:BUSY\r\n");
+        return -1;
     }
     
-    if (ret != 0) {
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_READLONG_Handler(uint8_t dev_idx, uint16_t char_handle)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+READLONG: dev=%d, handle=0x%04X", dev_idx, char_handle);
+    
+    if (BLE_GATT_ReadLongCharacteristic(dev->conn_handle, char_handle) != 0) {
         AT_Response_Send("ERROR\r\n");
         return -1;
     }
     
+    /* OK sent immediately, +READ follows once all parts arrived */
     AT_Response_Send("OK\r\n");
     return 0;
 }
 
-int AT_DISC_Handler(uint8_t dev_idx)
+#define AT_WRITE_MAX_DATA_LEN  GATT_LONG_MAX_LEN
+#define AT_WRITEREL_MAX_ATTRS  8U
+
+/* Parsed write data (too large for the stack frame) */
+static uint8_t write_buf[AT_WRITE_MAX_DATA_LEN];
+
+int AT_WRITE_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data)
 {
     BLE_Device_t *dev;
+    int data_len;
     int ret;
     
     dev = BLE_DeviceManager_GetDevice(dev_idx);
@@ -676,32 +1378,1121 @@ int AT_DISC_Handler(uint8_t dev_idx)
         return -1;
     }
     
-    DEBUG_INFO("AT+DISC: dev=%d, hdl=0x%04X", dev_idx, dev->conn_handle);
+    if (data == NULL || data[0] == '\0') {
+        AT_Response_Send("+ERROR:NO_DATA\r\n");
+        return -1;
+    }
+    
+    /* Parse hex string to bytes */
+    data_len = ParseHexString(data, write_buf, AT_WRITE_MAX_DATA_LEN);
+    if (data_len <= 0) {
+        AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+WRITE: dev=%d, handle=0x%04X, len=%d", dev_idx, char_handle, data_len);
     
-    /* Start service discovery - results will come async via GATT events */
-    ret = BLE_GATT_DiscoverAllServices(dev->conn_handle);
+    ret = BLE_GATT_WriteCharacteristic(dev->conn_handle, char_handle, write_buf, (uint16_t)data_len);
     if (ret != 0) {
         AT_Response_Send("ERROR\r\n");
         return -1;
     }
     
-    /* OK sent immediately, +SERVICE responses will follow after GATT events */
+    /* OK sent immediately, +WRITE response will follow after GATT proc complete */
     AT_Response_Send("OK\r\n");
     return 0;
 }
 
-int AT_INFO_Handler(uint8_t dev_idx)
+int AT_WRITEUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid, const char *data)
 {
-    BLE_Device_t *dev = BLE_DeviceManager_GetDevice(dev_idx);
-    if (!dev) {
+    BLE_Device_t *dev;
+    int data_len;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    data_len = ParseHexString(data, write_buf, AT_WRITE_MAX_DATA_LEN);
+    if (data_len <= 0) {
+        AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+WRITE: dev=%d, uuid len=%d, len=%d", dev_idx, uuid->len, data_len);
+    
+    if (BLE_GattQueue_WriteUuid(dev->conn_handle, uuid, write_buf, (uint16_t)data_len) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_WRITEREL_Handler(uint8_t dev_idx, const char *args)
+{
+    BLE_Device_t *dev;
+    BLE_GattWriteEntry_t entries[AT_WRITEREL_MAX_ATTRS];
+    const char *p = args;
+    uint16_t used = 0;
+    uint8_t count = 0;
+    int data_len;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    /* handle,hex pairs */
+    while (p != NULL && *p != '\0') {
+        if (count >= AT_WRITEREL_MAX_ATTRS) {
+            AT_Response_Send("ERROR\r\n");
+            return -1;
+        }
+        entries[count].handle = ParseUInt16(p);
+        p = SkipToComma(p);
+        if (entries[count].handle == 0U || p == NULL) {
+            AT_Response_Send("ERROR\r\n");
+            return -1;
+        }
+        data_len = ParseHexField(p, &write_buf[used], (uint16_t)(AT_WRITE_MAX_DATA_LEN - used), &p);
+        if (data_len <= 0) {
+            AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+            return -1;
+        }
+        entries[count].data = &write_buf[used];
+        entries[count].len = (uint16_t)data_len;
+        used += (uint16_t)data_len;
+        count++;
+        p = SkipToComma(p);
+    }
+    
+    if (count == 0U) {
+        AT_Response_Send("+ERROR:NO_DATA\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+WRITEREL: dev=%d, attributes=%d, len=%d", dev_idx, count, used);
+    
+    if (BLE_GATT_WriteReliable(dev->conn_handle, entries, count) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* OK sent immediately, one +WRITE_DONE / +WRITE_ERROR for the whole set */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_WRITENR_Handler(uint8_t dev_idx, uint16_t char_handle, const char *data)
+{
+    BLE_Device_t *dev;
+    int data_len;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    data_len = ParseHexString(data, write_buf, AT_WRITE_MAX_DATA_LEN);
+    if (data_len <= 0) {
+        AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+        return -1;
+    }
+    
+    if (BLE_GattStream_Write(dev->conn_handle, char_handle, write_buf, (uint16_t)data_len) != 0) {
+        AT_Response_Send("+ERROR:BUSY\r\n");
+        return -1;
+    }
+    
+    /* OK = accepted into the stream buffer, +STREAM_DONE follows */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_WRITEBIN_Handler(uint8_t dev_idx, uint16_t char_handle, uint16_t len)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    if (BLE_GattStream_Reserve(dev->conn_handle, char_handle, len) != 0) {
+        AT_Response_Send("+ERROR:BUSY\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+WRITEBIN: dev=%d, handle=0x%04X, len=%d", dev_idx, char_handle, len);
+    
+    /* Arm raw capture before the prompt: the host sends data after '>' */
+    __disable_irq();
+    at_bin_tick = HAL_GetTick();
+    at_bin_left = len;
+    __enable_irq();
+    if (!at_bin_timer_on) {
+        HW_TS_Start(at_bin_timer_id, AT_MS_TO_TICKS(AT_BIN_TICK_MS));
+        at_bin_timer_on = 1;
+    }
+    
+    AT_Response_Send(">\r\n");
+    
+    /* The LF of a CR LF command has arrived by the end of the blocking prompt; after
+       it, an LF is payload (a bare CR command would otherwise lose a leading 0x0A) */
+    __disable_irq();
+    at_skip_lf = 0;
+    __enable_irq();
+    return 0;
+}
+
+int AT_STREAM_Query_Handler(void)
+{
+    const BLE_GattStreamStats_t *s;
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+    
+    AT_Response_Send("+STREAM:%d,%d\r\n", BLE_GattStream_GetFree(), GATT_STREAM_BUF_SIZE);
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF) {
+            continue;
+        }
+        s = BLE_GattStream_GetStats(link->conn_handle);
+        if (s == NULL) {
+            continue;
+        }
+        AT_Response_Send("+STREAMS:0x%04X,%lu,%lu,%lu,%lu,%lu\r\n", s->conn_handle,
+                         (unsigned long)s->bytes, (unsigned long)s->packets,
+                         (unsigned long)s->stalls, (unsigned long)s->errors,
+                         (unsigned long)s->last_kbps);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_INDACK_Handler(uint8_t dev_idx)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    if (BLE_GattInd_Ack(dev->conn_handle) != 0) {
+        AT_Response_Send("+ERROR:NO_PENDING\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_IND_Query_Handler(void)
+{
+    const BLE_GattIndStats_t *s;
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+    
+    AT_Response_Send("+IND:%d\r\n", BLE_GattInd_GetMode());
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF) {
+            continue;
+        }
+        s = BLE_GattInd_GetStats(link->conn_handle);
+        if (s == NULL) {
+            continue;
+        }
+        AT_Response_Send("+INDS:0x%04X,%lu,%lu,%lu,%lu,%lu,%d,%lu\r\n", s->conn_handle,
+                         (unsigned long)s->received, (unsigned long)s->confirmed,
+                         (unsigned long)s->errors,
+                         (unsigned long)((s->confirmed > 0U) ? s->total_ms / s->confirmed : 0U),
+                         (unsigned long)s->max_ms, s->pending, (unsigned long)s->timeouts);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_NOTIFY_Handler(uint8_t dev_idx, uint16_t desc_handle, uint8_t enable)
+{
+    BLE_Device_t *dev;
+    int ret;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    if (enable > 2U) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+NOTIFY: dev=%d, handle=0x%04X, enable=%d", dev_idx, desc_handle, enable);
+    
+    if (enable == 2U) {
+        ret = BLE_GATT_EnableIndication(dev->conn_handle, desc_handle);
+    } else if (enable) {
+        ret = BLE_GATT_EnableNotification(dev->conn_handle, desc_handle);
+    } else {
+        ret = BLE_GATT_DisableNotification(dev->conn_handle, desc_handle);
+    }
+    
+    if (ret != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_NOTIFYUUID_Handler(uint8_t dev_idx, const BLE_GattUuidKey_t *uuid, uint8_t enable)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    if (enable > 2U) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+NOTIFY: dev=%d, uuid len=%d, enable=%d", dev_idx, uuid->len, enable);
+    
+    /* 0, 1 and 2 are the CCCD values; the CCCD is looked up next to the value */
+    if (BLE_GattQueue_WriteCccdUuid(dev->conn_handle, uuid, enable) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_DISC_Handler(uint8_t dev_idx)
+{
+    BLE_Device_t *dev;
+    int ret;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+DISC: dev=%d, hdl=0x%04X", dev_idx, dev->conn_handle);
+    
+    /* Queue full discovery - results will come async via GATT events */
+    ret = BLE_GattQueue_Discover(dev->conn_handle);
+    if (ret != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* OK sent immediately, +SERVICE/+CHAR/+DISC_DONE will follow after GATT events */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_DB_Handler(uint8_t dev_idx)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+DB: dev=%d, hdl=0x%04X", dev_idx, dev->conn_handle);
+    
+    /* Replay stored table, no ATT traffic */
+    if (BLE_GattDisc_Dump(dev->conn_handle) < 0) {
+        AT_Response_Send("+ERROR:NOT_DISCOVERED\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_INFO_Handler(uint8_t dev_idx)
+{
+    BLE_Device_t *dev = BLE_DeviceManager_GetDevice(dev_idx);
+    BLE_ConnectionInfo_t *link;
+    if (!dev) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+INFO: dev=%d", dev_idx);
+    AT_Response_Send("+INFO:%02X:%02X:%02X:%02X:%02X:%02X\r\n",
+                   dev->mac_addr[5], dev->mac_addr[4], dev->mac_addr[3],
+                   dev->mac_addr[2], dev->mac_addr[1], dev->mac_addr[0]);
+    
+    link = dev->is_connected ? BLE_Connection_GetInfo(dev->conn_handle) : NULL;
+    if (link != NULL) {
+        AT_Response_Send("+LINK:0x%04X,%d,%d,%d,%d,%d,%d,%d,%d,%02X\r\n",
+                         link->conn_handle, link->conn_interval, link->conn_latency,
+                         link->supervision_timeout, link->att_mtu,
+                         link->max_tx_octets, link->max_rx_octets,
+                         link->tx_phy, link->rx_phy, link->nego_pending);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ADAPT_Handler(uint8_t enable, const uint16_t *bounds)
+{
+    BLE_LinkAdaptBounds_t new_bounds;
+    
+    DEBUG_INFO("AT+ADAPT: enable=%d", enable);
+    
+    if (bounds != NULL) {
+        new_bounds.interval_min = bounds[0];
+        new_bounds.interval_max = bounds[1];
+        new_bounds.latency_max = bounds[2];
+        if (BLE_LinkAdapt_SetBounds(&new_bounds) != 0) {
+            AT_Response_Send("ERROR\r\n");
+            return -1;
+        }
+    }
+    
+    BLE_LinkAdapt_Enable(enable);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ADAPT_Query_Handler(void)
+{
+    static const char class_chars[] = { 'N', 'S', 'I' };
+    BLE_LinkAdaptBounds_t bounds;
+    const BLE_LinkAdaptInfo_t *state;
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+    
+    BLE_LinkAdapt_GetBounds(&bounds);
+    AT_Response_Send("+ADAPT:%d,%d,%d,%d\r\n", BLE_LinkAdapt_IsEnabled(),
+                     bounds.interval_min, bounds.interval_max, bounds.latency_max);
+    
+    /* One line per active link: class, rate (pkt/s * 10), bytes/s, params, airtime */
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF) {
+            continue;
+        }
+        state = BLE_LinkAdapt_GetInfo(link->conn_handle);
+        if (state == NULL) {
+            continue;
+        }
+        AT_Response_Send("+AIRTIME:0x%04X,%c,%d,%d,%d,%d,%lu\r\n",
+                         link->conn_handle, class_chars[state->link_class],
+                         state->rate_x10, state->byte_rate,
+                         link->conn_interval, link->conn_latency,
+                         (unsigned long)state->airtime_us);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_LINKMON_Handler(uint8_t enable, uint16_t period_ms, int8_t warn_dbm)
+{
+    DEBUG_INFO("AT+LINKMON: enable=%d, period=%d, warn=%d", enable, period_ms, warn_dbm);
+    
+    if (BLE_LinkMonitor_Config(enable, period_ms, warn_dbm) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_LINKMON_Query_Handler(void)
+{
+    const BLE_LinkQuality_t *q;
+    BLE_ConnectionInfo_t *link;
+    uint8_t enable;
+    uint16_t period_ms;
+    int8_t warn_dbm;
+    uint8_t i;
+    
+    BLE_LinkMonitor_GetConfig(&enable, &period_ms, &warn_dbm);
+    AT_Response_Send("+LINKMON:%d,%d,%d\r\n", enable, period_ms, warn_dbm);
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF) {
+            continue;
+        }
+        q = BLE_LinkMonitor_GetInfo(link->conn_handle);
+        if (q == NULL) {
+            continue;
+        }
+        AT_Response_Send("+LINKQ:0x%04X,%d,%d,%d,%d,%d,%d\r\n",
+                         q->conn_handle, q->rssi_last, q->rssi_ewma_x16 / 16,
+                         q->rssi_min, q->rssi_max,
+                         BLE_LinkMonitor_Trend(q) / 16, q->samples);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTQ_Handler(uint16_t timeout_ms)
+{
+    DEBUG_INFO("AT+GATTQ: timeout=%d", timeout_ms);
+    
+    if (BLE_GattQueue_SetTimeout(timeout_ms) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTQ_Query_Handler(void)
+{
+    const BLE_GattQueueStats_t *s;
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+    
+    AT_Response_Send("+GATTQ:%d,%d\r\n", BLE_GattQueue_GetTimeout(), GATT_QUEUE_DEPTH);
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF) {
+            continue;
+        }
+        s = BLE_GattQueue_GetStats(link->conn_handle);
+        if (s == NULL) {
+            continue;
+        }
+        AT_Response_Send("+GATTQS:0x%04X,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                         s->conn_handle, s->depth, s->max_depth,
+                         (unsigned long)s->completed, (unsigned long)s->failed,
+                         (unsigned long)s->timeouts, (unsigned long)s->rejected,
+                         (unsigned long)(s->started ? s->wait_ms_total / s->started : 0U),
+                         (unsigned long)(s->executed ? s->exec_ms_total / s->executed : 0U),
+                         (unsigned long)s->max_latency_ms);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTCACHE_Handler(uint8_t enable)
+{
+    DEBUG_INFO("AT+GATTCACHE: enable=%d", enable);
+    
+    BLE_GattCache_Enable(enable);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTCACHE_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+GATTCACHE=CLEAR");
+    
+    if (BLE_GattCache_Clear() != 0) {
+        AT_Response_Send("+ERROR:FLASH\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTCACHE_Query_Handler(void)
+{
+    BLE_GattCacheStats_t stats;
+    
+    BLE_GattCache_GetStats(&stats);
+    AT_Response_Send("+GATTCACHE:%d,%d,%d,%d,%lu,%lu\r\n",
+                     BLE_GattCache_IsEnabled(), stats.entries, stats.hits, stats.misses,
+                     (unsigned long)(stats.hits ? stats.hit_ms_total / stats.hits : 0U),
+                     (unsigned long)(stats.misses ? stats.disc_ms_total / stats.misses : 0U));
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_NOTIFYPOL_Handler(uint8_t dev_idx, uint16_t value_handle, uint8_t policy,
+                        uint16_t param, uint8_t fmt, uint8_t offset)
+{
+    BLE_Device_t *dev = BLE_DeviceManager_GetDevice(dev_idx);
+    
+    if (dev == NULL) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+NOTIFYPOL: dev=%d, handle=0x%04X, policy=%d, param=%d",
+               dev_idx, value_handle, policy, param);
+    
+    if (policy != (uint8_t)GATT_SUB_POLICY_NONE && param == 0U) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    if (BLE_GattSub_SetPolicy(dev->mac_addr, value_handle, (BLE_GattSubPolicy_t)policy, param,
+                              (BLE_GattSubFmt_t)fmt, offset) != 0) {
+        AT_Response_Send("+ERROR:NOT_SUBSCRIBED\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_NOTIFYPOL_Query_Handler(void)
+{
+    const BLE_GattSub_t *sub;
+    uint8_t i;
+    
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        sub = BLE_GattSub_Get(i);
+        if (sub == NULL || sub->policy == (uint8_t)GATT_SUB_POLICY_NONE) {
+            continue;
+        }
+        AT_Response_Send("+NOTIFYPOL:%02X:%02X:%02X:%02X:%02X:%02X,0x%04X,%d,%d,%d,%d,%lu,%lu\r\n",
+                         sub->mac_addr[0], sub->mac_addr[1], sub->mac_addr[2],
+                         sub->mac_addr[3], sub->mac_addr[4], sub->mac_addr[5],
+                         sub->value_handle, sub->policy, sub->param, sub->fmt, sub->offset,
+                         (unsigned long)sub->forwarded, (unsigned long)sub->suppressed);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_COCOPEN_Handler(uint8_t dev_idx, uint16_t spsm)
+{
+    BLE_Device_t *dev = BLE_DeviceManager_GetDevice(dev_idx);
+    
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+COCOPEN: dev=%d, spsm=0x%04X", dev_idx, spsm);
+    
+    if (BLE_L2capCoc_Open(dev->conn_handle, spsm) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* +COCOPEN or +COCERROR follows when the peer answers */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_COCSEND_Handler(uint8_t channel, const char *data)
+{
+    int data_len;
+    
+    if (data == NULL || data[0] == '\0') {
+        AT_Response_Send("+ERROR:NO_DATA\r\n");
+        return -1;
+    }
+    
+    data_len = ParseHexString(data, write_buf, AT_WRITE_MAX_DATA_LEN);
+    if (data_len <= 0) {
+        AT_Response_Send("+ERROR:INVALID_HEX\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+COCSEND: ch=%d, len=%d", channel, data_len);
+    
+    if (BLE_L2capCoc_Send(channel, write_buf, (uint16_t)data_len) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_COC_Query_Handler(void)
+{
+    const BLE_CocChannel_t *c;
+    uint8_t i;
+    
+    AT_Response_Send("+COCLISTEN:0x%04X\r\n", BLE_L2capCoc_GetListen());
+    
+    for (i = 0; i < COC_MAX_CHANNELS; i++) {
+        c = BLE_L2capCoc_GetChannel(i);
+        if (c == NULL || c->state != COC_STATE_OPEN) {
+            continue;
+        }
+        AT_Response_Send("+COC:%d,0x%04X,0x%04X,%d,%d,%d,%d,%lu,%lu,%lu\r\n", c->index,
+                         c->conn_handle, c->spsm, c->peer_mtu, c->peer_mps, c->tx_credits,
+                         c->rx_credits, (unsigned long)c->tx_bytes, (unsigned long)c->rx_bytes,
+                         (unsigned long)c->stalls);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SUBS_Handler(uint8_t enable)
+{
+    DEBUG_INFO("AT+SUBS: enable=%d", enable);
+    
+    BLE_GattSub_EnableRestore(enable);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SUBS_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+SUBS=CLEAR");
+    
+    BLE_GattSub_Clear();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SUBS_Query_Handler(void)
+{
+    const BLE_GattSub_t *sub;
+    uint8_t used = 0;
+    uint8_t i;
+    
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        if (BLE_GattSub_Get(i) != NULL) {
+            used++;
+        }
+    }
+    AT_Response_Send("+SUBS:%d,%d,%d\r\n", BLE_GattSub_IsRestoreEnabled(), used,
+                     GATT_SUB_MAX_ENTRIES);
+    
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        sub = BLE_GattSub_Get(i);
+        if (sub == NULL) {
+            continue;
+        }
+        AT_Response_Send("+SUB:%02X:%02X:%02X:%02X:%02X:%02X,0x%04X,0x%04X,%d\r\n",
+                         sub->mac_addr[0], sub->mac_addr[1], sub->mac_addr[2],
+                         sub->mac_addr[3], sub->mac_addr[4], sub->mac_addr[5],
+                         sub->value_handle, sub->cccd_handle, sub->cccd_value);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTSTAT_Query_Handler(void)
+{
+    static const char *const names[EVTDISP_CLASS_COUNT] = { "HCI", "LE", "VS" };
+    const BLE_EvtDispatchStats_t *s;
+    const BLE_EvtDispatchRingStats_t *r;
+    uint8_t i;
+    
+    AT_Response_Send("+EVTSTAT:%d,%d,%lu\r\n", BLE_EvtDispatch_GetUsed(), EVTDISP_MAX_HANDLERS,
+                     (unsigned long)SystemCoreClock);
+    
+    for (i = 0; i < EVTDISP_CLASS_COUNT; i++) {
+        s = BLE_EvtDispatch_GetStats((BLE_EvtDispatchClass_t)i);
+        if (s == NULL) {
+            continue;
+        }
+        AT_Response_Send("+EVTS:%s,%lu,%lu,%lu,%lu,%lu,%lu\r\n", names[i],
+                         (unsigned long)s->events, (unsigned long)s->unhandled,
+                         (unsigned long)((s->events > 0U) ? s->lookup_cycles / s->events : 0U),
+                         (unsigned long)s->lookup_max,
+                         (unsigned long)((s->events > 0U) ? s->handler_cycles / s->events : 0U),
+                         (unsigned long)s->handler_max);
+    }
+    
+    r = BLE_EvtDispatch_GetRingStats();
+    AT_Response_Send("+EVTHOLD:%d,%lu,%lu,%lu\r\n", BLE_EvtDispatch_IsDeferEnabled(),
+                     (unsigned long)r->events,
+                     (unsigned long)((r->events > 0U) ? r->hold_cycles / r->events : 0U),
+                     (unsigned long)r->hold_max);
+    AT_Response_Send("+EVTRING:%d,%d,%d,%lu,%lu,%lu,%lu\r\n", BLE_EvtDispatch_GetRingUsed(),
+                     r->peak, EVTDISP_RING_SIZE, (unsigned long)r->deferred,
+                     (unsigned long)r->flow_off,
+                     (unsigned long)((r->deferred > 0U) ? r->wait_cycles / r->deferred : 0U),
+                     (unsigned long)r->wait_max);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTSTAT_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+EVTSTAT=CLEAR");
+    
+    BLE_EvtDispatch_ClearStats();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_GATTSRV_Query_Handler(void)
+{
+    AT_Response_Send("+GATTSRV:%d,%d,%d,%lu,%lu,%lu\r\n",
+                     CFG_BLE_NUM_GATT_SERVICES - CFG_GATT_BASE_SERVICES,
+                     CFG_BLE_NUM_GATT_ATTRIBUTES, CFG_BLE_ATT_VALUE_ARRAY_SIZE,
+                     (unsigned long)CFG_BLE_GATT_DB_SIZE,
+                     (unsigned long)CFG_BLE_GATT_DB_RECLAIMED,
+                     (unsigned long)CFG_BLE_MBLOCK_COUNT);
+    AT_Response_Send("+BOOT:%lu,%lu\r\n", (unsigned long)APP_BLE_GetReadyTime(),
+                     (unsigned long)APP_BLE_GetSvcInitTime());
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_TLSTAT_Query_Handler(void)
+{
+    BLE_EvtDispatchTlStats_t t;
+    
+    BLE_EvtDispatch_GetTlStats(&t);
+    AT_Response_Send("+TLSTAT:%lu,%lu,%d,%d\r\n", (unsigned long)t.pool_size,
+                     (unsigned long)APPE_GetMbMem2Size(), CFG_TLBLE_POOL_LINKS,
+                     CFG_TLBLE_POOL_MTU);
+    AT_Response_Send("+TLHCI:%lu,%d,%d,%d,%lu,%lu,%lu\r\n", (unsigned long)t.events,
+                     t.queue_depth, t.queue_max, t.flow_off,
+                     (unsigned long)t.flow_off_count,
+                     (unsigned long)((t.flow_off_count > 0U) ?
+                                     t.flow_off_cycles / t.flow_off_count : 0U),
+                     (unsigned long)t.flow_off_max);
+    AT_Response_Send("+TLMM:%d,%d,%d,%lu,%lu,%lu\r\n", t.held, t.held_max, t.local_free_max,
+                     (unsigned long)t.returned,
+                     (unsigned long)((t.returned > 0U) ? t.return_cycles / t.returned : 0U),
+                     (unsigned long)t.return_max);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_TLSTAT_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+TLSTAT=CLEAR");
+    
+    BLE_EvtDispatch_ClearTlStats();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTDEFER_Handler(uint8_t enable)
+{
+    DEBUG_INFO("AT+EVTDEFER: enable=%d", enable);
+    
+    BLE_EvtDispatch_EnableDefer(enable);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTBUS_Query_Handler(void)
+{
+    const BLE_EventBusSub_t *s;
+    uint8_t i;
+    
+    AT_Response_Send("+EVTBUS:%d,%d\r\n", BLE_EventBus_GetCount(), EVTBUS_MAX_SUBSCRIBERS);
+    
+    for (i = 0; i < BLE_EventBus_GetCount(); i++) {
+        s = BLE_EventBus_GetSub(i);
+        if (s == NULL) {
+            continue;
+        }
+        AT_Response_Send("+EVTSUB:%d,%s,0x%02lX,0x%04X,0x%04X,%d,%lu,%lu,%lu,%lu\r\n", i, s->name,
+                         (unsigned long)s->mask, s->filter.conn_handle, s->filter.attr_handle,
+                         s->filter.match_mac, (unsigned long)s->calls,
+                         (unsigned long)s->filtered,
+                         (unsigned long)((s->calls > 0U) ? s->cycles / s->calls : 0U),
+                         (unsigned long)s->cycles_max);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTBUS_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+EVTBUS=CLEAR");
+    
+    BLE_EventBus_ClearStats();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_EVTBUS_Handler(uint8_t id, uint16_t conn_handle, uint16_t attr_handle)
+{
+    BLE_EventBusFilter_t filter;
+    
+    DEBUG_INFO("AT+EVTBUS: id=%d conn=0x%04X attr=0x%04X", id, conn_handle, attr_handle);
+    
+    memset(&filter, 0, sizeof(filter));
+    filter.conn_handle = conn_handle;
+    filter.attr_handle = attr_handle;
+    if (BLE_EventBus_SetFilter(id, &filter) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_HCITRACE_Handler(uint8_t mode, uint8_t filter, uint16_t snaplen)
+{
+    DEBUG_INFO("AT+HCITRACE: mode=%d filter=0x%02X snaplen=%d", mode, filter, snaplen);
+    
+    if (BLE_HciTrace_Config((BLE_HciTraceMode_t)mode, filter, snaplen) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_HCITRACE_Query_Handler(void)
+{
+    const BLE_HciTraceStats_t *s = BLE_HciTrace_GetStats();
+    BLE_HciTraceMode_t mode;
+    uint8_t filter;
+    uint16_t snaplen;
+    uint16_t used;
+    uint16_t records;
+    
+    BLE_HciTrace_GetConfig(&mode, &filter, &snaplen);
+    BLE_HciTrace_GetUsage(&used, &records);
+    AT_Response_Send("+HCITRACE:%d,0x%02X,%d,%d,%d,%d\r\n", mode, filter, snaplen,
+                     used, HCITRACE_RING_SIZE, records);
+    AT_Response_Send("+HCITRC:%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", (unsigned long)s->captured,
+                     (unsigned long)s->filtered, (unsigned long)s->truncated,
+                     (unsigned long)s->overwritten, (unsigned long)s->exported,
+                     (unsigned long)((s->hook_calls > 0U) ? s->hook_cycles / s->hook_calls : 0U),
+                     (unsigned long)s->hook_max);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_HCITRACE_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+HCITRACE=CLEAR");
+    
+    BLE_HciTrace_Clear();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_HCIDUMP_Handler(void)
+{
+    uint32_t bytes;
+    int records = BLE_HciTrace_Dump(&bytes);
+    
+    if (records < 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    AT_Response_Send("+HCIDUMP:%d,%lu\r\n", records, (unsigned long)bytes);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ATLAT_Query_Handler(void)
+{
+    const AT_LatencyStats_t *s = AT_Command_GetLatency();
+    
+    AT_Response_Send("+ATLAT:%lu,%lu,%lu,%lu,%lu,%lu\r\n", (unsigned long)s->commands,
+                     (unsigned long)((s->commands > 0U) ? s->wait_cycles / s->commands : 0U),
+                     (unsigned long)s->wait_max,
+                     (unsigned long)((s->commands > 0U) ? s->run_cycles / s->commands : 0U),
+                     (unsigned long)s->run_max, (unsigned long)SystemCoreClock);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ATLAT_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+ATLAT=CLEAR");
+    
+    AT_Command_ClearLatency();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ADVSTORM_Handler(uint16_t devices, uint16_t rate, uint8_t batch, uint16_t count, uint8_t ad_len)
+{
+    BLE_AdvStormConfig_t cfg;
+    
+    DEBUG_INFO("AT+ADVSTORM: devices=%d rate=%d batch=%d count=%d ad=%d",
+               devices, rate, batch, count, ad_len);
+    
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.devices = devices;
+    cfg.rate = rate;
+    cfg.batch = batch;
+    cfg.count = count;
+    cfg.ad_len = ad_len;
+    /* OK before the first injected report reaches the host */
+    if (BLE_AdvStorm_IsRunning() || BLE_AdvStorm_CheckConfig(&cfg) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    AT_Response_Send("OK\r\n");
+    BLE_AdvStorm_Start(&cfg);
+    return 0;
+}
+
+int AT_ADVSTORM_Stop_Handler(void)
+{
+    DEBUG_INFO("AT+ADVSTORM=STOP");
+    
+    BLE_AdvStorm_Stop();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_ADVSTORM_Query_Handler(void)
+{
+    BLE_AdvStormConfig_t cfg;
+    BLE_AdvStormStats_t s;
+    
+    BLE_AdvStorm_GetConfig(&cfg);
+    BLE_AdvStorm_GetStats(&s);
+    AT_Response_Send("+ADVSTORM:%d,%d,%d,%d,%d,%d\r\n", BLE_AdvStorm_IsRunning(), cfg.devices,
+                     cfg.rate, cfg.batch, cfg.count, cfg.ad_len);
+    AT_Response_Send("+ADVSTAT:%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", (unsigned long)s.events,
+                     (unsigned long)s.reports, (unsigned long)s.ingested, (unsigned long)s.flow_drops,
+                     (unsigned long)s.new_devices, (unsigned long)s.table_full,
+                     (unsigned long)s.uart_bytes, (unsigned long)s.elapsed_ms,
+                     (unsigned long)((s.elapsed_ms > 0U) ? (uint64_t)s.ingested * 1000U / s.elapsed_ms : 0U));
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SEQSTAT_Query_Handler(void)
+{
+    const UTIL_SEQ_TaskStats_t *s;
+    uint32_t busy_ms;
+    uint32_t total_ms;
+    uint16_t load;
+    uint32_t i;
+    
+    load = SEQ_Profile_GetLoad(&busy_ms, &total_ms);
+    AT_Response_Send("+SEQSTAT:%d,%lu,%lu,%lu\r\n", load, (unsigned long)busy_ms,
+                     (unsigned long)total_ms, (unsigned long)SystemCoreClock);
+    
+    /* Tasks that ran since the last clear, times in CPU cycles */
+    for (i = 0; i < CFG_TASK_NBR; i++) {
+        s = UTIL_SEQ_GetTaskStats(i);
+        if (s->RunCount == 0U) {
+            continue;
+        }
+        AT_Response_Send("+SEQTASK:%lu,%s,%lu,%lu,%lu,%lu,%lu,%lu\r\n", (unsigned long)i,
+                         SEQ_Profile_TaskName(i), (unsigned long)s->RunCount,
+                         (unsigned long)(s->RunCycles / s->RunCount), (unsigned long)s->RunMax,
+                         (unsigned long)s->RunLast, (unsigned long)(s->WaitCycles / s->RunCount),
+                         (unsigned long)s->WaitMax);
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SEQSTAT_Clear_Handler(void)
+{
+    DEBUG_INFO("AT+SEQSTAT=CLEAR");
+    
+    SEQ_Profile_Clear();
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SEQREPORT_Handler(uint16_t period_ms)
+{
+    DEBUG_INFO("AT+SEQREPORT: period=%d", period_ms);
+    
+    if (SEQ_Profile_SetReport(period_ms) != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_SEQREPORT_Query_Handler(void)
+{
+    AT_Response_Send("+SEQREPORT:%d\r\n", SEQ_Profile_GetReport());
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_NEGO_Handler(uint8_t dev_idx, uint8_t mask)
+{
+    BLE_Device_t *dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (!dev) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+NEGO: dev=%d, mask=0x%02X", dev_idx, mask);
+    
+    /* Applied on the next connection to this device */
+    BLE_DeviceManager_SetNegoMask(dev_idx, mask);
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_CONNPARAM_Handler(uint8_t dev_idx, const uint16_t *params)
+{
+    BLE_ConnParams_t conn_params;
+    BLE_Device_t *dev;
+    int ret;
+    
+    conn_params.interval_min = params[0];
+    conn_params.interval_max = params[1];
+    conn_params.latency = params[2];
+    conn_params.supervision_timeout = params[3];
+    
+    if (dev_idx == 0xFFU) {
+        DEBUG_INFO("AT+CONNPARAM: defaults");
+        ret = BLE_Connection_SetDefaultParams(&conn_params);
+    } else {
+        dev = BLE_DeviceManager_GetDevice(dev_idx);
+        if (dev == NULL || !dev->is_connected) {
+            AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+            return -1;
+        }
+        DEBUG_INFO("AT+CONNPARAM: dev=%d, hdl=0x%04X", dev_idx, dev->conn_handle);
+        ret = BLE_Connection_UpdateParams(dev->conn_handle, &conn_params);
+    }
+    
+    if (ret != 0) {
+        AT_Response_Send("ERROR\r\n");
+        return -1;
+    }
+    
+    /* OK sent immediately, +CONNUPDATE will follow for live updates */
+    AT_Response_Send("OK\r\n");
+    return 0;
+}
+
+int AT_CONNPOLICY_Handler(uint8_t dev_idx, uint8_t policy)
+{
+    BLE_Device_t *dev;
+    
+    dev = BLE_DeviceManager_GetDevice(dev_idx);
+    if (dev == NULL || !dev->is_connected) {
+        AT_Response_Send("+ERROR:NOT_CONNECTED\r\n");
+        return -1;
+    }
+    
+    DEBUG_INFO("AT+CONNPOLICY: dev=%d, policy=%d", dev_idx, policy);
+    
+    if (BLE_Connection_SetUpdatePolicy(dev->conn_handle, (BLE_ConnUpdatePolicy_t)policy) != 0) {
         AT_Response_Send("ERROR\r\n");
         return -1;
     }
     
-    DEBUG_INFO("AT+INFO: dev=%d", dev_idx);
-    AT_Response_Send("+INFO:%02X:%02X:%02X:%02X:%02X:%02X\r\n",
-                   dev->mac_addr[5], dev->mac_addr[4], dev->mac_addr[3],
-                   dev->mac_addr[2], dev->mac_addr[1], dev->mac_addr[0]);
     AT_Response_Send("OK\r\n");
     return 0;
 }
@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+  * @file    ble_adv_storm.c
+  * @brief   Synthetic advertising report generator implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_adv_storm.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "svc_ctl.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+extern uint32_t AT_Response_GetTxBytes(void);
+
+#define ADVSTORM_MS_TO_TICKS(ms)    ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+#define ADVSTORM_SEED_DEFAULT       0x5EED2024UL
+
+/* H4 LE meta event carrying LE advertising reports */
+#define ADVSTORM_H4_EVT             0x04U
+#define ADVSTORM_EVT_LE_META        0x3EU
+#define ADVSTORM_SUBEVT_ADV_REPORT  0x02U
+#define ADVSTORM_ADV_IND            0x00U
+#define ADVSTORM_ADDR_RANDOM        0x01U
+
+/* AD structures */
+#define ADVSTORM_AD_FLAGS_LEN       3U      /* Flags: LE General Discoverable, BR/EDR not supported */
+#define ADVSTORM_AD_NAME_LEN        8U      /* Complete local name "STxxxx" */
+#define ADVSTORM_AD_MFR_MIN         4U      /* Manufacturer data, company ID only */
+#define ADVSTORM_COMPANY_ID         0xFFFFU /* Reserved for tests */
+
+typedef enum {
+    STORM_IDLE = 0,
+    STORM_RUNNING,
+    STORM_DRAINING,                 /* All reports sent, deferred events still queued */
+} Storm_State_t;
+
+static BLE_AdvStormGen_t storm_gen;
+static BLE_AdvStormStats_t storm_stats;
+static BLE_ScanStats_t storm_scan0;
+static uint32_t storm_uart0;
+static uint32_t storm_start_tick;
+static uint8_t storm_state = STORM_IDLE;
+static uint8_t storm_timer_id;
+static uint8_t storm_held;          /* Event in storm_pkt refused, sent again first */
+/* Injected through hci_uart_pckt like a TL buffer: keep it word aligned */
+static uint32_t storm_pkt[(ADVSTORM_PKT_MAX + 3U) / 4U];
+
+/*============================================================================
+ * Generator
+ *============================================================================*/
+
+static uint32_t Storm_Rand(BLE_AdvStormGen_t *gen)
+{
+    uint32_t x = gen->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->rng = x;
+    return x;
+}
+
+/**
+ * @brief Mix device index and seed into the upper address bytes
+ */
+static uint32_t Storm_Hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief Fill AD data: flags, then name and manufacturer data as room allows
+ */
+static void Storm_BuildAd(BLE_AdvStormGen_t *gen, uint8_t *ad, uint16_t dev)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint8_t len = gen->cfg.ad_len;
+    uint8_t pos = 0;
+    uint8_t room;
+    uint8_t i;
+
+    if (len >= ADVSTORM_AD_FLAGS_LEN) {
+        ad[pos++] = ADVSTORM_AD_FLAGS_LEN - 1U;
+        ad[pos++] = 0x01;
+        ad[pos++] = 0x06;
+    }
+    room = (len > pos) ? (uint8_t)(len - pos) : 0U;
+    if (room >= ADVSTORM_AD_NAME_LEN) {
+        ad[pos++] = ADVSTORM_AD_NAME_LEN - 1U;
+        ad[pos++] = 0x09;
+        ad[pos++] = 'S';
+        ad[pos++] = 'T';
+        ad[pos++] = hex[(dev >> 12) & 0x0FU];
+        ad[pos++] = hex[(dev >> 8) & 0x0FU];
+        ad[pos++] = hex[(dev >> 4) & 0x0FU];
+        ad[pos++] = hex[dev & 0x0FU];
+    }
+    room = (len > pos) ? (uint8_t)(len - pos) : 0U;
+    if (room >= ADVSTORM_AD_MFR_MIN) {
+        ad[pos++] = room - 1U;
+        ad[pos++] = 0xFF;
+        ad[pos++] = (uint8_t)ADVSTORM_COMPANY_ID;
+        ad[pos++] = (uint8_t)(ADVSTORM_COMPANY_ID >> 8);
+        /* Payload changes on every report, like sensor beacons */
+        for (i = 0; pos < len; i++) {
+            ad[pos++] = (uint8_t)(gen->reports >> (8U * (i & 3U)));
+        }
+    }
+    /* Too short for another structure: zero length ends the data */
+    while (pos < len) {
+        ad[pos++] = 0;
+    }
+}
+
+int BLE_AdvStorm_CheckConfig(const BLE_AdvStormConfig_t *cfg)
+{
+    if (cfg->devices == 0U || cfg->batch == 0U ||
+        cfg->ad_len < ADVSTORM_AD_MIN || cfg->ad_len > ADVSTORM_AD_MAX ||
+        (uint16_t)cfg->batch * (ADVSTORM_REPORT_HDR + cfg->ad_len) > ADVSTORM_EVT_ROOM) {
+        return -1;
+    }
+    return 0;
+}
+
+void BLE_AdvStorm_GenInit(BLE_AdvStormGen_t *gen, const BLE_AdvStormConfig_t *cfg)
+{
+    memset(gen, 0, sizeof(*gen));
+    gen->cfg = *cfg;
+    if (gen->cfg.seed == 0U) {
+        gen->cfg.seed = ADVSTORM_SEED_DEFAULT;
+    }
+    gen->rng = gen->cfg.seed;
+}
+
+uint16_t BLE_AdvStorm_GenEvent(BLE_AdvStormGen_t *gen, uint8_t *pkt)
+{
+    uint8_t *rep = &pkt[5];
+    uint8_t num = gen->cfg.batch;
+    uint32_t rnd;
+    uint32_t hi;
+    uint16_t dev;
+    uint8_t n;
+
+    if (gen->cfg.count != 0U) {
+        if (gen->reports >= gen->cfg.count) {
+            return 0;
+        }
+        if (gen->cfg.count - gen->reports < num) {
+            num = (uint8_t)(gen->cfg.count - gen->reports);
+        }
+    }
+
+    for (n = 0; n < num; n++) {
+        rnd = Storm_Rand(gen);
+        dev = (uint16_t)(rnd % gen->cfg.devices);
+        hi = Storm_Hash(gen->cfg.seed + dev);
+
+        rep[0] = ADVSTORM_ADV_IND;
+        rep[1] = ADVSTORM_ADDR_RANDOM;
+        /* Random static address, unique per device index */
+        rep[2] = (uint8_t)dev;
+        rep[3] = (uint8_t)(dev >> 8);
+        rep[4] = (uint8_t)hi;
+        rep[5] = (uint8_t)(hi >> 8);
+        rep[6] = (uint8_t)(hi >> 16);
+        rep[7] = (uint8_t)(hi >> 24) | 0xC0U;
+        rep[8] = gen->cfg.ad_len;
+        Storm_BuildAd(gen, &rep[9], dev);
+        rep[9U + gen->cfg.ad_len] = (uint8_t)(int8_t)(-30 - (int)((rnd >> 16) % 60U));
+
+        rep += ADVSTORM_REPORT_HDR + gen->cfg.ad_len;
+        gen->reports++;
+    }
+
+    pkt[0] = ADVSTORM_H4_EVT;
+    pkt[1] = ADVSTORM_EVT_LE_META;
+    pkt[2] = (uint8_t)(2U + num * (ADVSTORM_REPORT_HDR + gen->cfg.ad_len));
+    pkt[3] = ADVSTORM_SUBEVT_ADV_REPORT;
+    pkt[4] = num;
+    gen->events++;
+    return (uint16_t)(3U + pkt[2]);
+}
+
+/*============================================================================
+ * On-target self-test
+ *============================================================================*/
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void Storm_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_ADV_STORM_ID, CFG_SCH_PRIO_BG);
+}
+
+/**
+ * @brief Results so far: own counters plus scan path deltas
+ */
+static void Storm_Collect(BLE_AdvStormStats_t *stats)
+{
+    const BLE_ScanStats_t *scan = BLE_Connection_GetScanStats();
+
+    stats->ingested = scan->reports - storm_scan0.reports;
+    stats->new_devices = scan->new_devices - storm_scan0.new_devices;
+    stats->table_full = scan->table_full - storm_scan0.table_full;
+    stats->host_reports = scan->host_reports - storm_scan0.host_reports;
+    stats->uart_bytes = AT_Response_GetTxBytes() - storm_uart0;
+    stats->elapsed_ms = HAL_GetTick() - storm_start_tick;
+}
+
+static void Storm_Finish(void)
+{
+    HW_TS_Stop(storm_timer_id);
+    Storm_Collect(&storm_stats);
+    storm_state = STORM_IDLE;
+}
+
+void BLE_AdvStorm_Init(void)
+{
+    memset(&storm_stats, 0, sizeof(storm_stats));
+    memset(&storm_gen, 0, sizeof(storm_gen));
+    storm_state = STORM_IDLE;
+
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &storm_timer_id, hw_ts_Repeated, Storm_TimerCb);
+
+    DEBUG_INFO("Advertising storm self-test ready");
+}
+
+int BLE_AdvStorm_Start(const BLE_AdvStormConfig_t *cfg)
+{
+    if (storm_state != STORM_IDLE || BLE_AdvStorm_CheckConfig(cfg) != 0) {
+        return -1;
+    }
+
+    BLE_AdvStorm_GenInit(&storm_gen, cfg);
+    storm_held = 0;
+    memset(&storm_stats, 0, sizeof(storm_stats));
+    storm_scan0 = *BLE_Connection_GetScanStats();
+    storm_uart0 = AT_Response_GetTxBytes();
+    storm_start_tick = HAL_GetTick();
+    storm_state = STORM_RUNNING;
+
+    HW_TS_Start(storm_timer_id, ADVSTORM_MS_TO_TICKS(ADVSTORM_TICK_MS));
+    UTIL_SEQ_SetTask(1U << CFG_TASK_ADV_STORM_ID, CFG_SCH_PRIO_BG);
+
+    DEBUG_INFO("Adv storm: devices=%d rate=%d batch=%d ad=%d count=%d",
+               cfg->devices, cfg->rate, cfg->batch, cfg->ad_len, cfg->count);
+    return 0;
+}
+
+void BLE_AdvStorm_Stop(void)
+{
+    if (storm_state != STORM_IDLE) {
+        Storm_Finish();
+        DEBUG_INFO("Adv storm stopped: %lu reports", (unsigned long)storm_stats.reports);
+    }
+}
+
+uint8_t BLE_AdvStorm_IsRunning(void)
+{
+    return (storm_state != STORM_IDLE) ? 1U : 0U;
+}
+
+void BLE_AdvStorm_GetConfig(BLE_AdvStormConfig_t *cfg)
+{
+    *cfg = storm_gen.cfg;
+}
+
+void BLE_AdvStorm_GetStats(BLE_AdvStormStats_t *stats)
+{
+    *stats = storm_stats;
+    if (storm_state != STORM_IDLE) {
+        Storm_Collect(stats);
+    }
+}
+
+void BLE_AdvStorm_Process(void)
+{
+    uint8_t *pkt = (uint8_t *)storm_pkt;
+    uint32_t due;
+    uint16_t len;
+    uint8_t n;
+
+    if (storm_state == STORM_RUNNING) {
+        if (storm_gen.cfg.rate == 0U) {
+            due = ADVSTORM_BURST;
+        } else {
+            /* Events owed by the schedule since the start */
+            due = (uint32_t)(((uint64_t)storm_gen.cfg.rate * (HAL_GetTick() - storm_start_tick)) / 1000U) -
+                  storm_stats.events;
+        }
+
+        for (n = 0; n < ADVSTORM_BURST && n < due; n++) {
+            if (!storm_held) {
+                len = BLE_AdvStorm_GenEvent(&storm_gen, pkt);
+                if (len == 0U) {
+                    storm_state = STORM_DRAINING;
+                    break;
+                }
+                storm_stats.events++;
+                storm_stats.reports += pkt[4];
+            }
+            storm_held = 0;
+            if (SVCCTL_UserEvtRx(pkt) == SVCCTL_UserEvtFlowDisable) {
+                if (storm_gen.cfg.rate == 0U) {
+                    /* Paced by the gateway: wait for the deferred task to free ring space */
+                    storm_held = 1;
+                    break;
+                }
+                /* Real-time load: the controller would have lost these reports */
+                storm_stats.flow_drops += pkt[4];
+            }
+        }
+
+        /* Flat out or behind schedule: yield to higher priority tasks, then carry on */
+        if (storm_state == STORM_RUNNING && (storm_gen.cfg.rate == 0U || due > ADVSTORM_BURST)) {
+            UTIL_SEQ_SetTask(1U << CFG_TASK_ADV_STORM_ID, CFG_SCH_PRIO_BG);
+        }
+    }
+
+    if (storm_state == STORM_DRAINING && BLE_EvtDispatch_GetRingUsed() == 0U) {
+        Storm_Finish();
+        DEBUG_INFO("Adv storm done: %lu reports in %lums", (unsigned long)storm_stats.reports,
+                   (unsigned long)storm_stats.elapsed_ms);
+        AT_Response_Send("+ADVSTORM:DONE,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n",
+                         (unsigned long)storm_stats.events, (unsigned long)storm_stats.reports,
+                         (unsigned long)storm_stats.ingested, (unsigned long)storm_stats.flow_drops,
+                         (unsigned long)storm_stats.new_devices, (unsigned long)storm_stats.table_full,
+                         (unsigned long)storm_stats.uart_bytes, (unsigned long)storm_stats.elapsed_ms);
+    }
+}
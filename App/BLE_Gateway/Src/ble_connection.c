@@ -8,22 +8,360 @@
 
 #include "ble_connection.h"
 #include "ble_device_manager.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_cache.h"
+#include "ble_gatt_queue.h"
+#include "ble_gatt_stream.h"
+#include "ble_gatt_readm.h"
+#include "ble_gatt_resolve.h"
+#include "ble_gatt_indicate.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_l2cap_coc.h"
+#include "ble_link_adapt.h"
+#include "ble_evt_dispatch.h"
+#include "ble_event_bus.h"
 #include "debug_trace.h"
 #include "at_command.h"
+#include "app_common.h"
+#include "app_conf.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
 #include "ble_gap_aci.h"
+#include "ble_gatt_aci.h"
 #include "ble_hci_le.h"
+#include "ble_l2cap_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include "stm32wbxx_hal.h"
 #include <string.h>
 
 extern void AT_Response_Send(const char *fmt, ...);
 
-typedef struct {
-    uint16_t conn_handle;
-    BLE_ConnectionState_t state;
-    uint8_t mac_addr[BLE_MAC_LEN];
-} ConnectionInfo_t;
+/* HCI parameter limits (Core spec Vol 4, Part E, 7.8.18) */
+#define CONN_INTERVAL_MIN       0x0006U     /* 7.5 ms */
+#define CONN_INTERVAL_MAX       0x0C80U     /* 4 s */
+#define CONN_LATENCY_MAX        0x01F3U     /* 499 events */
+#define CONN_TIMEOUT_MIN        0x000AU     /* 100 ms */
+#define CONN_TIMEOUT_MAX        0x0C80U     /* 32 s */
 
-static ConnectionInfo_t connections[MAX_BLE_CONNECTIONS];
+/* Link layer defaults before any negotiation */
+#define LINK_DEFAULT_ATT_MTU    23U
+#define LINK_DEFAULT_OCTETS     27U
+#define LINK_PHY_1M             0x01U
+#define LINK_PHY_2M             0x02U
+
+/* HCI_LE_Set_Data_Length targets: max payload, time for 251 B on 1M PHY */
+#define LINK_DLE_TX_OCTETS      251U
+#define LINK_DLE_TX_TIME        2120U
+
+/* Steps resolved only by a change event, which may never come */
+#define LINK_NEGO_EVT_STEPS     (BLE_NEGO_DLE | BLE_NEGO_PHY_2M)
+#define LINK_NEGO_TICK_MS       500U
+#define LINK_MS_TO_TICKS(ms)    ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* LE advertising report: event type, address type, address, data length, data, RSSI */
+#define ADV_REPORT_ADDR_TYPE_OFS 1U
+#define ADV_REPORT_ADDR_OFS     2U
+#define ADV_REPORT_DATA_LEN_OFS 8U
+#define ADV_REPORT_FIXED_LEN    10U
+
+static BLE_ConnectionInfo_t connections[MAX_BLE_CONNECTIONS];
 static uint8_t connection_count = 0;
+static BLE_ScanStats_t scan_stats;
+static uint8_t nego_timer_id;
+static uint8_t nego_timer_on = 0;
+
+/* Parameters used by BLE_Connection_CreateConnection */
+static BLE_ConnParams_t default_params = {
+    0x0018,     /* Conn_Interval_Min: 30ms (24 * 1.25ms) */
+    0x0028,     /* Conn_Interval_Max: 50ms (40 * 1.25ms) */
+    0x0000,     /* Conn_Latency: 0 */
+    0x00C8,     /* Supervision_Timeout: 2000ms (200 * 10ms) */
+};
+
+/**
+ * @brief Validate connection parameters against HCI limits
+ * @note  Timeout must exceed (1 + latency) * interval_max * 2
+ */
+static int ConnParams_IsValid(const BLE_ConnParams_t *p)
+{
+    if (p == NULL) {
+        return 0;
+    }
+    if (p->interval_min < CONN_INTERVAL_MIN || p->interval_max > CONN_INTERVAL_MAX ||
+        p->interval_min > p->interval_max) {
+        return 0;
+    }
+    if (p->latency > CONN_LATENCY_MAX) {
+        return 0;
+    }
+    if (p->supervision_timeout < CONN_TIMEOUT_MIN || p->supervision_timeout > CONN_TIMEOUT_MAX) {
+        return 0;
+    }
+    /* timeout[10ms] * 4 > (1 + latency) * interval_max[1.25ms] */
+    if ((uint32_t)p->supervision_timeout * 4U <= (1U + p->latency) * (uint32_t)p->interval_max) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Reset link-layer state of a connection slot to spec defaults
+ */
+static void Link_ResetDefaults(BLE_ConnectionInfo_t *info)
+{
+    info->att_mtu = LINK_DEFAULT_ATT_MTU;
+    info->max_tx_octets = LINK_DEFAULT_OCTETS;
+    info->max_rx_octets = LINK_DEFAULT_OCTETS;
+    info->tx_phy = LINK_PHY_1M;
+    info->rx_phy = LINK_PHY_1M;
+    info->nego_pending = 0;
+    info->encrypted = 0;
+    info->rx_packets = 0;
+    info->rx_bytes = 0;
+    info->tx_packets = 0;
+    info->tx_bytes = 0;
+}
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void Link_NegoTimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_LINK_NEGO_ID, CFG_SCH_PRIO_BG);
+}
+
+/**
+ * @brief Run the timer only while some link waits for a DLE or PHY event
+ */
+static void Link_NegoTimerUpdate(void)
+{
+    uint8_t i;
+    uint8_t busy = 0;
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (connections[i].conn_handle != 0xFFFF &&
+            (connections[i].nego_pending & LINK_NEGO_EVT_STEPS) != 0U) {
+            busy = 1;
+            break;
+        }
+    }
+    
+    if (busy && !nego_timer_on) {
+        HW_TS_Start(nego_timer_id, LINK_MS_TO_TICKS(LINK_NEGO_TICK_MS));
+        nego_timer_on = 1;
+    } else if (!busy && nego_timer_on) {
+        HW_TS_Stop(nego_timer_id);
+        nego_timer_on = 0;
+    }
+}
+
+/**
+ * @brief Clear a negotiation step and log once all steps resolved
+ */
+static void Link_NegoDone(BLE_ConnectionInfo_t *info, uint8_t step)
+{
+    if ((info->nego_pending & step) == 0U) {
+        return;
+    }
+    
+    info->nego_pending &= (uint8_t)~step;
+    if ((step & LINK_NEGO_EVT_STEPS) != 0U) {
+        Link_NegoTimerUpdate();
+    }
+    if (info->nego_pending == 0U) {
+        DEBUG_INFO("Conn 0x%04X ready: mtu=%d tx=%d rx=%d phy=%d/%d",
+                   info->conn_handle, info->att_mtu,
+                   info->max_tx_octets, info->max_rx_octets,
+                   info->tx_phy, info->rx_phy);
+    }
+}
+
+/**
+ * @brief Request ATT MTU exchange
+ * @note  Goes through the GATT queue: only one ATT procedure may run per link
+ */
+static void Link_RequestMtu(BLE_ConnectionInfo_t *info)
+{
+    if (BLE_GattQueue_ExchangeMtu(info->conn_handle) != 0) {
+        DEBUG_ERROR("MTU exchange not queued 0x%04X", info->conn_handle);
+        Link_NegoDone(info, BLE_NEGO_MTU);
+        BLE_GattCache_OnLinkUp(info->conn_handle);
+    }
+}
+
+/**
+ * @brief Post-connect negotiation: MTU, Data Length Extension, 2M PHY
+ * @note  All three run in parallel; results arrive as events
+ */
+static void Link_StartNegotiation(BLE_ConnectionInfo_t *info, uint8_t mask)
+{
+    tBleStatus ret;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    
+    info->nego_pending = mask & BLE_NEGO_ALL;
+    Link_NegoTimerUpdate();
+    
+    if (info->nego_pending & BLE_NEGO_MTU) {
+        Link_RequestMtu(info);
+    }
+    
+    if (info->nego_pending & BLE_NEGO_DLE) {
+        ret = hci_le_set_data_length(info->conn_handle, LINK_DLE_TX_OCTETS, LINK_DLE_TX_TIME);
+        if (ret != BLE_STATUS_SUCCESS) {
+            DEBUG_ERROR("Set data length failed: 0x%02X", ret);
+            Link_NegoDone(info, BLE_NEGO_DLE);
+        }
+    }
+    
+    /* Already on 2M: the controller reports no PHY update */
+    if ((info->nego_pending & BLE_NEGO_PHY_2M) &&
+        hci_le_read_phy(info->conn_handle, &tx_phy, &rx_phy) == BLE_STATUS_SUCCESS &&
+        tx_phy == LINK_PHY_2M && rx_phy == LINK_PHY_2M) {
+        info->tx_phy = tx_phy;
+        info->rx_phy = rx_phy;
+        Link_NegoDone(info, BLE_NEGO_PHY_2M);
+    }
+    
+    if (info->nego_pending & BLE_NEGO_PHY_2M) {
+        /* ALL_PHYS = 0: TX and RX preferences both given */
+        ret = hci_le_set_phy(info->conn_handle, 0x00, LINK_PHY_2M, LINK_PHY_2M, 0x0000);
+        if (ret != BLE_STATUS_SUCCESS) {
+            DEBUG_ERROR("Set PHY failed: 0x%02X", ret);
+            Link_NegoDone(info, BLE_NEGO_PHY_2M);
+        }
+    }
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void Connection_EvtDisconnComplete(void *evt)
+{
+    hci_disconnection_complete_event_rp0 *pr = evt;
+
+    BLE_Connection_OnDisconnected(pr->Connection_Handle, pr->Reason);
+}
+
+static void Connection_EvtEncryptionChange(void *evt)
+{
+    hci_encryption_change_event_rp0 *pr = evt;
+
+    BLE_Connection_OnEncryptionChange(pr->Connection_Handle, pr->Status, pr->Encryption_Enabled);
+}
+
+static void Connection_EvtConnComplete(void *evt)
+{
+    hci_le_connection_complete_event_rp0 *pr = evt;
+
+    BLE_Connection_OnConnected(pr->Peer_Address, pr->Connection_Handle, pr->Status);
+    if (pr->Status == 0x00) {
+        BLE_Connection_OnLinkParams(pr->Connection_Handle, pr->Conn_Interval,
+                                    pr->Conn_Latency, pr->Supervision_Timeout);
+    }
+}
+
+/**
+ * @brief Decode one advertising report and pass it to the scan path
+ */
+static void Connection_AdvReport(const uint8_t *mac, uint8_t addr_type, const uint8_t *data,
+                                 uint8_t data_len, int8_t rssi)
+{
+    char name[32];
+    uint8_t name_found = 0;
+    uint8_t ad_len;
+    uint16_t i = 0;
+
+    /* Device name from AD type 0x08 (shortened) or 0x09 (complete) */
+    while (i < data_len && !name_found) {
+        ad_len = data[i];
+        /* Zero length ends the data; a structure past the report is malformed */
+        if (ad_len == 0 || i + 1U + ad_len > data_len) {
+            break;
+        }
+        if (data[i + 1] == 0x08 || data[i + 1] == 0x09) {
+            uint8_t name_len = ad_len - 1;
+
+            if (name_len > sizeof(name) - 1U) {
+                name_len = sizeof(name) - 1U;
+            }
+            memcpy(name, &data[i + 2], name_len);
+            name[name_len] = '\0';
+            name_found = 1;
+        }
+        i += (ad_len + 1);
+    }
+
+    BLE_Connection_OnScanReport(mac, rssi, name_found ? name : NULL, addr_type);
+}
+
+static void Connection_EvtAdvReport(void *evt)
+{
+    hci_le_advertising_report_event_rp0 *pr = evt;
+    const uint8_t *rep = (const uint8_t *)&pr->Advertising_Report[0];
+    const uint8_t *end = (const uint8_t *)evt + BLE_EvtDispatch_GetParamLen();
+    uint8_t data_len;
+    uint8_t n;
+
+    /* Reports may be batched, each with its own data length: walk the raw bytes,
+       reading each length byte and then the data and RSSI only inside the event */
+    for (n = 0; n < pr->Num_Reports; n++) {
+        if (rep + ADV_REPORT_DATA_LEN_OFS + 1U > end) {
+            break;
+        }
+        data_len = rep[ADV_REPORT_DATA_LEN_OFS];
+        if (rep + ADV_REPORT_FIXED_LEN + data_len > end) {
+            break;
+        }
+        Connection_AdvReport(&rep[ADV_REPORT_ADDR_OFS], rep[ADV_REPORT_ADDR_TYPE_OFS],
+                             &rep[ADV_REPORT_DATA_LEN_OFS + 1U], data_len,
+                             (int8_t)rep[ADV_REPORT_DATA_LEN_OFS + 1U + data_len]);
+        rep += ADV_REPORT_FIXED_LEN + data_len;
+    }
+}
+
+static void Connection_EvtUpdateComplete(void *evt)
+{
+    hci_le_connection_update_complete_event_rp0 *pr = evt;
+
+    BLE_Connection_OnUpdateComplete(pr->Connection_Handle, pr->Status, pr->Conn_Interval,
+                                    pr->Conn_Latency, pr->Supervision_Timeout);
+}
+
+static void Connection_EvtDataLengthChange(void *evt)
+{
+    hci_le_data_length_change_event_rp0 *pr = evt;
+
+    BLE_Connection_OnDataLengthChange(pr->Connection_Handle, pr->MaxTxOctets, pr->MaxRxOctets);
+}
+
+static void Connection_EvtPhyUpdate(void *evt)
+{
+    hci_le_phy_update_complete_event_rp0 *pr = evt;
+
+    BLE_Connection_OnPhyUpdate(pr->Connection_Handle, pr->Status, pr->TX_PHY, pr->RX_PHY);
+}
+
+static void Connection_EvtUpdateRequest(void *evt)
+{
+    aci_l2cap_connection_update_req_event_rp0 *pr = evt;
+    BLE_ConnParams_t req_params;
+
+    req_params.interval_min = pr->Interval_Min;
+    req_params.interval_max = pr->Interval_Max;
+    req_params.latency = pr->Latency;
+    req_params.supervision_timeout = pr->Timeout_Multiplier;
+    BLE_Connection_OnUpdateRequest(pr->Connection_Handle, pr->Identifier, &req_params);
+}
+
+static void Connection_EvtMtuExchanged(void *evt)
+{
+    aci_att_exchange_mtu_resp_event_rp0 *pr = evt;
+
+    BLE_Connection_OnMtuExchanged(pr->Connection_Handle, pr->Server_RX_MTU);
+}
 
 void BLE_Connection_Init(void)
 {
@@ -32,8 +370,30 @@ void BLE_Connection_Init(void)
     for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
         connections[i].conn_handle = 0xFFFF;
         connections[i].state = CONN_STATE_IDLE;
+        connections[i].update_policy = CONN_UPDATE_POLICY_ACCEPT;
+        Link_ResetDefaults(&connections[i]);
     }
     connection_count = 0;
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &nego_timer_id, hw_ts_Repeated, Link_NegoTimerCb);
+    nego_timer_on = 0;
+
+    BLE_EvtDispatch_Register(HCI_DISCONNECTION_COMPLETE_EVT_CODE, 0, Connection_EvtDisconnComplete);
+    BLE_EvtDispatch_Register(HCI_ENCRYPTION_CHANGE_EVT_CODE, 0, Connection_EvtEncryptionChange);
+    BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE,
+                             Connection_EvtConnComplete);
+    BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_ADVERTISING_REPORT_SUBEVT_CODE,
+                             Connection_EvtAdvReport);
+    BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_CONNECTION_UPDATE_COMPLETE_SUBEVT_CODE,
+                             Connection_EvtUpdateComplete);
+    BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_DATA_LENGTH_CHANGE_SUBEVT_CODE,
+                             Connection_EvtDataLengthChange);
+    BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_PHY_UPDATE_COMPLETE_SUBEVT_CODE,
+                             Connection_EvtPhyUpdate);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_CONNECTION_UPDATE_REQ_VSEVT_CODE, Connection_EvtUpdateRequest);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_EXCHANGE_MTU_RESP_VSEVT_CODE, Connection_EvtMtuExchanged);
+
     DEBUG_INFO("Connection Manager initialized");
 }
 
@@ -124,10 +484,10 @@ int BLE_Connection_CreateConnection(const uint8_t *mac)
         dev->addr_type, /* Peer_Address_Type: Public */
         mac,            /* Peer_Address */
         0x00,           /* Own_Address_Type: Public */
-        0x0018,         /* Conn_Interval_Min: 30ms (24 * 1.25ms) */
-        0x0028,         /* Conn_Interval_Max: 50ms (40 * 1.25ms) */
-        0x0000,         /* Conn_Latency: 0 */
-        0x00C8,         /* Supervision_Timeout: 2000ms (200 * 10ms) */
+        default_params.interval_min,
+        default_params.interval_max,
+        default_params.latency,
+        default_params.supervision_timeout,
         0x0000,         /* Minimum_CE_Length: 0 */
         0x0000          /* Maximum_CE_Length: 0 */
     );
@@ -175,6 +535,133 @@ void BLE_Connection_SetState(uint16_t conn_handle, BLE_ConnectionState_t state)
     }
 }
 
+BLE_ConnectionInfo_t* BLE_Connection_GetInfo(uint16_t conn_handle)
+{
+    uint8_t i;
+    
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (connections[i].conn_handle == conn_handle) {
+            return &connections[i];
+        }
+    }
+    return NULL;
+}
+
+BLE_ConnectionInfo_t* BLE_Connection_GetSlot(uint8_t slot)
+{
+    if (slot >= MAX_BLE_CONNECTIONS) {
+        return NULL;
+    }
+    return &connections[slot];
+}
+
+void BLE_Connection_CountTraffic(uint16_t conn_handle, uint8_t is_tx, uint16_t len)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    if (is_tx) {
+        info->tx_packets++;
+        info->tx_bytes += len;
+    } else {
+        info->rx_packets++;
+        info->rx_bytes += len;
+    }
+}
+
+const BLE_ScanStats_t* BLE_Connection_GetScanStats(void)
+{
+    return &scan_stats;
+}
+
+void BLE_Connection_ClearScanStats(void)
+{
+    memset(&scan_stats, 0, sizeof(scan_stats));
+}
+
+int BLE_Connection_SetDefaultParams(const BLE_ConnParams_t *params)
+{
+    if (!ConnParams_IsValid(params)) {
+        DEBUG_ERROR("Invalid default conn params");
+        return -1;
+    }
+    
+    default_params = *params;
+    DEBUG_INFO("Default conn params: int=%d-%d lat=%d to=%d",
+               params->interval_min, params->interval_max,
+               params->latency, params->supervision_timeout);
+    return 0;
+}
+
+void BLE_Connection_GetDefaultParams(BLE_ConnParams_t *params)
+{
+    if (params != NULL) {
+        *params = default_params;
+    }
+}
+
+int BLE_Connection_UpdateParams(uint16_t conn_handle, const BLE_ConnParams_t *params)
+{
+    tBleStatus ret;
+    
+    if (BLE_Connection_GetInfo(conn_handle) == NULL) {
+        return -1;
+    }
+    if (!ConnParams_IsValid(params)) {
+        DEBUG_ERROR("Invalid conn params for 0x%04X", conn_handle);
+        return -1;
+    }
+    
+    DEBUG_INFO("Conn update 0x%04X: int=%d-%d lat=%d to=%d", conn_handle,
+               params->interval_min, params->interval_max,
+               params->latency, params->supervision_timeout);
+    
+    /* GAP procedure first; falls back to the raw HCI command when the
+     * GAP layer refuses (e.g. another GAP procedure is running) */
+    ret = aci_gap_start_connection_update(conn_handle,
+                                          params->interval_min,
+                                          params->interval_max,
+                                          params->latency,
+                                          params->supervision_timeout,
+                                          0x0000, 0x0000);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_WARN("GAP conn update failed: 0x%02X, using HCI", ret);
+        ret = hci_le_connection_update(conn_handle,
+                                       params->interval_min,
+                                       params->interval_max,
+                                       params->latency,
+                                       params->supervision_timeout,
+                                       0x0000, 0x0000);
+    }
+    
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("Failed to update connection: 0x%02X", ret);
+        return -1;
+    }
+    
+    return 0;
+}
+
+int BLE_Connection_SetUpdatePolicy(uint16_t conn_handle, BLE_ConnUpdatePolicy_t policy)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL || policy > CONN_UPDATE_POLICY_RANGE) {
+        return -1;
+    }
+    
+    info->update_policy = policy;
+    DEBUG_INFO("Conn 0x%04X update policy: %d", conn_handle, (int)policy);
+    return 0;
+}
+
 BLE_ConnectionState_t BLE_Connection_GetState(uint16_t conn_handle)
 {
     uint8_t i;
@@ -204,12 +691,22 @@ void BLE_Connection_OnScanReport(const uint8_t *mac, int8_t rssi,
 {
     int idx;
     BLE_Device_t *dev;
+    uint8_t known;
     
     if (mac == NULL) {
         return;
     }
     
+    scan_stats.reports++;
+    BLE_EventBus_OnScanReport(mac, rssi, name, addr_type);
+    
+    known = BLE_DeviceManager_GetCount();
     idx = BLE_DeviceManager_AddDevice(mac, rssi);
+    if (idx < 0) {
+        scan_stats.table_full++;
+    } else if (BLE_DeviceManager_GetCount() != known) {
+        scan_stats.new_devices++;
+    }
     
     if (idx >= 0) {
         dev = BLE_DeviceManager_GetDevice(idx);
@@ -227,6 +724,7 @@ void BLE_Connection_OnScanReport(const uint8_t *mac, int8_t rssi,
         /* Send AT response for newly discovered device */
         if (!dev->reported_in_scan) {
             dev->reported_in_scan = 1;
+            scan_stats.host_reports++;
             AT_Response_Send("+SCAN:%02X:%02X:%02X:%02X:%02X:%02X,%d,%s\r\n",
                 mac[5], mac[4], mac[3], mac[2], mac[1], mac[0],
                 (int)rssi,
@@ -240,12 +738,14 @@ void BLE_Connection_OnConnected(const uint8_t *mac, uint16_t conn_handle, uint8_
 {
     int dev_idx;
     uint8_t i;
+    BLE_Device_t *dev;
     
     DEBUG_INFO("Conn complete: hdl=0x%04X status=0x%02X", conn_handle, status);
     
     if (status != 0) {
         DEBUG_ERROR("Conn failed: 0x%02X", status);
         AT_Response_Send("+CONN_ERROR:%02X\r\n", status);
+        BLE_EventBus_OnConnectionComplete(mac, conn_handle, status);
         return;
     }
     
@@ -258,13 +758,27 @@ void BLE_Connection_OnConnected(const uint8_t *mac, uint16_t conn_handle, uint8_
             if (connections[i].conn_handle == 0xFFFF) {
                 connections[i].conn_handle = conn_handle;
                 connections[i].state = CONN_STATE_CONNECTED;
+                connections[i].update_policy = CONN_UPDATE_POLICY_ACCEPT;
                 memcpy(connections[i].mac_addr, mac, BLE_MAC_LEN);
+                Link_ResetDefaults(&connections[i]);
+                connections[i].connect_tick = HAL_GetTick();
                 connection_count++;
                 break;
             }
         }
         
         AT_Response_Send("+CONNECTED:%d,0x%04X\r\n", dev_idx, conn_handle);
+        BLE_EventBus_OnConnectionComplete(mac, conn_handle, status);
+        
+        dev = BLE_DeviceManager_GetDevice(dev_idx);
+        if (i < MAX_BLE_CONNECTIONS && dev != NULL && dev->nego_mask != 0U) {
+            Link_StartNegotiation(&connections[i], dev->nego_mask);
+        }
+        
+        /* Without an MTU exchange the ATT bearer is free right away */
+        if (i < MAX_BLE_CONNECTIONS && dev != NULL && (dev->nego_mask & BLE_NEGO_MTU) == 0U) {
+            BLE_GattCache_OnLinkUp(conn_handle);
+        }
     }
 }
 
@@ -280,17 +794,211 @@ void BLE_Connection_OnDisconnected(uint16_t conn_handle, uint8_t reason)
         BLE_DeviceManager_UpdateConnection(dev_idx, conn_handle, 0);
     }
     
+    BLE_GattDisc_OnDisconnected(conn_handle);
+    BLE_GattCache_OnDisconnected(conn_handle);
+    BLE_GattQueue_OnDisconnected(conn_handle);
+    BLE_GattReadM_OnDisconnected(conn_handle);
+    BLE_GattStream_OnDisconnected(conn_handle);
+    BLE_GattResolve_OnDisconnected(conn_handle);
+    BLE_GattInd_OnDisconnected(conn_handle);
+    BLE_GattSub_OnDisconnected(conn_handle);
+    BLE_L2capCoc_OnDisconnected(conn_handle);
+    
+    /* Published before the slot goes, so device filters still resolve the handle */
+    BLE_EventBus_OnDisconnectionComplete(conn_handle, reason);
+    
     /* Remove from connections */
     for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
         if (connections[i].conn_handle == conn_handle) {
             connections[i].conn_handle = 0xFFFF;
             connections[i].state = CONN_STATE_IDLE;
+            Link_ResetDefaults(&connections[i]);
             if (connection_count > 0) {
                 connection_count--;
             }
             break;
         }
     }
+    Link_NegoTimerUpdate();
     
     AT_Response_Send("+DISCONNECTED:0x%04X\r\n", conn_handle);
 }
+
+void BLE_Connection_OnLinkParams(uint16_t conn_handle, uint16_t interval,
+                                 uint16_t latency, uint16_t timeout)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    info->conn_interval = interval;
+    info->conn_latency = latency;
+    info->supervision_timeout = timeout;
+}
+
+void BLE_Connection_OnMtuExchanged(uint16_t conn_handle, uint16_t server_mtu)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    /* Effective MTU is the smaller of both sides' RX MTU */
+    info->att_mtu = (server_mtu < CFG_BLE_MAX_ATT_MTU) ? server_mtu : CFG_BLE_MAX_ATT_MTU;
+    if (info->att_mtu < LINK_DEFAULT_ATT_MTU) {
+        info->att_mtu = LINK_DEFAULT_ATT_MTU;
+    }
+    DEBUG_INFO("Conn 0x%04X MTU: %d (server %d)", conn_handle, info->att_mtu, server_mtu);
+}
+
+void BLE_Connection_OnDataLengthChange(uint16_t conn_handle, uint16_t max_tx_octets,
+                                       uint16_t max_rx_octets)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    info->max_tx_octets = max_tx_octets;
+    info->max_rx_octets = max_rx_octets;
+    DEBUG_INFO("Conn 0x%04X data length: tx=%d rx=%d", conn_handle, max_tx_octets, max_rx_octets);
+    Link_NegoDone(info, BLE_NEGO_DLE);
+}
+
+void BLE_Connection_OnPhyUpdate(uint16_t conn_handle, uint8_t status,
+                                uint8_t tx_phy, uint8_t rx_phy)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    if (status != 0) {
+        DEBUG_WARN("Conn 0x%04X PHY update failed: 0x%02X", conn_handle, status);
+    } else {
+        info->tx_phy = tx_phy;
+        info->rx_phy = rx_phy;
+        DEBUG_INFO("Conn 0x%04X PHY: tx=%d rx=%d", conn_handle, tx_phy, rx_phy);
+    }
+    Link_NegoDone(info, BLE_NEGO_PHY_2M);
+}
+
+void BLE_Connection_OnMtuDone(uint16_t conn_handle, uint8_t error_code)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL || (info->nego_pending & BLE_NEGO_MTU) == 0U) {
+        return;
+    }
+    
+    /* MTU already stored if the peer answered */
+    if (error_code != 0) {
+        DEBUG_WARN("Conn 0x%04X MTU exchange error: 0x%02X", conn_handle, error_code);
+    }
+    Link_NegoDone(info, BLE_NEGO_MTU);
+    BLE_GattCache_OnLinkUp(conn_handle);
+}
+
+void BLE_Connection_OnEncryptionChange(uint16_t conn_handle, uint8_t status, uint8_t enabled)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    
+    if (info == NULL) {
+        return;
+    }
+    
+    if (status != 0) {
+        DEBUG_WARN("Conn 0x%04X encryption failed: 0x%02X", conn_handle, status);
+        return;
+    }
+    info->encrypted = enabled ? 1U : 0U;
+    DEBUG_INFO("Conn 0x%04X encryption %s", conn_handle, info->encrypted ? "on" : "off");
+}
+
+void BLE_Connection_OnUpdateRequest(uint16_t conn_handle, uint8_t identifier,
+                                    const BLE_ConnParams_t *params)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    uint8_t accept = 0;
+    tBleStatus ret;
+    
+    if (params == NULL) {
+        return;
+    }
+    
+    if (info != NULL && ConnParams_IsValid(params)) {
+        switch (info->update_policy) {
+        case CONN_UPDATE_POLICY_ACCEPT:
+            accept = 1;
+            break;
+        case CONN_UPDATE_POLICY_RANGE:
+            accept = (params->interval_min >= default_params.interval_min &&
+                      params->interval_max <= default_params.interval_max) ? 1U : 0U;
+            break;
+        default:
+            break;
+        }
+    }
+    
+    DEBUG_INFO("Conn update req 0x%04X: int=%d-%d lat=%d to=%d -> %s", conn_handle,
+               params->interval_min, params->interval_max,
+               params->latency, params->supervision_timeout,
+               accept ? "accept" : "reject");
+    
+    ret = aci_l2cap_connection_parameter_update_resp(conn_handle,
+                                                     params->interval_min,
+                                                     params->interval_max,
+                                                     params->latency,
+                                                     params->supervision_timeout,
+                                                     0x0000, 0x0000,
+                                                     identifier,
+                                                     accept);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("Failed to answer conn update req: 0x%02X", ret);
+    }
+}
+
+void BLE_Connection_OnUpdateComplete(uint16_t conn_handle, uint8_t status, uint16_t interval,
+                                     uint16_t latency, uint16_t timeout)
+{
+    BLE_LinkAdapt_OnUpdateComplete(conn_handle, status, interval);
+
+    if (status != 0) {
+        DEBUG_ERROR("Conn update 0x%04X failed: 0x%02X", conn_handle, status);
+        AT_Response_Send("+CONNUPDATE_ERROR:0x%04X,%02X\r\n", conn_handle, status);
+        return;
+    }
+    
+    BLE_Connection_OnLinkParams(conn_handle, interval, latency, timeout);
+    DEBUG_INFO("Conn 0x%04X updated: int=%d lat=%d to=%d", conn_handle, interval, latency, timeout);
+    AT_Response_Send("+CONNUPDATE:0x%04X,%d,%d,%d\r\n", conn_handle, interval, latency, timeout);
+}
+
+void BLE_Connection_NegoProcess(void)
+{
+    BLE_ConnectionInfo_t *info;
+    uint32_t now = HAL_GetTick();
+    uint8_t i;
+    
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        info = &connections[i];
+        if (info->conn_handle == 0xFFFF || (info->nego_pending & LINK_NEGO_EVT_STEPS) == 0U) {
+            continue;
+        }
+        if ((now - info->connect_tick) < BLE_NEGO_TIMEOUT_MS) {
+            continue;
+        }
+        
+        /* Values unchanged or peer without the feature: keep what the link runs */
+        DEBUG_WARN("Conn 0x%04X negotiation 0x%02X: no event, keeping tx=%d rx=%d phy=%d/%d",
+                   info->conn_handle, info->nego_pending & LINK_NEGO_EVT_STEPS,
+                   info->max_tx_octets, info->max_rx_octets, info->tx_phy, info->rx_phy);
+        Link_NegoDone(info, info->nego_pending & LINK_NEGO_EVT_STEPS);
+    }
+    Link_NegoTimerUpdate();
+}
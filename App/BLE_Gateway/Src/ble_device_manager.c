@@ -7,6 +7,7 @@
   */
 
 #include "ble_device_manager.h"
+#include "ble_connection.h"
 #include "debug_trace.h"
 
 static BLE_DeviceManager_t device_manager;
@@ -58,6 +59,7 @@ int BLE_DeviceManager_AddDevice(const uint8_t *mac, int8_t rssi)
         device_manager.devices[idx].conn_handle = 0xFFFF;
         device_manager.devices[idx].name[0] = '\0';
         device_manager.devices[idx].reported_in_scan = 0;
+        device_manager.devices[idx].nego_mask = BLE_NEGO_ALL;
         device_manager.device_count++;
         list_full_warned = 0;  /* Reset warning flag */
         
@@ -190,6 +192,16 @@ void BLE_DeviceManager_UpdateName(int dev_idx, const char *name)
     DEBUG_INFO("Dev[%d] name updated: %s", dev_idx, name);
 }
 
+void BLE_DeviceManager_SetNegoMask(int dev_idx, uint8_t mask)
+{
+    if (dev_idx < 0 || dev_idx >= (int)device_manager.device_count) {
+        return;
+    }
+
+    device_manager.devices[dev_idx].nego_mask = mask & BLE_NEGO_ALL;
+    DEBUG_INFO("Dev[%d] nego mask: 0x%02X", dev_idx, mask);
+}
+
 void BLE_DeviceManager_ResetScanFlags(void)
 {
     uint8_t i;
@@ -0,0 +1,315 @@
+/**
+  ******************************************************************************
+  * @file    ble_event_bus.c
+  * @brief   BLE Event Bus implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_event_bus.h"
+#include "ble_connection.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <string.h>
+
+#if (EVTBUS_CYCLE_STATS != 0)
+#define EVTBUS_CYCLES()             (DWT->CYCCNT)
+#else
+#define EVTBUS_CYCLES()             (0U)
+#endif
+
+/* Subscriber table; no unsubscribe, ids stay valid */
+static BLE_EventBusSub_t bus_sub[EVTBUS_MAX_SUBSCRIBERS];
+static BLE_EventBusHandler_t bus_handler[EVTBUS_MAX_SUBSCRIBERS];
+static uint8_t bus_count;
+
+/* Subscriber ids per event type, in subscription order */
+static uint8_t bus_list[EVTBUS_EVT_COUNT][EVTBUS_MAX_SUBSCRIBERS];
+static uint8_t bus_list_len[EVTBUS_EVT_COUNT];
+
+static void EventBus_EvtNotification(void *evt)
+{
+    aci_gatt_notification_event_rp0 *pr = evt;
+
+    BLE_EventBus_OnNotification(pr->Connection_Handle, pr->Attribute_Handle,
+                                pr->Attribute_Value, pr->Attribute_Value_Length);
+}
+
+/**
+ * @brief Store a filter, NULL meaning all events
+ */
+static void EventBus_CopyFilter(BLE_EventBusFilter_t *f, const BLE_EventBusFilter_t *filter)
+{
+    if (filter != NULL) {
+        *f = *filter;
+    } else {
+        memset(f, 0, sizeof(*f));
+        f->conn_handle = EVTBUS_ANY_CONN;
+        f->attr_handle = EVTBUS_ANY_ATTR;
+    }
+}
+
+/**
+ * @brief Check an event against a subscriber filter
+ * @param mac Device address of the event, resolved on first use
+ * @return 1 if the subscriber gets the event
+ */
+static uint8_t EventBus_Match(const BLE_EventBusFilter_t *f, const BLE_EventBusEvt_t *evt,
+                              const uint8_t **mac, uint8_t *mac_known)
+{
+    BLE_ConnectionInfo_t *info;
+
+    if (f->conn_handle != EVTBUS_ANY_CONN && evt->conn_handle != EVTBUS_ANY_CONN &&
+        f->conn_handle != evt->conn_handle) {
+        return 0;
+    }
+    if (f->attr_handle != EVTBUS_ANY_ATTR && evt->attr_handle != EVTBUS_ANY_ATTR &&
+        f->attr_handle != evt->attr_handle) {
+        return 0;
+    }
+    if (f->match_mac != 0U) {
+        /* Link events carry only the handle: look the device up once per event */
+        if (*mac_known == 0U) {
+            info = BLE_Connection_GetInfo(evt->conn_handle);
+            *mac = (info != NULL) ? info->mac_addr : NULL;
+            *mac_known = 1;
+        }
+        if (*mac == NULL || memcmp(*mac, f->mac, sizeof(f->mac)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void BLE_EventBus_Init(void)
+{
+    memset(bus_sub, 0, sizeof(bus_sub));
+    memset(bus_handler, 0, sizeof(bus_handler));
+    memset(bus_list, 0, sizeof(bus_list));
+    memset(bus_list_len, 0, sizeof(bus_list_len));
+    bus_count = 0;
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_NOTIFICATION_VSEVT_CODE, EventBus_EvtNotification);
+
+    DEBUG_INFO("Event Bus initialized");
+}
+
+int BLE_EventBus_Subscribe(const char *name, uint32_t mask, const BLE_EventBusFilter_t *filter,
+                           BLE_EventBusHandler_t handler)
+{
+    BLE_EventBusSub_t *s;
+    uint8_t type;
+
+    if (handler == NULL || (mask & EVTBUS_MASK_ALL) == 0U) {
+        return -1;
+    }
+    if (bus_count >= EVTBUS_MAX_SUBSCRIBERS) {
+        DEBUG_ERROR("Event bus full: %s", (name != NULL) ? name : "?");
+        return -1;
+    }
+
+    s = &bus_sub[bus_count];
+    s->name = (name != NULL) ? name : "?";
+    s->mask = mask & EVTBUS_MASK_ALL;
+    EventBus_CopyFilter(&s->filter, filter);
+    bus_handler[bus_count] = handler;
+    for (type = 0; type < EVTBUS_EVT_COUNT; type++) {
+        if ((s->mask & EVTBUS_MASK(type)) != 0U) {
+            bus_list[type][bus_list_len[type]++] = bus_count;
+        }
+    }
+    return bus_count++;
+}
+
+int BLE_EventBus_SetFilter(uint8_t id, const BLE_EventBusFilter_t *filter)
+{
+    if (id >= bus_count) {
+        return -1;
+    }
+    EventBus_CopyFilter(&bus_sub[id].filter, filter);
+    return 0;
+}
+
+uint8_t BLE_EventBus_Publish(const BLE_EventBusEvt_t *evt)
+{
+    const uint8_t *list;
+    const uint8_t *mac = evt->mac;
+    uint8_t mac_known = (evt->mac != NULL) ? 1U : 0U;
+    BLE_EventBusSub_t *s;
+    uint32_t t0;
+    uint32_t dt;
+    uint8_t calls = 0;
+    uint8_t n;
+    uint8_t i;
+
+    if (evt->type >= EVTBUS_EVT_COUNT) {
+        return 0;
+    }
+    list = bus_list[evt->type];
+    n = bus_list_len[evt->type];
+
+    for (i = 0; i < n; i++) {
+        s = &bus_sub[list[i]];
+        if (EventBus_Match(&s->filter, evt, &mac, &mac_known) == 0U) {
+            s->filtered++;
+            continue;
+        }
+
+        t0 = EVTBUS_CYCLES();
+        bus_handler[list[i]](evt);
+        dt = EVTBUS_CYCLES() - t0;
+
+        s->calls++;
+        s->cycles += dt;
+        if (dt > s->cycles_max) {
+            s->cycles_max = dt;
+        }
+        calls++;
+    }
+    return calls;
+}
+
+uint8_t BLE_EventBus_GetCount(void)
+{
+    return bus_count;
+}
+
+const BLE_EventBusSub_t* BLE_EventBus_GetSub(uint8_t id)
+{
+    if (id >= bus_count) {
+        return NULL;
+    }
+    return &bus_sub[id];
+}
+
+void BLE_EventBus_ClearStats(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < bus_count; i++) {
+        bus_sub[i].calls = 0;
+        bus_sub[i].filtered = 0;
+        bus_sub[i].cycles = 0;
+        bus_sub[i].cycles_max = 0;
+    }
+}
+
+void BLE_EventBus_OnScanReport(const uint8_t *mac, int8_t rssi, const char *name, uint8_t addr_type)
+{
+    BLE_EventBusEvt_t evt;
+
+    if (bus_list_len[EVTBUS_EVT_SCAN_REPORT] == 0U) {
+        return;
+    }
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_SCAN_REPORT;
+    evt.conn_handle = EVTBUS_ANY_CONN;
+    evt.mac = mac;
+    evt.rssi = rssi;
+    evt.name = name;
+    evt.addr_type = addr_type;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnConnectionComplete(const uint8_t *mac, uint16_t conn_handle, uint8_t status)
+{
+    BLE_EventBusEvt_t evt;
+
+    DEBUG_PRINT("Event: Connection Complete - handle=0x%04X, status=0x%02X", conn_handle, status);
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_CONNECTED;
+    evt.conn_handle = conn_handle;
+    evt.mac = mac;
+    evt.status = status;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnDisconnectionComplete(uint16_t conn_handle, uint8_t reason)
+{
+    BLE_EventBusEvt_t evt;
+
+    DEBUG_PRINT("Event: Disconnection Complete - handle=0x%04X, reason=0x%02X", conn_handle, reason);
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_DISCONNECTED;
+    evt.conn_handle = conn_handle;
+    evt.status = reason;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnNotification(uint16_t conn_handle, uint16_t handle,
+                                 const uint8_t *data, uint16_t len)
+{
+    DEBUG_PRINT("Event: Notification - conn=0x%04X, handle=0x%04X, len=%d", conn_handle, handle, len);
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+    if (BLE_GattSub_FilterNotification(conn_handle, handle, data, len)) {
+        BLE_EventBus_DeliverNotification(conn_handle, handle, data, len);
+    }
+}
+
+void BLE_EventBus_DeliverNotification(uint16_t conn_handle, uint16_t handle,
+                                      const uint8_t *data, uint16_t len)
+{
+    BLE_EventBusEvt_t evt;
+
+    /* Hot path: fill only what a notification carries */
+    evt.type = EVTBUS_EVT_NOTIFICATION;
+    evt.status = 0;
+    evt.addr_type = 0;
+    evt.rssi = 0;
+    evt.conn_handle = conn_handle;
+    evt.attr_handle = handle;
+    evt.mac = NULL;
+    evt.name = NULL;
+    evt.data = data;
+    evt.len = len;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnIndication(uint16_t conn_handle, uint16_t handle,
+                               const uint8_t *data, uint16_t len)
+{
+    BLE_EventBusEvt_t evt;
+
+    DEBUG_PRINT("Event: Indication - conn=0x%04X, handle=0x%04X, len=%d", conn_handle, handle, len);
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_INDICATION;
+    evt.conn_handle = conn_handle;
+    evt.attr_handle = handle;
+    evt.data = data;
+    evt.len = len;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnReadResponse(uint16_t conn_handle, uint16_t handle,
+                                 const uint8_t *data, uint16_t len)
+{
+    BLE_EventBusEvt_t evt;
+
+    DEBUG_PRINT("Event: Read Response - conn=0x%04X, handle=0x%04X, len=%d", conn_handle, handle, len);
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_READ_RSP;
+    evt.conn_handle = conn_handle;
+    evt.attr_handle = handle;
+    evt.data = data;
+    evt.len = len;
+    BLE_EventBus_Publish(&evt);
+}
+
+void BLE_EventBus_OnWriteResponse(uint16_t conn_handle, uint8_t status)
+{
+    BLE_EventBusEvt_t evt;
+
+    DEBUG_PRINT("Event: Write Response - conn=0x%04X, status=0x%02X", conn_handle, status);
+    memset(&evt, 0, sizeof(evt));
+    evt.type = EVTBUS_EVT_WRITE_RSP;
+    evt.conn_handle = conn_handle;
+    evt.status = status;
+    BLE_EventBus_Publish(&evt);
+}
@@ -0,0 +1,377 @@
+/**
+  ******************************************************************************
+  * @file    ble_evt_dispatch.c
+  * @brief   BLE event dispatcher implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_std.h"
+#include "svc_ctl.h"
+#include "tl.h"
+#include "hci_tl.h"
+#include <string.h>
+
+/* Vendor ecode = group (bits 15:10) | code (bits 9:0) */
+#define EVTDISP_VS_GROUP(ecode)     ((uint16_t)(ecode) >> 10)
+#define EVTDISP_VS_CODE(ecode)      ((uint16_t)(ecode) & 0x03FFU)
+
+#if (EVTDISP_CYCLE_STATS != 0)
+#define EVTDISP_CYCLES()            (DWT->CYCCNT)
+#else
+#define EVTDISP_CYCLES()            (0U)
+#endif
+
+/* Handler lists: heads and links hold node number + 1, 0 ends a list */
+static BLE_EvtDispatchHandler_t disp_handler[EVTDISP_MAX_HANDLERS];
+static uint8_t disp_next[EVTDISP_MAX_HANDLERS];
+static uint8_t disp_used;
+static uint8_t disp_len;            /* Parameter bytes at evt of the event being handled */
+
+static uint8_t evt_head[256];
+static uint8_t le_head[EVTDISP_LE_SUBEVT_COUNT];
+static uint8_t vs_head[EVTDISP_VS_GROUP_COUNT][EVTDISP_VS_CODE_COUNT];
+static const uint8_t no_head = 0;   /* Keys outside the tables: always empty */
+
+static BLE_EvtDispatchStats_t disp_stats[EVTDISP_CLASS_COUNT];
+
+/* Deferred event ring: records are stored contiguously; when the end of the
+ * buffer is too short, writing restarts at 0 and ring_end marks the gap */
+static uint8_t ring_buf[EVTDISP_RING_SIZE];
+static uint16_t ring_wr;
+static uint16_t ring_rd;
+static uint16_t ring_end;
+static uint16_t ring_used;          /* Record bytes, gap excluded */
+static uint8_t ring_defer;
+static uint8_t ring_stalled;        /* Event flow stopped on a full ring */
+
+static BLE_EvtDispatchRingStats_t ring_stats;
+
+/**
+ * @brief Get the list head of a key
+ * @return Head, or &no_head if the key has no table entry
+ */
+static const uint8_t* EvtDispatch_Head(uint8_t evt, uint16_t code)
+{
+    if (evt == HCI_LE_META_EVT_CODE) {
+        return (code < EVTDISP_LE_SUBEVT_COUNT) ? &le_head[code] : &no_head;
+    }
+    if (evt == HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE) {
+        if (EVTDISP_VS_GROUP(code) >= EVTDISP_VS_GROUP_COUNT ||
+            EVTDISP_VS_CODE(code) >= EVTDISP_VS_CODE_COUNT) {
+            return &no_head;
+        }
+        return &vs_head[EVTDISP_VS_GROUP(code)][EVTDISP_VS_CODE(code)];
+    }
+    return &evt_head[evt];
+}
+
+/**
+ * @brief Find room for one record
+ * @return Write offset, or -1 if the ring is too full
+ */
+static int EvtDispatch_RingReserve(uint16_t need)
+{
+    if (ring_used == 0U) {
+        ring_wr = 0;
+        ring_rd = 0;
+        ring_end = EVTDISP_RING_SIZE;
+    }
+    if (ring_used == 0U || ring_wr > ring_rd) {
+        if ((uint16_t)(EVTDISP_RING_SIZE - ring_wr) >= need) {
+            return ring_wr;
+        }
+        return (ring_rd >= need) ? 0 : -1;
+    }
+    /* Wrapped (or full when both offsets meet) */
+    return ((uint16_t)(ring_rd - ring_wr) >= need) ? ring_wr : -1;
+}
+
+/**
+ * @brief Copy one event packet into the ring
+ * @return 0 if stored, -1 if the ring is full
+ */
+static int EvtDispatch_RingPush(const uint8_t *pkt, uint16_t len, uint32_t stamp)
+{
+    uint16_t need = EVTDISP_RECORD_HDR + len;
+    int at = EvtDispatch_RingReserve(need);
+    uint8_t *rec;
+
+    if (at < 0) {
+        return -1;
+    }
+    if (at == 0 && ring_used != 0U && ring_wr != 0U) {
+        ring_end = ring_wr;
+    }
+
+    rec = &ring_buf[at];
+    rec[0] = (uint8_t)len;
+    rec[1] = (uint8_t)(len >> 8);
+    memcpy(&rec[2], &stamp, sizeof(stamp));
+    memcpy(&rec[EVTDISP_RECORD_HDR], pkt, len);
+
+    ring_wr = (uint16_t)at + need;
+    ring_used += need;
+    if (ring_used > ring_stats.peak) {
+        ring_stats.peak = ring_used;
+    }
+    ring_stats.deferred++;
+    return 0;
+}
+
+void BLE_EvtDispatch_Init(void)
+{
+    memset(disp_handler, 0, sizeof(disp_handler));
+    memset(disp_next, 0, sizeof(disp_next));
+    memset(evt_head, 0, sizeof(evt_head));
+    memset(le_head, 0, sizeof(le_head));
+    memset(vs_head, 0, sizeof(vs_head));
+    disp_used = 0;
+    ring_wr = 0;
+    ring_rd = 0;
+    ring_end = EVTDISP_RING_SIZE;
+    ring_used = 0;
+    ring_defer = 1;
+    ring_stalled = 0;
+    BLE_EvtDispatch_ClearStats();
+
+#if (EVTDISP_CYCLE_STATS != 0)
+    /* Free-running CPU cycle counter, not reset: the TL statistics may use it already */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+int BLE_EvtDispatch_Register(uint8_t evt, uint16_t code, BLE_EvtDispatchHandler_t handler)
+{
+    uint8_t *link = (uint8_t *)EvtDispatch_Head(evt, code);
+
+    if (link == &no_head || handler == 0) {
+        DEBUG_ERROR("Event 0x%02X/0x%04X: no dispatch slot", evt, code);
+        return -1;
+    }
+    if (disp_used >= EVTDISP_MAX_HANDLERS) {
+        DEBUG_ERROR("Event 0x%02X/0x%04X: handler pool full", evt, code);
+        return -1;
+    }
+
+    /* Append, so handlers of one key keep registration order */
+    while (*link != 0U) {
+        link = &disp_next[*link - 1U];
+    }
+    disp_handler[disp_used] = handler;
+    disp_next[disp_used] = 0;
+    disp_used++;
+    *link = disp_used;
+    return 0;
+}
+
+uint8_t BLE_EvtDispatch_Process(void *pckt)
+{
+    hci_event_pckt *event_pckt = (hci_event_pckt *)((hci_uart_pckt *)pckt)->data;
+    BLE_EvtDispatchStats_t *s;
+    uint32_t t0 = EVTDISP_CYCLES();
+    uint32_t t1;
+    uint32_t t2;
+    uint8_t node;
+    uint8_t calls = 0;
+    uint8_t prev_len = disp_len;
+    void *evt;
+
+    if (event_pckt->evt == HCI_LE_META_EVT_CODE) {
+        evt_le_meta_event *meta_evt = (evt_le_meta_event *)event_pckt->data;
+
+        s = &disp_stats[EVTDISP_CLASS_LE_META];
+        node = *EvtDispatch_Head(HCI_LE_META_EVT_CODE, meta_evt->subevent);
+        evt = meta_evt->data;
+        disp_len = (event_pckt->plen > 1U) ? (uint8_t)(event_pckt->plen - 1U) : 0U;
+    } else if (event_pckt->evt == HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE) {
+        evt_blecore_aci *blecore_evt = (evt_blecore_aci *)event_pckt->data;
+
+        s = &disp_stats[EVTDISP_CLASS_VENDOR];
+        node = *EvtDispatch_Head(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, blecore_evt->ecode);
+        evt = blecore_evt->data;
+        disp_len = (event_pckt->plen > 2U) ? (uint8_t)(event_pckt->plen - 2U) : 0U;
+    } else {
+        s = &disp_stats[EVTDISP_CLASS_HCI];
+        node = evt_head[event_pckt->evt];
+        evt = event_pckt->data;
+        disp_len = event_pckt->plen;
+    }
+    t1 = EVTDISP_CYCLES();
+
+    while (node != 0U) {
+        disp_handler[node - 1U](evt);
+        node = disp_next[node - 1U];
+        calls++;
+    }
+    t2 = EVTDISP_CYCLES();
+    disp_len = prev_len;            /* A handler may have dispatched a nested event */
+
+    s->events++;
+    if (calls == 0U) {
+        s->unhandled++;
+    }
+    s->lookup_cycles += t1 - t0;
+    if ((t1 - t0) > s->lookup_max) {
+        s->lookup_max = t1 - t0;
+    }
+    s->handler_cycles += t2 - t1;
+    if ((t2 - t1) > s->handler_max) {
+        s->handler_max = t2 - t1;
+    }
+    return calls;
+}
+
+uint8_t BLE_EvtDispatch_GetParamLen(void)
+{
+    return disp_len;
+}
+
+void BLE_EvtDispatch_ProcessDeferred(void)
+{
+    uint8_t *rec;
+    uint16_t need;
+    uint32_t stamp;
+    uint32_t wait;
+    uint8_t n;
+
+    for (n = 0; n < EVTDISP_DEFER_BURST && ring_used != 0U; n++) {
+        if (ring_rd == ring_end) {
+            ring_rd = 0;
+            ring_end = EVTDISP_RING_SIZE;
+        }
+        rec = &ring_buf[ring_rd];
+        need = EVTDISP_RECORD_HDR + (uint16_t)(rec[0] | ((uint16_t)rec[1] << 8));
+        memcpy(&stamp, &rec[2], sizeof(stamp));
+
+        wait = EVTDISP_CYCLES() - stamp;
+        ring_stats.wait_cycles += wait;
+        if (wait > ring_stats.wait_max) {
+            ring_stats.wait_max = wait;
+        }
+
+        /* Record stays reserved while its handlers run: events arriving
+         * meanwhile (handler waiting on a command) go behind it */
+        BLE_EvtDispatch_Process(&rec[EVTDISP_RECORD_HDR]);
+        ring_rd += need;
+        ring_used -= need;
+    }
+
+    if (ring_stalled != 0U && EvtDispatch_RingReserve(EVTDISP_RECORD_MAX) >= 0) {
+        ring_stalled = 0;
+        SVCCTL_ResumeUserEventFlow();
+    }
+    if (ring_used != 0U) {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_EVT_DEFER_ID, CFG_SCH_PRIO_NOTIFY);
+    }
+}
+
+void BLE_EvtDispatch_EnableDefer(uint8_t enable)
+{
+    ring_defer = (enable != 0U) ? 1U : 0U;
+}
+
+uint8_t BLE_EvtDispatch_IsDeferEnabled(void)
+{
+    return ring_defer;
+}
+
+uint16_t BLE_EvtDispatch_GetRingUsed(void)
+{
+    return ring_used;
+}
+
+const BLE_EvtDispatchRingStats_t* BLE_EvtDispatch_GetRingStats(void)
+{
+    return &ring_stats;
+}
+
+void BLE_EvtDispatch_GetTlStats(BLE_EvtDispatchTlStats_t *stats)
+{
+    const HCI_TL_Stats_t *h = hci_get_stats();
+    const TL_MM_Stats_t *m = TL_MM_GetStats();
+
+    stats->events = h->AsynchEvtCount;
+    stats->queue_depth = h->AsynchQueueDepth;
+    stats->queue_max = h->AsynchQueueMax;
+    stats->flow_off = h->UserEvtFlowOff;
+    stats->flow_off_count = h->FlowOffCount;
+    stats->flow_off_cycles = h->FlowOffCycles;
+    stats->flow_off_max = h->FlowOffMax;
+    stats->pool_size = m->PoolSize;
+    stats->held = m->Held;
+    stats->held_max = m->HeldMax;
+    stats->local_free_max = m->LocalFreeMax;
+    stats->returned = m->Returned;
+    stats->return_cycles = m->ReturnCycles;
+    stats->return_max = m->ReturnMax;
+}
+
+void BLE_EvtDispatch_ClearTlStats(void)
+{
+    hci_clear_stats();
+    TL_MM_ClearStats();
+}
+
+uint8_t BLE_EvtDispatch_GetUsed(void)
+{
+    return disp_used;
+}
+
+const BLE_EvtDispatchStats_t* BLE_EvtDispatch_GetStats(BLE_EvtDispatchClass_t cls)
+{
+    if (cls >= EVTDISP_CLASS_COUNT) {
+        return NULL;
+    }
+    return &disp_stats[cls];
+}
+
+void BLE_EvtDispatch_ClearStats(void)
+{
+    memset(disp_stats, 0, sizeof(disp_stats));
+    memset(&ring_stats, 0, sizeof(ring_stats));
+    ring_stats.peak = ring_used;
+}
+
+/**
+ * @brief Stack user event entry point, replaces the weak svc_ctl version
+ * @note  Each event is decoded once and goes straight to the handlers
+ *        subscribed to its key; the service/client handler walk and the
+ *        SVCCTL_App_Notification switch are no longer on the path.
+ *        With deferral on, the packet is copied to the ring and the TL
+ *        buffer goes back to CPU2 as soon as this returns; handlers run
+ *        later from the lower priority deferred task
+ */
+SVCCTL_UserEvtFlowStatus_t SVCCTL_UserEvtRx(void *pckt)
+{
+    hci_event_pckt *event_pckt = (hci_event_pckt *)((hci_uart_pckt *)pckt)->data;
+    uint32_t t0 = EVTDISP_CYCLES();
+    uint32_t hold;
+
+    if (ring_defer != 0U || ring_used != 0U) {
+        /* Ring not empty: keep arrival order even with deferral off */
+        if (EvtDispatch_RingPush((const uint8_t *)pckt, 3U + event_pckt->plen, t0) != 0) {
+            /* TL keeps the event queued until the task frees ring space */
+            ring_stats.flow_off++;
+            ring_stalled = 1;
+            return SVCCTL_UserEvtFlowDisable;
+        }
+        UTIL_SEQ_SetTask(1U << CFG_TASK_EVT_DEFER_ID, CFG_SCH_PRIO_NOTIFY);
+    } else {
+        BLE_EvtDispatch_Process(pckt);
+    }
+
+    hold = EVTDISP_CYCLES() - t0;
+    ring_stats.events++;
+    ring_stats.hold_cycles += hold;
+    if (hold > ring_stats.hold_max) {
+        ring_stats.hold_max = hold;
+    }
+    return SVCCTL_UserEvtFlowEnable;
+}
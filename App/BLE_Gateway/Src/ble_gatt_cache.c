@@ -0,0 +1,701 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_cache.c
+  * @brief   Persistent GATT discovery cache implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_cache.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "shci.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <stddef.h>
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+/* Linker script: GATT_CACHE region */
+extern uint8_t __gatt_cache_start[];
+
+#define GATT_CACHE_MAGIC            0x47435331UL    /* "GCS1" */
+#define GATT_CACHE_FLASH_TIMEOUT_MS 100U
+#define GATT_CACHE_NO_SLOT          (-1)
+
+/* Cache work of one link */
+typedef enum {
+    CACHE_PHASE_IDLE = 0,
+    CACHE_PHASE_HASH,               /* Reading peer Database Hash */
+    CACHE_PHASE_VERIFY,             /* Services-only walk, checksum compare */
+    CACHE_PHASE_DISC,               /* Full discovery running */
+} GattCache_Phase_t;
+
+typedef struct {
+    uint16_t conn_handle;
+    GattCache_Phase_t phase;
+    int8_t slot;                    /* Record of this peer, or GATT_CACHE_NO_SLOT */
+    uint8_t hash_valid;
+    uint8_t hash[GATT_DB_HASH_LEN];
+} GattCache_Link_t;
+
+/* Stored content; compared as a whole to skip identical rewrites */
+typedef struct {
+    uint8_t mac[BLE_MAC_LEN];
+    uint8_t has_hash;
+    uint8_t reserved;
+    uint16_t svc_checksum;          /* CRC16 of the primary service list */
+    uint8_t hash[GATT_DB_HASH_LEN];
+    BLE_GattDb_t db;
+} GattCache_Payload_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                   /* Write order: lowest is evicted first */
+    GattCache_Payload_t payload;
+    uint16_t crc;                   /* CRC16 from seq to end of payload */
+} GattCache_Record_t;
+
+/* Each record must fit in a slot */
+typedef char GattCache_RecordFits_t[(sizeof(GattCache_Record_t) <= GATT_CACHE_SLOT_SIZE) ? 1 : -1];
+
+static GattCache_Link_t cache_link[MAX_BLE_CONNECTIONS];
+static uint8_t cache_enabled = 1;
+static uint32_t cache_seq = 0;
+static BLE_GattCacheStats_t cache_stats;
+
+/* Page image for pending writes; the page is read through it until flushed */
+static uint64_t page_shadow[GATT_CACHE_PAGE_SIZE / sizeof(uint64_t)];
+static int8_t shadow_page = -1;
+static uint8_t shadow_write_mask = 0;   /* Slots to program */
+static uint8_t shadow_need_erase = 0;   /* A programmed slot is replaced */
+static GattCache_Record_t rec_scratch;
+
+static void GattCache_OnDiscDone(uint16_t conn_handle, BLE_GattDiscState_t state);
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ */
+static uint16_t GattCache_Crc16(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    uint32_t i;
+    uint8_t bit;
+
+    for (i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8U; bit++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t GattCache_RecordCrc(const GattCache_Record_t *rec)
+{
+    return GattCache_Crc16(0xFFFFU, (const uint8_t*)&rec->seq,
+                           offsetof(GattCache_Record_t, crc) - offsetof(GattCache_Record_t, seq));
+}
+
+/**
+ * @brief Checksum of the primary service list: handle ranges and UUIDs
+ * @note  Used to validate a record when the peer has no Database Hash
+ */
+static uint16_t GattCache_ServiceChecksum(const BLE_GattDb_t *db)
+{
+    uint16_t crc = 0xFFFFU;
+    const BLE_GattService_t *svc;
+    uint8_t i;
+
+    for (i = 0; i < db->service_count; i++) {
+        svc = &db->services[i];
+        crc = GattCache_Crc16(crc, (const uint8_t*)&svc->start_handle, sizeof(svc->start_handle));
+        crc = GattCache_Crc16(crc, (const uint8_t*)&svc->end_handle, sizeof(svc->end_handle));
+        if (svc->uuid.is_uuid128 && svc->uuid.value < db->uuid128_count) {
+            crc = GattCache_Crc16(crc, db->uuid128[svc->uuid.value], GATT_UUID128_LEN);
+        } else {
+            crc = GattCache_Crc16(crc, (const uint8_t*)&svc->uuid.value, sizeof(svc->uuid.value));
+        }
+    }
+    return crc;
+}
+
+static uint32_t GattCache_SlotAddr(uint8_t slot)
+{
+    return (uint32_t)__gatt_cache_start + (uint32_t)slot * GATT_CACHE_SLOT_SIZE;
+}
+
+/**
+ * @brief Current content of a slot: pending page image or flash
+ */
+static const GattCache_Record_t* GattCache_Slot(uint8_t slot)
+{
+    uint8_t page = slot / GATT_CACHE_SLOTS_PER_PAGE;
+
+    if ((int8_t)page == shadow_page) {
+        return (const GattCache_Record_t*)((const uint8_t*)page_shadow +
+               (slot % GATT_CACHE_SLOTS_PER_PAGE) * GATT_CACHE_SLOT_SIZE);
+    }
+    return (const GattCache_Record_t*)GattCache_SlotAddr(slot);
+}
+
+static uint8_t GattCache_IsValid(const GattCache_Record_t *rec)
+{
+    return (rec->magic == GATT_CACHE_MAGIC && rec->crc == GattCache_RecordCrc(rec)) ? 1U : 0U;
+}
+
+static uint8_t GattCache_FlashSlotBlank(uint8_t slot)
+{
+    const uint32_t *p = (const uint32_t*)GattCache_SlotAddr(slot);
+    uint32_t i;
+
+    for (i = 0; i < GATT_CACHE_SLOT_SIZE / sizeof(uint32_t); i++) {
+        if (p[i] != 0xFFFFFFFFUL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int8_t GattCache_FindMac(const uint8_t *mac)
+{
+    const GattCache_Record_t *rec;
+    uint8_t i;
+
+    for (i = 0; i < GATT_CACHE_MAX_ENTRIES; i++) {
+        rec = GattCache_Slot(i);
+        if (GattCache_IsValid(rec) && memcmp(rec->payload.mac, mac, BLE_MAC_LEN) == 0) {
+            return (int8_t)i;
+        }
+    }
+    return GATT_CACHE_NO_SLOT;
+}
+
+/**
+ * @brief One flash operation under the CPU1/CPU2 flash protocol
+ * @note  CPU2 blocks flash access around radio events (PESD bit or semaphore);
+ *        each double word or page erase is retried until the window is free
+ */
+static int GattCache_FlashOp(uint32_t addr, const uint64_t *data)
+{
+    FLASH_EraseInitTypeDef erase;
+    uint32_t page_error;
+    uint32_t start = HAL_GetTick();
+    HAL_StatusTypeDef status = HAL_ERROR;
+    uint8_t done = 0;
+
+    while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID)) {
+        if ((HAL_GetTick() - start) > GATT_CACHE_FLASH_TIMEOUT_MS) {
+            return -1;
+        }
+    }
+    HAL_FLASH_Unlock();
+
+    while (!done && (HAL_GetTick() - start) <= GATT_CACHE_FLASH_TIMEOUT_MS) {
+        if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_PESD)) {
+            continue;
+        }
+
+        BACKUP_PRIMASK();
+        DISABLE_IRQ();
+        if (!LL_HSEM_IsSemaphoreLocked(HSEM, CFG_HW_BLOCK_FLASH_REQ_BY_CPU2_SEMID)) {
+            if (data) {
+                status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr, *data);
+            } else {
+                erase.TypeErase = FLASH_TYPEERASE_PAGES;
+                erase.Page = (addr - FLASH_BASE) / FLASH_PAGE_SIZE;
+                erase.NbPages = 1;
+                status = HAL_FLASHEx_Erase(&erase, &page_error);
+            }
+            done = 1;
+        }
+        RESTORE_PRIMASK();
+    }
+
+    HAL_FLASH_Lock();
+    LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+    return (done && status == HAL_OK) ? 0 : -1;
+}
+
+static int GattCache_ErasePage(uint8_t page)
+{
+    int ret;
+
+    SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_ON);
+    ret = GattCache_FlashOp((uint32_t)__gatt_cache_start + (uint32_t)page * GATT_CACHE_PAGE_SIZE,
+                            NULL);
+    SHCI_C2_FLASH_EraseActivity(ERASE_ACTIVITY_OFF);
+    return ret;
+}
+
+/**
+ * @brief Write the page image to flash
+ * @note  New records go to blank slots without an erase; replacing a
+ *        programmed slot erases the page and rewrites all of it
+ */
+static int GattCache_Flush(void)
+{
+    uint32_t base;
+    uint32_t i;
+    uint8_t mask;
+    uint8_t page;
+    int ret = 0;
+
+    if (shadow_page < 0) {
+        return 0;
+    }
+
+    page = (uint8_t)shadow_page;
+    base = (uint32_t)__gatt_cache_start + (uint32_t)page * GATT_CACHE_PAGE_SIZE;
+    mask = shadow_write_mask;
+
+    if (shadow_need_erase) {
+        if (GattCache_ErasePage(page) != 0) {
+            DEBUG_ERROR("GATT cache erase page %d failed", page);
+            ret = -1;
+        }
+        mask = (1U << GATT_CACHE_SLOTS_PER_PAGE) - 1U;
+    }
+
+    for (i = 0; ret == 0 && i < GATT_CACHE_PAGE_SIZE / sizeof(uint64_t); i++) {
+        if ((mask & (1U << ((i * sizeof(uint64_t)) / GATT_CACHE_SLOT_SIZE))) == 0U ||
+            page_shadow[i] == 0xFFFFFFFFFFFFFFFFULL) {
+            continue;
+        }
+        if (GattCache_FlashOp(base + i * sizeof(uint64_t), &page_shadow[i]) != 0) {
+            DEBUG_ERROR("GATT cache program 0x%08lX failed", (unsigned long)(base + i * 8U));
+            ret = -1;
+        }
+    }
+
+    /* On failure the page is left as is; a damaged record fails its CRC */
+    shadow_page = -1;
+    shadow_write_mask = 0;
+    shadow_need_erase = 0;
+    DEBUG_INFO("GATT cache page %d written%s", page, (ret == 0) ? "" : " with errors");
+    return ret;
+}
+
+/**
+ * @brief Slot for a new record of a peer: its own, a free one, else the oldest
+ */
+static uint8_t GattCache_PickSlot(const uint8_t *mac)
+{
+    const GattCache_Record_t *rec;
+    int8_t slot = GattCache_FindMac(mac);
+    int8_t free_slot = GATT_CACHE_NO_SLOT;
+    uint8_t oldest = 0;
+    uint32_t oldest_seq = 0xFFFFFFFFUL;
+    uint8_t i;
+
+    if (slot != GATT_CACHE_NO_SLOT) {
+        return (uint8_t)slot;
+    }
+
+    for (i = 0; i < GATT_CACHE_MAX_ENTRIES; i++) {
+        rec = GattCache_Slot(i);
+        if (!GattCache_IsValid(rec)) {
+            /* Prefer a blank slot: no erase needed */
+            if (free_slot == GATT_CACHE_NO_SLOT || GattCache_FlashSlotBlank(i)) {
+                free_slot = (int8_t)i;
+            }
+        } else if (rec->seq < oldest_seq) {
+            oldest_seq = rec->seq;
+            oldest = i;
+        }
+    }
+    return (free_slot != GATT_CACHE_NO_SLOT) ? (uint8_t)free_slot : oldest;
+}
+
+/**
+ * @brief Queue the discovered table of a link for writing
+ */
+static void GattCache_Store(uint16_t conn_handle, const GattCache_Link_t *link)
+{
+    const BLE_GattDb_t *db = BLE_GattDisc_GetDb(conn_handle);
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    GattCache_Payload_t *p = &rec_scratch.payload;
+    const GattCache_Record_t *old;
+    uint8_t slot;
+    uint8_t page;
+    int8_t existing;
+
+    if (!db || !info || db->state != GATT_DISC_DONE) {
+        return;
+    }
+
+    memset(&rec_scratch, 0, sizeof(rec_scratch));
+    memcpy(p->mac, info->mac_addr, BLE_MAC_LEN);
+    if (link && link->hash_valid) {
+        p->has_hash = 1;
+        memcpy(p->hash, link->hash, GATT_DB_HASH_LEN);
+    }
+    p->db = *db;
+    p->db.conn_handle = 0xFFFF;
+    p->db.cur_service = 0;
+    p->db.services_only = 0;
+    p->db.start_tick = 0;
+    p->db.duration_ms = 0;
+    p->svc_checksum = GattCache_ServiceChecksum(&p->db);
+
+    /* Unchanged table: keep flash as is */
+    existing = GattCache_FindMac(p->mac);
+    if (existing != GATT_CACHE_NO_SLOT) {
+        old = GattCache_Slot((uint8_t)existing);
+        if (memcmp(&old->payload, p, sizeof(*p)) == 0) {
+            return;
+        }
+    }
+
+    slot = GattCache_PickSlot(p->mac);
+    page = slot / GATT_CACHE_SLOTS_PER_PAGE;
+
+    /* One page image at a time: write out the other page first */
+    if (shadow_page >= 0 && shadow_page != (int8_t)page) {
+        GattCache_Flush();
+    }
+    if (shadow_page < 0) {
+        memcpy(page_shadow, (const void*)((uint32_t)__gatt_cache_start +
+               (uint32_t)page * GATT_CACHE_PAGE_SIZE), GATT_CACHE_PAGE_SIZE);
+        shadow_page = (int8_t)page;
+    }
+    if (!GattCache_FlashSlotBlank(slot)) {
+        shadow_need_erase = 1;
+    }
+
+    rec_scratch.magic = GATT_CACHE_MAGIC;
+    rec_scratch.seq = ++cache_seq;
+    rec_scratch.crc = GattCache_RecordCrc(&rec_scratch);
+
+    memset((uint8_t*)page_shadow + (slot % GATT_CACHE_SLOTS_PER_PAGE) * GATT_CACHE_SLOT_SIZE,
+           0xFF, GATT_CACHE_SLOT_SIZE);
+    memcpy((uint8_t*)page_shadow + (slot % GATT_CACHE_SLOTS_PER_PAGE) * GATT_CACHE_SLOT_SIZE,
+           &rec_scratch, sizeof(rec_scratch));
+    shadow_write_mask |= (uint8_t)(1U << (slot % GATT_CACHE_SLOTS_PER_PAGE));
+
+    DEBUG_INFO("GATT cache 0x%04X -> slot %d (%d svc, %d char%s)", conn_handle, slot,
+               p->db.service_count, p->db.char_count, p->has_hash ? ", hash" : "");
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_CACHE_ID, CFG_SCH_PRIO_BG);
+}
+
+static GattCache_Link_t* GattCache_FindLink(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (cache_link[i].conn_handle == conn_handle) {
+            return &cache_link[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Report connect-to-ready time of a link
+ */
+static void GattCache_Ready(GattCache_Link_t *link, BLE_GattReadySource_t source)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(link->conn_handle);
+    uint32_t ms = info ? (HAL_GetTick() - info->connect_tick) : 0U;
+
+    if (source == GATT_READY_CACHE) {
+        cache_stats.hits++;
+        cache_stats.hit_ms_total += ms;
+    } else {
+        cache_stats.misses++;
+        cache_stats.disc_ms_total += ms;
+    }
+
+    link->phase = CACHE_PHASE_IDLE;
+    DEBUG_INFO("GATT 0x%04X ready from %s in %lums", link->conn_handle,
+               (source == GATT_READY_CACHE) ? "cache" : "discovery", (unsigned long)ms);
+    AT_Response_Send("+GATT_READY:0x%04X,%s,%lu\r\n", link->conn_handle,
+                     (source == GATT_READY_CACHE) ? "CACHE" : "DISC", (unsigned long)ms);
+    BLE_GattSub_OnLinkReady(link->conn_handle);
+}
+
+static void GattCache_Discover(GattCache_Link_t *link)
+{
+    if (BLE_GattDisc_Start(link->conn_handle) == 0) {
+        link->phase = CACHE_PHASE_DISC;
+    } else {
+        link->phase = CACHE_PHASE_IDLE;
+        DEBUG_WARN("GATT cache 0x%04X: discovery not started", link->conn_handle);
+        BLE_GattSub_OnLinkReady(link->conn_handle);
+    }
+}
+
+static void GattCache_Restore(GattCache_Link_t *link)
+{
+    const GattCache_Record_t *rec;
+
+    if (link->slot == GATT_CACHE_NO_SLOT) {
+        GattCache_Discover(link);
+        return;
+    }
+
+    rec = GattCache_Slot((uint8_t)link->slot);
+    if (!GattCache_IsValid(rec) ||
+        BLE_GattDisc_Restore(link->conn_handle, &rec->payload.db) != 0) {
+        GattCache_Discover(link);
+        return;
+    }
+    GattCache_Ready(link, GATT_READY_CACHE);
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void GattCache_EvtReadByUuid(void *evt)
+{
+    aci_gatt_disc_read_char_by_uuid_resp_event_rp0 *pr = evt;
+
+    BLE_GattCache_OnReadByUuid(pr->Connection_Handle, pr->Attribute_Handle,
+                               pr->Attribute_Value, pr->Attribute_Value_Length);
+}
+
+void BLE_GattCache_Init(void)
+{
+    const GattCache_Record_t *rec;
+    uint8_t i;
+
+    memset(cache_link, 0, sizeof(cache_link));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        cache_link[i].conn_handle = 0xFFFF;
+    }
+    memset(&cache_stats, 0, sizeof(cache_stats));
+    shadow_page = -1;
+    shadow_write_mask = 0;
+    shadow_need_erase = 0;
+
+    cache_seq = 0;
+    for (i = 0; i < GATT_CACHE_MAX_ENTRIES; i++) {
+        rec = GattCache_Slot(i);
+        if (GattCache_IsValid(rec) && rec->seq > cache_seq) {
+            cache_seq = rec->seq;
+        }
+    }
+
+    BLE_GattDisc_RegisterDoneCallback(GattCache_OnDiscDone);
+    BLE_GattCache_GetStats(NULL);
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_DISC_READ_CHAR_BY_UUID_RESP_VSEVT_CODE, GattCache_EvtReadByUuid);
+    /* ACI_GATT_PROC_COMPLETE comes from the GATT queue, which orders the engines */
+
+    DEBUG_INFO("GATT cache initialized: %d entries", cache_stats.entries);
+}
+
+void BLE_GattCache_Enable(uint8_t enable)
+{
+    cache_enabled = enable ? 1U : 0U;
+    DEBUG_INFO("GATT cache %s", cache_enabled ? "enabled" : "disabled");
+}
+
+uint8_t BLE_GattCache_IsEnabled(void)
+{
+    return cache_enabled;
+}
+
+int BLE_GattCache_Clear(void)
+{
+    uint8_t page;
+    uint8_t i;
+    int ret = 0;
+
+    shadow_page = -1;
+    shadow_write_mask = 0;
+    shadow_need_erase = 0;
+
+    for (page = 0; page < GATT_CACHE_PAGES; page++) {
+        if (GattCache_ErasePage(page) != 0) {
+            ret = -1;
+        }
+    }
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        cache_link[i].slot = GATT_CACHE_NO_SLOT;
+    }
+    cache_seq = 0;
+    cache_stats.entries = 0;
+    DEBUG_INFO("GATT cache cleared");
+    return ret;
+}
+
+void BLE_GattCache_GetStats(BLE_GattCacheStats_t *stats)
+{
+    uint8_t i;
+
+    cache_stats.entries = 0;
+    for (i = 0; i < GATT_CACHE_MAX_ENTRIES; i++) {
+        if (GattCache_IsValid(GattCache_Slot(i))) {
+            cache_stats.entries++;
+        }
+    }
+    if (stats) {
+        *stats = cache_stats;
+    }
+}
+
+void BLE_GattCache_OnLinkUp(uint16_t conn_handle)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    GattCache_Link_t *link;
+    UUID_t uuid;
+    tBleStatus ret;
+
+    if (!info) {
+        return;
+    }
+    if (!cache_enabled) {
+        /* No table to wait for: subscriptions go back by handle */
+        BLE_GattSub_OnLinkReady(conn_handle);
+        return;
+    }
+
+    link = GattCache_FindLink(conn_handle);
+    if (!link) {
+        link = GattCache_FindLink(0xFFFF);
+    }
+    if (!link) {
+        BLE_GattSub_OnLinkReady(conn_handle);
+        return;
+    }
+
+    memset(link, 0, sizeof(*link));
+    link->conn_handle = conn_handle;
+    link->slot = GattCache_FindMac(info->mac_addr);
+
+    /* Read the hash even without a record: it is stored with the new one */
+    uuid.UUID_16 = GATT_UUID_DATABASE_HASH;
+    ret = aci_gatt_read_using_char_uuid(conn_handle, 0x0001, 0xFFFF, UUID_TYPE_16, &uuid);
+    if (ret == BLE_STATUS_SUCCESS) {
+        link->phase = CACHE_PHASE_HASH;
+        return;
+    }
+
+    DEBUG_WARN("Database Hash read 0x%04X failed: 0x%02X", conn_handle, ret);
+    link->phase = CACHE_PHASE_HASH;
+    BLE_GattCache_OnProcComplete(conn_handle, ret);
+}
+
+void BLE_GattCache_OnReadByUuid(uint16_t conn_handle, uint16_t attr_handle,
+                                const uint8_t *value, uint8_t len)
+{
+    GattCache_Link_t *link = GattCache_FindLink(conn_handle);
+
+    if (!link || link->phase != CACHE_PHASE_HASH || len != GATT_DB_HASH_LEN) {
+        return;
+    }
+
+    memcpy(link->hash, value, GATT_DB_HASH_LEN);
+    link->hash_valid = 1;
+    DEBUG_INFO("Conn 0x%04X Database Hash at 0x%04X", conn_handle, attr_handle);
+}
+
+void BLE_GattCache_OnProcComplete(uint16_t conn_handle, uint8_t error_code)
+{
+    GattCache_Link_t *link = GattCache_FindLink(conn_handle);
+    const GattCache_Record_t *rec;
+
+    if (!link || link->phase != CACHE_PHASE_HASH) {
+        return;
+    }
+
+    (void)error_code;   /* Attribute Not Found: peer has no hash */
+
+    if (link->slot == GATT_CACHE_NO_SLOT) {
+        GattCache_Discover(link);
+        return;
+    }
+
+    rec = GattCache_Slot((uint8_t)link->slot);
+    if (link->hash_valid) {
+        if (rec->payload.has_hash &&
+            memcmp(rec->payload.hash, link->hash, GATT_DB_HASH_LEN) == 0) {
+            GattCache_Restore(link);
+        } else {
+            DEBUG_INFO("Conn 0x%04X Database Hash changed", conn_handle);
+            GattCache_Discover(link);
+        }
+        return;
+    }
+
+    /* No hash: compare the primary service list before trusting the record */
+    if (BLE_GattDisc_StartServices(conn_handle) == 0) {
+        link->phase = CACHE_PHASE_VERIFY;
+    } else {
+        link->phase = CACHE_PHASE_IDLE;
+        BLE_GattSub_OnLinkReady(conn_handle);
+    }
+}
+
+/**
+ * @brief Discovery finished (registered with BLE_GattDisc)
+ */
+static void GattCache_OnDiscDone(uint16_t conn_handle, BLE_GattDiscState_t state)
+{
+    GattCache_Link_t *link = GattCache_FindLink(conn_handle);
+    const BLE_GattDb_t *db;
+    const GattCache_Record_t *rec;
+
+    switch (state) {
+    case GATT_DISC_SERVICES_DONE:
+        if (!link || link->phase != CACHE_PHASE_VERIFY) {
+            return;
+        }
+        db = BLE_GattDisc_GetDb(conn_handle);
+        rec = (link->slot != GATT_CACHE_NO_SLOT) ? GattCache_Slot((uint8_t)link->slot) : NULL;
+        if (db && rec && GattCache_IsValid(rec) &&
+            GattCache_ServiceChecksum(db) == rec->payload.svc_checksum) {
+            GattCache_Restore(link);
+        } else if (BLE_GattDisc_Continue(conn_handle) == 0) {
+            DEBUG_INFO("Conn 0x%04X service list changed", conn_handle);
+            link->phase = CACHE_PHASE_DISC;
+        } else {
+            link->phase = CACHE_PHASE_IDLE;
+            BLE_GattSub_OnLinkReady(conn_handle);
+        }
+        break;
+
+    case GATT_DISC_DONE:
+        /* Manual AT+DISC refreshes the record as well */
+        if (cache_enabled) {
+            GattCache_Store(conn_handle, link);
+        }
+        if (link && link->phase == CACHE_PHASE_DISC) {
+            GattCache_Ready(link, GATT_READY_DISC);
+        }
+        break;
+
+    default:
+        if (link && link->phase != CACHE_PHASE_IDLE) {
+            link->phase = CACHE_PHASE_IDLE;
+            BLE_GattSub_OnLinkReady(conn_handle);
+        }
+        break;
+    }
+}
+
+void BLE_GattCache_OnDisconnected(uint16_t conn_handle)
+{
+    GattCache_Link_t *link = GattCache_FindLink(conn_handle);
+
+    if (link) {
+        link->conn_handle = 0xFFFF;
+        link->phase = CACHE_PHASE_IDLE;
+    }
+}
+
+void BLE_GattCache_Process(void)
+{
+    GattCache_Flush();
+}
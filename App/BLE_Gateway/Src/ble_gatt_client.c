@@ -7,6 +7,8 @@
   */
 
 #include "ble_gatt_client.h"
+#include "ble_gatt_queue.h"
+#include "ble_connection.h"
 #include "debug_trace.h"
 #include "ble_gatt_aci.h"
 
@@ -56,17 +58,24 @@ int BLE_GATT_DiscoverCharacteristics(uint16_t conn_handle, uint16_t start_handle
 
 int BLE_GATT_ReadCharacteristic(uint16_t conn_handle, uint16_t char_handle)
 {
-    tBleStatus ret;
-    
     DEBUG_INFO("Reading char: conn=0x%04X, handle=0x%04X", conn_handle, char_handle);
     
-    /* Read characteristic value
-     * Response will come via ACI_GATT_NOTIFICATION_VSEVT_CODE or read response event
-     */
-    ret = aci_gatt_read_char_value(conn_handle, char_handle);
+    /* Queued: value comes via ACI_ATT_READ_RESP_VSEVT_CODE as +READ */
+    if (BLE_GattQueue_Read(conn_handle, char_handle) != 0) {
+        DEBUG_ERROR("Failed to queue read");
+        return -1;
+    }
     
-    if (ret != BLE_STATUS_SUCCESS) {
-        DEBUG_ERROR("Failed to read characteristic: 0x%02X", ret);
+    return 0;
+}
+
+int BLE_GATT_ReadLongCharacteristic(uint16_t conn_handle, uint16_t char_handle)
+{
+    DEBUG_INFO("Reading long char: conn=0x%04X, handle=0x%04X", conn_handle, char_handle);
+    
+    /* Queued: Read Blob parts are reassembled, full value comes as +READ */
+    if (BLE_GattQueue_ReadLong(conn_handle, char_handle) != 0) {
+        DEBUG_ERROR("Failed to queue long read");
         return -1;
     }
     
@@ -76,8 +85,6 @@ int BLE_GATT_ReadCharacteristic(uint16_t conn_handle, uint16_t char_handle)
 int BLE_GATT_WriteCharacteristic(uint16_t conn_handle, uint16_t char_handle,
                                  const uint8_t *data, uint16_t len)
 {
-    tBleStatus ret;
-    
     if (data == NULL || len == 0) {
         DEBUG_ERROR("Invalid write data");
         return -1;
@@ -86,13 +93,23 @@ int BLE_GATT_WriteCharacteristic(uint16_t conn_handle, uint16_t char_handle,
     DEBUG_INFO("Writing char: conn=0x%04X, handle=0x%04X, len=%d", 
                conn_handle, char_handle, len);
     
-    /* Write with response (Write Request)
-     * Response will come via ACI_GATT_PROC_COMPLETE_VSEVT_CODE event
-     */
-    ret = aci_gatt_write_char_value(conn_handle, char_handle, len, (uint8_t *)data);
+    /* Queued Write Request: result on ACI_GATT_PROC_COMPLETE_VSEVT_CODE */
+    if (BLE_GattQueue_Write(conn_handle, char_handle, data, len) != 0) {
+        DEBUG_ERROR("Failed to queue write");
+        return -1;
+    }
     
-    if (ret != BLE_STATUS_SUCCESS) {
-        DEBUG_ERROR("Failed to write characteristic: 0x%02X", ret);
+    return 0;
+}
+
+int BLE_GATT_WriteReliable(uint16_t conn_handle, const BLE_GattWriteEntry_t *entries,
+                           uint8_t count)
+{
+    DEBUG_INFO("Reliable write: conn=0x%04X, attributes=%d", conn_handle, count);
+    
+    /* Queued Prepare Writes, executed together after all echoes matched */
+    if (BLE_GattQueue_WriteReliable(conn_handle, entries, count) != 0) {
+        DEBUG_ERROR("Failed to queue reliable write");
         return -1;
     }
     
@@ -120,13 +137,12 @@ int BLE_GATT_WriteCharacteristicNoResp(uint16_t conn_handle, uint16_t char_handl
         return -1;
     }
     
+    BLE_Connection_CountTraffic(conn_handle, 1, len);
     return 0;
 }
 
 int BLE_GATT_EnableNotification(uint16_t conn_handle, uint16_t desc_handle)
 {
-    tBleStatus ret;
-    
     DEBUG_INFO("Enabling notification: conn=0x%04X, desc=0x%04X", conn_handle, desc_handle);
     
     /* Write 0x0001 to CCCD to enable notification
@@ -134,10 +150,8 @@ int BLE_GATT_EnableNotification(uint16_t conn_handle, uint16_t desc_handle)
      * Bit 1 = Indication enable
      */
     uint8_t cccd_value[2] = {0x01, 0x00};
-    ret = aci_gatt_write_char_desc(conn_handle, desc_handle, 2, cccd_value);
-    
-    if (ret != BLE_STATUS_SUCCESS) {
-        DEBUG_ERROR("Failed to enable notification: 0x%02X", ret);
+    if (BLE_GattQueue_WriteDesc(conn_handle, desc_handle, cccd_value, 2) != 0) {
+        DEBUG_ERROR("Failed to enable notification");
         return -1;
     }
     
@@ -146,16 +160,12 @@ int BLE_GATT_EnableNotification(uint16_t conn_handle, uint16_t desc_handle)
 
 int BLE_GATT_DisableNotification(uint16_t conn_handle, uint16_t desc_handle)
 {
-    tBleStatus ret;
-    
     DEBUG_INFO("Disabling notification: conn=0x%04X, desc=0x%04X", conn_handle, desc_handle);
     
     /* Write 0x0000 to CCCD to disable notification */
     uint8_t cccd_value[2] = {0x00, 0x00};
-    ret = aci_gatt_write_char_desc(conn_handle, desc_handle, 2, cccd_value);
-    
-    if (ret != BLE_STATUS_SUCCESS) {
-        DEBUG_ERROR("Failed to disable notification: 0x%02X", ret);
+    if (BLE_GattQueue_WriteDesc(conn_handle, desc_handle, cccd_value, 2) != 0) {
+        DEBUG_ERROR("Failed to disable notification");
         return -1;
     }
     
@@ -164,16 +174,12 @@ int BLE_GATT_DisableNotification(uint16_t conn_handle, uint16_t desc_handle)
 
 int BLE_GATT_EnableIndication(uint16_t conn_handle, uint16_t desc_handle)
 {
-    tBleStatus ret;
-    
     DEBUG_INFO("Enabling indication: conn=0x%04X, desc=0x%04X", conn_handle, desc_handle);
     
     /* Write 0x0002 to CCCD to enable indication */
     uint8_t cccd_value[2] = {0x02, 0x00};
-    ret = aci_gatt_write_char_desc(conn_handle, desc_handle, 2, cccd_value);
-    
-    if (ret != BLE_STATUS_SUCCESS) {
-        DEBUG_ERROR("Failed to enable indication: 0x%02X", ret);
+    if (BLE_GattQueue_WriteDesc(conn_handle, desc_handle, cccd_value, 2) != 0) {
+        DEBUG_ERROR("Failed to enable indication");
         return -1;
     }
     
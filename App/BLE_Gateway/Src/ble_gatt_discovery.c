@@ -0,0 +1,560 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_discovery.c
+  * @brief   GATT discovery engine implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_discovery.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include "stm32wbxx_hal.h"
+#include <stdio.h>
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+#define LE16(p)     ((uint16_t)((p)[0] | ((uint16_t)(p)[1] << 8)))
+
+/* ATT Find Information response formats */
+#define FIND_INFO_FORMAT_UUID16     0x01U
+#define FIND_INFO_FORMAT_UUID128    0x02U
+
+static BLE_GattDb_t gatt_db[MAX_BLE_CONNECTIONS];
+static BLE_GattDiscDoneCallback_t done_cb = NULL;
+
+static BLE_GattDb_t* GattDisc_Find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (gatt_db[i].conn_handle == conn_handle) {
+            return &gatt_db[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find table of a link, or claim a free one
+ */
+static BLE_GattDb_t* GattDisc_Alloc(uint16_t conn_handle)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+
+    if (db == NULL) {
+        db = GattDisc_Find(0xFFFF);
+    }
+    return db;
+}
+
+/**
+ * @brief Decode a 2 or 16 byte UUID into the table
+ * @return 0 on success, -1 if the 128-bit pool is full
+ */
+static int GattDisc_StoreUuid(BLE_GattDb_t *db, const uint8_t *raw, uint8_t len,
+                              BLE_GattUuid_t *uuid)
+{
+    uint8_t i;
+
+    if (len == 2U) {
+        uuid->value = LE16(raw);
+        uuid->is_uuid128 = 0;
+        return 0;
+    }
+
+    /* Services of one vendor usually share a base: reuse pool entries */
+    for (i = 0; i < db->uuid128_count; i++) {
+        if (memcmp(db->uuid128[i], raw, GATT_UUID128_LEN) == 0) {
+            break;
+        }
+    }
+    if (i == db->uuid128_count) {
+        if (db->uuid128_count >= GATT_DB_MAX_UUID128) {
+            return -1;
+        }
+        memcpy(db->uuid128[i], raw, GATT_UUID128_LEN);
+        db->uuid128_count++;
+    }
+
+    uuid->value = i;
+    uuid->is_uuid128 = 1;
+    return 0;
+}
+
+static void GattDisc_PrintService(const BLE_GattDb_t *db, const BLE_GattService_t *svc)
+{
+    char uuid[GATT_UUID_STR_LEN];
+
+    BLE_GattDisc_FormatUuid(db, &svc->uuid, uuid);
+    AT_Response_Send("+SERVICE:0x%04X,0x%04X,%s,0x%04X\r\n", db->conn_handle,
+                     svc->start_handle, uuid, svc->end_handle);
+}
+
+static void GattDisc_PrintChar(const BLE_GattDb_t *db, const BLE_GattChar_t *chr)
+{
+    char uuid[GATT_UUID_STR_LEN];
+
+    BLE_GattDisc_FormatUuid(db, &chr->uuid, uuid);
+    AT_Response_Send("+CHAR:0x%04X,0x%04X,%s,0x%02X,0x%04X\r\n", db->conn_handle,
+                     chr->value_handle, uuid, chr->properties, chr->cccd_handle);
+}
+
+/**
+ * @brief Stream characteristics of the current service
+ */
+static void GattDisc_PrintServiceChars(const BLE_GattDb_t *db)
+{
+    uint8_t i;
+
+    for (i = 0; i < db->char_count; i++) {
+        if (db->chars[i].service_idx == db->cur_service) {
+            GattDisc_PrintChar(db, &db->chars[i]);
+        }
+    }
+}
+
+static void GattDisc_Fail(BLE_GattDb_t *db, uint8_t reason)
+{
+    db->state = GATT_DISC_FAILED;
+    db->duration_ms = HAL_GetTick() - db->start_tick;
+    DEBUG_ERROR("Discovery 0x%04X failed: 0x%02X", db->conn_handle, reason);
+    AT_Response_Send("+DISC_ERROR:0x%04X,%02X\r\n", db->conn_handle, reason);
+    if (done_cb) {
+        done_cb(db->conn_handle, db->state);
+    }
+}
+
+/**
+ * @brief Start characteristic discovery of the next service, or finish
+ */
+static void GattDisc_NextService(BLE_GattDb_t *db)
+{
+    const BLE_GattService_t *svc;
+    tBleStatus ret;
+
+    if (db->cur_service >= db->service_count) {
+        db->state = GATT_DISC_DONE;
+        db->duration_ms = HAL_GetTick() - db->start_tick;
+        DEBUG_INFO("Discovery 0x%04X done: %d svc, %d char, %lums%s", db->conn_handle,
+                   db->service_count, db->char_count, (unsigned long)db->duration_ms,
+                   db->overflow ? " (truncated)" : "");
+        AT_Response_Send("+DISC_DONE:0x%04X,%d,%d,%lu\r\n", db->conn_handle,
+                         db->service_count, db->char_count, (unsigned long)db->duration_ms);
+        if (done_cb) {
+            done_cb(db->conn_handle, db->state);
+        }
+        return;
+    }
+
+    svc = &db->services[db->cur_service];
+    db->state = GATT_DISC_CHARS;
+    ret = aci_gatt_disc_all_char_of_service(db->conn_handle, svc->start_handle, svc->end_handle);
+    if (ret != BLE_STATUS_SUCCESS) {
+        GattDisc_Fail(db, ret);
+    }
+}
+
+/**
+ * @brief Start descriptor discovery for the current service if needed
+ * @note  One Find Information walk per service, from the first characteristic
+ *        value to the service end; cheaper than one walk per characteristic
+ */
+static void GattDisc_Descriptors(BLE_GattDb_t *db)
+{
+    const BLE_GattService_t *svc = &db->services[db->cur_service];
+    uint16_t first_value = 0;
+    uint8_t i;
+    tBleStatus ret;
+
+    for (i = 0; i < db->char_count; i++) {
+        if (db->chars[i].service_idx == db->cur_service) {
+            first_value = db->chars[i].value_handle;
+            break;
+        }
+    }
+
+    if (first_value == 0U || first_value >= svc->end_handle) {
+        /* No characteristic or no room for descriptors */
+        GattDisc_PrintServiceChars(db);
+        db->cur_service++;
+        GattDisc_NextService(db);
+        return;
+    }
+
+    db->state = GATT_DISC_DESCRIPTORS;
+    ret = aci_gatt_disc_all_char_desc(db->conn_handle, first_value, svc->end_handle);
+    if (ret != BLE_STATUS_SUCCESS) {
+        GattDisc_Fail(db, ret);
+    }
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void GattDisc_EvtServices(void *evt)
+{
+    aci_att_read_by_group_type_resp_event_rp0 *pr = evt;
+
+    BLE_GattDisc_OnServices(pr->Connection_Handle, pr->Attribute_Data_Length,
+                            pr->Attribute_Data_List, pr->Data_Length);
+}
+
+static void GattDisc_EvtChars(void *evt)
+{
+    aci_att_read_by_type_resp_event_rp0 *pr = evt;
+
+    BLE_GattDisc_OnChars(pr->Connection_Handle, pr->Handle_Value_Pair_Length,
+                         pr->Handle_Value_Pair_Data, pr->Data_Length);
+}
+
+static void GattDisc_EvtFindInfo(void *evt)
+{
+    aci_att_find_info_resp_event_rp0 *pr = evt;
+
+    BLE_GattDisc_OnDescriptors(pr->Connection_Handle, pr->Format,
+                               pr->Handle_UUID_Pair, pr->Event_Data_Length);
+}
+
+static void GattDisc_EvtProcTimeout(void *evt)
+{
+    aci_gatt_proc_timeout_event_rp0 *pr = evt;
+
+    BLE_GattDisc_OnProcTimeout(pr->Connection_Handle);
+}
+
+void BLE_GattDisc_Init(void)
+{
+    uint8_t i;
+
+    memset(gatt_db, 0, sizeof(gatt_db));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        gatt_db[i].conn_handle = 0xFFFF;
+    }
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_BY_GROUP_TYPE_RESP_VSEVT_CODE, GattDisc_EvtServices);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_BY_TYPE_RESP_VSEVT_CODE, GattDisc_EvtChars);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_FIND_INFO_RESP_VSEVT_CODE, GattDisc_EvtFindInfo);
+    /* ACI_GATT_PROC_COMPLETE comes from the GATT queue, which orders the engines */
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_PROC_TIMEOUT_VSEVT_CODE, GattDisc_EvtProcTimeout);
+
+    DEBUG_INFO("GATT discovery initialized");
+}
+
+void BLE_GattDisc_RegisterDoneCallback(BLE_GattDiscDoneCallback_t cb)
+{
+    done_cb = cb;
+}
+
+/**
+ * @brief Claim a table and start the primary service walk
+ */
+static int GattDisc_Begin(uint16_t conn_handle, uint8_t services_only)
+{
+    BLE_GattDb_t *db = GattDisc_Alloc(conn_handle);
+    tBleStatus ret;
+
+    if (db == NULL) {
+        DEBUG_ERROR("No GATT table for 0x%04X", conn_handle);
+        return -1;
+    }
+    if (db->state == GATT_DISC_SERVICES || db->state == GATT_DISC_CHARS ||
+        db->state == GATT_DISC_DESCRIPTORS) {
+        DEBUG_WARN("Discovery 0x%04X already running", conn_handle);
+        return -1;
+    }
+
+    ret = aci_gatt_disc_all_primary_services(conn_handle);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("Failed to start service discovery: 0x%02X", ret);
+        return -1;
+    }
+
+    memset(db, 0, sizeof(*db));
+    db->conn_handle = conn_handle;
+    db->state = GATT_DISC_SERVICES;
+    db->services_only = services_only;
+    db->start_tick = HAL_GetTick();
+    DEBUG_INFO("Discovery 0x%04X started%s", conn_handle, services_only ? " (services)" : "");
+    return 0;
+}
+
+int BLE_GattDisc_Start(uint16_t conn_handle)
+{
+    return GattDisc_Begin(conn_handle, 0);
+}
+
+int BLE_GattDisc_StartServices(uint16_t conn_handle)
+{
+    return GattDisc_Begin(conn_handle, 1);
+}
+
+int BLE_GattDisc_Continue(uint16_t conn_handle)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+
+    if (db == NULL || db->state != GATT_DISC_SERVICES_DONE) {
+        return -1;
+    }
+
+    db->services_only = 0;
+    db->cur_service = 0;
+    GattDisc_NextService(db);
+    return (db->state == GATT_DISC_FAILED) ? -1 : 0;
+}
+
+int BLE_GattDisc_Restore(uint16_t conn_handle, const BLE_GattDb_t *src)
+{
+    BLE_GattDb_t *db = GattDisc_Alloc(conn_handle);
+
+    if (db == NULL || src == NULL || src->service_count > GATT_DB_MAX_SERVICES ||
+        src->char_count > GATT_DB_MAX_CHARS || src->uuid128_count > GATT_DB_MAX_UUID128) {
+        return -1;
+    }
+
+    memcpy(db->services, src->services, sizeof(db->services));
+    memcpy(db->chars, src->chars, sizeof(db->chars));
+    memcpy(db->uuid128, src->uuid128, sizeof(db->uuid128));
+    db->service_count = src->service_count;
+    db->char_count = src->char_count;
+    db->uuid128_count = src->uuid128_count;
+    db->conn_handle = conn_handle;
+    db->state = GATT_DISC_DONE;
+    db->services_only = 0;
+    db->overflow = 0;
+    db->duration_ms = 0;
+    DEBUG_INFO("GATT table 0x%04X restored: %d svc, %d char", conn_handle,
+               db->service_count, db->char_count);
+    return 0;
+}
+
+const BLE_GattDb_t* BLE_GattDisc_GetDb(uint16_t conn_handle)
+{
+    return GattDisc_Find(conn_handle);
+}
+
+int BLE_GattDisc_Dump(uint16_t conn_handle)
+{
+    const BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+    uint8_t s;
+    uint8_t c;
+
+    if (db == NULL || db->state != GATT_DISC_DONE) {
+        return -1;
+    }
+
+    for (s = 0; s < db->service_count; s++) {
+        GattDisc_PrintService(db, &db->services[s]);
+        for (c = 0; c < db->char_count; c++) {
+            if (db->chars[c].service_idx == s) {
+                GattDisc_PrintChar(db, &db->chars[c]);
+            }
+        }
+    }
+    return db->char_count;
+}
+
+void BLE_GattDisc_FormatUuid(const BLE_GattDb_t *db, const BLE_GattUuid_t *uuid, char *buf)
+{
+    const uint8_t *u;
+    uint8_t i;
+    uint8_t pos = 0;
+
+    if (!uuid->is_uuid128 || db == NULL || uuid->value >= db->uuid128_count) {
+        snprintf(buf, GATT_UUID_STR_LEN, "%04X", uuid->value);
+        return;
+    }
+
+    /* Stored little-endian; printed big-endian with dashes after bytes 4, 6, 8, 10 */
+    u = db->uuid128[uuid->value];
+    for (i = 0; i < GATT_UUID128_LEN; i++) {
+        if (i == 4U || i == 6U || i == 8U || i == 10U) {
+            buf[pos++] = '-';
+        }
+        snprintf(&buf[pos], 3, "%02X", u[GATT_UUID128_LEN - 1U - i]);
+        pos += 2;
+    }
+    buf[pos] = '\0';
+}
+
+void BLE_GattDisc_OnServices(uint16_t conn_handle, uint8_t attr_len,
+                             const uint8_t *data, uint8_t data_len)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+    BLE_GattService_t *svc;
+    uint8_t off;
+
+    /* Entry: start handle (2), end handle (2), UUID (2 or 16) */
+    if (db == NULL || db->state != GATT_DISC_SERVICES ||
+        (attr_len != 6U && attr_len != 20U)) {
+        return;
+    }
+
+    for (off = 0; (uint16_t)off + attr_len <= data_len; off += attr_len) {
+        if (db->service_count >= GATT_DB_MAX_SERVICES) {
+            db->overflow = 1;
+            return;
+        }
+        svc = &db->services[db->service_count];
+        svc->start_handle = LE16(&data[off]);
+        svc->end_handle = LE16(&data[off + 2U]);
+        if (GattDisc_StoreUuid(db, &data[off + 4U], attr_len - 4U, &svc->uuid) != 0) {
+            db->overflow = 1;
+            continue;
+        }
+        db->service_count++;
+        GattDisc_PrintService(db, svc);
+    }
+}
+
+void BLE_GattDisc_OnChars(uint16_t conn_handle, uint8_t pair_len,
+                          const uint8_t *data, uint8_t data_len)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+    BLE_GattChar_t *chr;
+    uint8_t off;
+
+    /* Entry: declaration handle (2), properties (1), value handle (2), UUID (2 or 16) */
+    if (db == NULL || db->state != GATT_DISC_CHARS ||
+        (pair_len != 7U && pair_len != 21U)) {
+        return;
+    }
+
+    for (off = 0; (uint16_t)off + pair_len <= data_len; off += pair_len) {
+        if (db->char_count >= GATT_DB_MAX_CHARS) {
+            db->overflow = 1;
+            return;
+        }
+        chr = &db->chars[db->char_count];
+        chr->decl_handle = LE16(&data[off]);
+        chr->properties = data[off + 2U];
+        chr->value_handle = LE16(&data[off + 3U]);
+        chr->cccd_handle = 0;
+        chr->service_idx = db->cur_service;
+        if (GattDisc_StoreUuid(db, &data[off + 5U], pair_len - 5U, &chr->uuid) != 0) {
+            db->overflow = 1;
+            continue;
+        }
+        db->char_count++;
+    }
+}
+
+void BLE_GattDisc_OnDescriptors(uint16_t conn_handle, uint8_t format,
+                                const uint8_t *data, uint8_t data_len)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+    uint8_t entry_len;
+    uint8_t off;
+    uint8_t i;
+    uint16_t handle;
+    BLE_GattChar_t *owner;
+
+    if (db == NULL || db->state != GATT_DISC_DESCRIPTORS) {
+        return;
+    }
+
+    /* Only 16-bit descriptors are of interest (CCCD) */
+    if (format != FIND_INFO_FORMAT_UUID16) {
+        return;
+    }
+    entry_len = 4U;
+
+    for (off = 0; (uint16_t)off + entry_len <= data_len; off += entry_len) {
+        if (LE16(&data[off + 2U]) != GATT_UUID_CCCD) {
+            continue;
+        }
+        handle = LE16(&data[off]);
+
+        /* Owner: characteristic of this service with the highest value handle below */
+        owner = NULL;
+        for (i = 0; i < db->char_count; i++) {
+            if (db->chars[i].service_idx == db->cur_service &&
+                db->chars[i].value_handle < handle &&
+                (owner == NULL || db->chars[i].value_handle > owner->value_handle)) {
+                owner = &db->chars[i];
+            }
+        }
+        if (owner != NULL) {
+            owner->cccd_handle = handle;
+        }
+    }
+}
+
+void BLE_GattDisc_OnProcComplete(uint16_t conn_handle, uint8_t error_code)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+
+    if (db == NULL) {
+        return;
+    }
+
+    /* ATT "Attribute Not Found" ends every discovery walk; other errors are logged */
+    if (error_code != 0) {
+        DEBUG_WARN("Discovery 0x%04X step %d: 0x%02X", conn_handle, (int)db->state, error_code);
+    }
+
+    switch (db->state) {
+    case GATT_DISC_SERVICES:
+        if (db->services_only) {
+            db->state = GATT_DISC_SERVICES_DONE;
+            db->duration_ms = HAL_GetTick() - db->start_tick;
+            if (done_cb) {
+                done_cb(db->conn_handle, db->state);
+            }
+            break;
+        }
+        db->cur_service = 0;
+        GattDisc_NextService(db);
+        break;
+    case GATT_DISC_CHARS:
+        GattDisc_Descriptors(db);
+        break;
+    case GATT_DISC_DESCRIPTORS:
+        GattDisc_PrintServiceChars(db);
+        db->cur_service++;
+        GattDisc_NextService(db);
+        break;
+    default:
+        break;
+    }
+}
+
+void BLE_GattDisc_Abort(uint16_t conn_handle)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+
+    if (db == NULL || (db->state != GATT_DISC_SERVICES && db->state != GATT_DISC_CHARS &&
+                       db->state != GATT_DISC_DESCRIPTORS)) {
+        return;
+    }
+    GattDisc_Fail(db, 0xFF);
+}
+
+void BLE_GattDisc_OnProcTimeout(uint16_t conn_handle)
+{
+    BLE_GattDisc_Abort(conn_handle);
+}
+
+void BLE_GattDisc_OnDisconnected(uint16_t conn_handle)
+{
+    BLE_GattDb_t *db = GattDisc_Find(conn_handle);
+
+    if (db != NULL) {
+        memset(db, 0, sizeof(*db));
+        db->conn_handle = 0xFFFF;
+    }
+}
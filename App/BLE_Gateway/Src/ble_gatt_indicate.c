@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_indicate.c
+  * @brief   Indication delivery and confirmation implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_indicate.h"
+#include "ble_connection.h"
+#include "ble_event_bus.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+#define GATT_IND_MS_TO_TICKS(ms)    ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* Confirm deadline check period while an indication waits for the host */
+#define GATT_IND_TICK_MS            500U
+
+typedef struct {
+    BLE_GattIndStats_t stats;       /* stats.conn_handle keys the slot */
+    uint32_t rx_tick;               /* Reception of the pending indication */
+    uint16_t handle;                /* Attribute of the pending indication */
+} GattInd_Link_t;
+
+static GattInd_Link_t ind_links[MAX_BLE_CONNECTIONS];
+static BLE_GattIndMode_t ind_mode = GATT_IND_CONFIRM_AUTO;
+static uint8_t ind_timer_id;
+static uint8_t ind_timer_on = 0;
+
+static GattInd_Link_t* GattInd_Find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (ind_links[i].stats.conn_handle == conn_handle) {
+            return &ind_links[i];
+        }
+    }
+    return NULL;
+}
+
+static GattInd_Link_t* GattInd_Alloc(uint16_t conn_handle)
+{
+    GattInd_Link_t *l = GattInd_Find(conn_handle);
+
+    if (l == NULL && BLE_Connection_GetInfo(conn_handle) != NULL) {
+        l = GattInd_Find(0xFFFF);
+        if (l != NULL) {
+            memset(l, 0, sizeof(*l));
+            l->stats.conn_handle = conn_handle;
+        }
+    }
+    return l;
+}
+
+/**
+ * @brief Send the Handle Value Confirmation; the peer may then indicate again
+ */
+static int GattInd_Confirm(GattInd_Link_t *l)
+{
+    uint32_t ms = HAL_GetTick() - l->rx_tick;
+    tBleStatus ret;
+
+    ret = aci_gatt_confirm_indication(l->stats.conn_handle);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("Indication confirm 0x%04X failed: 0x%02X", l->stats.conn_handle, ret);
+        l->stats.errors++;
+        return -1;
+    }
+
+    l->stats.pending = 0;
+    l->stats.confirmed++;
+    l->stats.total_ms += ms;
+    if (ms > l->stats.max_ms) {
+        l->stats.max_ms = ms;
+    }
+    return 0;
+}
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void GattInd_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_IND_ID, CFG_SCH_PRIO_HOST);
+}
+
+/**
+ * @brief Run the timer only while some indication waits for the host
+ */
+static void GattInd_TimerUpdate(void)
+{
+    uint8_t i;
+    uint8_t busy = 0;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (ind_links[i].stats.conn_handle != 0xFFFF && ind_links[i].stats.pending) {
+            busy = 1;
+            break;
+        }
+    }
+
+    if (busy && !ind_timer_on) {
+        HW_TS_Start(ind_timer_id, GATT_IND_MS_TO_TICKS(GATT_IND_TICK_MS));
+        ind_timer_on = 1;
+    } else if (!busy && ind_timer_on) {
+        HW_TS_Stop(ind_timer_id);
+        ind_timer_on = 0;
+    }
+}
+
+static void GattInd_EvtIndication(void *evt)
+{
+    aci_gatt_indication_event_rp0 *pr = evt;
+
+    BLE_GattInd_OnIndication(pr->Connection_Handle, pr->Attribute_Handle,
+                             pr->Attribute_Value, pr->Attribute_Value_Length);
+}
+
+void BLE_GattInd_Init(void)
+{
+    uint8_t i;
+
+    memset(ind_links, 0, sizeof(ind_links));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        ind_links[i].stats.conn_handle = 0xFFFF;
+    }
+    ind_mode = GATT_IND_CONFIRM_AUTO;
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &ind_timer_id, hw_ts_Repeated, GattInd_TimerCb);
+    ind_timer_on = 0;
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_INDICATION_VSEVT_CODE, GattInd_EvtIndication);
+}
+
+void BLE_GattInd_SetMode(BLE_GattIndMode_t mode)
+{
+    uint8_t i;
+
+    ind_mode = mode;
+    DEBUG_INFO("Indication confirm: %s", (mode == GATT_IND_CONFIRM_HOST) ? "host" : "auto");
+
+    /* Nothing may stay unconfirmed once the host stops acknowledging */
+    if (mode == GATT_IND_CONFIRM_AUTO) {
+        for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+            if (ind_links[i].stats.conn_handle != 0xFFFF && ind_links[i].stats.pending) {
+                GattInd_Confirm(&ind_links[i]);
+            }
+        }
+        GattInd_TimerUpdate();
+    }
+}
+
+BLE_GattIndMode_t BLE_GattInd_GetMode(void)
+{
+    return ind_mode;
+}
+
+int BLE_GattInd_Ack(uint16_t conn_handle)
+{
+    GattInd_Link_t *l = GattInd_Find(conn_handle);
+    int ret;
+
+    if (l == NULL || !l->stats.pending) {
+        return -1;
+    }
+    ret = GattInd_Confirm(l);
+    GattInd_TimerUpdate();
+    return ret;
+}
+
+const BLE_GattIndStats_t* BLE_GattInd_GetStats(uint16_t conn_handle)
+{
+    GattInd_Link_t *l;
+
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+    l = GattInd_Find(conn_handle);
+    return (l != NULL) ? &l->stats : NULL;
+}
+
+void BLE_GattInd_OnIndication(uint16_t conn_handle, uint16_t handle,
+                              const uint8_t *data, uint16_t len)
+{
+    GattInd_Link_t *l = GattInd_Alloc(conn_handle);
+
+    if (l != NULL) {
+        if (l->stats.pending) {
+            /* ATT allows one outstanding indication: the peer broke sequencing */
+            DEBUG_WARN("Indication 0x%04X handle 0x%04X before confirmation",
+                       conn_handle, handle);
+        }
+        l->stats.received++;
+        l->stats.pending = 1;
+        l->rx_tick = HAL_GetTick();
+        l->handle = handle;
+    }
+
+    /* Blocking UART write: the payload has left for the host on return */
+    BLE_EventBus_OnIndication(conn_handle, handle, data, len);
+
+    if (l == NULL) {
+        /* No slot for metrics: never leave the peer waiting */
+        aci_gatt_confirm_indication(conn_handle);
+        return;
+    }
+    if (ind_mode == GATT_IND_CONFIRM_AUTO) {
+        GattInd_Confirm(l);
+    }
+    GattInd_TimerUpdate();
+}
+
+void BLE_GattInd_Process(void)
+{
+    GattInd_Link_t *l;
+    uint32_t now = HAL_GetTick();
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        l = &ind_links[i];
+        if (l->stats.conn_handle == 0xFFFF || !l->stats.pending) {
+            continue;
+        }
+        if ((now - l->rx_tick) < GATT_IND_CONFIRM_TIMEOUT_MS) {
+            continue;
+        }
+
+        /* The peer would drop the link at 30 s: confirm for the host; a refused
+           confirm stays pending and is retried on the next tick */
+        if (GattInd_Confirm(l) == 0) {
+            l->stats.timeouts++;
+            DEBUG_WARN("Indication 0x%04X handle 0x%04X not acknowledged, confirmed at deadline",
+                       l->stats.conn_handle, l->handle);
+            AT_Response_Send("+IND_TIMEOUT:0x%04X,0x%04X\r\n", l->stats.conn_handle, l->handle);
+        }
+    }
+    GattInd_TimerUpdate();
+}
+
+void BLE_GattInd_OnDisconnected(uint16_t conn_handle)
+{
+    GattInd_Link_t *l = GattInd_Find(conn_handle);
+
+    if (l == NULL) {
+        return;
+    }
+    if (l->stats.pending) {
+        DEBUG_WARN("Indication 0x%04X unconfirmed at disconnect", conn_handle);
+    }
+    l->stats.conn_handle = 0xFFFF;
+    l->stats.pending = 0;
+    GattInd_TimerUpdate();
+}
@@ -0,0 +1,1238 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_queue.c
+  * @brief   Per-connection GATT operation queue implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_queue.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_cache.h"
+#include "ble_gatt_readm.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "ble_event_bus.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+#define GATT_QUEUE_MS_TO_TICKS(ms)  ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* Timeout and retry check period while any queue holds operations */
+#define GATT_QUEUE_TICK_MS          100U
+
+/* Largest value of one write long command (stack limit) */
+#define GATT_LONG_CHUNK             (BLE_CMD_MAX_PARAM_LEN - 7U)
+
+/* ATT_MTU before the exchange */
+#define GATT_ATT_MTU_MIN            23U
+
+/* Reliable write: entries packed as handle (2), length (2), value */
+#define GATT_REL_HDR_LEN            4U
+#define GATT_REL_PREPARE            0U
+#define GATT_REL_EXECUTE            1U
+#define GATT_REL_CANCEL             2U
+
+/* UUID operation steps */
+#define GATT_UUID_RESOLVE           0U      /* Read / discover by UUID */
+#define GATT_UUID_FIND_CCCD         1U      /* Find Information after the value */
+
+#define GATT_ATT_ERR_NOT_FOUND      0x0AU   /* ATT Error: Attribute Not Found */
+#define GATT_UUID_CHAR_DECL         0x2803U
+#define GATT_UUID_PRIMARY_SVC       0x2800U
+#define GATT_UUID_SECONDARY_SVC     0x2801U
+
+typedef struct {
+    BLE_GattOpType_t type;
+    uint16_t handle;
+    uint16_t len;
+    uint16_t timeout_ms;
+    uint32_t enqueue_tick;
+    uint32_t head_tick;             /* Reached the head: start deadline while refused */
+    uint32_t start_tick;
+    int8_t buf;                     /* Long buffer index, -1 if data is inline */
+    uint8_t phase;                  /* Reliable write step */
+    uint8_t err;                    /* Reliable write: error that caused the cancel */
+    uint16_t offset;                /* Long write progress / current reliable entry */
+    uint16_t part;                  /* Reliable write progress inside the entry */
+    uint16_t step_len;              /* Bytes of the running procedure */
+    BLE_GattOpType_t action;        /* UUID operation: READ, WRITE or WRITE_DESC */
+    uint16_t found;                 /* UUID operation: resolved value handle */
+    uint16_t cccd;                  /* UUID operation: resolved CCCD handle */
+    BLE_GattUuidKey_t key;
+    uint8_t data[GATT_QUEUE_MAX_DATA];
+} GattQueue_Op_t;
+
+typedef struct {
+    BLE_GattQueueStats_t stats;     /* stats.conn_handle keys the slot */
+    uint8_t head;
+    uint8_t running;                /* Head operation accepted by the stack */
+    uint8_t stale;                  /* Procedure of a timed-out operation still in the stack */
+    uint8_t att_error;              /* ATT Error Response of the running operation */
+    GattQueue_Op_t ops[GATT_QUEUE_DEPTH];
+} GattQueue_Link_t;
+
+static GattQueue_Link_t gatt_queue[MAX_BLE_CONNECTIONS];
+static uint16_t op_timeout_ms = GATT_QUEUE_DEFAULT_TIMEOUT_MS;
+static uint8_t queue_timer_id;
+static uint8_t queue_timer_on = 0;
+
+static uint8_t long_bufs[CFG_GATT_LONG_BUF_NBR][GATT_LONG_MAX_LEN];
+static uint8_t long_buf_used[CFG_GATT_LONG_BUF_NBR];
+
+static const char *const op_names[] = { "READ", "WRITE", "DESC", "DISC", "MTU",
+                                        "READ", "WRITE", "WRITE", "READM", "UUID" };
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void GattQueue_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_QUEUE_ID, CFG_SCH_PRIO_HOST);
+}
+
+static GattQueue_Link_t* GattQueue_Find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (gatt_queue[i].stats.conn_handle == conn_handle) {
+            return &gatt_queue[i];
+        }
+    }
+    return NULL;
+}
+
+static GattQueue_Link_t* GattQueue_Alloc(uint16_t conn_handle)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+
+    if (q == NULL && BLE_Connection_GetInfo(conn_handle) != NULL) {
+        q = GattQueue_Find(0xFFFF);
+        if (q != NULL) {
+            memset(q, 0, sizeof(*q));
+            q->stats.conn_handle = conn_handle;
+        }
+    }
+    return q;
+}
+
+static int8_t GattQueue_AllocBuf(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < CFG_GATT_LONG_BUF_NBR; i++) {
+        if (!long_buf_used[i]) {
+            long_buf_used[i] = 1;
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+static void GattQueue_FreeBuf(GattQueue_Op_t *op)
+{
+    if (op->buf >= 0) {
+        long_buf_used[op->buf] = 0;
+        op->buf = -1;
+    }
+}
+
+static uint8_t* GattQueue_Data(GattQueue_Op_t *op)
+{
+    return (op->buf >= 0) ? long_bufs[op->buf] : op->data;
+}
+
+/**
+ * @brief Run the timer only while some operation is queued
+ */
+static void GattQueue_TimerUpdate(void)
+{
+    uint8_t i;
+    uint8_t busy = 0;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (gatt_queue[i].stats.conn_handle != 0xFFFF && gatt_queue[i].stats.depth > 0U) {
+            busy = 1;
+            break;
+        }
+    }
+
+    if (busy && !queue_timer_on) {
+        HW_TS_Start(queue_timer_id, GATT_QUEUE_MS_TO_TICKS(GATT_QUEUE_TICK_MS));
+        queue_timer_on = 1;
+    } else if (!busy && queue_timer_on) {
+        HW_TS_Stop(queue_timer_id);
+        queue_timer_on = 0;
+    }
+}
+
+/**
+ * @brief Issue the next Prepare Write (or the Execute Write) of a reliable write
+ */
+static tBleStatus GattQueue_StartReliable(uint16_t conn_handle, GattQueue_Op_t *op)
+{
+    const uint8_t *entry = GattQueue_Data(op) + op->offset;
+    BLE_ConnectionInfo_t *info;
+    uint16_t handle;
+    uint16_t len;
+    uint16_t max;
+
+    if (op->phase == GATT_REL_EXECUTE) {
+        return aci_att_execute_write_req(conn_handle, 0x01);
+    }
+    if (op->phase == GATT_REL_CANCEL) {
+        return aci_att_execute_write_req(conn_handle, 0x00);
+    }
+
+    handle = (uint16_t)(entry[0] | (entry[1] << 8));
+    len = (uint16_t)(entry[2] | (entry[3] << 8));
+
+    /* Prepare Write Request carries ATT_MTU - 5 value bytes */
+    info = BLE_Connection_GetInfo(conn_handle);
+    max = (info != NULL && info->att_mtu > GATT_ATT_MTU_MIN) ?
+          (uint16_t)(info->att_mtu - 5U) : (uint16_t)(GATT_ATT_MTU_MIN - 5U);
+    op->step_len = (uint16_t)(len - op->part);
+    if (op->step_len > max) {
+        op->step_len = max;
+    }
+
+    return aci_att_prepare_write_req(conn_handle, handle, op->part, (uint8_t)op->step_len,
+                                     &entry[GATT_REL_HDR_LEN + op->part]);
+}
+
+static tBleStatus GattQueue_StartOp(uint16_t conn_handle, GattQueue_Op_t *op);
+
+/**
+ * @brief Turn a resolved UUID operation into its handle operation and start it
+ */
+static tBleStatus GattQueue_Resolved(uint16_t conn_handle, GattQueue_Op_t *op, uint16_t handle)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+
+    op->type = op->action;
+    op->handle = handle;
+    if (op->type == GATT_OP_WRITE && info != NULL && op->len + 3U > info->att_mtu) {
+        op->type = GATT_OP_WRITE_LONG;
+    }
+    return GattQueue_StartOp(conn_handle, op);
+}
+
+/**
+ * @brief Issue the next lookup of a UUID operation
+ */
+static tBleStatus GattQueue_StartUuid(uint16_t conn_handle, GattQueue_Op_t *op)
+{
+    UUID_t uuid;
+    uint8_t type;
+    uint16_t value_handle;
+    uint16_t cccd_handle;
+
+    /* Resolved while queued: discovery finished or an earlier lookup */
+    if (op->phase == GATT_UUID_RESOLVE &&
+        BLE_GattResolve_Lookup(conn_handle, &op->key, &value_handle, &cccd_handle) == 0) {
+        if (op->action != GATT_OP_WRITE_DESC) {
+            return GattQueue_Resolved(conn_handle, op, value_handle);
+        }
+        if (cccd_handle != 0U) {
+            return GattQueue_Resolved(conn_handle, op, cccd_handle);
+        }
+        op->found = value_handle;
+        op->phase = GATT_UUID_FIND_CCCD;
+    }
+
+    if (op->phase == GATT_UUID_FIND_CCCD) {
+        if (op->found == 0xFFFF) {
+            return BLE_STATUS_INVALID_PARAMS;
+        }
+        /* One request: the CCCD follows the value within the first response */
+        op->cccd = 0;
+        return aci_att_find_info_req(conn_handle, (uint16_t)(op->found + 1U), 0xFFFF);
+    }
+
+    op->found = 0;
+    if (op->key.len == 2U) {
+        type = UUID_TYPE_16;
+        uuid.UUID_16 = (uint16_t)(op->key.uuid[0] | (op->key.uuid[1] << 8));
+    } else {
+        type = UUID_TYPE_128;
+        memcpy(uuid.UUID_128, op->key.uuid, sizeof(uuid.UUID_128));
+    }
+
+    /* Read By Type returns handle and value in one round trip */
+    if (op->action == GATT_OP_READ) {
+        return aci_gatt_read_using_char_uuid(conn_handle, 0x0001, 0xFFFF, type, &uuid);
+    }
+    return aci_gatt_disc_char_by_uuid(conn_handle, 0x0001, 0xFFFF, type, &uuid);
+}
+
+/**
+ * @brief Issue the ATT procedure of an operation
+ */
+static tBleStatus GattQueue_StartOp(uint16_t conn_handle, GattQueue_Op_t *op)
+{
+    tBleStatus ret;
+
+    switch (op->type) {
+    case GATT_OP_READ:
+        ret = aci_gatt_read_char_value(conn_handle, op->handle);
+        break;
+    case GATT_OP_WRITE:
+        ret = aci_gatt_write_char_value(conn_handle, op->handle, (uint8_t)op->len,
+                                        GattQueue_Data(op));
+        if (ret == BLE_STATUS_SUCCESS) {
+            BLE_Connection_CountTraffic(conn_handle, 1, op->len);
+        }
+        break;
+    case GATT_OP_WRITE_DESC:
+        ret = aci_gatt_write_char_desc(conn_handle, op->handle, (uint8_t)op->len,
+                                       GattQueue_Data(op));
+        break;
+    case GATT_OP_READ_LONG:
+        /* Reassembled from Read Blob responses */
+        op->len = 0;
+        ret = aci_gatt_read_long_char_value(conn_handle, op->handle, 0);
+        break;
+    case GATT_OP_WRITE_LONG:
+        op->step_len = (uint16_t)(op->len - op->offset);
+        if (op->step_len > GATT_LONG_CHUNK) {
+            op->step_len = GATT_LONG_CHUNK;
+        }
+        ret = aci_gatt_write_long_char_value(conn_handle, op->handle, op->offset,
+                                             (uint8_t)op->step_len,
+                                             GattQueue_Data(op) + op->offset);
+        if (ret == BLE_STATUS_SUCCESS) {
+            BLE_Connection_CountTraffic(conn_handle, 1, op->step_len);
+        }
+        break;
+    case GATT_OP_READ_MULTI:
+        /* Multi-procedure: the engine chains its own steps on PROC_COMPLETE */
+        ret = BLE_GattReadM_Start(conn_handle, op->data[0], &op->data[1],
+                                  (uint8_t)((op->len - 1U) / 2U));
+        break;
+    case GATT_OP_WRITE_REL:
+        ret = GattQueue_StartReliable(conn_handle, op);
+        if (ret == BLE_STATUS_SUCCESS && op->phase == GATT_REL_PREPARE) {
+            BLE_Connection_CountTraffic(conn_handle, 1, op->step_len);
+        }
+        break;
+    case GATT_OP_DISC:
+        /* Multi-procedure: the engine chains its own steps on PROC_COMPLETE */
+        ret = (BLE_GattDisc_Start(conn_handle) == 0) ? BLE_STATUS_SUCCESS : BLE_STATUS_BUSY;
+        break;
+    case GATT_OP_MTU:
+        ret = aci_gatt_exchange_config(conn_handle);
+        break;
+    case GATT_OP_UUID:
+        ret = GattQueue_StartUuid(conn_handle, op);
+        break;
+    default:
+        ret = BLE_STATUS_INVALID_PARAMS;
+        break;
+    }
+    return ret;
+}
+
+/**
+ * @brief Finish the head operation, report its result and pop it
+ */
+static void GattQueue_Complete(GattQueue_Link_t *q, uint8_t status)
+{
+    GattQueue_Op_t *op = &q->ops[q->head];
+    uint16_t conn_handle = q->stats.conn_handle;
+    BLE_GattOpType_t type = op->type;
+    uint16_t handle = op->handle;
+    uint32_t now = HAL_GetTick();
+    uint32_t latency = now - op->enqueue_tick;
+    uint8_t started = q->running;
+
+    if (q->running) {
+        q->stats.exec_ms_total += now - op->start_tick;
+        q->stats.executed++;
+    }
+    if (latency > q->stats.max_latency_ms) {
+        q->stats.max_latency_ms = latency;
+    }
+    if (status == 0U) {
+        q->stats.completed++;
+    } else if (status == GATT_QUEUE_ERR_TIMEOUT) {
+        q->stats.timeouts++;
+    } else {
+        q->stats.failed++;
+    }
+
+    q->head = (uint8_t)((q->head + 1U) % GATT_QUEUE_DEPTH);
+    q->stats.depth--;
+    q->running = 0;
+    q->att_error = 0;
+    if (q->stats.depth > 0U) {
+        q->ops[q->head].head_tick = now;
+    }
+
+    if (status != 0U) {
+        DEBUG_WARN("GATT %s 0x%04X handle 0x%04X failed: 0x%02X", op_names[type],
+                   conn_handle, handle, status);
+    }
+
+    switch (type) {
+    case GATT_OP_WRITE:
+    case GATT_OP_WRITE_LONG:
+    case GATT_OP_WRITE_REL:
+        BLE_EventBus_OnWriteResponse(conn_handle, status);
+        break;
+    case GATT_OP_READ_MULTI:
+        /* The engine reports +READM itself */
+        if (status != 0U) {
+            BLE_GattReadM_Abort(conn_handle);
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    case GATT_OP_READ_LONG:
+        if (status == 0U) {
+            BLE_EventBus_OnReadResponse(conn_handle, handle, GattQueue_Data(op), op->len);
+        } else {
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    case GATT_OP_MTU:
+        /* A lost link has nothing left to bring up */
+        if (status != GATT_QUEUE_ERR_DISCONNECTED) {
+            BLE_Connection_OnMtuDone(conn_handle, status);
+        }
+        break;
+    case GATT_OP_UUID:
+        /* Resolution failed (a resolved read has reported +READ already) */
+        if (op->action == GATT_OP_WRITE) {
+            BLE_EventBus_OnWriteResponse(conn_handle, status);
+        } else if (status != 0U) {
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    case GATT_OP_DISC:
+        /* A started engine reports its own +DISC_DONE / +DISC_ERROR, timeouts included;
+           at disconnect it is cleared without a report */
+        if ((!started || status == GATT_QUEUE_ERR_DISCONNECTED) && status != 0U) {
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    case GATT_OP_WRITE_DESC:
+        if (op->len == 2U) {
+            /* CCCD write: the subscription manager keeps the set per device */
+            BLE_GattSub_OnCccdWritten(conn_handle, handle, op->found,
+                                      (uint16_t)(GattQueue_Data(op)[0] |
+                                                 (GattQueue_Data(op)[1] << 8)), status);
+        }
+        if (status != 0U) {
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    default:
+        if (status != 0U) {
+            AT_Response_Send("+GATT_ERROR:0x%04X,%s,0x%04X,%02X\r\n", conn_handle,
+                             op_names[type], handle, status);
+        }
+        break;
+    }
+
+    GattQueue_FreeBuf(op);
+}
+
+/**
+ * @brief Fail the running operation on timeout
+ * @note  The stack still owns its procedure: the link stays blocked until the
+ *        procedure completes, or the ATT transaction timeout ends the link
+ */
+static void GattQueue_Expire(GattQueue_Link_t *q)
+{
+    if (q->ops[q->head].type == GATT_OP_DISC) {
+        BLE_GattDisc_Abort(q->stats.conn_handle);
+    }
+    GattQueue_Complete(q, GATT_QUEUE_ERR_TIMEOUT);
+    q->stale = 1;
+}
+
+/**
+ * @brief Advance a multi-procedure operation after PROC_COMPLETE
+ * @param status In: result of the procedure, out: result of the operation
+ * @return 1 if the next procedure runs, 0 if the operation is finished
+ */
+static uint8_t GattQueue_Continue(GattQueue_Link_t *q, uint8_t *status)
+{
+    GattQueue_Op_t *op = &q->ops[q->head];
+    const uint8_t *entry;
+    uint16_t entry_len;
+    tBleStatus ret;
+
+    switch (op->type) {
+    case GATT_OP_WRITE_LONG:
+        if (*status != 0U) {
+            return 0;
+        }
+        op->offset += op->step_len;
+        if (op->offset >= op->len) {
+            return 0;
+        }
+        break;
+    case GATT_OP_WRITE_REL:
+        if (op->phase == GATT_REL_CANCEL) {
+            *status = op->err;
+            return 0;
+        }
+        if (op->phase == GATT_REL_EXECUTE) {
+            return 0;
+        }
+        if (*status != 0U) {
+            /* Drop what the server has queued so far */
+            op->err = *status;
+            op->phase = GATT_REL_CANCEL;
+            break;
+        }
+        entry = GattQueue_Data(op) + op->offset;
+        entry_len = (uint16_t)(entry[2] | (entry[3] << 8));
+        op->part += op->step_len;
+        if (op->part >= entry_len) {
+            op->offset += GATT_REL_HDR_LEN + entry_len;
+            op->part = 0;
+        }
+        if (op->offset >= op->len) {
+            op->phase = GATT_REL_EXECUTE;
+        }
+        break;
+    case GATT_OP_UUID:
+        if (op->phase == GATT_UUID_RESOLVE) {
+            /* A match ends the walk with Attribute Not Found: not an error */
+            if (op->found == 0U) {
+                if (*status == 0U) {
+                    *status = GATT_ATT_ERR_NOT_FOUND;
+                }
+                return 0;
+            }
+            *status = 0;
+            BLE_GattResolve_Learn(q->stats.conn_handle, &op->key, op->found, 0, 1);
+            if (op->action == GATT_OP_READ) {
+                return 0;
+            }
+            if (op->action == GATT_OP_WRITE_DESC) {
+                op->phase = GATT_UUID_FIND_CCCD;
+                break;
+            }
+            q->att_error = 0;
+            ret = GattQueue_Resolved(q->stats.conn_handle, op, op->found);
+        } else {
+            if (op->cccd == 0U) {
+                *status = GATT_ATT_ERR_NOT_FOUND;
+                return 0;
+            }
+            BLE_GattResolve_Learn(q->stats.conn_handle, &op->key, op->found, op->cccd, 1);
+            q->att_error = 0;
+            ret = GattQueue_Resolved(q->stats.conn_handle, op, op->cccd);
+        }
+        if (ret != BLE_STATUS_SUCCESS) {
+            *status = ret;
+            return 0;
+        }
+        return 1;
+    default:
+        return 0;
+    }
+
+    q->att_error = 0;
+    ret = GattQueue_StartOp(q->stats.conn_handle, op);
+    if (ret != BLE_STATUS_SUCCESS) {
+        *status = ret;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Start the head operation if the link is free
+ * @note  Engines outside the queue (discovery steps, cache hash read) may hold
+ *        the link; a refused start is retried on the next PROC_COMPLETE or tick
+ */
+static void GattQueue_Kick(GattQueue_Link_t *q)
+{
+    GattQueue_Op_t *op;
+    tBleStatus ret;
+
+    while (!q->running && !q->stale && q->stats.depth > 0U) {
+        op = &q->ops[q->head];
+        ret = GattQueue_StartOp(q->stats.conn_handle, op);
+        if (ret == BLE_STATUS_SUCCESS) {
+            op->start_tick = HAL_GetTick();
+            q->stats.wait_ms_total += op->start_tick - op->enqueue_tick;
+            q->stats.started++;
+            q->running = 1;
+            return;
+        }
+        if (ret != BLE_STATUS_INVALID_PARAMS) {
+            return;
+        }
+        GattQueue_Complete(q, ret);
+    }
+}
+
+/**
+ * @brief Fill the next free slot of a link; GattQueue_Submit makes it visible
+ * @return Slot, or NULL if queue full, no buffer free or invalid argument
+ */
+static GattQueue_Op_t* GattQueue_Reserve(GattQueue_Link_t **q_out, uint16_t conn_handle,
+                                         BLE_GattOpType_t type, uint16_t handle,
+                                         const uint8_t *data, uint16_t len, uint16_t timeout_ms)
+{
+    GattQueue_Link_t *q;
+    GattQueue_Op_t *op;
+
+    if (len > GATT_LONG_MAX_LEN || (len > 0U && data == NULL)) {
+        return NULL;
+    }
+
+    q = GattQueue_Alloc(conn_handle);
+    if (q == NULL) {
+        return NULL;
+    }
+    if (q->stats.depth >= GATT_QUEUE_DEPTH) {
+        q->stats.rejected++;
+        DEBUG_WARN("GATT queue 0x%04X full", conn_handle);
+        return NULL;
+    }
+
+    op = &q->ops[(q->head + q->stats.depth) % GATT_QUEUE_DEPTH];
+    op->buf = -1;
+    if (len > GATT_QUEUE_MAX_DATA || type == GATT_OP_READ_LONG) {
+        op->buf = GattQueue_AllocBuf();
+        if (op->buf < 0) {
+            DEBUG_WARN("GATT queue 0x%04X: no long buffer free", conn_handle);
+            return NULL;
+        }
+    }
+    op->type = type;
+    op->handle = handle;
+    op->len = len;
+    op->timeout_ms = timeout_ms;
+    op->enqueue_tick = HAL_GetTick();
+    op->head_tick = op->enqueue_tick;
+    op->start_tick = 0;
+    op->phase = GATT_REL_PREPARE;
+    op->err = 0;
+    op->offset = 0;
+    op->part = 0;
+    op->step_len = 0;
+    op->action = type;
+    op->found = 0;
+    op->cccd = 0;
+    if (len > 0U) {
+        memcpy(GattQueue_Data(op), data, len);
+    }
+
+    *q_out = q;
+    return op;
+}
+
+static void GattQueue_Submit(GattQueue_Link_t *q)
+{
+    q->stats.depth++;
+    if (q->stats.depth > q->stats.max_depth) {
+        q->stats.max_depth = q->stats.depth;
+    }
+
+    GattQueue_Kick(q);
+    GattQueue_TimerUpdate();
+}
+
+static int GattQueue_Push(uint16_t conn_handle, BLE_GattOpType_t type, uint16_t handle,
+                          const uint8_t *data, uint16_t len, uint16_t timeout_ms)
+{
+    GattQueue_Link_t *q;
+
+    if (GattQueue_Reserve(&q, conn_handle, type, handle, data, len, timeout_ms) == NULL) {
+        return -1;
+    }
+    GattQueue_Submit(q);
+    return 0;
+}
+
+/**
+ * @brief Queue a UUID operation that resolves its handle when it runs
+ */
+static int GattQueue_PushUuid(uint16_t conn_handle, BLE_GattOpType_t action,
+                              const BLE_GattUuidKey_t *key, const uint8_t *data, uint16_t len)
+{
+    GattQueue_Link_t *q;
+    GattQueue_Op_t *op;
+    uint16_t timeout_ms = (len > GATT_QUEUE_MAX_DATA) ? GATT_QUEUE_LONG_TIMEOUT_MS : op_timeout_ms;
+
+    op = GattQueue_Reserve(&q, conn_handle, GATT_OP_UUID, 0, data, len, timeout_ms);
+    if (op == NULL) {
+        return -1;
+    }
+    op->action = action;
+    op->key = *key;
+    op->phase = GATT_UUID_RESOLVE;
+    GattQueue_Submit(q);
+    return 0;
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void GattQueue_EvtFindInfo(void *evt)
+{
+    aci_att_find_info_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnFindInfo(pr->Connection_Handle, pr->Format,
+                             pr->Handle_UUID_Pair, pr->Event_Data_Length);
+}
+
+static void GattQueue_EvtReadResp(void *evt)
+{
+    aci_att_read_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnReadResp(pr->Connection_Handle, pr->Attribute_Value, pr->Event_Data_Length);
+}
+
+static void GattQueue_EvtReadBlobResp(void *evt)
+{
+    aci_att_read_blob_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnReadBlobResp(pr->Connection_Handle, pr->Attribute_Value, pr->Event_Data_Length);
+}
+
+static void GattQueue_EvtPrepareWriteResp(void *evt)
+{
+    aci_att_prepare_write_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnPrepareWriteResp(pr->Connection_Handle, pr->Attribute_Handle, pr->Offset,
+                                     pr->Part_Attribute_Value, pr->Part_Attribute_Value_Length);
+}
+
+static void GattQueue_EvtErrorResp(void *evt)
+{
+    aci_gatt_error_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnErrorResp(pr->Connection_Handle, pr->Attribute_Handle, pr->Error_Code);
+}
+
+static void GattQueue_EvtReadByUuid(void *evt)
+{
+    aci_gatt_disc_read_char_by_uuid_resp_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnReadByUuid(pr->Connection_Handle, pr->Attribute_Handle,
+                               pr->Attribute_Value, pr->Attribute_Value_Length);
+}
+
+/**
+ * @brief One procedure ended: the engine that owns the link goes first
+ * @note  The queue is the only subscriber of this event. Discovery runs before the
+ *        cache, whose hash check may start a discovery that must not see this
+ *        completion; both engines, and batched reads, chain their next step before
+ *        the queue looks for a free link. Each engine ignores the event unless it
+ *        has a procedure running on the link
+ */
+static void GattQueue_EvtProcComplete(void *evt)
+{
+    aci_gatt_proc_complete_event_rp0 *pr = evt;
+
+    BLE_GattDisc_OnProcComplete(pr->Connection_Handle, pr->Error_Code);
+    BLE_GattCache_OnProcComplete(pr->Connection_Handle, pr->Error_Code);
+    BLE_GattReadM_OnProcComplete(pr->Connection_Handle, pr->Error_Code);
+    BLE_GattQueue_OnProcComplete(pr->Connection_Handle, pr->Error_Code);
+}
+
+static void GattQueue_EvtProcTimeout(void *evt)
+{
+    aci_gatt_proc_timeout_event_rp0 *pr = evt;
+
+    BLE_GattQueue_OnProcTimeout(pr->Connection_Handle);
+}
+
+void BLE_GattQueue_Init(void)
+{
+    uint8_t i;
+
+    memset(gatt_queue, 0, sizeof(gatt_queue));
+    memset(long_buf_used, 0, sizeof(long_buf_used));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        gatt_queue[i].stats.conn_handle = 0xFFFF;
+    }
+
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &queue_timer_id, hw_ts_Repeated, GattQueue_TimerCb);
+    queue_timer_on = 0;
+
+    /* Response events are filtered by each engine's state, so their order does
+     * not matter; ACI_GATT_PROC_COMPLETE is forwarded in order from here */
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_FIND_INFO_RESP_VSEVT_CODE, GattQueue_EvtFindInfo);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_RESP_VSEVT_CODE, GattQueue_EvtReadResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_BLOB_RESP_VSEVT_CODE, GattQueue_EvtReadBlobResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_PREPARE_WRITE_RESP_VSEVT_CODE, GattQueue_EvtPrepareWriteResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_ERROR_RESP_VSEVT_CODE, GattQueue_EvtErrorResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_DISC_READ_CHAR_BY_UUID_RESP_VSEVT_CODE, GattQueue_EvtReadByUuid);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_PROC_COMPLETE_VSEVT_CODE, GattQueue_EvtProcComplete);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_PROC_TIMEOUT_VSEVT_CODE, GattQueue_EvtProcTimeout);
+
+    DEBUG_INFO("GATT queue initialized: depth=%d", GATT_QUEUE_DEPTH);
+}
+
+int BLE_GattQueue_SetTimeout(uint16_t timeout_ms)
+{
+    if (timeout_ms < GATT_QUEUE_MIN_TIMEOUT_MS) {
+        return -1;
+    }
+    op_timeout_ms = timeout_ms;
+    DEBUG_INFO("GATT queue timeout: %dms", timeout_ms);
+    return 0;
+}
+
+uint16_t BLE_GattQueue_GetTimeout(void)
+{
+    return op_timeout_ms;
+}
+
+int BLE_GattQueue_Read(uint16_t conn_handle, uint16_t handle)
+{
+    return GattQueue_Push(conn_handle, GATT_OP_READ, handle, NULL, 0, op_timeout_ms);
+}
+
+int BLE_GattQueue_Write(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+
+    if (len == 0U) {
+        return -1;
+    }
+    /* Value does not fit one Write Request */
+    if (info != NULL && len + 3U > info->att_mtu) {
+        return BLE_GattQueue_WriteLong(conn_handle, handle, data, len);
+    }
+    return GattQueue_Push(conn_handle, GATT_OP_WRITE, handle, data, len, op_timeout_ms);
+}
+
+int BLE_GattQueue_WriteDesc(uint16_t conn_handle, uint16_t handle,
+                            const uint8_t *data, uint16_t len)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    uint16_t mtu = (info != NULL && info->att_mtu > GATT_ATT_MTU_MIN) ?
+                   info->att_mtu : GATT_ATT_MTU_MIN;
+
+    /* One Write Request: no long descriptor writes */
+    if (len == 0U || len + 3U > mtu) {
+        return -1;
+    }
+    return GattQueue_Push(conn_handle, GATT_OP_WRITE_DESC, handle, data, len, op_timeout_ms);
+}
+
+int BLE_GattQueue_Discover(uint16_t conn_handle)
+{
+    return GattQueue_Push(conn_handle, GATT_OP_DISC, 0, NULL, 0, GATT_QUEUE_DISC_TIMEOUT_MS);
+}
+
+int BLE_GattQueue_ExchangeMtu(uint16_t conn_handle)
+{
+    return GattQueue_Push(conn_handle, GATT_OP_MTU, 0, NULL, 0, op_timeout_ms);
+}
+
+int BLE_GattQueue_ReadLong(uint16_t conn_handle, uint16_t handle)
+{
+    return GattQueue_Push(conn_handle, GATT_OP_READ_LONG, handle, NULL, 0,
+                          GATT_QUEUE_LONG_TIMEOUT_MS);
+}
+
+int BLE_GattQueue_WriteLong(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len)
+{
+    if (len == 0U) {
+        return -1;
+    }
+    return GattQueue_Push(conn_handle, GATT_OP_WRITE_LONG, handle, data, len,
+                          GATT_QUEUE_LONG_TIMEOUT_MS);
+}
+
+int BLE_GattQueue_ReadMulti(uint16_t conn_handle, const uint16_t *handles, uint8_t count,
+                            uint8_t flags)
+{
+    uint8_t packed[1U + 2U * GATT_READM_MAX_HANDLES];
+    uint8_t i;
+
+    if (handles == NULL || count == 0U || count > GATT_READM_MAX_HANDLES) {
+        return -1;
+    }
+
+    packed[0] = flags;
+    for (i = 0; i < count; i++) {
+        packed[1U + 2U * i] = (uint8_t)(handles[i] & 0xFFU);
+        packed[2U + 2U * i] = (uint8_t)(handles[i] >> 8);
+    }
+    return GattQueue_Push(conn_handle, GATT_OP_READ_MULTI, handles[0], packed,
+                          (uint16_t)(1U + 2U * count), op_timeout_ms);
+}
+
+int BLE_GattQueue_ReadUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key)
+{
+    uint16_t value_handle;
+    uint16_t cccd_handle;
+
+    if (key == NULL || (key->len != 2U && key->len != 16U)) {
+        return -1;
+    }
+    if (BLE_GattResolve_Lookup(conn_handle, key, &value_handle, &cccd_handle) == 0) {
+        return BLE_GattQueue_Read(conn_handle, value_handle);
+    }
+    return GattQueue_PushUuid(conn_handle, GATT_OP_READ, key, NULL, 0);
+}
+
+int BLE_GattQueue_WriteUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                            const uint8_t *data, uint16_t len)
+{
+    uint16_t value_handle;
+    uint16_t cccd_handle;
+
+    if (key == NULL || (key->len != 2U && key->len != 16U) || len == 0U) {
+        return -1;
+    }
+    if (BLE_GattResolve_Lookup(conn_handle, key, &value_handle, &cccd_handle) == 0) {
+        return BLE_GattQueue_Write(conn_handle, value_handle, data, len);
+    }
+    return GattQueue_PushUuid(conn_handle, GATT_OP_WRITE, key, data, len);
+}
+
+int BLE_GattQueue_WriteCccdUuid(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                                uint16_t value)
+{
+    uint8_t cccd_value[2];
+    uint16_t value_handle;
+    uint16_t cccd_handle;
+
+    if (key == NULL || (key->len != 2U && key->len != 16U)) {
+        return -1;
+    }
+
+    cccd_value[0] = (uint8_t)(value & 0xFFU);
+    cccd_value[1] = (uint8_t)(value >> 8);
+    if (BLE_GattResolve_Lookup(conn_handle, key, &value_handle, &cccd_handle) == 0 &&
+        cccd_handle != 0U) {
+        return BLE_GattQueue_WriteDesc(conn_handle, cccd_handle, cccd_value, 2);
+    }
+    return GattQueue_PushUuid(conn_handle, GATT_OP_WRITE_DESC, key, cccd_value, 2);
+}
+
+int BLE_GattQueue_WriteReliable(uint16_t conn_handle, const BLE_GattWriteEntry_t *entries,
+                                uint8_t count)
+{
+    static uint8_t packed[GATT_LONG_MAX_LEN];
+    const BLE_GattWriteEntry_t *e;
+    uint16_t total = 0;
+    uint8_t i;
+
+    if (entries == NULL || count == 0U) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        e = &entries[i];
+        if (e->handle == 0U || e->len == 0U || e->data == NULL ||
+            total + GATT_REL_HDR_LEN + e->len > GATT_LONG_MAX_LEN) {
+            return -1;
+        }
+        packed[total++] = (uint8_t)(e->handle & 0xFFU);
+        packed[total++] = (uint8_t)(e->handle >> 8);
+        packed[total++] = (uint8_t)(e->len & 0xFFU);
+        packed[total++] = (uint8_t)(e->len >> 8);
+        memcpy(&packed[total], e->data, e->len);
+        total += e->len;
+    }
+
+    return GattQueue_Push(conn_handle, GATT_OP_WRITE_REL, entries[0].handle, packed, total,
+                          GATT_QUEUE_LONG_TIMEOUT_MS);
+}
+
+const BLE_GattQueueStats_t* BLE_GattQueue_GetStats(uint16_t conn_handle)
+{
+    GattQueue_Link_t *q;
+
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+    q = GattQueue_Find(conn_handle);
+    return (q != NULL) ? &q->stats : NULL;
+}
+
+/**
+ * @brief Append a Read Blob part to the running long read
+ */
+static void GattQueue_Append(GattQueue_Link_t *q, const uint8_t *data, uint16_t len)
+{
+    GattQueue_Op_t *op = &q->ops[q->head];
+
+    if (op->len + len > GATT_LONG_MAX_LEN) {
+        DEBUG_WARN("Long read 0x%04X truncated", op->handle);
+        len = (uint16_t)(GATT_LONG_MAX_LEN - op->len);
+    }
+    memcpy(GattQueue_Data(op) + op->len, data, len);
+    op->len += len;
+}
+
+void BLE_GattQueue_OnReadResp(uint16_t conn_handle, const uint8_t *data, uint16_t len)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+
+    if (q == NULL || !q->running) {
+        return;
+    }
+    if (q->ops[q->head].type == GATT_OP_READ_LONG) {
+        BLE_Connection_CountTraffic(conn_handle, 0, len);
+        GattQueue_Append(q, data, len);
+        return;
+    }
+    if (q->ops[q->head].type != GATT_OP_READ) {
+        return;
+    }
+
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+    BLE_EventBus_OnReadResponse(conn_handle, q->ops[q->head].handle, data, len);
+}
+
+void BLE_GattQueue_OnReadBlobResp(uint16_t conn_handle, const uint8_t *data, uint16_t len)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+
+    if (q == NULL || !q->running || q->ops[q->head].type != GATT_OP_READ_LONG) {
+        return;
+    }
+
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+    GattQueue_Append(q, data, len);
+}
+
+void BLE_GattQueue_OnPrepareWriteResp(uint16_t conn_handle, uint16_t attr_handle, uint16_t offset,
+                                      const uint8_t *data, uint16_t len)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+    GattQueue_Op_t *op;
+    const uint8_t *entry;
+
+    if (q == NULL || !q->running) {
+        return;
+    }
+    op = &q->ops[q->head];
+    if (op->type != GATT_OP_WRITE_REL || op->phase != GATT_REL_PREPARE) {
+        return;
+    }
+
+    /* Reliable write: the server must echo exactly what was sent */
+    entry = GattQueue_Data(op) + op->offset;
+    if (attr_handle != (uint16_t)(entry[0] | (entry[1] << 8)) || offset != op->part ||
+        len != op->step_len || memcmp(data, &entry[GATT_REL_HDR_LEN + op->part], len) != 0) {
+        DEBUG_WARN("Reliable write 0x%04X: echo mismatch at 0x%04X", conn_handle, attr_handle);
+        q->att_error = GATT_QUEUE_ERR_VERIFY;
+    }
+}
+
+void BLE_GattQueue_OnReadByUuid(uint16_t conn_handle, uint16_t attr_handle,
+                                const uint8_t *value, uint16_t len)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+    GattQueue_Op_t *op;
+
+    if (q == NULL || !q->running) {
+        return;
+    }
+    op = &q->ops[q->head];
+    if (op->type != GATT_OP_UUID || op->phase != GATT_UUID_RESOLVE || op->found != 0U) {
+        return;
+    }
+
+    if (op->action == GATT_OP_READ) {
+        /* Read Using Characteristic UUID: value handle and value */
+        op->found = attr_handle;
+        BLE_Connection_CountTraffic(conn_handle, 0, len);
+        BLE_EventBus_OnReadResponse(conn_handle, attr_handle, value, len);
+    } else if (len >= 3U) {
+        /* Characteristic declaration: properties, value handle, UUID */
+        op->found = (uint16_t)(value[1] | (value[2] << 8));
+    }
+}
+
+void BLE_GattQueue_OnFindInfo(uint16_t conn_handle, uint8_t format,
+                              const uint8_t *data, uint16_t len)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+    GattQueue_Op_t *op;
+    uint16_t uuid;
+    uint16_t off;
+
+    if (q == NULL || !q->running) {
+        return;
+    }
+    op = &q->ops[q->head];
+    if (op->type != GATT_OP_UUID || op->phase != GATT_UUID_FIND_CCCD || format != UUID_TYPE_16) {
+        return;
+    }
+
+    /* Handle-UUID pairs; the characteristic ends at the next declaration */
+    for (off = 0; off + 4U <= len; off += 4U) {
+        uuid = (uint16_t)(data[off + 2U] | (data[off + 3U] << 8));
+        if (uuid == GATT_UUID_CHAR_DECL || uuid == GATT_UUID_PRIMARY_SVC ||
+            uuid == GATT_UUID_SECONDARY_SVC) {
+            return;
+        }
+        if (uuid == GATT_UUID_CCCD) {
+            op->cccd = (uint16_t)(data[off] | (data[off + 1U] << 8));
+            return;
+        }
+    }
+}
+
+void BLE_GattQueue_OnErrorResp(uint16_t conn_handle, uint16_t attr_handle, uint8_t error_code)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+
+    if (q == NULL || !q->running) {
+        return;
+    }
+
+    DEBUG_WARN("ATT error 0x%04X handle 0x%04X: 0x%02X", conn_handle, attr_handle, error_code);
+    q->att_error = error_code;
+}
+
+void BLE_GattQueue_OnProcComplete(uint16_t conn_handle, uint8_t error_code)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+    const BLE_GattDb_t *db;
+    uint8_t status;
+
+    if (q == NULL) {
+        return;
+    }
+
+    if (q->stale) {
+        /* End of the procedure of a timed-out operation: not the head's result */
+        DEBUG_WARN("GATT 0x%04X: late completion dropped: 0x%02X", conn_handle, error_code);
+        q->stale = 0;
+        if (q->stats.depth > 0U) {
+            q->ops[q->head].head_tick = HAL_GetTick();
+        }
+    } else if (q->running) {
+        if (q->ops[q->head].type == GATT_OP_DISC) {
+            /* Intermediate steps keep the link; only the end completes the op */
+            db = BLE_GattDisc_GetDb(conn_handle);
+            if (db != NULL && db->state == GATT_DISC_DONE) {
+                GattQueue_Complete(q, 0);
+            } else if (db == NULL || db->state == GATT_DISC_FAILED) {
+                GattQueue_Complete(q, (error_code != 0U) ? error_code : BLE_STATUS_FAILED);
+            } else {
+                return;
+            }
+        } else if (q->ops[q->head].type == GATT_OP_READ_MULTI) {
+            if (!BLE_GattReadM_IsDone(conn_handle, &status)) {
+                return;
+            }
+            GattQueue_Complete(q, status);
+        } else {
+            status = (q->att_error != 0U) ? q->att_error : error_code;
+            if (GattQueue_Continue(q, &status)) {
+                return;
+            }
+            GattQueue_Complete(q, status);
+        }
+    }
+
+    GattQueue_Kick(q);
+    GattQueue_TimerUpdate();
+}
+
+void BLE_GattQueue_OnProcTimeout(uint16_t conn_handle)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+
+    if (q == NULL) {
+        return;
+    }
+
+    /* ATT bearer is unusable after a transaction timeout: fail everything */
+    q->stale = 0;
+    while (q->stats.depth > 0U) {
+        GattQueue_Complete(q, GATT_QUEUE_ERR_TIMEOUT);
+    }
+    GattQueue_TimerUpdate();
+}
+
+void BLE_GattQueue_OnDisconnected(uint16_t conn_handle)
+{
+    GattQueue_Link_t *q = GattQueue_Find(conn_handle);
+    uint8_t count;
+    uint8_t i;
+
+    if (q == NULL) {
+        return;
+    }
+
+    if (q->stats.depth > 0U) {
+        DEBUG_WARN("GATT queue 0x%04X dropped %d ops", conn_handle, q->stats.depth);
+    }
+
+    /* Owners and the host get a result for every dropped operation; anything a
+       callback queues meanwhile is freed below */
+    q->stale = 0;
+    count = q->stats.depth;
+    for (i = 0; i < count; i++) {
+        GattQueue_Complete(q, GATT_QUEUE_ERR_DISCONNECTED);
+    }
+    for (i = 0; i < q->stats.depth; i++) {
+        GattQueue_FreeBuf(&q->ops[(q->head + i) % GATT_QUEUE_DEPTH]);
+    }
+    q->stats.conn_handle = 0xFFFF;
+    q->stats.depth = 0;
+    q->running = 0;
+    q->stale = 0;
+    GattQueue_TimerUpdate();
+}
+
+void BLE_GattQueue_Process(void)
+{
+    GattQueue_Link_t *q;
+    uint32_t now = HAL_GetTick();
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        q = &gatt_queue[i];
+        if (q->stats.conn_handle == 0xFFFF) {
+            continue;
+        }
+
+        /* Timed from the start: an operation waiting behind a long one keeps its time */
+        if (q->running && (now - q->ops[q->head].start_tick) >= q->ops[q->head].timeout_ms) {
+            GattQueue_Expire(q);
+        } else if (!q->running && !q->stale && q->stats.depth > 0U &&
+                   (now - q->ops[q->head].head_tick) >= q->ops[q->head].timeout_ms) {
+            /* Start refused for a whole timeout (ATT held outside the queue) */
+            DEBUG_WARN("GATT 0x%04X: %s never started", q->stats.conn_handle,
+                       op_names[q->ops[q->head].type]);
+            GattQueue_Complete(q, GATT_QUEUE_ERR_TIMEOUT);
+        }
+        GattQueue_Kick(q);
+    }
+    GattQueue_TimerUpdate();
+}
@@ -0,0 +1,645 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_readm.c
+  * @brief   Batched characteristic reads implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_readm.h"
+#include "ble_gatt_queue.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+/* Result buffers shared by all links; a batch waits in the queue if none is free */
+#define GATT_READM_BUFS             2U
+#define GATT_READM_BUF_SIZE         512U
+
+/* Learned value lengths per link (needed to split a Read Multiple response) */
+#define GATT_READM_LEN_CACHE        16U
+
+/* ATT Error: Request Not Supported */
+#define GATT_ATT_ERR_REQ_NOT_SUPP   0x06U
+
+/* Peer support of a procedure */
+#define GATT_CAP_UNKNOWN            0U
+#define GATT_CAP_YES                1U
+#define GATT_CAP_NO                 2U
+
+/* Engine state */
+#define GATT_READM_IDLE             0U
+#define GATT_READM_RUNNING          1U
+#define GATT_READM_DONE             2U
+
+typedef struct {
+    uint16_t conn_handle;
+    uint8_t state;
+    uint8_t status;                 /* Result once DONE */
+    uint8_t mode;                   /* BLE_GattReadMMode_t of the running step */
+    uint8_t flags;
+    uint8_t count;
+    uint8_t idx;                    /* Sequential: handle being read */
+    uint8_t att_error;
+    uint8_t mismatch;               /* Read Multiple length did not match learned lengths */
+    uint8_t trips;                  /* ATT round trips of this batch */
+    int8_t buf;
+    uint16_t used;                  /* Bytes stored in the result buffer */
+    uint16_t handles[GATT_READM_MAX_HANDLES];
+    uint16_t lens[GATT_READM_MAX_HANDLES];
+    uint32_t start_tick;
+    uint8_t var_cap;
+    uint8_t multi_cap;
+    uint8_t known_next;
+    uint16_t known_handle[GATT_READM_LEN_CACHE];
+    uint16_t known_len[GATT_READM_LEN_CACHE];
+} GattReadM_Link_t;
+
+typedef struct {
+    uint8_t active;
+    uint8_t batched;                /* 0 = sequential rounds, 1 = batched rounds */
+    uint8_t count;
+    uint8_t mode;                   /* Procedure of the last batched round */
+    uint16_t conn_handle;
+    uint16_t rounds;
+    uint16_t done;
+    uint16_t handles[GATT_READM_MAX_HANDLES];
+    uint32_t ms[2];
+    uint32_t trips[2];
+} GattReadM_Bench_t;
+
+static GattReadM_Link_t readm_links[MAX_BLE_CONNECTIONS];
+static uint8_t readm_bufs[GATT_READM_BUFS][GATT_READM_BUF_SIZE];
+static uint8_t readm_buf_used[GATT_READM_BUFS];
+static GattReadM_Bench_t readm_bench;
+
+static const char *const mode_names[] = { "VAR", "MULTI", "SEQ" };
+
+static GattReadM_Link_t* GattReadM_Find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (readm_links[i].conn_handle == conn_handle) {
+            return &readm_links[i];
+        }
+    }
+    return NULL;
+}
+
+static GattReadM_Link_t* GattReadM_Alloc(uint16_t conn_handle)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (l == NULL && BLE_Connection_GetInfo(conn_handle) != NULL) {
+        l = GattReadM_Find(0xFFFF);
+        if (l != NULL) {
+            memset(l, 0, sizeof(*l));
+            l->conn_handle = conn_handle;
+            l->buf = -1;
+        }
+    }
+    return l;
+}
+
+static void GattReadM_FreeBuf(GattReadM_Link_t *l)
+{
+    if (l->buf >= 0) {
+        readm_buf_used[l->buf] = 0;
+        l->buf = -1;
+    }
+}
+
+/**
+ * @brief Learned length of a value, 0xFFFF if unknown
+ */
+static uint16_t GattReadM_KnownLen(GattReadM_Link_t *l, uint16_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < GATT_READM_LEN_CACHE; i++) {
+        if (l->known_handle[i] == handle) {
+            return l->known_len[i];
+        }
+    }
+    return 0xFFFF;
+}
+
+static void GattReadM_Learn(GattReadM_Link_t *l, uint16_t handle, uint16_t len)
+{
+    uint8_t i;
+
+    for (i = 0; i < GATT_READM_LEN_CACHE; i++) {
+        if (l->known_handle[i] == handle) {
+            l->known_len[i] = len;
+            return;
+        }
+    }
+    l->known_handle[l->known_next] = handle;
+    l->known_len[l->known_next] = len;
+    l->known_next = (uint8_t)((l->known_next + 1U) % GATT_READM_LEN_CACHE);
+}
+
+static void GattReadM_Forget(GattReadM_Link_t *l)
+{
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < l->count; i++) {
+        for (j = 0; j < GATT_READM_LEN_CACHE; j++) {
+            if (l->known_handle[j] == l->handles[i]) {
+                l->known_handle[j] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Read Multiple is usable when every length is known and the answer fits one PDU
+ */
+static uint8_t GattReadM_MultiUsable(GattReadM_Link_t *l)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(l->conn_handle);
+    uint16_t total = 0;
+    uint16_t len;
+    uint8_t i;
+
+    if (l->multi_cap == GATT_CAP_NO || l->count < 2U || info == NULL) {
+        return 0;
+    }
+    for (i = 0; i < l->count; i++) {
+        len = GattReadM_KnownLen(l, l->handles[i]);
+        if (len == 0xFFFF) {
+            return 0;
+        }
+        total += len;
+    }
+    return (total + 1U <= info->att_mtu) ? 1U : 0U;
+}
+
+/**
+ * @brief Pick the cheapest procedure the peer is known or assumed to support
+ */
+static uint8_t GattReadM_PickMode(GattReadM_Link_t *l)
+{
+    if ((l->flags & GATT_READM_FLAG_SEQ) || l->count < 2U) {
+        return GATT_READM_SEQ;
+    }
+    if (l->var_cap != GATT_CAP_NO) {
+        return GATT_READM_VAR;
+    }
+    return GattReadM_MultiUsable(l) ? GATT_READM_MULTI : GATT_READM_SEQ;
+}
+
+/**
+ * @brief Issue the ATT procedure of the current step
+ */
+static tBleStatus GattReadM_Step(GattReadM_Link_t *l)
+{
+    Handle_Entry_t entries[GATT_READM_MAX_HANDLES];
+    tBleStatus ret;
+    uint8_t i;
+
+    for (i = 0; i < l->count; i++) {
+        entries[i].Handle = l->handles[i];
+    }
+
+    switch (l->mode) {
+    case GATT_READM_VAR:
+        ret = aci_gatt_read_multiple_var_char_value(l->conn_handle, l->count, entries);
+        break;
+    case GATT_READM_MULTI:
+        ret = aci_gatt_read_multiple_char_value(l->conn_handle, l->count, entries);
+        break;
+    default:
+        ret = aci_gatt_read_char_value(l->conn_handle, l->handles[l->idx]);
+        break;
+    }
+
+    if (ret == BLE_STATUS_SUCCESS) {
+        l->trips++;
+    }
+    return ret;
+}
+
+/**
+ * @brief Restart the batch with another procedure
+ */
+static tBleStatus GattReadM_Fallback(GattReadM_Link_t *l)
+{
+    l->mode = GattReadM_PickMode(l);
+    l->idx = 0;
+    l->used = 0;
+    l->mismatch = 0;
+    return GattReadM_Step(l);
+}
+
+/**
+ * @brief Store one value of the batch
+ */
+static void GattReadM_Store(GattReadM_Link_t *l, uint8_t i, const uint8_t *data, uint16_t len)
+{
+    if (l->used + len > GATT_READM_BUF_SIZE) {
+        DEBUG_WARN("READM 0x%04X: result truncated", l->conn_handle);
+        len = (uint16_t)(GATT_READM_BUF_SIZE - l->used);
+    }
+    memcpy(&readm_bufs[l->buf][l->used], data, len);
+    l->lens[i] = len;
+    l->used += len;
+}
+
+static void GattReadM_BenchNext(GattReadM_Link_t *l, uint8_t status);
+
+/**
+ * @brief Finish the batch: report values, release buffer
+ */
+static void GattReadM_Finish(GattReadM_Link_t *l, uint8_t status)
+{
+    const uint8_t *p;
+    uint8_t i;
+    uint16_t j;
+
+    l->state = GATT_READM_DONE;
+    l->status = status;
+
+    if (status == 0U && !(l->flags & GATT_READM_FLAG_QUIET)) {
+        /* One line: +READM:<conn>,<handle>:<hex>,... */
+        AT_Response_Send("+READM:0x%04X", l->conn_handle);
+        p = readm_bufs[l->buf];
+        for (i = 0; i < l->count; i++) {
+            AT_Response_Send(",0x%04X:", l->handles[i]);
+            for (j = 0; j < l->lens[i]; j++) {
+                AT_Response_Send("%02X", p[j]);
+            }
+            p += l->lens[i];
+        }
+        AT_Response_Send("\r\n");
+    }
+
+    GattReadM_FreeBuf(l);
+
+    if (l->flags & GATT_READM_FLAG_BENCH) {
+        GattReadM_BenchNext(l, status);
+    }
+}
+
+/**
+ * @brief Queue the next benchmark round or report the result
+ */
+static void GattReadM_BenchNext(GattReadM_Link_t *l, uint8_t status)
+{
+    GattReadM_Bench_t *b = &readm_bench;
+    uint8_t flags = GATT_READM_FLAG_QUIET | GATT_READM_FLAG_BENCH;
+
+    if (!b->active || b->conn_handle != l->conn_handle) {
+        return;
+    }
+    if (status != 0U) {
+        AT_Response_Send("+READMBENCH_ERROR:0x%04X,0x%02X\r\n", b->conn_handle, status);
+        b->active = 0;
+        return;
+    }
+
+    b->ms[b->batched] += HAL_GetTick() - l->start_tick;
+    b->trips[b->batched] += l->trips;
+    if (b->batched) {
+        b->mode = l->mode;
+    }
+
+    b->done++;
+    if (b->done >= b->rounds) {
+        if (b->batched) {
+            AT_Response_Send("+READMBENCH:0x%04X,%d,%d,%lu,%lu,%lu,%lu,%s\r\n",
+                             b->conn_handle, b->rounds, b->count,
+                             (unsigned long)(b->ms[0] / b->rounds),
+                             (unsigned long)(b->trips[0] / b->rounds),
+                             (unsigned long)(b->ms[1] / b->rounds),
+                             (unsigned long)(b->trips[1] / b->rounds),
+                             mode_names[b->mode]);
+            b->active = 0;
+            return;
+        }
+        b->batched = 1;
+        b->done = 0;
+    }
+
+    if (!b->batched) {
+        flags |= GATT_READM_FLAG_SEQ;
+    }
+    if (BLE_GattQueue_ReadMulti(b->conn_handle, b->handles, b->count, flags) != 0) {
+        AT_Response_Send("+READMBENCH_ERROR:0x%04X,BUSY\r\n", b->conn_handle);
+        b->active = 0;
+    }
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void GattReadM_EvtReadResp(void *evt)
+{
+    aci_att_read_resp_event_rp0 *pr = evt;
+
+    BLE_GattReadM_OnReadResp(pr->Connection_Handle, pr->Attribute_Value, pr->Event_Data_Length);
+}
+
+static void GattReadM_EvtReadMultiResp(void *evt)
+{
+    aci_att_read_multiple_resp_event_rp0 *pr = evt;
+
+    BLE_GattReadM_OnReadMultiResp(pr->Connection_Handle, pr->Set_Of_Values, pr->Event_Data_Length);
+}
+
+static void GattReadM_EvtErrorResp(void *evt)
+{
+    aci_gatt_error_resp_event_rp0 *pr = evt;
+
+    BLE_GattReadM_OnErrorResp(pr->Connection_Handle, pr->Error_Code);
+}
+
+void BLE_GattReadM_Init(void)
+{
+    uint8_t i;
+
+    memset(readm_links, 0, sizeof(readm_links));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        readm_links[i].conn_handle = 0xFFFF;
+        readm_links[i].buf = -1;
+    }
+    memset(readm_buf_used, 0, sizeof(readm_buf_used));
+    memset(&readm_bench, 0, sizeof(readm_bench));
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_RESP_VSEVT_CODE, GattReadM_EvtReadResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_ATT_READ_MULTIPLE_RESP_VSEVT_CODE, GattReadM_EvtReadMultiResp);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_ERROR_RESP_VSEVT_CODE, GattReadM_EvtErrorResp);
+    /* ACI_GATT_PROC_COMPLETE comes from the GATT queue, which orders the engines */
+}
+
+uint8_t BLE_GattReadM_Start(uint16_t conn_handle, uint8_t flags, const uint8_t *handles,
+                            uint8_t count)
+{
+    GattReadM_Link_t *l = GattReadM_Alloc(conn_handle);
+    tBleStatus ret;
+    uint8_t i;
+
+    if (l == NULL || count == 0U || count > GATT_READM_MAX_HANDLES) {
+        return BLE_STATUS_INVALID_PARAMS;
+    }
+    if (l->state == GATT_READM_RUNNING) {
+        return BLE_STATUS_BUSY;
+    }
+
+    for (i = 0; i < GATT_READM_BUFS; i++) {
+        if (!readm_buf_used[i]) {
+            break;
+        }
+    }
+    if (i >= GATT_READM_BUFS) {
+        return BLE_STATUS_BUSY;
+    }
+
+    l->buf = (int8_t)i;
+    l->flags = flags;
+    l->count = count;
+    for (i = 0; i < count; i++) {
+        l->handles[i] = (uint16_t)(handles[2U * i] | (handles[2U * i + 1U] << 8));
+        l->lens[i] = 0;
+    }
+    l->att_error = 0;
+    l->trips = 0;
+    l->start_tick = HAL_GetTick();
+
+    ret = GattReadM_Fallback(l);
+    if (ret == HCI_UNKNOWN_HCI_COMMAND_ERR_CODE && l->mode == GATT_READM_VAR) {
+        /* Stack without Read Multiple Variable Length */
+        l->var_cap = GATT_CAP_NO;
+        ret = GattReadM_Fallback(l);
+    }
+    if (ret != BLE_STATUS_SUCCESS) {
+        l->buf = -1;
+        return ret;
+    }
+
+    readm_buf_used[l->buf] = 1;
+    l->state = GATT_READM_RUNNING;
+    return BLE_STATUS_SUCCESS;
+}
+
+uint8_t BLE_GattReadM_IsDone(uint16_t conn_handle, uint8_t *status)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (l == NULL || l->state == GATT_READM_IDLE) {
+        *status = BLE_STATUS_FAILED;
+        return 1;
+    }
+    if (l->state == GATT_READM_RUNNING) {
+        return 0;
+    }
+    *status = l->status;
+    l->state = GATT_READM_IDLE;
+    return 1;
+}
+
+void BLE_GattReadM_Abort(uint16_t conn_handle)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (l == NULL) {
+        return;
+    }
+    if (l->state == GATT_READM_RUNNING && (l->flags & GATT_READM_FLAG_BENCH)) {
+        readm_bench.active = 0;
+    }
+    GattReadM_FreeBuf(l);
+    l->state = GATT_READM_IDLE;
+}
+
+int BLE_GattReadM_Bench(uint16_t conn_handle, const uint16_t *handles, uint8_t count,
+                        uint16_t rounds)
+{
+    GattReadM_Bench_t *b = &readm_bench;
+
+    if (b->active || handles == NULL || count == 0U || count > GATT_READM_MAX_HANDLES ||
+        rounds == 0U) {
+        return -1;
+    }
+
+    memset(b, 0, sizeof(*b));
+    b->conn_handle = conn_handle;
+    b->count = count;
+    b->rounds = rounds;
+    memcpy(b->handles, handles, count * sizeof(uint16_t));
+
+    /* Sequential rounds first: they also teach the value lengths Read Multiple needs */
+    if (BLE_GattQueue_ReadMulti(conn_handle, handles, count,
+                                GATT_READM_FLAG_SEQ | GATT_READM_FLAG_QUIET |
+                                GATT_READM_FLAG_BENCH) != 0) {
+        return -1;
+    }
+    b->active = 1;
+    return 0;
+}
+
+void BLE_GattReadM_OnReadResp(uint16_t conn_handle, const uint8_t *data, uint16_t len)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (l == NULL || l->state != GATT_READM_RUNNING || l->mode != GATT_READM_SEQ) {
+        return;
+    }
+
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+    GattReadM_Store(l, l->idx, data, len);
+    GattReadM_Learn(l, l->handles[l->idx], len);
+}
+
+void BLE_GattReadM_OnReadMultiResp(uint16_t conn_handle, const uint8_t *data, uint16_t len)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+    uint16_t pos = 0;
+    uint16_t vlen;
+    uint16_t expected = 0;
+    uint8_t i;
+
+    if (l == NULL || l->state != GATT_READM_RUNNING || l->mode == GATT_READM_SEQ) {
+        return;
+    }
+
+    BLE_Connection_CountTraffic(conn_handle, 0, len);
+
+    if (l->mode == GATT_READM_VAR) {
+        /* Length Value Tuples; the last may be cut at ATT_MTU - 1 */
+        for (i = 0; i < l->count; i++) {
+            if (pos + 2U > len) {
+                l->lens[i] = 0;
+                continue;
+            }
+            vlen = (uint16_t)(data[pos] | (data[pos + 1U] << 8));
+            pos += 2U;
+            GattReadM_Learn(l, l->handles[i], vlen);
+            if (vlen > len - pos) {
+                vlen = (uint16_t)(len - pos);
+            }
+            GattReadM_Store(l, i, &data[pos], vlen);
+            pos += vlen;
+        }
+        return;
+    }
+
+    /* Plain Read Multiple: concatenated values, split by learned lengths */
+    for (i = 0; i < l->count; i++) {
+        expected += GattReadM_KnownLen(l, l->handles[i]);
+    }
+    if (expected != len) {
+        l->mismatch = 1;
+        return;
+    }
+    for (i = 0; i < l->count; i++) {
+        vlen = GattReadM_KnownLen(l, l->handles[i]);
+        GattReadM_Store(l, i, &data[pos], vlen);
+        pos += vlen;
+    }
+}
+
+void BLE_GattReadM_OnErrorResp(uint16_t conn_handle, uint8_t error_code)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (l != NULL && l->state == GATT_READM_RUNNING) {
+        l->att_error = error_code;
+    }
+}
+
+void BLE_GattReadM_OnProcComplete(uint16_t conn_handle, uint8_t error_code)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+    uint8_t err;
+    tBleStatus ret;
+
+    if (l == NULL || l->state != GATT_READM_RUNNING) {
+        return;
+    }
+
+    err = (l->att_error != 0U) ? l->att_error : error_code;
+    l->att_error = 0;
+
+    switch (l->mode) {
+    case GATT_READM_VAR:
+        if (err == GATT_ATT_ERR_REQ_NOT_SUPP) {
+            l->var_cap = GATT_CAP_NO;
+            ret = GattReadM_Fallback(l);
+            if (ret != BLE_STATUS_SUCCESS) {
+                GattReadM_Finish(l, ret);
+            }
+            return;
+        }
+        if (err == 0U) {
+            l->var_cap = GATT_CAP_YES;
+        }
+        GattReadM_Finish(l, err);
+        return;
+
+    case GATT_READM_MULTI:
+        if (err == GATT_ATT_ERR_REQ_NOT_SUPP || (err == 0U && l->mismatch)) {
+            /* Not supported, or lengths changed: read one by one and relearn */
+            if (err != 0U) {
+                l->multi_cap = GATT_CAP_NO;
+            } else {
+                GattReadM_Forget(l);
+            }
+            ret = GattReadM_Fallback(l);
+            if (ret != BLE_STATUS_SUCCESS) {
+                GattReadM_Finish(l, ret);
+            }
+            return;
+        }
+        if (err == 0U) {
+            l->multi_cap = GATT_CAP_YES;
+        }
+        GattReadM_Finish(l, err);
+        return;
+
+    default:
+        if (err != 0U) {
+            GattReadM_Finish(l, err);
+            return;
+        }
+        l->idx++;
+        if (l->idx >= l->count) {
+            GattReadM_Finish(l, 0);
+            return;
+        }
+        ret = GattReadM_Step(l);
+        if (ret != BLE_STATUS_SUCCESS) {
+            GattReadM_Finish(l, ret);
+        }
+        return;
+    }
+}
+
+void BLE_GattReadM_OnDisconnected(uint16_t conn_handle)
+{
+    GattReadM_Link_t *l = GattReadM_Find(conn_handle);
+
+    if (readm_bench.active && readm_bench.conn_handle == conn_handle) {
+        readm_bench.active = 0;
+    }
+    if (l == NULL) {
+        return;
+    }
+    GattReadM_FreeBuf(l);
+    l->conn_handle = 0xFFFF;
+    l->state = GATT_READM_IDLE;
+}
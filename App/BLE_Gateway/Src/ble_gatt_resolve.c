@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_resolve.c
+  * @brief   UUID to attribute handle resolution implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_resolve.h"
+#include "ble_gatt_discovery.h"
+#include "debug_trace.h"
+#include <string.h>
+
+typedef struct {
+    uint16_t conn_handle;           /* 0xFFFF: free */
+    uint16_t value_handle;
+    uint16_t cccd_handle;           /* 0 if not looked up yet */
+    uint32_t last_use;
+    BLE_GattUuidKey_t key;
+} GattResolve_Entry_t;
+
+static GattResolve_Entry_t resolve_cache[GATT_RESOLVE_CACHE_SIZE];
+static BLE_GattResolveStats_t resolve_stats;
+static uint32_t use_counter = 0;
+
+static uint8_t GattResolve_KeyEqual(const BLE_GattUuidKey_t *a, const BLE_GattUuidKey_t *b)
+{
+    return (a->len == b->len && memcmp(a->uuid, b->uuid, a->len) == 0) ? 1U : 0U;
+}
+
+static GattResolve_Entry_t* GattResolve_Find(uint16_t conn_handle, const BLE_GattUuidKey_t *key)
+{
+    uint8_t i;
+
+    for (i = 0; i < GATT_RESOLVE_CACHE_SIZE; i++) {
+        if (resolve_cache[i].conn_handle == conn_handle &&
+            GattResolve_KeyEqual(&resolve_cache[i].key, key)) {
+            return &resolve_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Search the discovered attribute table; first match in handle order wins
+ */
+static const BLE_GattChar_t* GattResolve_FindInDb(uint16_t conn_handle,
+                                                  const BLE_GattUuidKey_t *key)
+{
+    const BLE_GattDb_t *db = BLE_GattDisc_GetDb(conn_handle);
+    const BLE_GattChar_t *ch;
+    uint8_t i;
+
+    if (db == NULL || db->state != GATT_DISC_DONE) {
+        return NULL;
+    }
+
+    for (i = 0; i < db->char_count; i++) {
+        ch = &db->chars[i];
+        if (key->len == 2U) {
+            if (!ch->uuid.is_uuid128 &&
+                ch->uuid.value == (uint16_t)(key->uuid[0] | (key->uuid[1] << 8))) {
+                return ch;
+            }
+        } else if (ch->uuid.is_uuid128 && ch->uuid.value < db->uuid128_count &&
+                   memcmp(db->uuid128[ch->uuid.value], key->uuid, GATT_UUID128_LEN) == 0) {
+            return ch;
+        }
+    }
+    return NULL;
+}
+
+void BLE_GattResolve_Init(void)
+{
+    uint8_t i;
+
+    memset(resolve_cache, 0, sizeof(resolve_cache));
+    for (i = 0; i < GATT_RESOLVE_CACHE_SIZE; i++) {
+        resolve_cache[i].conn_handle = 0xFFFF;
+    }
+    memset(&resolve_stats, 0, sizeof(resolve_stats));
+    use_counter = 0;
+}
+
+int BLE_GattResolve_Lookup(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                           uint16_t *value_handle, uint16_t *cccd_handle)
+{
+    GattResolve_Entry_t *e;
+    const BLE_GattChar_t *ch;
+
+    if (key == NULL || (key->len != 2U && key->len != 16U)) {
+        return -1;
+    }
+
+    e = GattResolve_Find(conn_handle, key);
+    if (e != NULL) {
+        e->last_use = ++use_counter;
+        *value_handle = e->value_handle;
+        *cccd_handle = e->cccd_handle;
+        resolve_stats.cache_hits++;
+        return 0;
+    }
+
+    ch = GattResolve_FindInDb(conn_handle, key);
+    if (ch != NULL) {
+        *value_handle = ch->value_handle;
+        *cccd_handle = ch->cccd_handle;
+        resolve_stats.db_hits++;
+        return 0;
+    }
+    return -1;
+}
+
+void BLE_GattResolve_Learn(uint16_t conn_handle, const BLE_GattUuidKey_t *key,
+                           uint16_t value_handle, uint16_t cccd_handle, uint8_t lookup)
+{
+    GattResolve_Entry_t *e;
+    uint8_t i;
+
+    if (key == NULL || value_handle == 0U) {
+        return;
+    }
+    if (lookup) {
+        resolve_stats.lookups++;
+    }
+
+    e = GattResolve_Find(conn_handle, key);
+    if (e == NULL) {
+        /* Free entry, else the least recently used one */
+        e = &resolve_cache[0];
+        for (i = 0; i < GATT_RESOLVE_CACHE_SIZE; i++) {
+            if (resolve_cache[i].conn_handle == 0xFFFF) {
+                e = &resolve_cache[i];
+                break;
+            }
+            if (resolve_cache[i].last_use < e->last_use) {
+                e = &resolve_cache[i];
+            }
+        }
+        if (e->conn_handle != 0xFFFF) {
+            resolve_stats.evictions++;
+        } else {
+            resolve_stats.entries++;
+        }
+        e->conn_handle = conn_handle;
+        e->key = *key;
+        e->cccd_handle = 0;
+    }
+
+    e->value_handle = value_handle;
+    if (cccd_handle != 0U) {
+        e->cccd_handle = cccd_handle;
+    }
+    e->last_use = ++use_counter;
+
+    DEBUG_INFO("Conn 0x%04X UUID resolved: value 0x%04X, CCCD 0x%04X",
+               conn_handle, value_handle, e->cccd_handle);
+}
+
+const BLE_GattResolveStats_t* BLE_GattResolve_GetStats(void)
+{
+    return &resolve_stats;
+}
+
+void BLE_GattResolve_OnDisconnected(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    /* Handles are only valid for the link that reported them */
+    for (i = 0; i < GATT_RESOLVE_CACHE_SIZE; i++) {
+        if (resolve_cache[i].conn_handle == conn_handle) {
+            resolve_cache[i].conn_handle = 0xFFFF;
+            resolve_stats.entries--;
+        }
+    }
+}
@@ -0,0 +1,376 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_stream.c
+  * @brief   Write Without Response streaming implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_stream.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gatt_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+/* Payload of a packet when the link MTU is unknown */
+#define GATT_STREAM_MIN_CHUNK       20U
+
+/* One Write Without Response payload, stored contiguously (mod ring size) */
+typedef struct {
+    uint16_t conn_handle;           /* 0xFFFF: link lost, drop */
+    uint16_t handle;
+    uint16_t offset;                /* Start in stream_buf */
+    uint16_t len;
+    uint16_t sent;
+    uint8_t ready;                  /* 0 while the reservation is being filled */
+} GattStream_Seg_t;
+
+typedef struct {
+    BLE_GattStreamStats_t stats;    /* stats.conn_handle keys the slot */
+    uint8_t active;                 /* Burst running */
+    uint32_t burst_start;
+    uint32_t burst_bytes;
+} GattStream_Link_t;
+
+static uint8_t stream_buf[GATT_STREAM_BUF_SIZE];
+static GattStream_Seg_t stream_segs[GATT_STREAM_MAX_SEGMENTS];
+static uint8_t seg_head = 0;
+static uint8_t seg_count = 0;
+static uint16_t buf_wr = 0;         /* Next free byte */
+static uint16_t buf_used = 0;       /* Queued bytes, open reservation included */
+static uint8_t reserve_open = 0;
+static uint8_t stream_paused = 0;   /* Stack TX pool full */
+
+/* Open reservation fill position (written from the UART ISR) */
+static volatile uint16_t fill_idx = 0;
+static volatile uint16_t fill_left = 0;
+
+static GattStream_Link_t stream_links[MAX_BLE_CONNECTIONS];
+
+static GattStream_Link_t* GattStream_Find(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (stream_links[i].stats.conn_handle == conn_handle) {
+            return &stream_links[i];
+        }
+    }
+    return NULL;
+}
+
+static GattStream_Link_t* GattStream_Alloc(uint16_t conn_handle)
+{
+    GattStream_Link_t *l = GattStream_Find(conn_handle);
+
+    if (l == NULL && BLE_Connection_GetInfo(conn_handle) != NULL) {
+        l = GattStream_Find(0xFFFF);
+        if (l != NULL) {
+            memset(l, 0, sizeof(*l));
+            l->stats.conn_handle = conn_handle;
+        }
+    }
+    return l;
+}
+
+/**
+ * @brief Check whether a link still has queued data
+ */
+static uint8_t GattStream_LinkPending(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < seg_count; i++) {
+        if (stream_segs[(seg_head + i) % GATT_STREAM_MAX_SEGMENTS].conn_handle == conn_handle) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Release the head segment and its bytes
+ */
+static void GattStream_Pop(void)
+{
+    buf_used -= stream_segs[seg_head].len;
+    seg_head = (uint8_t)((seg_head + 1U) % GATT_STREAM_MAX_SEGMENTS);
+    seg_count--;
+}
+
+/**
+ * @brief Report throughput when a link has drained its data
+ */
+static void GattStream_BurstEnd(GattStream_Link_t *l)
+{
+    uint32_t ms = HAL_GetTick() - l->burst_start;
+
+    if (!l->active) {
+        return;
+    }
+    if (ms == 0U) {
+        ms = 1U;
+    }
+    /* bits per millisecond == kbit/s */
+    l->stats.last_kbps = (l->burst_bytes * 8U) / ms;
+    l->active = 0;
+
+    AT_Response_Send("+STREAM_DONE:0x%04X,%lu,%lu,%lu\r\n", l->stats.conn_handle,
+                     (unsigned long)l->burst_bytes, (unsigned long)ms,
+                     (unsigned long)l->stats.last_kbps);
+}
+
+/**
+ * @brief Stack buffers freed: resume Write Without Response streaming
+ */
+static void GattStream_EvtTxPoolAvailable(void *evt)
+{
+    (void)evt;
+    BLE_GattStream_OnTxPoolAvailable();
+}
+
+void BLE_GattStream_Init(void)
+{
+    uint8_t i;
+
+    memset(stream_links, 0, sizeof(stream_links));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        stream_links[i].stats.conn_handle = 0xFFFF;
+    }
+    seg_head = 0;
+    seg_count = 0;
+    buf_wr = 0;
+    buf_used = 0;
+    reserve_open = 0;
+    stream_paused = 0;
+    fill_left = 0;
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_GATT_TX_POOL_AVAILABLE_VSEVT_CODE, GattStream_EvtTxPoolAvailable);
+}
+
+int BLE_GattStream_Reserve(uint16_t conn_handle, uint16_t handle, uint16_t len)
+{
+    GattStream_Seg_t *seg;
+
+    if (reserve_open || len == 0U || handle == 0U ||
+        seg_count >= GATT_STREAM_MAX_SEGMENTS || len > BLE_GattStream_GetFree()) {
+        return -1;
+    }
+    if (GattStream_Alloc(conn_handle) == NULL) {
+        return -1;
+    }
+
+    seg = &stream_segs[(seg_head + seg_count) % GATT_STREAM_MAX_SEGMENTS];
+    seg->conn_handle = conn_handle;
+    seg->handle = handle;
+    seg->offset = buf_wr;
+    seg->len = len;
+    seg->sent = 0;
+    seg->ready = 0;
+    seg_count++;
+
+    buf_wr = (uint16_t)((buf_wr + len) % GATT_STREAM_BUF_SIZE);
+    buf_used += len;
+    fill_idx = seg->offset;
+    fill_left = len;
+    reserve_open = 1;
+    return 0;
+}
+
+void BLE_GattStream_PutByte(uint8_t byte)
+{
+    if (fill_left == 0U) {
+        return;
+    }
+    stream_buf[fill_idx] = byte;
+    fill_idx = (uint16_t)((fill_idx + 1U) % GATT_STREAM_BUF_SIZE);
+    fill_left--;
+}
+
+void BLE_GattStream_Commit(void)
+{
+    if (!reserve_open) {
+        return;
+    }
+    stream_segs[(seg_head + seg_count - 1U) % GATT_STREAM_MAX_SEGMENTS].ready = 1;
+    reserve_open = 0;
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_STREAM_ID, CFG_SCH_PRIO_HOST);
+}
+
+void BLE_GattStream_Cancel(void)
+{
+    GattStream_Seg_t *seg;
+
+    if (!reserve_open) {
+        return;
+    }
+    seg = &stream_segs[(seg_head + seg_count - 1U) % GATT_STREAM_MAX_SEGMENTS];
+    buf_wr = seg->offset;
+    buf_used -= seg->len;
+    seg_count--;
+    fill_left = 0;
+    reserve_open = 0;
+}
+
+int BLE_GattStream_Write(uint16_t conn_handle, uint16_t handle, const uint8_t *data, uint16_t len)
+{
+    uint16_t i;
+
+    if (data == NULL || BLE_GattStream_Reserve(conn_handle, handle, len) != 0) {
+        return -1;
+    }
+    for (i = 0; i < len; i++) {
+        BLE_GattStream_PutByte(data[i]);
+    }
+    BLE_GattStream_Commit();
+    return 0;
+}
+
+uint16_t BLE_GattStream_GetFree(void)
+{
+    return (uint16_t)(GATT_STREAM_BUF_SIZE - buf_used);
+}
+
+const BLE_GattStreamStats_t* BLE_GattStream_GetStats(uint16_t conn_handle)
+{
+    GattStream_Link_t *l = GattStream_Find(conn_handle);
+
+    return (l != NULL) ? &l->stats : NULL;
+}
+
+void BLE_GattStream_OnTxPoolAvailable(void)
+{
+    if (stream_paused) {
+        stream_paused = 0;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_STREAM_ID, CFG_SCH_PRIO_HOST);
+    }
+}
+
+void BLE_GattStream_OnDisconnected(uint16_t conn_handle)
+{
+    GattStream_Link_t *l = GattStream_Find(conn_handle);
+    uint8_t dropped = 0;
+    uint8_t i;
+
+    /* Segments stay in place to keep the ring contiguous; the pump skips them */
+    for (i = 0; i < seg_count; i++) {
+        GattStream_Seg_t *seg = &stream_segs[(seg_head + i) % GATT_STREAM_MAX_SEGMENTS];
+        if (seg->conn_handle == conn_handle) {
+            seg->conn_handle = 0xFFFF;
+            dropped++;
+        }
+    }
+    if (dropped > 0U) {
+        DEBUG_WARN("Stream 0x%04X dropped %d segments", conn_handle, dropped);
+    }
+
+    if (l != NULL) {
+        l->stats.conn_handle = 0xFFFF;
+        l->active = 0;
+    }
+
+    /* Buffers of the link are released by the stack */
+    stream_paused = 0;
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_STREAM_ID, CFG_SCH_PRIO_HOST);
+}
+
+void BLE_GattStream_Process(void)
+{
+    static uint8_t pkt[CFG_BLE_MAX_ATT_MTU];
+    GattStream_Seg_t *seg;
+    GattStream_Link_t *l;
+    BLE_ConnectionInfo_t *info;
+    uint16_t chunk;
+    uint16_t pos;
+    uint16_t i;
+    uint8_t pkts = 0;
+    tBleStatus ret;
+
+    while (!stream_paused && seg_count > 0U && pkts < GATT_STREAM_BURST_PKTS) {
+        seg = &stream_segs[seg_head];
+        if (!seg->ready) {
+            break;
+        }
+        if (seg->conn_handle == 0xFFFF) {
+            GattStream_Pop();
+            continue;
+        }
+        l = GattStream_Find(seg->conn_handle);
+        info = BLE_Connection_GetInfo(seg->conn_handle);
+
+        chunk = GATT_STREAM_MIN_CHUNK;
+        if (info != NULL && info->att_mtu > 3U) {
+            chunk = (uint16_t)(info->att_mtu - 3U);
+        }
+        if (chunk > sizeof(pkt)) {
+            chunk = sizeof(pkt);
+        }
+        if (chunk > seg->len - seg->sent) {
+            chunk = (uint16_t)(seg->len - seg->sent);
+        }
+
+        /* Linearize across the ring wrap */
+        pos = (uint16_t)((seg->offset + seg->sent) % GATT_STREAM_BUF_SIZE);
+        for (i = 0; i < chunk; i++) {
+            pkt[i] = stream_buf[pos];
+            pos = (uint16_t)((pos + 1U) % GATT_STREAM_BUF_SIZE);
+        }
+
+        ret = aci_gatt_write_without_resp(seg->conn_handle, seg->handle, (uint8_t)chunk, pkt);
+        if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+            /* Resumed by ACI_GATT_TX_POOL_AVAILABLE */
+            stream_paused = 1;
+            if (l != NULL) {
+                l->stats.stalls++;
+            }
+            return;
+        }
+
+        if (l != NULL && !l->active) {
+            l->active = 1;
+            l->burst_start = HAL_GetTick();
+            l->burst_bytes = 0;
+        }
+
+        if (ret != BLE_STATUS_SUCCESS) {
+            DEBUG_WARN("WriteNR 0x%04X handle 0x%04X failed: 0x%02X",
+                       seg->conn_handle, seg->handle, ret);
+            AT_Response_Send("+WRITENR_ERROR:0x%04X,0x%02X\r\n", seg->conn_handle, ret);
+            if (l != NULL) {
+                l->stats.errors++;
+            }
+            seg->sent = seg->len;
+        } else {
+            BLE_Connection_CountTraffic(seg->conn_handle, 1, chunk);
+            seg->sent += chunk;
+            if (l != NULL) {
+                l->stats.bytes += chunk;
+                l->stats.packets++;
+                l->burst_bytes += chunk;
+            }
+            pkts++;
+        }
+
+        if (seg->sent >= seg->len) {
+            uint16_t conn_handle = seg->conn_handle;
+            GattStream_Pop();
+            if (l != NULL && !GattStream_LinkPending(conn_handle)) {
+                GattStream_BurstEnd(l);
+            }
+        }
+    }
+
+    /* Yield to other tasks between bursts */
+    if (!stream_paused && seg_count > 0U && stream_segs[seg_head].ready) {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_STREAM_ID, CFG_SCH_PRIO_HOST);
+    }
+}
@@ -0,0 +1,585 @@
+/**
+  ******************************************************************************
+  * @file    ble_gatt_subscribe.c
+  * @brief   Subscription manager implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_gatt_subscribe.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_queue.h"
+#include "ble_connection.h"
+#include "ble_event_bus.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_gap_aci.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+/* Hardware timer ticks from milliseconds */
+#define GATT_SUB_MS_TO_TICKS(ms)    ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* Resolution of rate limits and windows */
+#define GATT_SUB_TICK_MS            10U
+
+/* Restore progress of one link */
+typedef struct {
+    uint16_t conn_handle;
+    uint8_t done;                   /* +SUBSCRIBED sent for this connection */
+    uint8_t pending;                /* CCCD writes queued */
+    uint8_t restored;
+    uint8_t failed;                 /* Write failed, or handle no longer in the table */
+    uint8_t skipped;                /* Bonded peer keeps its CCCDs */
+} GattSub_Restore_t;
+
+/* Policy state of one subscription, valid while its device is connected */
+typedef struct {
+    uint16_t conn_handle;           /* 0xFFFF: idle */
+    uint16_t counter;               /* DECIMATE: notifications since the last forward */
+    uint8_t started;                /* RATE: tick valid, DELTA: last valid */
+    uint8_t held_len;               /* RATE: latest value kept back, 0 = none */
+    uint32_t tick;                  /* RATE: last forward, WINDOW: window start */
+    int32_t last;                   /* DELTA: last forwarded value */
+    int32_t min;                    /* WINDOW */
+    int32_t max;
+    int64_t sum;
+    uint32_t count;
+    uint8_t held[GATT_SUB_HOLD_LEN];
+} GattSub_Filter_t;
+
+static BLE_GattSub_t sub_table[GATT_SUB_MAX_ENTRIES];
+static GattSub_Filter_t sub_filter[GATT_SUB_MAX_ENTRIES];
+static GattSub_Restore_t sub_restore[MAX_BLE_CONNECTIONS];
+static uint8_t restore_enabled = 1;
+static uint8_t sub_timer_id;
+static uint8_t sub_timer_on = 0;
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void GattSub_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_GATT_SUB_ID, CFG_SCH_PRIO_NOTIFY);
+}
+
+/**
+ * @brief Run the timer only while a value is held back or a window is open
+ */
+static void GattSub_TimerUpdate(void)
+{
+    uint8_t i;
+    uint8_t busy = 0;
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        if (sub_filter[i].held_len > 0U || sub_filter[i].count > 0U) {
+            busy = 1;
+            break;
+        }
+    }
+
+    if (busy && !sub_timer_on) {
+        HW_TS_Start(sub_timer_id, GATT_SUB_MS_TO_TICKS(GATT_SUB_TICK_MS));
+        sub_timer_on = 1;
+    } else if (!busy && sub_timer_on) {
+        HW_TS_Stop(sub_timer_id);
+        sub_timer_on = 0;
+    }
+}
+
+static void GattSub_ResetFilter(uint8_t slot)
+{
+    memset(&sub_filter[slot], 0, sizeof(sub_filter[slot]));
+    sub_filter[slot].conn_handle = 0xFFFF;
+}
+
+/**
+ * @brief Read the policy field of a notification
+ * @return 0 on success, -1 if the value is too short
+ */
+static int GattSub_Decode(const BLE_GattSub_t *e, const uint8_t *data, uint16_t len,
+                          int32_t *out)
+{
+    static const uint8_t fmt_size[GATT_SUB_FMT_COUNT] = { 1, 1, 2, 2, 4 };
+    const uint8_t *p = data + e->offset;
+
+    if ((uint16_t)e->offset + fmt_size[e->fmt] > len) {
+        return -1;
+    }
+
+    switch (e->fmt) {
+    case GATT_SUB_FMT_U8:
+        *out = p[0];
+        break;
+    case GATT_SUB_FMT_S8:
+        *out = (int8_t)p[0];
+        break;
+    case GATT_SUB_FMT_U16:
+        *out = (int32_t)(p[0] | (p[1] << 8));
+        break;
+    case GATT_SUB_FMT_S16:
+        *out = (int16_t)(p[0] | (p[1] << 8));
+        break;
+    default:
+        *out = (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        break;
+    }
+    return 0;
+}
+
+static void GattSub_CloseWindow(BLE_GattSub_t *e, GattSub_Filter_t *f)
+{
+    e->forwarded++;
+    AT_Response_Send("+NOTIFYWIN:0x%04X,0x%04X,%ld,%ld,%ld,%lu\r\n", f->conn_handle,
+                     e->value_handle, (long)f->min, (long)f->max,
+                     (long)(f->sum / (int64_t)f->count), (unsigned long)f->count);
+    f->count = 0;
+}
+
+static GattSub_Restore_t* GattSub_FindRestore(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (sub_restore[i].conn_handle == conn_handle) {
+            return &sub_restore[i];
+        }
+    }
+    return NULL;
+}
+
+static BLE_GattSub_t* GattSub_FindEntry(const uint8_t *mac, uint16_t cccd_handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        if (sub_table[i].cccd_value != 0U && sub_table[i].cccd_handle == cccd_handle &&
+            memcmp(sub_table[i].mac_addr, mac, BLE_MAC_LEN) == 0) {
+            return &sub_table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief A bonded peer restores its CCCDs itself once the link is encrypted
+ *        (Core spec Vol 3, Part G, 3.3.3.3)
+ */
+static uint8_t GattSub_PeerRemembers(const BLE_ConnectionInfo_t *info)
+{
+    BLE_Device_t *dev;
+    uint8_t id_type;
+    uint8_t id_addr[BLE_MAC_LEN];
+    int idx;
+
+    if (!info->encrypted) {
+        return 0;
+    }
+    idx = BLE_DeviceManager_FindDevice(info->mac_addr);
+    dev = (idx >= 0) ? BLE_DeviceManager_GetDevice(idx) : NULL;
+    if (dev == NULL) {
+        return 0;
+    }
+    return (aci_gap_check_bonded_device(dev->addr_type, info->mac_addr, &id_type, id_addr) ==
+            BLE_STATUS_SUCCESS) ? 1U : 0U;
+}
+
+/**
+ * @brief Check a stored subscription against a freshly discovered table
+ */
+static uint8_t GattSub_InDb(const BLE_GattDb_t *db, const BLE_GattSub_t *e)
+{
+    uint8_t i;
+
+    for (i = 0; i < db->char_count; i++) {
+        if (db->chars[i].cccd_handle == e->cccd_handle &&
+            db->chars[i].value_handle == e->value_handle) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void GattSub_Report(GattSub_Restore_t *r)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(r->conn_handle);
+    uint32_t ms = info ? (HAL_GetTick() - info->connect_tick) : 0U;
+
+    r->done = 1;
+    DEBUG_INFO("Conn 0x%04X subscriptions: %d restored, %d failed, %d kept by peer",
+               r->conn_handle, r->restored, r->failed, r->skipped);
+    AT_Response_Send("+SUBSCRIBED:0x%04X,%d,%d,%d,%lu\r\n", r->conn_handle, r->restored,
+                     r->failed, r->skipped, (unsigned long)ms);
+}
+
+void BLE_GattSub_Init(void)
+{
+    uint8_t i;
+
+    memset(sub_table, 0, sizeof(sub_table));
+    memset(sub_restore, 0, sizeof(sub_restore));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        sub_restore[i].conn_handle = 0xFFFF;
+    }
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        GattSub_ResetFilter(i);
+    }
+    restore_enabled = 1;
+
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &sub_timer_id, hw_ts_Repeated, GattSub_TimerCb);
+    sub_timer_on = 0;
+}
+
+void BLE_GattSub_EnableRestore(uint8_t enable)
+{
+    restore_enabled = enable ? 1U : 0U;
+    DEBUG_INFO("Subscription restore %s", restore_enabled ? "enabled" : "disabled");
+}
+
+uint8_t BLE_GattSub_IsRestoreEnabled(void)
+{
+    return restore_enabled;
+}
+
+void BLE_GattSub_Clear(void)
+{
+    uint8_t i;
+
+    memset(sub_table, 0, sizeof(sub_table));
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        GattSub_ResetFilter(i);
+    }
+    GattSub_TimerUpdate();
+}
+
+const BLE_GattSub_t* BLE_GattSub_Get(uint8_t slot)
+{
+    if (slot >= GATT_SUB_MAX_ENTRIES || sub_table[slot].cccd_value == 0U) {
+        return NULL;
+    }
+    return &sub_table[slot];
+}
+
+void BLE_GattSub_OnLinkReady(uint16_t conn_handle)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    const BLE_GattDb_t *db;
+    GattSub_Restore_t *r;
+    BLE_GattSub_t *e;
+    uint8_t value[2];
+    uint8_t bonded;
+    uint8_t i;
+
+    if (info == NULL || !restore_enabled || GattSub_FindRestore(conn_handle) != NULL) {
+        return;
+    }
+    r = GattSub_FindRestore(0xFFFF);
+    if (r == NULL) {
+        return;
+    }
+    memset(r, 0, sizeof(*r));
+    r->conn_handle = conn_handle;
+
+    bonded = GattSub_PeerRemembers(info);
+    db = BLE_GattDisc_GetDb(conn_handle);
+    if (db != NULL && db->state != GATT_DISC_DONE) {
+        db = NULL;
+    }
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        e = &sub_table[i];
+        if (e->cccd_value == 0U || memcmp(e->mac_addr, info->mac_addr, BLE_MAC_LEN) != 0) {
+            continue;
+        }
+        if (db != NULL && !GattSub_InDb(db, e)) {
+            /* Peer firmware changed its attribute layout */
+            DEBUG_WARN("Conn 0x%04X CCCD 0x%04X gone, subscription dropped",
+                       conn_handle, e->cccd_handle);
+            e->cccd_value = 0;
+            GattSub_ResetFilter(i);
+            r->failed++;
+            continue;
+        }
+        if (bonded) {
+            r->skipped++;
+            continue;
+        }
+        /* Queued back to back: they go out in consecutive connection events */
+        value[0] = e->cccd_value;
+        value[1] = 0;
+        if (BLE_GattQueue_WriteDesc(conn_handle, e->cccd_handle, value, 2) == 0) {
+            r->pending++;
+        } else {
+            r->failed++;
+        }
+    }
+
+    if (r->pending == 0U) {
+        if (r->failed == 0U && r->skipped == 0U) {
+            return;         /* Nothing known for this device: stay silent */
+        }
+        GattSub_Report(r);
+    }
+}
+
+void BLE_GattSub_OnCccdWritten(uint16_t conn_handle, uint16_t cccd_handle,
+                               uint16_t value_handle, uint16_t value, uint8_t status)
+{
+    BLE_ConnectionInfo_t *info = BLE_Connection_GetInfo(conn_handle);
+    GattSub_Restore_t *r = GattSub_FindRestore(conn_handle);
+    const BLE_GattDb_t *db;
+    BLE_GattSub_t *e;
+    uint8_t i;
+
+    if (info == NULL) {
+        return;
+    }
+    e = GattSub_FindEntry(info->mac_addr, cccd_handle);
+
+    if (r != NULL && !r->done && r->pending > 0U && e != NULL && e->cccd_value == value) {
+        r->pending--;
+        if (status == 0U) {
+            r->restored++;
+        } else {
+            r->failed++;
+        }
+        if (r->pending == 0U) {
+            GattSub_Report(r);
+        }
+        return;
+    }
+    if (status != 0U) {
+        return;
+    }
+
+    /* Host write: remember the new state (an existing policy stays) */
+    if (value == 0U) {
+        if (e != NULL) {
+            e->cccd_value = 0;
+            GattSub_ResetFilter((uint8_t)(e - sub_table));
+            GattSub_TimerUpdate();
+        }
+        return;
+    }
+    if (e == NULL) {
+        for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+            if (sub_table[i].cccd_value == 0U) {
+                e = &sub_table[i];
+                break;
+            }
+        }
+        if (e == NULL) {
+            DEBUG_WARN("Subscription table full, CCCD 0x%04X not kept", cccd_handle);
+            return;
+        }
+        memset(e, 0, sizeof(*e));
+        memcpy(e->mac_addr, info->mac_addr, BLE_MAC_LEN);
+        e->cccd_handle = cccd_handle;
+    }
+
+    if (value_handle == 0U) {
+        /* Without a table the CCCD usually directly follows the value */
+        value_handle = (uint16_t)(cccd_handle - 1U);
+        db = BLE_GattDisc_GetDb(conn_handle);
+        for (i = 0; db != NULL && i < db->char_count; i++) {
+            if (db->chars[i].cccd_handle == cccd_handle) {
+                value_handle = db->chars[i].value_handle;
+                break;
+            }
+        }
+    }
+    e->value_handle = value_handle;
+    e->cccd_value = (uint8_t)(value & (GATT_SUB_NOTIFY | GATT_SUB_INDICATE));
+}
+
+int BLE_GattSub_SetPolicy(const uint8_t *mac, uint16_t value_handle, BLE_GattSubPolicy_t policy,
+                          uint16_t param, BLE_GattSubFmt_t fmt, uint8_t offset)
+{
+    BLE_GattSub_t *e;
+    uint8_t i;
+
+    if (mac == NULL || policy >= GATT_SUB_POLICY_COUNT || fmt >= GATT_SUB_FMT_COUNT ||
+        (policy != GATT_SUB_POLICY_NONE && param == 0U)) {
+        return -1;
+    }
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        e = &sub_table[i];
+        if (e->cccd_value == 0U || e->value_handle != value_handle ||
+            memcmp(e->mac_addr, mac, BLE_MAC_LEN) != 0) {
+            continue;
+        }
+        e->policy = (uint8_t)policy;
+        e->param = param;
+        e->fmt = (uint8_t)fmt;
+        e->offset = offset;
+        e->forwarded = 0;
+        e->suppressed = 0;
+        GattSub_ResetFilter(i);
+        GattSub_TimerUpdate();
+        DEBUG_INFO("Subscription 0x%04X policy %d, param %d", value_handle, policy, param);
+        return 0;
+    }
+    return -1;
+}
+
+uint8_t BLE_GattSub_FilterNotification(uint16_t conn_handle, uint16_t handle,
+                                       const uint8_t *data, uint16_t len)
+{
+    BLE_ConnectionInfo_t *info = NULL;
+    BLE_GattSub_t *e = NULL;
+    GattSub_Filter_t *f;
+    uint32_t now;
+    int32_t v;
+    uint8_t i;
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        if (sub_table[i].cccd_value == 0U || sub_table[i].policy == GATT_SUB_POLICY_NONE ||
+            sub_table[i].value_handle != handle) {
+            continue;
+        }
+        if (info == NULL) {
+            info = BLE_Connection_GetInfo(conn_handle);
+            if (info == NULL) {
+                return 1;
+            }
+        }
+        if (memcmp(sub_table[i].mac_addr, info->mac_addr, BLE_MAC_LEN) == 0) {
+            e = &sub_table[i];
+            break;
+        }
+    }
+    if (e == NULL) {
+        return 1;
+    }
+
+    f = &sub_filter[i];
+    f->conn_handle = conn_handle;
+    now = HAL_GetTick();
+
+    switch (e->policy) {
+    case GATT_SUB_POLICY_RATE:
+        if (!f->started || (now - f->tick) >= e->param) {
+            if (f->held_len > 0U) {
+                /* Newer value overtook the held one before the task ran */
+                e->suppressed++;
+                f->held_len = 0;
+            }
+            f->started = 1;
+            f->tick = now;
+            break;
+        }
+        /* Latest value wins: the one it replaces is lost */
+        if (f->held_len > 0U || len > GATT_SUB_HOLD_LEN || len == 0U) {
+            e->suppressed++;
+        }
+        if (len > 0U && len <= GATT_SUB_HOLD_LEN) {
+            memcpy(f->held, data, len);
+            f->held_len = (uint8_t)len;
+            GattSub_TimerUpdate();
+        }
+        return 0;
+
+    case GATT_SUB_POLICY_DECIMATE:
+        v = f->counter;
+        f->counter = (uint16_t)((f->counter + 1U < e->param) ? f->counter + 1U : 0U);
+        if (v != 0) {
+            e->suppressed++;
+            return 0;
+        }
+        break;
+
+    case GATT_SUB_POLICY_DELTA:
+        if (GattSub_Decode(e, data, len, &v) != 0) {
+            break;          /* Field missing: nothing to compare */
+        }
+        if (f->started && (int64_t)v - f->last <= (int64_t)e->param &&
+            (int64_t)f->last - v <= (int64_t)e->param) {
+            e->suppressed++;
+            return 0;
+        }
+        f->started = 1;
+        f->last = v;
+        break;
+
+    case GATT_SUB_POLICY_WINDOW:
+        if (GattSub_Decode(e, data, len, &v) != 0) {
+            break;
+        }
+        if (f->count == 0U) {
+            f->tick = now;
+            f->min = v;
+            f->max = v;
+            f->sum = 0;
+            GattSub_TimerUpdate();
+        }
+        if (v < f->min) {
+            f->min = v;
+        }
+        if (v > f->max) {
+            f->max = v;
+        }
+        f->sum += v;
+        f->count++;
+        e->suppressed++;
+        return 0;
+
+    default:
+        break;
+    }
+
+    e->forwarded++;
+    return 1;
+}
+
+void BLE_GattSub_Process(void)
+{
+    BLE_GattSub_t *e;
+    GattSub_Filter_t *f;
+    uint32_t now = HAL_GetTick();
+    uint8_t len;
+    uint8_t i;
+
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        e = &sub_table[i];
+        f = &sub_filter[i];
+        if (e->cccd_value == 0U || f->conn_handle == 0xFFFF) {
+            continue;
+        }
+        if (f->held_len > 0U && (now - f->tick) >= e->param) {
+            len = f->held_len;
+            f->held_len = 0;
+            f->tick = now;
+            e->forwarded++;
+            BLE_EventBus_DeliverNotification(f->conn_handle, e->value_handle, f->held, len);
+        }
+        if (f->count > 0U && (now - f->tick) >= e->param) {
+            GattSub_CloseWindow(e, f);
+        }
+    }
+    GattSub_TimerUpdate();
+}
+
+void BLE_GattSub_OnDisconnected(uint16_t conn_handle)
+{
+    GattSub_Restore_t *r = GattSub_FindRestore(conn_handle);
+    uint8_t i;
+
+    /* Subscriptions stay: they are keyed by MAC for the next connection */
+    if (r != NULL) {
+        r->conn_handle = 0xFFFF;
+    }
+
+    /* Held values and open windows of the link are dropped */
+    for (i = 0; i < GATT_SUB_MAX_ENTRIES; i++) {
+        if (sub_filter[i].conn_handle == conn_handle) {
+            GattSub_ResetFilter(i);
+        }
+    }
+    GattSub_TimerUpdate();
+}
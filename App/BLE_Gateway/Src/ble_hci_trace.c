@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file    ble_hci_trace.c
+  * @brief   HCI/ACI traffic recorder implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_hci_trace.h"
+#include "at_command.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "usbd_cdc_if.h"
+#include "ble_std.h"
+#include "hci_tl.h"
+#include <string.h>
+
+#define HCITRACE_CYCLES()           (DWT->CYCCNT)
+
+/* btsnoop file: version 1, datalink 1002 = HCI UART (H4), big-endian fields */
+#define BTSNOOP_FILE_HDR            16U
+#define BTSNOOP_RECORD_HDR          24U
+#define BTSNOOP_DATALINK_H4         1002U
+#define BTSNOOP_FLAG_RECEIVED       0x01U
+#define BTSNOOP_FLAG_CMD_EVT        0x02U
+/* Microseconds from year 0 to 1970: boot time shows as 1970-01-01 00:00 */
+#define BTSNOOP_EPOCH_OFFSET        0x00DCDDB30F2F8000ULL
+
+/* H4 packet type prepended to each exported packet */
+#define H4_TYPE_CMD                 0x01U
+#define H4_TYPE_EVT                 0x04U
+
+typedef enum {
+    HCITRACE_EXPORT_NONE = 0,
+    HCITRACE_EXPORT_DUMP,
+    HCITRACE_EXPORT_LIVE,
+} HciTrace_Export_t;
+
+/* Record ring, written from the IPCC interrupt and the command context:
+ * all ring accesses run with interrupts masked. Records may wrap */
+static uint8_t trace_ring[HCITRACE_RING_SIZE];
+static uint16_t trace_rd;
+static uint16_t trace_wr;
+static uint16_t trace_used;
+static uint16_t trace_records;
+
+static uint8_t trace_mode;
+static uint8_t trace_filter;
+static uint16_t trace_snaplen;
+static volatile uint8_t trace_paused;   /* Dump running: ring frozen */
+
+/* Export: two chunks, one being filled while USB sends the other */
+static uint8_t trace_export;
+static uint8_t trace_hdr_pending;
+static uint16_t trace_dump_left;
+static uint8_t tx_buf[2][HCITRACE_TX_CHUNK];
+static uint16_t tx_len;
+static uint8_t tx_idx;
+
+static BLE_HciTraceStats_t trace_stats;
+
+static void HciTrace_RingWrite(const uint8_t *src, uint16_t len)
+{
+    uint16_t first = HCITRACE_RING_SIZE - trace_wr;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&trace_ring[trace_wr], src, first);
+    memcpy(trace_ring, &src[first], len - first);
+    trace_wr = (uint16_t)((trace_wr + len) % HCITRACE_RING_SIZE);
+}
+
+static void HciTrace_RingRead(uint16_t at, uint8_t *dst, uint16_t len)
+{
+    uint16_t first = HCITRACE_RING_SIZE - at;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, &trace_ring[at], first);
+    memcpy(&dst[first], trace_ring, len - first);
+}
+
+/**
+ * @brief Drop the oldest record (interrupts masked)
+ */
+static void HciTrace_RingDrop(void)
+{
+    uint8_t hdr[HCITRACE_RECORD_HDR];
+    uint16_t size;
+
+    HciTrace_RingRead(trace_rd, hdr, HCITRACE_RECORD_HDR);
+    size = HCITRACE_RECORD_HDR + (uint16_t)(hdr[4] | ((uint16_t)hdr[5] << 8));
+    trace_rd = (uint16_t)((trace_rd + size) % HCITRACE_RING_SIZE);
+    trace_used -= size;
+    trace_records--;
+}
+
+/**
+ * @brief Current time, microsecond resolution (interrupts masked)
+ * @note  Sub-millisecond part from SysTick, the HAL time base
+ */
+static void HciTrace_Now(uint32_t *ms, uint16_t *us)
+{
+    uint32_t load = SysTick->LOAD + 1U;
+    uint32_t val = SysTick->VAL;
+    uint32_t tick = HAL_GetTick();
+
+    /* Counter reloaded, tick interrupt still pending */
+    if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U) {
+        val = SysTick->VAL;
+        tick++;
+    }
+    *ms = tick;
+    *us = (uint16_t)(((load - 1U - val) * 1000U) / load);
+}
+
+static uint8_t HciTrace_Class(HCI_TL_TraceType_t type, const uint8_t *p_pckt)
+{
+    if (type == HCI_TL_TRACE_CMD) {
+        return HCITRACE_F_CMD;
+    }
+    switch (p_pckt[0]) {
+    case HCI_COMMAND_COMPLETE_EVT_CODE:
+    case HCI_COMMAND_STATUS_EVT_CODE:
+        return HCITRACE_F_CMD_RSP;
+    case HCI_LE_META_EVT_CODE:
+        if (p_pckt[2] == HCI_LE_ADVERTISING_REPORT_SUBEVT_CODE ||
+            p_pckt[2] == HCI_LE_DIRECTED_ADVERTISING_REPORT_SUBEVT_CODE ||
+            p_pckt[2] == HCI_LE_EXTENDED_ADVERTISING_REPORT_SUBEVT_CODE) {
+            return HCITRACE_F_ADV;
+        }
+        return HCITRACE_F_LE_EVT;
+    case HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE:
+        return HCITRACE_F_VS_EVT;
+    default:
+        return HCITRACE_F_HCI_EVT;
+    }
+}
+
+static void HciTrace_PutBe32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * @brief Move the oldest record into the export chunk as a btsnoop record
+ * @return 1 if moved, 0 if none left or the chunk is too full
+ */
+static uint8_t HciTrace_ExportRecord(uint8_t *chunk)
+{
+    uint8_t hdr[HCITRACE_RECORD_HDR];
+    uint8_t *out = &chunk[tx_len];
+    uint16_t orig;
+    uint16_t incl;
+    uint32_t ms;
+    uint64_t ts;
+    uint32_t primask_bit;
+
+    primask_bit = __get_PRIMASK();
+    __disable_irq();
+    if (trace_records == 0U) {
+        __set_PRIMASK(primask_bit);
+        return 0;
+    }
+    HciTrace_RingRead(trace_rd, hdr, HCITRACE_RECORD_HDR);
+    orig = (uint16_t)(hdr[2] | ((uint16_t)hdr[3] << 8));
+    incl = (uint16_t)(hdr[4] | ((uint16_t)hdr[5] << 8));
+    if (tx_len + BTSNOOP_RECORD_HDR + 1U + incl > HCITRACE_TX_CHUNK) {
+        __set_PRIMASK(primask_bit);
+        return 0;
+    }
+    HciTrace_RingRead((uint16_t)((trace_rd + HCITRACE_RECORD_HDR) % HCITRACE_RING_SIZE),
+                      &out[BTSNOOP_RECORD_HDR + 1U], incl);
+    trace_rd = (uint16_t)((trace_rd + HCITRACE_RECORD_HDR + incl) % HCITRACE_RING_SIZE);
+    trace_used -= HCITRACE_RECORD_HDR + incl;
+    trace_records--;
+    __set_PRIMASK(primask_bit);
+
+    memcpy(&ms, &hdr[6], sizeof(ms));
+    ts = BTSNOOP_EPOCH_OFFSET + (uint64_t)ms * 1000U + (uint16_t)(hdr[10] | ((uint16_t)hdr[11] << 8));
+
+    HciTrace_PutBe32(&out[0], orig + 1U);
+    HciTrace_PutBe32(&out[4], incl + 1U);
+    HciTrace_PutBe32(&out[8], (hdr[0] == HCI_TL_TRACE_CMD) ? BTSNOOP_FLAG_CMD_EVT :
+                                  (BTSNOOP_FLAG_CMD_EVT | BTSNOOP_FLAG_RECEIVED));
+    HciTrace_PutBe32(&out[12], trace_stats.overwritten);
+    HciTrace_PutBe32(&out[16], (uint32_t)(ts >> 32));
+    HciTrace_PutBe32(&out[20], (uint32_t)ts);
+    out[BTSNOOP_RECORD_HDR] = (hdr[0] == HCI_TL_TRACE_CMD) ? H4_TYPE_CMD : H4_TYPE_EVT;
+
+    tx_len += BTSNOOP_RECORD_HDR + 1U + incl;
+    trace_stats.exported++;
+    return 1;
+}
+
+static void HciTrace_ExportEnd(void)
+{
+    trace_export = HCITRACE_EXPORT_NONE;
+    trace_paused = 0;
+    tx_len = 0;
+}
+
+void BLE_HciTrace_Init(void)
+{
+    trace_rd = 0;
+    trace_wr = 0;
+    trace_used = 0;
+    trace_records = 0;
+    trace_mode = HCITRACE_MODE_OFF;
+    trace_filter = HCITRACE_F_DEFAULT;
+    trace_snaplen = HCITRACE_SNAPLEN_DEFAULT;
+    trace_paused = 0;
+    trace_export = HCITRACE_EXPORT_NONE;
+    trace_hdr_pending = 0;
+    trace_dump_left = 0;
+    tx_len = 0;
+    tx_idx = 0;
+    memset(&trace_stats, 0, sizeof(trace_stats));
+}
+
+int BLE_HciTrace_Config(BLE_HciTraceMode_t mode, uint8_t filter, uint16_t snaplen)
+{
+    if (mode > HCITRACE_MODE_LIVE || (filter & ~HCITRACE_F_ALL) != 0U ||
+        snaplen < 4U || snaplen > HCITRACE_SNAPLEN_MAX ||
+        trace_export == HCITRACE_EXPORT_DUMP) {
+        return -1;
+    }
+
+    trace_filter = filter;
+    trace_snaplen = snaplen;
+    trace_mode = mode;
+
+    if (mode == HCITRACE_MODE_LIVE && trace_export != HCITRACE_EXPORT_LIVE) {
+        trace_export = HCITRACE_EXPORT_LIVE;
+        trace_hdr_pending = 1;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_HCI_TRACE_ID, CFG_SCH_PRIO_BG);
+    } else if (mode != HCITRACE_MODE_LIVE && trace_export == HCITRACE_EXPORT_LIVE) {
+        HciTrace_ExportEnd();
+    }
+    return 0;
+}
+
+int BLE_HciTrace_Dump(uint32_t *bytes)
+{
+    uint8_t hdr[HCITRACE_RECORD_HDR];
+    uint32_t total = BTSNOOP_FILE_HDR;
+    uint16_t at;
+    uint16_t n;
+
+    if (trace_export != HCITRACE_EXPORT_NONE) {
+        return -1;
+    }
+
+    /* Freeze the ring so the announced size holds */
+    trace_paused = 1;
+    at = trace_rd;
+    for (n = 0; n < trace_records; n++) {
+        HciTrace_RingRead(at, hdr, HCITRACE_RECORD_HDR);
+        total += BTSNOOP_RECORD_HDR + 1U + (uint16_t)(hdr[4] | ((uint16_t)hdr[5] << 8));
+        at = (uint16_t)((at + HCITRACE_RECORD_HDR + (hdr[4] | ((uint16_t)hdr[5] << 8))) %
+                        HCITRACE_RING_SIZE);
+    }
+
+    trace_dump_left = trace_records;
+    trace_hdr_pending = 1;
+    trace_export = HCITRACE_EXPORT_DUMP;
+    UTIL_SEQ_SetTask(1U << CFG_TASK_HCI_TRACE_ID, CFG_SCH_PRIO_BG);
+
+    *bytes = total;
+    return trace_records;
+}
+
+void BLE_HciTrace_Clear(void)
+{
+    uint32_t primask_bit;
+
+    primask_bit = __get_PRIMASK();
+    __disable_irq();
+    if (trace_export != HCITRACE_EXPORT_DUMP) {
+        trace_rd = 0;
+        trace_wr = 0;
+        trace_used = 0;
+        trace_records = 0;
+    }
+    memset(&trace_stats, 0, sizeof(trace_stats));
+    __set_PRIMASK(primask_bit);
+}
+
+uint8_t BLE_HciTrace_IsExporting(void)
+{
+    return (trace_export != HCITRACE_EXPORT_NONE) ? 1U : 0U;
+}
+
+void BLE_HciTrace_GetConfig(BLE_HciTraceMode_t *mode, uint8_t *filter, uint16_t *snaplen)
+{
+    *mode = (BLE_HciTraceMode_t)trace_mode;
+    *filter = trace_filter;
+    *snaplen = trace_snaplen;
+}
+
+void BLE_HciTrace_GetUsage(uint16_t *used, uint16_t *records)
+{
+    *used = trace_used;
+    *records = trace_records;
+}
+
+const BLE_HciTraceStats_t* BLE_HciTrace_GetStats(void)
+{
+    return &trace_stats;
+}
+
+void BLE_HciTrace_OnUsbTxDone(void)
+{
+    if (trace_export != HCITRACE_EXPORT_NONE) {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_HCI_TRACE_ID, CFG_SCH_PRIO_BG);
+    }
+}
+
+void BLE_HciTrace_Process(void)
+{
+    uint8_t *chunk;
+    uint8_t ret;
+
+    while (trace_export != HCITRACE_EXPORT_NONE) {
+        chunk = tx_buf[tx_idx];
+
+        /* Fill the free chunk; keep it if USB refused it last time */
+        if (tx_len == 0U && trace_hdr_pending != 0U) {
+            memcpy(chunk, "btsnoop", 8);
+            HciTrace_PutBe32(&chunk[8], 1U);
+            HciTrace_PutBe32(&chunk[12], BTSNOOP_DATALINK_H4);
+            tx_len = BTSNOOP_FILE_HDR;
+            trace_hdr_pending = 0;
+        }
+        while (trace_export == HCITRACE_EXPORT_LIVE || trace_dump_left > 0U) {
+            if (HciTrace_ExportRecord(chunk) == 0U) {
+                break;
+            }
+            if (trace_dump_left > 0U) {
+                trace_dump_left--;
+            }
+        }
+
+        if (tx_len == 0U) {
+            if (trace_export == HCITRACE_EXPORT_DUMP) {
+                HciTrace_ExportEnd();
+                AT_Response_Send("+HCIDUMP:DONE\r\n");
+            }
+            return;
+        }
+
+        ret = CDC_Transmit_FS(chunk, tx_len);
+        if (ret == USBD_BUSY) {
+            /* Resumed by the transfer complete callback */
+            return;
+        }
+        if (ret != USBD_OK) {
+            trace_stats.export_errors++;
+            if (trace_export == HCITRACE_EXPORT_LIVE) {
+                trace_mode = HCITRACE_MODE_RECORD;
+            }
+            HciTrace_ExportEnd();
+            AT_Response_Send("+HCIDUMP:ERROR\r\n");
+            return;
+        }
+        tx_idx ^= 1U;
+        tx_len = 0;
+    }
+}
+
+/**
+ * @brief Transport layer hook, replaces the weak hci_tl.c version
+ * @note  Runs for every command and in the IPCC interrupt for every event:
+ *        cost is one class lookup and a copy of at most the snap length
+ */
+void hci_trace_packet(HCI_TL_TraceType_t type, const uint8_t *p_pckt, uint16_t len)
+{
+    uint8_t hdr[HCITRACE_RECORD_HDR];
+    uint32_t t0 = HCITRACE_CYCLES();
+    uint32_t primask_bit;
+    uint32_t ms;
+    uint32_t dt;
+    uint16_t us;
+    uint16_t incl;
+
+    if (trace_mode == HCITRACE_MODE_OFF || trace_paused != 0U) {
+        return;
+    }
+
+    primask_bit = __get_PRIMASK();
+    __disable_irq();
+    if ((HciTrace_Class(type, p_pckt) & trace_filter) == 0U) {
+        trace_stats.filtered++;
+    } else {
+        incl = (len > trace_snaplen) ? trace_snaplen : len;
+        if (incl < len) {
+            trace_stats.truncated++;
+        }
+        while ((uint16_t)(HCITRACE_RING_SIZE - trace_used) < HCITRACE_RECORD_HDR + incl) {
+            HciTrace_RingDrop();
+            trace_stats.overwritten++;
+        }
+
+        HciTrace_Now(&ms, &us);
+        hdr[0] = (uint8_t)type;
+        hdr[1] = 0;
+        hdr[2] = (uint8_t)len;
+        hdr[3] = (uint8_t)(len >> 8);
+        hdr[4] = (uint8_t)incl;
+        hdr[5] = (uint8_t)(incl >> 8);
+        memcpy(&hdr[6], &ms, sizeof(ms));
+        hdr[10] = (uint8_t)us;
+        hdr[11] = (uint8_t)(us >> 8);
+        HciTrace_RingWrite(hdr, HCITRACE_RECORD_HDR);
+        HciTrace_RingWrite(p_pckt, incl);
+        trace_used += HCITRACE_RECORD_HDR + incl;
+        trace_records++;
+        trace_stats.captured++;
+
+        if (trace_export == HCITRACE_EXPORT_LIVE) {
+            UTIL_SEQ_SetTask(1U << CFG_TASK_HCI_TRACE_ID, CFG_SCH_PRIO_BG);
+        }
+    }
+
+    dt = HCITRACE_CYCLES() - t0;
+    trace_stats.hook_calls++;
+    trace_stats.hook_cycles += dt;
+    if (dt > trace_stats.hook_max) {
+        trace_stats.hook_max = dt;
+    }
+    __set_PRIMASK(primask_bit);
+}
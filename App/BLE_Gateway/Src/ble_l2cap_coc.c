@@ -0,0 +1,531 @@
+/**
+  ******************************************************************************
+  * @file    ble_l2cap_coc.c
+  * @brief   L2CAP connection-oriented channel implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_l2cap_coc.h"
+#include "ble_connection.h"
+#include "ble_evt_dispatch.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include "ble_l2cap_aci.h"
+#include "ble_std.h"
+#include "ble_vs_codes.h"
+#include <stddef.h>
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+/* Longest K-frame accepted by aci_l2cap_coc_tx_data */
+#define COC_FRAME_MAX               248U
+
+/* Credit Based Connection Response results (Core spec Vol 3, Part A, 4.23) */
+#define COC_RESULT_SPSM_UNSUPPORTED 0x0002U
+#define COC_RESULT_NO_RESOURCES     0x0004U
+
+typedef struct {
+    BLE_CocChannel_t ch;            /* ch.state FREE: slot unused */
+    uint16_t tx_len;                /* SDU being sent, 0 = idle */
+    uint16_t tx_off;                /* SDU bytes handed to the stack */
+    uint16_t rx_left;               /* SDU bytes still expected, 0 = next frame starts one */
+    uint8_t stalled;                /* Out of credits, counted once per stall */
+    uint8_t test;                   /* Pattern source instead of tx_buf */
+    uint32_t test_left;             /* Pattern bytes not yet queued as SDUs */
+    uint32_t test_bytes;
+    uint32_t test_start;
+    uint8_t tx_buf[COC_SDU_MAX];
+} Coc_Slot_t;
+
+static Coc_Slot_t coc_slots[COC_MAX_CHANNELS];
+static uint16_t listen_spsm = 0;
+static uint8_t coc_paused = 0;      /* Stack TX pool full */
+
+static Coc_Slot_t* Coc_Find(uint8_t index)
+{
+    uint8_t i;
+
+    for (i = 0; i < COC_MAX_CHANNELS; i++) {
+        if (coc_slots[i].ch.state != COC_STATE_FREE &&
+            coc_slots[i].ch.state != COC_STATE_CONNECTING && coc_slots[i].ch.index == index) {
+            return &coc_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static Coc_Slot_t* Coc_Alloc(uint16_t conn_handle, uint16_t spsm)
+{
+    uint8_t i;
+
+    for (i = 0; i < COC_MAX_CHANNELS; i++) {
+        if (coc_slots[i].ch.state == COC_STATE_FREE) {
+            memset(&coc_slots[i], 0, offsetof(Coc_Slot_t, tx_buf));
+            coc_slots[i].ch.conn_handle = conn_handle;
+            coc_slots[i].ch.spsm = spsm;
+            coc_slots[i].ch.index = 0xFF;
+            return &coc_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void Coc_Opened(Coc_Slot_t *s, uint8_t index, uint16_t mtu, uint16_t mps, uint16_t credits)
+{
+    s->ch.state = COC_STATE_OPEN;
+    s->ch.index = index;
+    s->ch.peer_mtu = mtu;
+    s->ch.peer_mps = mps;
+    s->ch.tx_credits = credits;
+    s->ch.rx_credits = COC_INITIAL_CREDITS;
+
+    DEBUG_INFO("CoC %d open on 0x%04X: SPSM 0x%04X, MTU %d, MPS %d, credits %d",
+               index, s->ch.conn_handle, s->ch.spsm, mtu, mps, credits);
+    AT_Response_Send("+COCOPEN:%d,0x%04X,%d,%d,%d\r\n", index, s->ch.conn_handle,
+                     mtu, mps, credits);
+}
+
+static void Coc_Free(Coc_Slot_t *s)
+{
+    if (s->ch.state == COC_STATE_OPEN || s->ch.state == COC_STATE_CLOSING) {
+        AT_Response_Send("+COCCLOSED:%d\r\n", s->ch.index);
+    }
+    s->ch.state = COC_STATE_FREE;
+    s->tx_len = 0;
+    s->test = 0;
+}
+
+/**
+ * @brief Start the next pattern SDU of a throughput test, or report its end
+ */
+static void Coc_TestNext(Coc_Slot_t *s)
+{
+    uint32_t ms;
+    uint16_t sdu = (s->ch.peer_mtu < COC_SDU_MAX) ? s->ch.peer_mtu : COC_SDU_MAX;
+
+    if (s->test_left > 0U) {
+        s->tx_len = (s->test_left < sdu) ? (uint16_t)s->test_left : sdu;
+        s->tx_off = 0;
+        s->test_left -= s->tx_len;
+        return;
+    }
+
+    ms = HAL_GetTick() - s->test_start;
+    if (ms == 0U) {
+        ms = 1U;
+    }
+    s->test = 0;
+    /* bits per millisecond == kbit/s */
+    AT_Response_Send("+COCTEST:%d,%lu,%lu,%lu\r\n", s->ch.index, (unsigned long)s->test_bytes,
+                     (unsigned long)ms, (unsigned long)((s->test_bytes * 8U) / ms));
+}
+
+/**
+ * @brief Give the peer back the credits it used once half of them are gone
+ */
+static void Coc_Replenish(Coc_Slot_t *s)
+{
+    uint16_t grant;
+
+    if (s->ch.rx_credits > COC_INITIAL_CREDITS / 2U) {
+        return;
+    }
+    grant = (uint16_t)(COC_INITIAL_CREDITS - s->ch.rx_credits);
+    if (aci_l2cap_coc_flow_control(s->ch.index, grant) == BLE_STATUS_SUCCESS) {
+        s->ch.rx_credits += grant;
+    }
+}
+
+/*============================================================================
+ * Stack events (registered with the event dispatcher)
+ *============================================================================*/
+
+static void Coc_EvtConnect(void *evt)
+{
+    aci_l2cap_coc_connect_event_rp0 *pr = evt;
+
+    BLE_L2capCoc_OnConnectRequest(pr->Connection_Handle, pr->SPSM, pr->MTU, pr->MPS,
+                                  pr->Initial_Credits);
+}
+
+static void Coc_EvtConnectConfirm(void *evt)
+{
+    aci_l2cap_coc_connect_confirm_event_rp0 *pr = evt;
+
+    BLE_L2capCoc_OnConnectConfirm(pr->Connection_Handle, pr->MTU, pr->MPS, pr->Initial_Credits,
+                                  pr->Result, pr->Channel_Number, pr->Channel_Index_List);
+}
+
+static void Coc_EvtDisconnect(void *evt)
+{
+    aci_l2cap_coc_disconnect_event_rp0 *pr = evt;
+
+    BLE_L2capCoc_OnChannelClosed(pr->Channel_Index);
+}
+
+static void Coc_EvtFlowControl(void *evt)
+{
+    aci_l2cap_coc_flow_control_event_rp0 *pr = evt;
+
+    BLE_L2capCoc_OnFlowControl(pr->Channel_Index, pr->Credits);
+}
+
+static void Coc_EvtRxData(void *evt)
+{
+    aci_l2cap_coc_rx_data_event_rp0 *pr = evt;
+
+    BLE_L2capCoc_OnRxData(pr->Channel_Index, pr->Data, pr->Length);
+}
+
+static void Coc_EvtTxPoolAvailable(void *evt)
+{
+    (void)evt;
+    BLE_L2capCoc_OnTxPoolAvailable();
+}
+
+void BLE_L2capCoc_Init(void)
+{
+    memset(coc_slots, 0, sizeof(coc_slots));
+    listen_spsm = 0;
+    coc_paused = 0;
+
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_CONNECT_VSEVT_CODE, Coc_EvtConnect);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_CONNECT_CONFIRM_VSEVT_CODE, Coc_EvtConnectConfirm);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_DISCONNECT_VSEVT_CODE, Coc_EvtDisconnect);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_FLOW_CONTROL_VSEVT_CODE, Coc_EvtFlowControl);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_RX_DATA_VSEVT_CODE, Coc_EvtRxData);
+    BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE,
+                             ACI_L2CAP_COC_TX_POOL_AVAILABLE_VSEVT_CODE, Coc_EvtTxPoolAvailable);
+}
+
+int BLE_L2capCoc_Open(uint16_t conn_handle, uint16_t spsm)
+{
+    Coc_Slot_t *s;
+    tBleStatus ret;
+
+    if (BLE_Connection_GetInfo(conn_handle) == NULL || spsm == 0U) {
+        return -1;
+    }
+    s = Coc_Alloc(conn_handle, spsm);
+    if (s == NULL) {
+        return -1;
+    }
+
+    /* Channel_Number 0: one LE credit based channel */
+    ret = aci_l2cap_coc_connect(conn_handle, spsm, COC_LOCAL_MTU, COC_LOCAL_MPS,
+                                COC_INITIAL_CREDITS, 0);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("CoC connect 0x%04X failed: 0x%02X", conn_handle, ret);
+        return -1;
+    }
+    s->ch.state = COC_STATE_CONNECTING;
+    return 0;
+}
+
+int BLE_L2capCoc_Close(uint8_t index)
+{
+    Coc_Slot_t *s = Coc_Find(index);
+
+    if (s == NULL || aci_l2cap_coc_disconnect(index) != BLE_STATUS_SUCCESS) {
+        return -1;
+    }
+    /* Freed by ACI_L2CAP_COC_DISCONNECT */
+    s->ch.state = COC_STATE_CLOSING;
+    s->tx_len = 0;
+    s->test = 0;
+    return 0;
+}
+
+int BLE_L2capCoc_Send(uint8_t index, const uint8_t *data, uint16_t len)
+{
+    Coc_Slot_t *s = Coc_Find(index);
+
+    if (s == NULL || s->ch.state != COC_STATE_OPEN || s->tx_len > 0U || data == NULL ||
+        len == 0U || len > COC_SDU_MAX || len > s->ch.peer_mtu) {
+        return -1;
+    }
+    memcpy(s->tx_buf, data, len);
+    s->tx_len = len;
+    s->tx_off = 0;
+    UTIL_SEQ_SetTask(1U << CFG_TASK_L2CAP_COC_ID, CFG_SCH_PRIO_HOST);
+    return 0;
+}
+
+int BLE_L2capCoc_StartTest(uint8_t index, uint32_t bytes)
+{
+    Coc_Slot_t *s = Coc_Find(index);
+
+    if (s == NULL || s->ch.state != COC_STATE_OPEN || s->tx_len > 0U || bytes == 0U) {
+        return -1;
+    }
+    s->test = 1;
+    s->test_left = bytes;
+    s->test_bytes = bytes;
+    s->test_start = HAL_GetTick();
+    Coc_TestNext(s);
+    UTIL_SEQ_SetTask(1U << CFG_TASK_L2CAP_COC_ID, CFG_SCH_PRIO_HOST);
+    return 0;
+}
+
+void BLE_L2capCoc_SetListen(uint16_t spsm)
+{
+    listen_spsm = spsm;
+    DEBUG_INFO("CoC listen SPSM 0x%04X", spsm);
+}
+
+uint16_t BLE_L2capCoc_GetListen(void)
+{
+    return listen_spsm;
+}
+
+const BLE_CocChannel_t* BLE_L2capCoc_GetChannel(uint8_t slot)
+{
+    if (slot >= COC_MAX_CHANNELS || coc_slots[slot].ch.state == COC_STATE_FREE) {
+        return NULL;
+    }
+    return &coc_slots[slot].ch;
+}
+
+void BLE_L2capCoc_OnConnectRequest(uint16_t conn_handle, uint16_t spsm, uint16_t mtu,
+                                   uint16_t mps, uint16_t credits)
+{
+    Coc_Slot_t *s = NULL;
+    uint8_t count = 0;
+    uint8_t indexes[5];
+    uint16_t result = 0;
+
+    if (listen_spsm == 0U || spsm != listen_spsm) {
+        result = COC_RESULT_SPSM_UNSUPPORTED;
+    } else {
+        s = Coc_Alloc(conn_handle, spsm);
+        if (s == NULL) {
+            result = COC_RESULT_NO_RESOURCES;
+        }
+    }
+
+    if (aci_l2cap_coc_connect_confirm(conn_handle, COC_LOCAL_MTU, COC_LOCAL_MPS,
+                                      COC_INITIAL_CREDITS, result, &count, indexes) !=
+            BLE_STATUS_SUCCESS || result != 0U || count == 0U) {
+        DEBUG_WARN("CoC request 0x%04X SPSM 0x%04X refused: 0x%04X", conn_handle, spsm, result);
+        return;
+    }
+    Coc_Opened(s, indexes[0], mtu, mps, credits);
+}
+
+void BLE_L2capCoc_OnConnectConfirm(uint16_t conn_handle, uint16_t mtu, uint16_t mps,
+                                   uint16_t credits, uint16_t result, uint8_t count,
+                                   const uint8_t *indexes)
+{
+    Coc_Slot_t *s = NULL;
+    uint8_t i;
+
+    for (i = 0; i < COC_MAX_CHANNELS; i++) {
+        if (coc_slots[i].ch.state == COC_STATE_CONNECTING &&
+            coc_slots[i].ch.conn_handle == conn_handle) {
+            s = &coc_slots[i];
+            break;
+        }
+    }
+    if (s == NULL) {
+        return;
+    }
+
+    if (result != 0U || count == 0U) {
+        DEBUG_WARN("CoC 0x%04X refused by peer: 0x%04X", conn_handle, result);
+        AT_Response_Send("+COCERROR:0x%04X,0x%04X\r\n", conn_handle, result);
+        s->ch.state = COC_STATE_FREE;
+        return;
+    }
+    Coc_Opened(s, indexes[0], mtu, mps, credits);
+}
+
+void BLE_L2capCoc_OnChannelClosed(uint8_t index)
+{
+    Coc_Slot_t *s = Coc_Find(index);
+
+    if (s != NULL) {
+        DEBUG_INFO("CoC %d closed", index);
+        Coc_Free(s);
+    }
+}
+
+void BLE_L2capCoc_OnFlowControl(uint8_t index, uint16_t credits)
+{
+    Coc_Slot_t *s = Coc_Find(index);
+
+    if (s == NULL) {
+        return;
+    }
+    s->ch.tx_credits = (uint16_t)(s->ch.tx_credits + credits);
+    if (s->stalled) {
+        s->stalled = 0;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_L2CAP_COC_ID, CFG_SCH_PRIO_HOST);
+    }
+}
+
+void BLE_L2capCoc_OnRxData(uint8_t index, const uint8_t *data, uint16_t len)
+{
+    static char hex[COC_FRAME_MAX * 2U + 1U];
+    Coc_Slot_t *s = Coc_Find(index);
+    uint16_t sdu_len;
+    uint16_t i;
+
+    if (s == NULL) {
+        return;
+    }
+    if (s->ch.rx_credits > 0U) {
+        s->ch.rx_credits--;
+    }
+
+    /* First K-frame of an SDU carries the SDU length */
+    if (s->rx_left == 0U) {
+        if (len < 2U) {
+            return;
+        }
+        sdu_len = (uint16_t)(data[0] | (data[1] << 8));
+        data += 2;
+        len -= 2U;
+        s->rx_left = sdu_len;
+        AT_Response_Send("+COCRX:%d,%d,", index, sdu_len);
+    }
+    if (len > s->rx_left) {
+        len = s->rx_left;
+    }
+    if (len > COC_FRAME_MAX) {
+        len = COC_FRAME_MAX;
+    }
+
+    for (i = 0; i < len; i++) {
+        hex[2U * i] = "0123456789ABCDEF"[data[i] >> 4];
+        hex[2U * i + 1U] = "0123456789ABCDEF"[data[i] & 0x0FU];
+    }
+    hex[2U * len] = '\0';
+    /* Blocking UART write: credits go back only once the host has the data */
+    AT_Response_Send("%s", hex);
+
+    s->rx_left -= len;
+    s->ch.rx_bytes += len;
+    if (s->rx_left == 0U) {
+        AT_Response_Send("\r\n");
+        s->ch.rx_sdus++;
+    }
+    Coc_Replenish(s);
+}
+
+void BLE_L2capCoc_OnTxPoolAvailable(void)
+{
+    if (coc_paused) {
+        coc_paused = 0;
+        UTIL_SEQ_SetTask(1U << CFG_TASK_L2CAP_COC_ID, CFG_SCH_PRIO_HOST);
+    }
+}
+
+void BLE_L2capCoc_OnDisconnected(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    /* Channels end with their link */
+    for (i = 0; i < COC_MAX_CHANNELS; i++) {
+        if (coc_slots[i].ch.state != COC_STATE_FREE && coc_slots[i].ch.conn_handle == conn_handle) {
+            Coc_Free(&coc_slots[i]);
+        }
+    }
+    coc_paused = 0;
+}
+
+void BLE_L2capCoc_Process(void)
+{
+    static uint8_t frame[COC_FRAME_MAX];
+    Coc_Slot_t *s;
+    uint16_t mps;
+    uint16_t hdr;
+    uint16_t chunk;
+    uint16_t i;
+    uint8_t frames;
+    uint8_t more = 0;
+    uint8_t n;
+    tBleStatus ret;
+
+    for (n = 0; n < COC_MAX_CHANNELS && !coc_paused; n++) {
+        s = &coc_slots[n];
+        frames = 0;
+
+        while (s->ch.state == COC_STATE_OPEN && s->tx_len > 0U && frames < COC_BURST_FRAMES) {
+            if (s->ch.tx_credits == 0U) {
+                /* Resumed by ACI_L2CAP_COC_FLOW_CONTROL */
+                if (!s->stalled) {
+                    s->stalled = 1;
+                    s->ch.stalls++;
+                }
+                break;
+            }
+
+            mps = (s->ch.peer_mps < COC_FRAME_MAX) ? s->ch.peer_mps : COC_FRAME_MAX;
+            hdr = 0;
+            if (s->tx_off == 0U) {
+                frame[0] = (uint8_t)(s->tx_len & 0xFFU);
+                frame[1] = (uint8_t)(s->tx_len >> 8);
+                hdr = 2;
+            }
+            chunk = (uint16_t)(mps - hdr);
+            if (chunk > s->tx_len - s->tx_off) {
+                chunk = (uint16_t)(s->tx_len - s->tx_off);
+            }
+            if (s->test) {
+                for (i = 0; i < chunk; i++) {
+                    frame[hdr + i] = (uint8_t)(s->tx_off + i);
+                }
+            } else {
+                memcpy(&frame[hdr], &s->tx_buf[s->tx_off], chunk);
+            }
+
+            ret = aci_l2cap_coc_tx_data(s->ch.index, (uint16_t)(hdr + chunk), frame);
+            if (ret == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+                /* Resumed by ACI_L2CAP_COC_TX_POOL_AVAILABLE */
+                coc_paused = 1;
+                s->ch.stalls++;
+                return;
+            }
+            if (ret != BLE_STATUS_SUCCESS) {
+                DEBUG_WARN("CoC %d TX failed: 0x%02X", s->ch.index, ret);
+                AT_Response_Send("+COCTX_ERROR:%d,0x%02X\r\n", s->ch.index, ret);
+                s->tx_len = 0;
+                s->test = 0;
+                break;
+            }
+
+            s->ch.tx_credits--;
+            s->ch.tx_bytes += chunk;
+            s->tx_off += chunk;
+            frames++;
+
+            if (s->tx_off >= s->tx_len) {
+                s->ch.tx_sdus++;
+                s->tx_len = 0;
+                if (s->test) {
+                    Coc_TestNext(s);
+                } else {
+                    AT_Response_Send("+COCSENT:%d,%d\r\n", s->ch.index, s->tx_off);
+                }
+            }
+        }
+
+        if (s->ch.state == COC_STATE_OPEN && s->tx_len > 0U && s->ch.tx_credits > 0U) {
+            more = 1;
+        }
+    }
+
+    /* Yield to other tasks between bursts */
+    if (more && !coc_paused) {
+        UTIL_SEQ_SetTask(1U << CFG_TASK_L2CAP_COC_ID, CFG_SCH_PRIO_HOST);
+    }
+}
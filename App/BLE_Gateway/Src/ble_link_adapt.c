@@ -0,0 +1,361 @@
+/**
+  ******************************************************************************
+  * @file    ble_link_adapt.c
+  * @brief   Adaptive connection interval implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_link_adapt.h"
+#include "ble_connection.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "stm32wbxx_hal.h"
+#include <string.h>
+
+#define LINK_ADAPT_MS_TO_TICKS(ms)  ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* Class thresholds in packets/s * 10; enter and exit differ (hysteresis) */
+#define STREAM_ENTER_RATE_X10   200U    /* 20 pkt/s */
+#define STREAM_EXIT_RATE_X10    100U    /* 10 pkt/s */
+#define IDLE_ENTER_RATE_X10     2U      /* 0.2 pkt/s */
+#define IDLE_EXIT_RATE_X10      10U     /* 1 pkt/s */
+
+/* Candidate must hold this many periods before a renegotiation */
+#define STABLE_PERIODS          3U
+/* Minimum time between two renegotiations of one link */
+#define UPDATE_HOLDOFF_MS       10000U
+
+/* Airtime model: empty PDU exchange per connection event and per-byte cost */
+#define EMPTY_EVENT_US_1M       310U    /* 80 + T_IFS 150 + 80 */
+#define EMPTY_EVENT_US_2M       238U    /* 44 + T_IFS 150 + 44 */
+#define BYTE_US_1M              8U
+#define BYTE_US_2M              4U
+#define ATT_L2CAP_OVERHEAD      7U      /* L2CAP 4 + ATT 3 */
+
+#define SUPERVISION_TIMEOUT_MAX 0x0C80U
+
+static BLE_LinkAdaptInfo_t adapt_info[MAX_BLE_CONNECTIONS];
+static BLE_LinkAdaptBounds_t adapt_bounds = {
+    0x0006,     /* 7.5 ms while streaming */
+    0x0190,     /* 500 ms while idle */
+    4,          /* idle latency: effective 2.5 s */
+};
+static uint8_t adapt_enabled = 0;
+static uint8_t adapt_timer_id;
+
+static const char *const class_names[] = { "normal", "stream", "idle" };
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void LinkAdapt_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_LINK_ADAPT_ID, CFG_SCH_PRIO_BG);
+}
+
+/**
+ * @brief Estimate radio time used by a link in one second
+ * @note  Connection events are skipped by latency only while the link is quiet;
+ *        each packet forces at least one event
+ */
+static uint32_t LinkAdapt_EstimateAirtime(const BLE_ConnectionInfo_t *link,
+                                          uint16_t rate_x10, uint16_t byte_rate)
+{
+    uint32_t events_x10;
+    uint32_t max_events_x10;
+    uint32_t event_us;
+    uint32_t byte_us;
+
+    if (link->conn_interval == 0U) {
+        return 0;
+    }
+
+    /* 1 s / (interval * 1.25 ms) = 800 / interval events per second */
+    max_events_x10 = 8000U / link->conn_interval;
+    events_x10 = max_events_x10 / (1U + link->conn_latency);
+    if (rate_x10 > events_x10) {
+        events_x10 = (rate_x10 < max_events_x10) ? rate_x10 : max_events_x10;
+    }
+
+    if (link->tx_phy == 0x02U) {
+        event_us = EMPTY_EVENT_US_2M;
+        byte_us = BYTE_US_2M;
+    } else {
+        event_us = EMPTY_EVENT_US_1M;
+        byte_us = BYTE_US_1M;
+    }
+
+    return (events_x10 * event_us) / 10U +
+           ((uint32_t)byte_rate + (rate_x10 * ATT_L2CAP_OVERHEAD) / 10U) * byte_us;
+}
+
+/**
+ * @brief Next class for a traffic rate, starting from the current class
+ */
+static BLE_LinkClass_t LinkAdapt_Classify(BLE_LinkClass_t current, uint16_t rate_x10)
+{
+    switch (current) {
+    case LINK_CLASS_STREAM:
+        if (rate_x10 >= STREAM_EXIT_RATE_X10) {
+            return LINK_CLASS_STREAM;
+        }
+        break;
+    case LINK_CLASS_IDLE:
+        if (rate_x10 < IDLE_EXIT_RATE_X10) {
+            return LINK_CLASS_IDLE;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (rate_x10 >= STREAM_ENTER_RATE_X10) {
+        return LINK_CLASS_STREAM;
+    }
+    if (rate_x10 <= IDLE_ENTER_RATE_X10) {
+        return LINK_CLASS_IDLE;
+    }
+    return LINK_CLASS_NORMAL;
+}
+
+/**
+ * @brief Connection parameters for a class within host bounds
+ */
+static void LinkAdapt_ClassParams(BLE_LinkClass_t link_class, BLE_ConnParams_t *params)
+{
+    uint32_t timeout;
+
+    BLE_Connection_GetDefaultParams(params);
+
+    if (link_class == LINK_CLASS_STREAM) {
+        params->interval_min = adapt_bounds.interval_min;
+        params->interval_max = adapt_bounds.interval_min;
+        params->latency = 0;
+    } else if (link_class == LINK_CLASS_IDLE) {
+        params->interval_min = adapt_bounds.interval_max;
+        params->interval_max = adapt_bounds.interval_max;
+        params->latency = adapt_bounds.latency_max;
+    } else {
+        return;
+    }
+
+    /* Timeout of 3x the effective interval: (1 + lat) * max * 1.25 ms * 3 / 10 ms */
+    timeout = ((1U + params->latency) * (uint32_t)params->interval_max * 3U) / 8U + 1U;
+    if (timeout < params->supervision_timeout) {
+        timeout = params->supervision_timeout;
+    }
+    if (timeout > SUPERVISION_TIMEOUT_MAX) {
+        timeout = SUPERVISION_TIMEOUT_MAX;
+    }
+    params->supervision_timeout = (uint16_t)timeout;
+}
+
+/**
+ * @brief Sample one link and renegotiate when its class settled
+ */
+static void LinkAdapt_Sample(BLE_LinkAdaptInfo_t *state, const BLE_ConnectionInfo_t *link,
+                             uint32_t now)
+{
+    uint32_t packets = link->rx_packets + link->tx_packets;
+    uint32_t bytes = link->rx_bytes + link->tx_bytes;
+    uint32_t rate;
+    BLE_LinkClass_t next;
+    BLE_ConnParams_t params;
+
+    if (state->conn_handle != link->conn_handle) {
+        /* New link in this slot: start from the connect-time parameters */
+        memset(state, 0, sizeof(*state));
+        state->conn_handle = link->conn_handle;
+        state->link_class = LINK_CLASS_NORMAL;
+        state->candidate = LINK_CLASS_NORMAL;
+        state->last_update_tick = now;
+        state->last_packets = packets;
+        state->last_bytes = bytes;
+        return;
+    }
+
+    rate = ((packets - state->last_packets) * 10000U) / LINK_ADAPT_PERIOD_MS;
+    state->rate_x10 = (rate > 0xFFFFU) ? 0xFFFFU : (uint16_t)rate;
+    rate = ((bytes - state->last_bytes) * 1000U) / LINK_ADAPT_PERIOD_MS;
+    state->byte_rate = (rate > 0xFFFFU) ? 0xFFFFU : (uint16_t)rate;
+    state->last_packets = packets;
+    state->last_bytes = bytes;
+    state->airtime_us = LinkAdapt_EstimateAirtime(link, state->rate_x10, state->byte_rate);
+
+    if (state->update_pending) {
+        /* No complete event: the request was lost, retry after the holdoff */
+        if ((now - state->last_update_tick) < UPDATE_HOLDOFF_MS) {
+            return;
+        }
+        DEBUG_WARN("Adapt 0x%04X: no update complete, staying %s",
+                   link->conn_handle, class_names[state->link_class]);
+        state->update_pending = 0;
+    }
+
+    if (!adapt_enabled) {
+        return;
+    }
+
+    next = LinkAdapt_Classify(state->link_class, state->rate_x10);
+    if (next == state->link_class) {
+        state->stable_count = 0;
+        return;
+    }
+    if (next != state->candidate) {
+        state->candidate = next;
+        state->stable_count = 0;
+    }
+    if (++state->stable_count < STABLE_PERIODS) {
+        return;
+    }
+    if ((now - state->last_update_tick) < UPDATE_HOLDOFF_MS) {
+        return;
+    }
+
+    LinkAdapt_ClassParams(next, &params);
+    DEBUG_INFO("Adapt 0x%04X: %s -> %s (rate=%d.%d/s, air=%luus/s) int=%d-%d lat=%d to=%d",
+               link->conn_handle, class_names[state->link_class], class_names[next],
+               state->rate_x10 / 10U, state->rate_x10 % 10U,
+               (unsigned long)state->airtime_us,
+               params.interval_min, params.interval_max,
+               params.latency, params.supervision_timeout);
+
+    state->last_update_tick = now;
+    state->stable_count = 0;
+    /* The class is committed by the update complete event */
+    if (BLE_Connection_UpdateParams(link->conn_handle, &params) == 0) {
+        state->requested = next;
+        state->update_pending = 1;
+    }
+}
+
+void BLE_LinkAdapt_Init(void)
+{
+    uint8_t i;
+
+    memset(adapt_info, 0, sizeof(adapt_info));
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        adapt_info[i].conn_handle = 0xFFFF;
+    }
+    adapt_enabled = 0;
+
+    /* Sampling runs always so airtime estimates are available */
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &adapt_timer_id, hw_ts_Repeated, LinkAdapt_TimerCb);
+    HW_TS_Start(adapt_timer_id, LINK_ADAPT_MS_TO_TICKS(LINK_ADAPT_PERIOD_MS));
+
+    DEBUG_INFO("Link adapt initialized");
+}
+
+void BLE_LinkAdapt_Enable(uint8_t enable)
+{
+    uint8_t i;
+
+    adapt_enabled = enable ? 1U : 0U;
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        adapt_info[i].candidate = adapt_info[i].link_class;
+        adapt_info[i].stable_count = 0;
+    }
+    DEBUG_INFO("Link adapt %s", adapt_enabled ? "enabled" : "disabled");
+}
+
+uint8_t BLE_LinkAdapt_IsEnabled(void)
+{
+    return adapt_enabled;
+}
+
+int BLE_LinkAdapt_SetBounds(const BLE_LinkAdaptBounds_t *bounds)
+{
+    BLE_ConnParams_t idle;
+
+    if (bounds == NULL || bounds->interval_min < 0x0006U ||
+        bounds->interval_min > bounds->interval_max ||
+        bounds->interval_max > 0x0C80U || bounds->latency_max > 0x01F3U) {
+        return -1;
+    }
+
+    /* Idle parameters must still fit a valid supervision timeout */
+    if ((1U + bounds->latency_max) * (uint32_t)bounds->interval_max >=
+        SUPERVISION_TIMEOUT_MAX * 4U) {
+        return -1;
+    }
+
+    adapt_bounds = *bounds;
+    LinkAdapt_ClassParams(LINK_CLASS_IDLE, &idle);
+    DEBUG_INFO("Adapt bounds: stream=%d idle=%d lat=%d to=%d", bounds->interval_min,
+               bounds->interval_max, bounds->latency_max, idle.supervision_timeout);
+    return 0;
+}
+
+void BLE_LinkAdapt_GetBounds(BLE_LinkAdaptBounds_t *bounds)
+{
+    if (bounds != NULL) {
+        *bounds = adapt_bounds;
+    }
+}
+
+const BLE_LinkAdaptInfo_t* BLE_LinkAdapt_GetInfo(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (adapt_info[i].conn_handle == conn_handle) {
+            return &adapt_info[i];
+        }
+    }
+    return NULL;
+}
+
+void BLE_LinkAdapt_Process(void)
+{
+    uint32_t now = HAL_GetTick();
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF ||
+            link->state != CONN_STATE_CONNECTED) {
+            adapt_info[i].conn_handle = 0xFFFF;
+            continue;
+        }
+        LinkAdapt_Sample(&adapt_info[i], link, now);
+    }
+}
+
+void BLE_LinkAdapt_OnUpdateComplete(uint16_t conn_handle, uint8_t status, uint16_t interval)
+{
+    BLE_LinkAdaptInfo_t *state = NULL;
+    BLE_ConnParams_t params;
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (adapt_info[i].conn_handle == conn_handle) {
+            state = &adapt_info[i];
+            break;
+        }
+    }
+    if (state == NULL || !state->update_pending) {
+        return;
+    }
+    state->update_pending = 0;
+
+    /* A rejected update, or one that ended outside the requested range, leaves the
+       class on the running parameters so hysteresis proposes the change again */
+    LinkAdapt_ClassParams(state->requested, &params);
+    if (status != 0 || interval < params.interval_min || interval > params.interval_max) {
+        DEBUG_WARN("Adapt 0x%04X: %s not applied (status=0x%02X int=%d), staying %s",
+                   conn_handle, class_names[state->requested], status, interval,
+                   class_names[state->link_class]);
+        state->candidate = state->link_class;
+        state->stable_count = 0;
+        return;
+    }
+    state->link_class = state->requested;
+}
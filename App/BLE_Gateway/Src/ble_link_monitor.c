@@ -0,0 +1,283 @@
+/**
+  ******************************************************************************
+  * @file    ble_link_monitor.c
+  * @brief   Link quality monitor implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "ble_link_monitor.h"
+#include "ble_connection.h"
+#include "ble_device_manager.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+#include "ble_hal_aci.h"
+#include "ble_hci_le.h"
+#include <string.h>
+
+extern void AT_Response_Send(const char *fmt, ...);
+
+#define LINK_MON_MS_TO_TICKS(ms)    ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+#define RSSI_NOT_AVAILABLE          127
+#define TREND_WARN_X16              (-6 * 16)   /* Falling 6 dB faster than average */
+#define WARN_CLEAR_HYST_DB          5           /* Recovery margin above threshold */
+#define LINK_STATUS_CONNECTED_P     0x02U
+#define LINK_STATUS_CONNECTED_C     0x05U
+#define STACK_LINK_NBR              8U
+
+static BLE_LinkQuality_t link_quality[MAX_BLE_CONNECTIONS];
+static uint8_t mon_enabled = 1;
+static uint16_t mon_period_ms = LINK_MON_DEFAULT_PERIOD_MS;
+static int8_t mon_warn_dbm = LINK_MON_DEFAULT_WARN_DBM;
+static uint8_t mon_timer_id;
+static uint8_t mon_next_slot = 0;
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void LinkMonitor_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_LINK_MONITOR_ID, CFG_SCH_PRIO_BG);
+}
+
+static void LinkMonitor_Reset(BLE_LinkQuality_t *q, uint16_t conn_handle)
+{
+    memset(q, 0, sizeof(*q));
+    q->conn_handle = conn_handle;
+}
+
+/**
+ * @brief Raise or clear +LINKWARN for a link
+ */
+static void LinkMonitor_Warn(BLE_LinkQuality_t *q, const char *reason)
+{
+    int16_t trend = BLE_LinkMonitor_Trend(q);
+
+    DEBUG_WARN("Link 0x%04X %s: rssi=%d trend=%d", q->conn_handle, reason,
+               q->rssi_ewma_x16 / 16, trend / 16);
+    AT_Response_Send("+LINKWARN:0x%04X,%s,%d,%d\r\n", q->conn_handle, reason,
+                     q->rssi_ewma_x16 / 16, trend / 16);
+}
+
+/**
+ * @brief Fold one RSSI sample into the link statistics
+ */
+static void LinkMonitor_AddSample(BLE_LinkQuality_t *q, int8_t rssi)
+{
+    int16_t sample_x16 = (int16_t)(rssi * 16);
+    int16_t trend;
+    int dev_idx;
+    BLE_Device_t *dev;
+
+    if (q->samples == 0U) {
+        q->rssi_min = rssi;
+        q->rssi_max = rssi;
+        q->rssi_ewma_x16 = sample_x16;
+        q->rssi_fast_x16 = sample_x16;
+    } else {
+        if (rssi < q->rssi_min) {
+            q->rssi_min = rssi;
+        }
+        if (rssi > q->rssi_max) {
+            q->rssi_max = rssi;
+        }
+        q->rssi_ewma_x16 += (int16_t)((sample_x16 - q->rssi_ewma_x16) / 8);
+        q->rssi_fast_x16 += (int16_t)((sample_x16 - q->rssi_fast_x16) / 2);
+    }
+    q->rssi_last = rssi;
+    if (q->samples < 0xFFFFU) {
+        q->samples++;
+    }
+
+    /* Keep device list RSSI fresh while connected */
+    dev_idx = BLE_DeviceManager_FindConnHandle(q->conn_handle);
+    dev = (dev_idx >= 0) ? BLE_DeviceManager_GetDevice(dev_idx) : NULL;
+    if (dev != NULL) {
+        dev->rssi = (int8_t)(q->rssi_ewma_x16 / 16);
+    }
+
+    trend = BLE_LinkMonitor_Trend(q);
+    if (!q->warned) {
+        if (q->rssi_ewma_x16 < mon_warn_dbm * 16) {
+            q->warned = 1;
+            LinkMonitor_Warn(q, "WEAK");
+        } else if (trend <= TREND_WARN_X16) {
+            q->warned = 1;
+            LinkMonitor_Warn(q, "FALLING");
+        }
+    } else if (q->rssi_ewma_x16 >= (mon_warn_dbm + WARN_CLEAR_HYST_DB) * 16 &&
+               trend > TREND_WARN_X16 / 2) {
+        q->warned = 0;
+        LinkMonitor_Warn(q, "CLEAR");
+    }
+}
+
+/**
+ * @brief Cross-check gateway links against controller link table
+ * @note  A link the controller no longer reports as connected is about to
+ *        be dropped; warn before the supervision timeout fires
+ */
+static void LinkMonitor_CheckStatus(void)
+{
+    uint8_t status[STACK_LINK_NBR];
+    uint16_t handles[STACK_LINK_NBR];
+    BLE_ConnectionInfo_t *link;
+    uint8_t i;
+    uint8_t j;
+    uint8_t found;
+    tBleStatus ret;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (link_quality[i].conn_handle != 0xFFFF) {
+            break;
+        }
+    }
+    if (i == MAX_BLE_CONNECTIONS) {
+        return;
+    }
+
+    ret = aci_hal_get_link_status(status, handles);
+    if (ret != BLE_STATUS_SUCCESS) {
+        DEBUG_ERROR("Get link status failed: 0x%02X", ret);
+        return;
+    }
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        link = BLE_Connection_GetSlot(i);
+        if (link == NULL || link->conn_handle == 0xFFFF ||
+            link->state != CONN_STATE_CONNECTED) {
+            continue;
+        }
+
+        found = 0;
+        for (j = 0; j < STACK_LINK_NBR; j++) {
+            if ((status[j] == LINK_STATUS_CONNECTED_C || status[j] == LINK_STATUS_CONNECTED_P) &&
+                handles[j] == link->conn_handle) {
+                found = 1;
+                break;
+            }
+        }
+
+        if (!found && link_quality[i].conn_handle == link->conn_handle &&
+            !link_quality[i].warned) {
+            link_quality[i].warned = 1;
+            LinkMonitor_Warn(&link_quality[i], "STATUS");
+        }
+    }
+}
+
+void BLE_LinkMonitor_Init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        LinkMonitor_Reset(&link_quality[i], 0xFFFF);
+    }
+    mon_next_slot = 0;
+
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &mon_timer_id, hw_ts_Repeated, LinkMonitor_TimerCb);
+    if (mon_enabled) {
+        HW_TS_Start(mon_timer_id, LINK_MON_MS_TO_TICKS(mon_period_ms));
+    }
+
+    DEBUG_INFO("Link monitor initialized: %dms", mon_period_ms);
+}
+
+int BLE_LinkMonitor_Config(uint8_t enable, uint16_t period_ms, int8_t warn_dbm)
+{
+    if (period_ms < LINK_MON_MIN_PERIOD_MS) {
+        return -1;
+    }
+
+    mon_enabled = enable ? 1U : 0U;
+    mon_period_ms = period_ms;
+    mon_warn_dbm = warn_dbm;
+
+    HW_TS_Stop(mon_timer_id);
+    if (mon_enabled) {
+        HW_TS_Start(mon_timer_id, LINK_MON_MS_TO_TICKS(mon_period_ms));
+    }
+
+    DEBUG_INFO("Link monitor: en=%d period=%dms warn=%ddBm", mon_enabled,
+               mon_period_ms, mon_warn_dbm);
+    return 0;
+}
+
+void BLE_LinkMonitor_GetConfig(uint8_t *enable, uint16_t *period_ms, int8_t *warn_dbm)
+{
+    if (enable != NULL) {
+        *enable = mon_enabled;
+    }
+    if (period_ms != NULL) {
+        *period_ms = mon_period_ms;
+    }
+    if (warn_dbm != NULL) {
+        *warn_dbm = mon_warn_dbm;
+    }
+}
+
+const BLE_LinkQuality_t* BLE_LinkMonitor_GetInfo(uint16_t conn_handle)
+{
+    uint8_t i;
+
+    if (conn_handle == 0xFFFF) {
+        return NULL;
+    }
+
+    for (i = 0; i < MAX_BLE_CONNECTIONS; i++) {
+        if (link_quality[i].conn_handle == conn_handle && link_quality[i].samples > 0U) {
+            return &link_quality[i];
+        }
+    }
+    return NULL;
+}
+
+int16_t BLE_LinkMonitor_Trend(const BLE_LinkQuality_t *q)
+{
+    if (q == NULL || q->samples < 2U) {
+        return 0;
+    }
+    return (int16_t)(q->rssi_fast_x16 - q->rssi_ewma_x16);
+}
+
+void BLE_LinkMonitor_Process(void)
+{
+    BLE_ConnectionInfo_t *link;
+    BLE_LinkQuality_t *q;
+    uint8_t rssi;
+    uint8_t n;
+    tBleStatus ret;
+
+    /* Next active slot after the one polled last */
+    for (n = 0; n < MAX_BLE_CONNECTIONS; n++) {
+        link = BLE_Connection_GetSlot(mon_next_slot);
+        q = &link_quality[mon_next_slot];
+
+        mon_next_slot++;
+        if (mon_next_slot >= MAX_BLE_CONNECTIONS) {
+            mon_next_slot = 0;
+            /* One link table check per round */
+            LinkMonitor_CheckStatus();
+        }
+
+        if (link == NULL || link->conn_handle == 0xFFFF ||
+            link->state != CONN_STATE_CONNECTED) {
+            q->conn_handle = 0xFFFF;
+            continue;
+        }
+        if (q->conn_handle != link->conn_handle) {
+            LinkMonitor_Reset(q, link->conn_handle);
+        }
+
+        ret = hci_read_rssi(link->conn_handle, &rssi);
+        if (ret != BLE_STATUS_SUCCESS) {
+            DEBUG_ERROR("Read RSSI 0x%04X failed: 0x%02X", link->conn_handle, ret);
+        } else if ((int8_t)rssi != RSSI_NOT_AVAILABLE) {
+            LinkMonitor_AddSample(q, (int8_t)rssi);
+        }
+        return;
+    }
+}
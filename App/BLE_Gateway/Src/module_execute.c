@@ -11,7 +11,22 @@
 #include "ble_device_manager.h"
 #include "ble_connection.h"
 #include "ble_gatt_client.h"
-#include "ble_event_handler.h"
+#include "ble_gatt_discovery.h"
+#include "ble_gatt_cache.h"
+#include "ble_gatt_queue.h"
+#include "ble_gatt_stream.h"
+#include "ble_gatt_readm.h"
+#include "ble_gatt_resolve.h"
+#include "ble_gatt_indicate.h"
+#include "ble_gatt_subscribe.h"
+#include "ble_l2cap_coc.h"
+#include "ble_evt_dispatch.h"
+#include "ble_event_bus.h"
+#include "ble_hci_trace.h"
+#include "ble_link_adapt.h"
+#include "ble_link_monitor.h"
+#include "ble_adv_storm.h"
+#include "seq_profile.h"
 #include "debug_trace.h"
 #include "app_conf.h"
 #include "stm32_seq.h"
@@ -19,55 +34,44 @@
 static void Module_AT_Task(void);
 
 /*============================================================================
- * GATT Event Callbacks - Forward to AT Response
+ * GATT Events - Forward to AT Response
  *============================================================================*/
 
 /**
- * @brief Callback for GATT notification received
+ * @brief Event bus subscriber: GATT results and peer data to the host
  */
-static void Module_OnNotification(uint16_t conn_handle, uint16_t handle,
-                                  const uint8_t *data, uint16_t len)
+static void Module_OnGattEvent(const BLE_EventBusEvt_t *evt)
 {
     uint16_t i;
     
-    /* Send notification data as hex string via AT response */
-    AT_Response_Send("+NOTIFICATION:0x%04X,0x%04X,", conn_handle, handle);
-    
-    for (i = 0; i < len; i++) {
-        AT_Response_Send("%02X", data[i]);
+    switch (evt->type) {
+    case EVTBUS_EVT_NOTIFICATION:
+        AT_Response_Send("+NOTIFICATION:0x%04X,0x%04X,", evt->conn_handle, evt->attr_handle);
+        break;
+    case EVTBUS_EVT_INDICATION:
+        AT_Response_Send("+INDICATION:0x%04X,0x%04X,", evt->conn_handle, evt->attr_handle);
+        break;
+    case EVTBUS_EVT_READ_RSP:
+        AT_Response_Send("+READ:0x%04X,0x%04X,", evt->conn_handle, evt->attr_handle);
+        break;
+    case EVTBUS_EVT_WRITE_RSP:
+        if (evt->status == 0) {
+            AT_Response_Send("+WRITE_DONE:0x%04X\r\n", evt->conn_handle);
+        } else {
+            AT_Response_Send("+WRITE_ERROR:0x%04X,0x%02X\r\n", evt->conn_handle, evt->status);
+        }
+        return;
+    default:
+        return;
     }
-    AT_Response_Send("\r\n");
-}
-
-/**
- * @brief Callback for GATT read response received
- */
-static void Module_OnReadResponse(uint16_t conn_handle, uint16_t handle,
-                                  const uint8_t *data, uint16_t len)
-{
-    uint16_t i;
-    
-    /* Send read data as hex string via AT response */
-    AT_Response_Send("+READ:0x%04X,0x%04X,", conn_handle, handle);
     
-    for (i = 0; i < len; i++) {
-        AT_Response_Send("%02X", data[i]);
+    /* Send data as hex string via AT response */
+    for (i = 0; i < evt->len; i++) {
+        AT_Response_Send("%02X", evt->data[i]);
     }
     AT_Response_Send("\r\n");
 }
 
-/**
- * @brief Callback for GATT write response received
- */
-static void Module_OnWriteResponse(uint16_t conn_handle, uint8_t status)
-{
-    if (status == 0) {
-        AT_Response_Send("+WRITE_DONE:0x%04X\r\n", conn_handle);
-    } else {
-        AT_Response_Send("+WRITE_ERROR:0x%04X,0x%02X\r\n", conn_handle, status);
-    }
-}
-
 /*============================================================================
  * Module Initialization
  *============================================================================*/
@@ -76,25 +80,76 @@ void module_ble_init(void)
 {
     DEBUG_INFO("=== BLE Gateway Initialization ===");
     
-    /* Initialize all modules */
+    /* Event dispatcher first: modules register their stack events in Init */
+    BLE_EvtDispatch_Init();
+    
+    /* Initialize all modules; handlers of one event run in this order. The end of a
+     * GATT procedure is the exception: the queue forwards it to discovery, cache and
+     * batched reads in a fixed order, so this sequence does not route it */
     BLE_DeviceManager_Init();
     AT_Command_Init();
     BLE_Connection_Init();
     BLE_GATT_Init();
-    BLE_EventHandler_Init();
+    BLE_GattDisc_Init();
+    BLE_GattCache_Init();
+    BLE_GattReadM_Init();
+    BLE_GattQueue_Init();
+    BLE_GattStream_Init();
+    BLE_GattResolve_Init();
+    BLE_GattInd_Init();
+    BLE_GattSub_Init();
+    BLE_L2capCoc_Init();
+    BLE_EventBus_Init();
+    BLE_HciTrace_Init();
+    BLE_LinkAdapt_Init();
+    BLE_LinkMonitor_Init();
+    BLE_AdvStorm_Init();
+    SEQ_Profile_Init();
 
     /* Register sequencer task for AT command processing */
     UTIL_SEQ_RegTask(1 << CFG_TASK_AT_CMD_PROC_ID, UTIL_SEQ_RFU, Module_AT_Task);
     
-    /* Register BLE event callbacks */
-    BLE_EventHandler_RegisterScanCallback(BLE_Connection_OnScanReport);
-    BLE_EventHandler_RegisterConnectionCallback(BLE_Connection_OnConnected);
-    BLE_EventHandler_RegisterDisconnectionCallback(BLE_Connection_OnDisconnected);
+    /* Register sequencer task for adaptive connection interval */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_LINK_ADAPT_ID, UTIL_SEQ_RFU, BLE_LinkAdapt_Process);
+    
+    /* Register sequencer task for link quality monitor */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_LINK_MONITOR_ID, UTIL_SEQ_RFU, BLE_LinkMonitor_Process);
+    
+    /* Register sequencer task for GATT queue timeouts and retries */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_GATT_QUEUE_ID, UTIL_SEQ_RFU, BLE_GattQueue_Process);
+    
+    /* Register sequencer task for Write Without Response streaming */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_GATT_STREAM_ID, UTIL_SEQ_RFU, BLE_GattStream_Process);
+    
+    /* Register sequencer task for L2CAP channel transmission */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_L2CAP_COC_ID, UTIL_SEQ_RFU, BLE_L2capCoc_Process);
+    
+    /* Register sequencer task for stack events deferred out of transport context */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_EVT_DEFER_ID, UTIL_SEQ_RFU, BLE_EvtDispatch_ProcessDeferred);
+    
+    /* Register sequencer task for advertising storm self-test injection */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_ADV_STORM_ID, UTIL_SEQ_RFU, BLE_AdvStorm_Process);
+    
+    /* Register sequencer task for indication confirm deadlines */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_GATT_IND_ID, UTIL_SEQ_RFU, BLE_GattInd_Process);
+    
+    /* Register sequencer task for GATT cache flash writes */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_GATT_CACHE_ID, UTIL_SEQ_RFU, BLE_GattCache_Process);
+    
+    /* Register sequencer task for held notifications and summary windows */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_GATT_SUB_ID, UTIL_SEQ_RFU, BLE_GattSub_Process);
+    
+    /* Register sequencer task for HCI trace export over USB CDC */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_HCI_TRACE_ID, UTIL_SEQ_RFU, BLE_HciTrace_Process);
+    
+    /* Register sequencer task for the periodic sequencer profile report */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_SEQ_REPORT_ID, UTIL_SEQ_RFU, SEQ_Profile_Process);
+    
+    /* Register sequencer task for DLE and PHY negotiation timeouts */
+    UTIL_SEQ_RegTask(1 << CFG_TASK_LINK_NEGO_ID, UTIL_SEQ_RFU, BLE_Connection_NegoProcess);
     
-    /* Register GATT event callbacks for AT response */
-    BLE_EventHandler_RegisterNotificationCallback(Module_OnNotification);
-    BLE_EventHandler_RegisterReadResponseCallback(Module_OnReadResponse);
-    BLE_EventHandler_RegisterWriteResponseCallback(Module_OnWriteResponse);
+    /* Event bus subscribers; more consumers subscribe here without touching the sources */
+    BLE_EventBus_Subscribe("host", EVTBUS_MASK_GATT, NULL, Module_OnGattEvent);
     
     DEBUG_INFO("=== BLE Gateway Ready ===");
 }
@@ -0,0 +1,199 @@
+/**
+  ******************************************************************************
+  * @file    seq_profile.c
+  * @brief   Sequencer task profile and CPU load report implementation
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "seq_profile.h"
+#include "debug_trace.h"
+#include "app_common.h"
+#include "hw_if.h"
+#include "stm32_seq.h"
+
+#define SEQ_REPORT_MS_TO_TICKS(ms)  ((uint32_t)(ms) * 1000U / CFG_TS_TICK_VAL)
+
+/* Task figures at the previous report */
+typedef struct {
+    uint32_t runs;
+    uint64_t run_cycles;
+    uint64_t wait_cycles;
+} SEQ_ProfileSnap_t;
+
+static const char * const task_names[CFG_TASK_NBR] = {
+    [CFG_TASK_START_SCAN_ID]            = "START_SCAN",
+    [CFG_TASK_CONN_DEV_1_ID]            = "CONN_DEV",
+    [CFG_TASK_SEARCH_SERVICE_ID]        = "SEARCH_SVC",
+    [CFG_TASK_CONN_UPDATE_ID]           = "CONN_UPDATE",
+    [CFG_TASK_HCI_ASYNCH_EVT_ID]        = "HCI_EVT",
+    [CFG_TASK_AT_CMD_PROC_ID]           = "AT_CMD",
+    [CFG_TASK_LINK_ADAPT_ID]            = "LINK_ADAPT",
+    [CFG_TASK_LINK_MONITOR_ID]          = "LINK_MON",
+    [CFG_TASK_GATT_QUEUE_ID]            = "GATT_QUEUE",
+    [CFG_TASK_GATT_STREAM_ID]           = "GATT_STREAM",
+    [CFG_TASK_L2CAP_COC_ID]             = "L2CAP_COC",
+    [CFG_TASK_EVT_DEFER_ID]             = "EVT_DEFER",
+    [CFG_TASK_ADV_STORM_ID]             = "ADV_STORM",
+    [CFG_TASK_GATT_IND_ID]              = "GATT_IND",
+    [CFG_TASK_SYSTEM_HCI_ASYNCH_EVT_ID] = "SYS_EVT",
+    [CFG_TASK_GATT_CACHE_ID]            = "GATT_CACHE",
+    [CFG_TASK_GATT_SUB_ID]              = "GATT_SUB",
+    [CFG_TASK_HCI_TRACE_ID]             = "HCI_TRACE",
+    [CFG_TASK_SEQ_REPORT_ID]            = "SEQ_REPORT",
+    [CFG_TASK_LINK_NEGO_ID]             = "LINK_NEGO",
+};
+
+static SEQ_ProfileSnap_t report_snap[CFG_TASK_NBR];
+static UTIL_SEQ_Load_t report_load;
+static uint16_t report_period_ms = 0;
+static uint8_t report_timer_id;
+
+/**
+ * @brief Timer callback (ISR context): defer work to sequencer
+ */
+static void SeqProfile_TimerCb(void)
+{
+    UTIL_SEQ_SetTask(1U << CFG_TASK_SEQ_REPORT_ID, CFG_SCH_PRIO_BG);
+}
+
+/**
+ * @brief Load in 0.1 %; a clear from inside a task may leave busy slightly above total
+ */
+static uint16_t SeqProfile_Permille(uint64_t busy, uint64_t total)
+{
+    if (total == 0U) {
+        return 0;
+    }
+    if (busy >= total) {
+        return 1000U;
+    }
+    return (uint16_t)(busy * 1000U / total);
+}
+
+static uint32_t SeqProfile_CyclesToUs(uint64_t cycles)
+{
+    uint32_t per_us = SystemCoreClock / 1000000U;
+
+    return (per_us > 0U) ? (uint32_t)(cycles / per_us) : 0U;
+}
+
+/**
+ * @brief Start a report interval at the current figures
+ */
+static void SeqProfile_Snapshot(void)
+{
+    const UTIL_SEQ_TaskStats_t *s;
+    uint32_t i;
+
+    for (i = 0; i < CFG_TASK_NBR; i++) {
+        s = UTIL_SEQ_GetTaskStats(i);
+        report_snap[i].runs = s->RunCount;
+        report_snap[i].run_cycles = s->RunCycles;
+        report_snap[i].wait_cycles = s->WaitCycles;
+    }
+    UTIL_SEQ_GetLoad(&report_load);
+}
+
+void SEQ_Profile_Init(void)
+{
+    report_period_ms = 0;
+    HW_TS_Create(CFG_TIM_PROC_ID_ISR, &report_timer_id, hw_ts_Repeated, SeqProfile_TimerCb);
+
+    DEBUG_INFO("Sequencer profile initialized: %s", (CFG_SEQ_PROFILE != 0) ? "on" : "off");
+}
+
+int SEQ_Profile_SetReport(uint16_t period_ms)
+{
+    if (period_ms != 0U && period_ms < SEQ_REPORT_MIN_PERIOD_MS) {
+        return -1;
+    }
+
+    report_period_ms = period_ms;
+    HW_TS_Stop(report_timer_id);
+    if (report_period_ms != 0U) {
+        SeqProfile_Snapshot();
+        HW_TS_Start(report_timer_id, SEQ_REPORT_MS_TO_TICKS(report_period_ms));
+    }
+
+    DEBUG_INFO("Sequencer report: period=%dms", report_period_ms);
+    return 0;
+}
+
+uint16_t SEQ_Profile_GetReport(void)
+{
+    return report_period_ms;
+}
+
+const char* SEQ_Profile_TaskName(uint32_t task_idx)
+{
+    if (task_idx >= CFG_TASK_NBR || task_names[task_idx] == NULL) {
+        return "-";
+    }
+    return task_names[task_idx];
+}
+
+uint16_t SEQ_Profile_GetLoad(uint32_t *busy_ms, uint32_t *total_ms)
+{
+    UTIL_SEQ_Load_t load;
+    uint32_t per_ms = SystemCoreClock / 1000U;
+
+    UTIL_SEQ_GetLoad(&load);
+    if (busy_ms != NULL) {
+        *busy_ms = (per_ms > 0U) ? (uint32_t)(load.BusyCycles / per_ms) : 0U;
+    }
+    if (total_ms != NULL) {
+        *total_ms = (per_ms > 0U) ? (uint32_t)(load.TotalCycles / per_ms) : 0U;
+    }
+    return SeqProfile_Permille(load.BusyCycles, load.TotalCycles);
+}
+
+void SEQ_Profile_Clear(void)
+{
+    /* The report interval restarts at the clear */
+    UTIL_SEQ_ClearStats();
+    SeqProfile_Snapshot();
+}
+
+void SEQ_Profile_Process(void)
+{
+    const UTIL_SEQ_TaskStats_t *s;
+    SEQ_ProfileSnap_t *snap;
+    UTIL_SEQ_Load_t load;
+    uint64_t busy;
+    uint64_t total;
+    uint32_t runs;
+    uint16_t permille;
+    uint32_t i;
+
+    if (report_period_ms == 0U) {
+        return;
+    }
+
+    UTIL_SEQ_GetLoad(&load);
+    busy = load.BusyCycles - report_load.BusyCycles;
+    total = load.TotalCycles - report_load.TotalCycles;
+    permille = SeqProfile_Permille(busy, total);
+
+    DEBUG_INFO("SEQ: load %d.%d%% over %lums", permille / 10U, permille % 10U,
+               (unsigned long)(SeqProfile_CyclesToUs(total) / 1000U));
+
+    /* Tasks that ran in the interval; max figures are since the last clear */
+    for (i = 0; i < CFG_TASK_NBR; i++) {
+        s = UTIL_SEQ_GetTaskStats(i);
+        snap = &report_snap[i];
+        runs = s->RunCount - snap->runs;
+        if (runs > 0U) {
+            DEBUG_INFO("SEQ: %-11s %5lu runs, run %lu/%luus, wait %lu/%luus",
+                       SEQ_Profile_TaskName(i), (unsigned long)runs,
+                       (unsigned long)SeqProfile_CyclesToUs((s->RunCycles - snap->run_cycles) / runs),
+                       (unsigned long)SeqProfile_CyclesToUs(s->RunMax),
+                       (unsigned long)SeqProfile_CyclesToUs((s->WaitCycles - snap->wait_cycles) / runs),
+                       (unsigned long)SeqProfile_CyclesToUs(s->WaitMax));
+        }
+        snap->runs = s->RunCount;
+        snap->run_cycles = s->RunCycles;
+        snap->wait_cycles = s->WaitCycles;
+    }
+    report_load = load;
+}
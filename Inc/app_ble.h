@@ -78,6 +78,15 @@ void APP_BLE_Init(void);
 APP_BLE_ConnStatus_t APP_BLE_Get_Client_Connection_Status(uint16_t Connection_Handle);
 
 /* USER CODE BEGIN EF */
+/**
+ * @brief  Milliseconds from reset to the end of APP_BLE_Init() (stack and services ready)
+ */
+uint32_t APP_BLE_GetReadyTime(void);
+
+/**
+ * @brief  Milliseconds spent adding the GATT server service set
+ */
+uint32_t APP_BLE_GetSvcInitTime(void);
 
 /* USER CODE END EF */
 
@@ -167,11 +167,35 @@
  */
 #define CFG_BLE_NUM_LINK            8
 
+/**
+ * GATT server service set, chosen at build time (SVCCTL_SvcInit() in app_ble.c)
+ * The gateway is a central and exposes no service by default, only the GAP and GATT services
+ * the stack adds itself. Each service enabled here adds its footprint to CFG_BLE_NUM_GATT_SERVICES,
+ * CFG_BLE_NUM_GATT_ATTRIBUTES and CFG_BLE_ATT_VALUE_ARRAY_SIZE
+ */
+#define CFG_GATT_SVC_DIS                0   /**< Device Information: manufacturer and model strings */
+
+/**
+ * Stack-added GAP and GATT services: attributes as documented below, values rounded up
+ * (device name, appearance, central address resolution, service changed with one CCCD per link,
+ * client and server supported features, database hash)
+ */
+#define CFG_GATT_BASE_SERVICES          2
+#define CFG_GATT_BASE_ATTRIBUTES        9
+#define CFG_GATT_BASE_VALUE_SIZE        160
+
+/**
+ * Device Information: 2 read-only strings, declaration and value each, 16-bit UUIDs (value + 5)
+ */
+#define CFG_GATT_DIS_STRING_LEN_MAX     20
+#define CFG_GATT_DIS_ATTRIBUTES         4
+#define CFG_GATT_DIS_VALUE_SIZE         (2 * (CFG_GATT_DIS_STRING_LEN_MAX + 5))
+
 /**
  * Maximum number of Services that can be stored in the GATT database.
  * Note that the GAP and GATT services are automatically added so this parameter should be 2 plus the number of user services
  */
-#define CFG_BLE_NUM_GATT_SERVICES   8
+#define CFG_BLE_NUM_GATT_SERVICES   (CFG_GATT_BASE_SERVICES + CFG_GATT_SVC_DIS)
 
 /**
  * Maximum number of Attributes
@@ -180,7 +204,7 @@
  * Note that certain characteristics and relative descriptors are added automatically during device initialization
  * so this parameters should be 9 plus the number of user Attributes
  */
-#define CFG_BLE_NUM_GATT_ATTRIBUTES 68
+#define CFG_BLE_NUM_GATT_ATTRIBUTES (CFG_GATT_BASE_ATTRIBUTES + (CFG_GATT_SVC_DIS * CFG_GATT_DIS_ATTRIBUTES))
 
 /**
  * Maximum supported ATT_MTU size
@@ -199,7 +223,25 @@
  *  The total amount of memory needed is the sum of the above quantities for each attribute.
  * This parameter is ignored by the CPU2 when CFG_BLE_OPTIONS has SHCI_C2_BLE_INIT_OPTIONS_LL_ONLY flag set
  */
-#define CFG_BLE_ATT_VALUE_ARRAY_SIZE    (1344)
+#define CFG_BLE_ATT_VALUE_ARRAY_SIZE    (CFG_GATT_BASE_VALUE_SIZE + (CFG_GATT_SVC_DIS * CFG_GATT_DIS_VALUE_SIZE))
+
+/**
+ * CPU2 RAM of the GATT database: with the generic configuration (8 services, 68 attributes,
+ * 1344 value bytes) and with the service set above. What the service set leaves unused is
+ * given to packet memory blocks (CFG_BLE_MBLOCK_COUNT), which buffer the notifications and
+ * read responses received as a client
+ */
+#define CFG_BLE_GATT_DB_GENERIC_SIZE    BLE_TOTAL_BUFFER_SIZE_GATT(68, 8, 1344)
+#define CFG_BLE_GATT_DB_SIZE            BLE_TOTAL_BUFFER_SIZE_GATT(CFG_BLE_NUM_GATT_ATTRIBUTES, CFG_BLE_NUM_GATT_SERVICES, CFG_BLE_ATT_VALUE_ARRAY_SIZE)
+#define CFG_BLE_GATT_DB_RECLAIMED       (CFG_BLE_GATT_DB_GENERIC_SIZE - CFG_BLE_GATT_DB_SIZE)
+
+/**
+ * GATT client long value buffers in CPU1 RAM, 512 bytes each (GATT_LONG_MAX_LEN), used by writes
+ * over 64 bytes, long reads and reliable writes. The buffers are shared by all links: each long
+ * operation holds one from enqueue to completion, and a request finding none free is refused.
+ * 4 buffers (2 KB) let half of the links run a long operation at the same time. Range 1..127
+ */
+#define CFG_GATT_LONG_BUF_NBR           4
 
 /**
  * Prepare Write List size in terms of number of packet
@@ -211,7 +253,8 @@
  * Number of allocated memory blocks
  * This parameter is overwritten by the CPU2 with an hardcoded optimal value when the parameter CFG_BLE_OPTIONS has SHCI_C2_BLE_INIT_OPTIONS_LL_ONLY flag set
  */
-#define CFG_BLE_MBLOCK_COUNT            (BLE_MBLOCKS_CALC(CFG_BLE_PREPARE_WRITE_LIST_SIZE, CFG_BLE_MAX_ATT_MTU, CFG_BLE_NUM_LINK))
+#define CFG_BLE_MBLOCK_COUNT            (BLE_MBLOCKS_CALC(CFG_BLE_PREPARE_WRITE_LIST_SIZE, CFG_BLE_MAX_ATT_MTU, CFG_BLE_NUM_LINK) + \
+                                         (CFG_BLE_GATT_DB_RECLAIMED / (BLE_MEM_BLOCK_SIZE + 8)))
 
 /**
  * Enable or disable the Extended Packet length feature. Valid values are 0 or 1.
@@ -406,6 +449,46 @@
 #define CFG_TLBLE_MOST_EVENT_PAYLOAD_SIZE 255   /**< Set to 255 with the memory manager and the mailbox */
 
 #define TL_BLE_EVENT_FRAME_SIZE ( TL_EVT_HDR_SIZE + CFG_TLBLE_MOST_EVENT_PAYLOAD_SIZE )
+
+/**
+ * Asynchronous event pool calculator
+ * CPU2 allocates each event from the pool with the size it needs. While notifications stream,
+ * each of CFG_TLBLE_POOL_LINKS links can have CFG_TLBLE_POOL_EVT_PER_LINK notification events of one
+ * ATT_MTU in flight, plus one full size event (scan report, procedure end) next to them.
+ * CFG_TLBLE_EVT_QUEUE_LENGTH full size events stay the minimum. The result is placed in MB_MEM2
+ * (RAM_SHARED, 10K) with the command and spare event buffers; the total is printed at boot and by AT+TLSTAT?
+ */
+#define CFG_TLBLE_POOL_LINKS            4   /**< Links notifying at the same time, up to CFG_BLE_NUM_LINK */
+#define CFG_TLBLE_POOL_EVT_PER_LINK     2   /**< Notifications per link queued while one is processed */
+#define CFG_TLBLE_POOL_MTU              CFG_BLE_MAX_ATT_MTU
+
+/**< ACI_GATT_NOTIFICATION_EVENT: ecode (2) + connection (2) + attribute (2) + length (1) + value (MTU - 3) */
+#define TL_BLE_NOTIFICATION_PAYLOAD_SIZE  MIN( (7U + CFG_TLBLE_POOL_MTU - 3U), CFG_TLBLE_MOST_EVENT_PAYLOAD_SIZE )
+#define TL_BLE_EVENT_BUFFER_SIZE(payload) ( 4U * DIVC( (sizeof(TL_PacketHeader_t) + TL_EVT_HDR_SIZE + (payload)), 4U ) )
+
+#define CFG_TLBLE_EVT_POOL_SIZE  MAX( (CFG_TLBLE_EVT_QUEUE_LENGTH * TL_BLE_EVENT_BUFFER_SIZE(CFG_TLBLE_MOST_EVENT_PAYLOAD_SIZE)), \
+                                      ((CFG_TLBLE_POOL_LINKS * CFG_TLBLE_POOL_EVT_PER_LINK * TL_BLE_EVENT_BUFFER_SIZE(TL_BLE_NOTIFICATION_PAYLOAD_SIZE)) + \
+                                       TL_BLE_EVENT_BUFFER_SIZE(CFG_TLBLE_MOST_EVENT_PAYLOAD_SIZE)) )
+
+/**
+ * Transport layer statistics in hci_tl.c and tl_mbox.c: event queue depths, time with the user event
+ * flow disabled and event buffer return latency, in DWT CPU cycles. Set to 0 to remove them
+ */
+#define CFG_TL_STATS                    1
+
+/**
+ * HCI/ACI packet recorder: hci_tl.c reports each command and event to hci_trace_packet(), which the
+ * gateway records in a RAM ring for btsnoop export. Recording is off until enabled with AT+HCITRACE.
+ * Set to 0 to remove the hooks
+ */
+#define CFG_HCI_TRACE                   1
+
+/**
+ * Sequencer profiling in stm32_seq.c: per task run count, run time and time from UTIL_SEQ_SetTask() to
+ * run, plus the share of time spent in tasks, in DWT CPU cycles. Read with AT+SEQSTAT, reported
+ * periodically with AT+SEQREPORT. Set to 0 to remove it
+ */
+#define CFG_SEQ_PROFILE                 1
 /******************************************************************************
  * UART interfaces
  ******************************************************************************/
@@ -642,6 +725,14 @@ typedef enum
   CFG_TASK_HCI_ASYNCH_EVT_ID,
   /* USER CODE BEGIN CFG_Task_Id_With_HCI_Cmd_t */
   CFG_TASK_AT_CMD_PROC_ID,
+  CFG_TASK_LINK_ADAPT_ID,
+  CFG_TASK_LINK_MONITOR_ID,
+  CFG_TASK_GATT_QUEUE_ID,
+  CFG_TASK_GATT_STREAM_ID,
+  CFG_TASK_L2CAP_COC_ID,
+  CFG_TASK_EVT_DEFER_ID,
+  CFG_TASK_ADV_STORM_ID,
+  CFG_TASK_GATT_IND_ID,
 
   /* USER CODE END CFG_Task_Id_With_HCI_Cmd_t */
   CFG_LAST_TASK_ID_WITH_HCICMD,                                               /**< Shall be LAST in the list */
@@ -653,6 +744,11 @@ typedef enum
   CFG_FIRST_TASK_ID_WITH_NO_HCICMD = CFG_LAST_TASK_ID_WITH_HCICMD - 1,        /**< Shall be FIRST in the list */
   CFG_TASK_SYSTEM_HCI_ASYNCH_EVT_ID,
   /* USER CODE BEGIN CFG_Task_Id_With_NO_HCI_Cmd_t */
+  CFG_TASK_GATT_CACHE_ID,
+  CFG_TASK_GATT_SUB_ID,
+  CFG_TASK_HCI_TRACE_ID,
+  CFG_TASK_SEQ_REPORT_ID,
+  CFG_TASK_LINK_NEGO_ID,
 
   /* USER CODE END CFG_Task_Id_With_NO_HCI_Cmd_t */
   CFG_LAST_TASK_ID_WITH_NO_HCICMD                                            /**< Shall be LAST in the list */
@@ -668,11 +764,32 @@ typedef enum
 {
   CFG_SCH_PRIO_0,
   /* USER CODE BEGIN CFG_SCH_Prio_Id_t */
+  CFG_SCH_PRIO_1,
+  CFG_SCH_PRIO_2,
+  CFG_SCH_PRIO_3,
 
   /* USER CODE END CFG_SCH_Prio_Id_t */
   CFG_SCH_PRIO_NBR
 } CFG_SCH_Prio_Id_t;
 
+/* USER CODE BEGIN CFG_SCH_Prio_Class */
+/**
+ * Task priority classes, highest first. The sequencer runs tasks to completion and
+ * picks the highest pending class when one returns, so the wait of a class is one
+ * task run of a lower class plus the work pending above it
+ */
+/**< Transport: HCI/system event queues (ring copy only) */
+#define CFG_SCH_PRIO_HCI                CFG_SCH_PRIO_0
+/**< Host commands: AT parser, scan start and connect requests, GATT queue timeouts, indication
+     confirm deadlines, Write Without Response stream, L2CAP TX */
+#define CFG_SCH_PRIO_HOST               CFG_SCH_PRIO_1
+/**< Output to the host: deferred stack events (notifications, scan reports), notification windows */
+#define CFG_SCH_PRIO_NOTIFY             CFG_SCH_PRIO_2
+/**< Background: link adaptation and monitor, negotiation timeouts, GATT cache flash writes, HCI trace
+     export, adv storm, sequencer profile report */
+#define CFG_SCH_PRIO_BG                 CFG_SCH_PRIO_3
+/* USER CODE END CFG_SCH_Prio_Class */
+
 /**
  * This is a bit mapping over 32bits listing all events id supported in the application
  */
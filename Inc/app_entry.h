@@ -61,6 +61,10 @@ void Init_Exti(void);
 void Init_Smps(void);
 
 /* USER CODE BEGIN EF */
+/**
+  * @brief Get the RAM linked in MB_MEM2 (event pool, command and spare event buffers)
+  */
+uint32_t APPE_GetMbMem2Size(void);
 
 /* USER CODE END EF */
 
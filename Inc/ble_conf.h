@@ -49,11 +49,23 @@
  *
  * This shall take into account all registered handlers
  * (from either the provided services or the custom services)
+ * The gateway service set (CFG_GATT_SVC_* in app_conf.h) registers its GATT events with
+ * the event dispatcher instead, so no table is needed
  */
-#define BLE_CFG_SVC_MAX_NBR_CB                                                 7
+#define BLE_CFG_SVC_MAX_NBR_CB                                                 0
 
 #define BLE_CFG_CLT_MAX_NBR_CB                                                 1
 
+/******************************************************************************
+ * Device Information Service (CFG_GATT_SVC_DIS)
+ ******************************************************************************/
+#if (CFG_GATT_SVC_DIS != 0)
+#define BLE_CFG_DIS_MANUFACTURER_NAME_STRING                                   1
+#define BLE_CFG_DIS_MODEL_NUMBER_STRING                                        1
+#define BLE_CFG_DIS_MANUFACTURER_NAME_STRING_LEN_MAX        CFG_GATT_DIS_STRING_LEN_MAX
+#define BLE_CFG_DIS_MODEL_NUMBER_STRING_LEN_MAX             CFG_GATT_DIS_STRING_LEN_MAX
+#endif
+
 /******************************************************************************
  * GAP Service - Appearance
  ******************************************************************************/
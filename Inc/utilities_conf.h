@@ -57,6 +57,8 @@ extern "C" {
 #define UTIL_SEQ_CONF_TASK_NBR                  (32)
 #define UTIL_SEQ_CONF_PRIO_NBR                  CFG_SCH_PRIO_NBR
 #define UTIL_SEQ_MEMSET8( dest, value, size )   UTILS_MEMSET8( dest, value, size )
+#define UTIL_SEQ_CONF_PROFILE                   CFG_SEQ_PROFILE
+#define UTIL_SEQ_PROFILE_CYCLES( )              (DWT->CYCCNT)
 
 #ifdef __cplusplus
 }
@@ -40,6 +40,10 @@ typedef enum
 #define HCI_TL_DEFAULT_TIMEOUT (33000)
 
 /* Private macros ------------------------------------------------------------*/
+#if (CFG_TL_STATS != 0)
+#define HCI_TL_STATS_CYCLES()  (DWT->CYCCNT)
+#endif
+
 /* Public variables ---------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /**
@@ -57,6 +61,8 @@ static tHciContext hciContext;
 static tListNode HciCmdEventQueue;
 static void (* StatusNotCallBackFunction) (HCI_TL_CmdStatus_t status);
 static volatile HCI_TL_CmdRespStatus_t CmdRspStatusFlag;
+static HCI_TL_Stats_t HciStats;
+static uint32_t HciFlowOffStart;
 
 /* Private function prototypes -----------------------------------------------*/
 static void NotifyCmdStatus(HCI_TL_CmdStatus_t hcicmdstatus);
@@ -115,6 +121,14 @@ void hci_user_evt_proc(void)
 
     if(UserEventFlow != HCI_TL_UserEventFlow_Disable)
     {
+#if (CFG_TL_STATS != 0)
+      uint32_t primask_bit;
+
+      primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+      __disable_irq();                  /**< Depth is also updated from the IPCC interrupt */
+      HciStats.AsynchQueueDepth--;
+      __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+#endif
       TL_MM_EvtDone( phcievtbuffer );
     }
     else
@@ -123,6 +137,14 @@ void hci_user_evt_proc(void)
        * put back the event in the queue
        */
       LST_insert_head ( &HciAsynchEventQueue, (tListNode *)phcievtbuffer );
+#if (CFG_TL_STATS != 0)
+      if(HciStats.UserEvtFlowOff == 0)
+      {
+        HciStats.UserEvtFlowOff = 1;
+        HciStats.FlowOffCount++;
+        HciFlowOffStart = HCI_TL_STATS_CYCLES();
+      }
+#endif
     }
   }
 
@@ -137,6 +159,21 @@ void hci_user_evt_proc(void)
 
 void hci_resume_flow( void )
 {
+#if (CFG_TL_STATS != 0)
+  uint32_t flow_off_cycles;
+
+  if(HciStats.UserEvtFlowOff != 0)
+  {
+    flow_off_cycles = HCI_TL_STATS_CYCLES() - HciFlowOffStart;
+    HciStats.FlowOffCycles += flow_off_cycles;
+    if(flow_off_cycles > HciStats.FlowOffMax)
+    {
+      HciStats.FlowOffMax = flow_off_cycles;
+    }
+    HciStats.UserEvtFlowOff = 0;
+  }
+#endif
+
   UserEventFlow = HCI_TL_UserEventFlow_Enable;
 
   /**
@@ -213,6 +250,27 @@ int hci_send_req(struct hci_request *p_cmd, uint8_t async)
   return 0;
 }
 
+const HCI_TL_Stats_t * hci_get_stats(void)
+{
+  return &HciStats;
+}
+
+void hci_clear_stats(void)
+{
+  uint32_t primask_bit;
+
+  primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+  __disable_irq();                  /**< Disable all interrupts by setting PRIMASK bit on Cortex*/
+  HciStats.AsynchEvtCount = 0;
+  HciStats.AsynchQueueMax = HciStats.AsynchQueueDepth;
+  HciStats.FlowOffCount = 0;
+  HciStats.FlowOffCycles = 0;
+  HciStats.FlowOffMax = 0;
+  __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+
+  return;
+}
+
 /* Private functions ---------------------------------------------------------*/
 static void TlInit( TL_CmdPacket_t * p_cmdbuffer )
 {
@@ -247,6 +305,10 @@ static void SendCmd(uint16_t opcode, uint8_t plen, void *param)
   pCmdBuffer->cmdserial.cmd.plen = plen;
   memcpy( pCmdBuffer->cmdserial.cmd.payload, param, plen );
 
+#if (CFG_HCI_TRACE != 0)
+  hci_trace_packet(HCI_TL_TRACE_CMD, (const uint8_t *)&pCmdBuffer->cmdserial.cmd, TL_CMD_HDR_SIZE - 1 + plen);
+#endif
+
   hciContext.io.Send(0,0);
 
   return;
@@ -274,6 +336,10 @@ static void NotifyCmdStatus(HCI_TL_CmdStatus_t hcicmdstatus)
 
 static void TlEvtReceived(TL_EvtPacket_t *hcievt)
 {
+#if (CFG_HCI_TRACE != 0)
+  hci_trace_packet(HCI_TL_TRACE_EVT, (const uint8_t *)&hcievt->evtserial.evt, TL_EVT_HDR_SIZE - 1 + hcievt->evtserial.evt.plen);
+#endif
+
   if ( ((hcievt->evtserial.evt.evtcode) == TL_BLEEVT_CS_OPCODE) || ((hcievt->evtserial.evt.evtcode) == TL_BLEEVT_CC_OPCODE ) )
   {
     LST_insert_tail(&HciCmdEventQueue, (tListNode *)hcievt);
@@ -282,6 +348,14 @@ static void TlEvtReceived(TL_EvtPacket_t *hcievt)
   else
   {
     LST_insert_tail(&HciAsynchEventQueue, (tListNode *)hcievt);
+#if (CFG_TL_STATS != 0)
+    HciStats.AsynchEvtCount++;
+    HciStats.AsynchQueueDepth++;
+    if(HciStats.AsynchQueueDepth > HciStats.AsynchQueueMax)
+    {
+      HciStats.AsynchQueueMax = HciStats.AsynchQueueDepth;
+    }
+#endif
     hci_notify_asynch_evt((void*) &HciAsynchEventQueue); /**< Notify the application a full HCI event has been received */
   }
 
@@ -306,3 +380,12 @@ __WEAK void hci_cmd_resp_release(uint32_t flag)
 
   return;
 }
+
+__WEAK void hci_trace_packet(HCI_TL_TraceType_t type, const uint8_t *p_pckt, uint16_t len)
+{
+  (void)type;
+  (void)p_pckt;
+  (void)len;
+
+  return;
+}
@@ -82,6 +82,30 @@ typedef struct
   void (* StatusNotCallBack) (HCI_TL_CmdStatus_t status);
 } HCI_TL_HciInitConf_t;
 
+/**
+ * @brief Asynchronous event queue statistics, filled when CFG_TL_STATS is set
+ *        (times in DWT CPU cycles)
+ */
+typedef struct
+{
+  uint32_t AsynchEvtCount;    /**< Asynchronous events received */
+  uint8_t  AsynchQueueDepth;  /**< Events in HciAsynchEventQueue, the one being processed included */
+  uint8_t  AsynchQueueMax;    /**< High-water mark of AsynchQueueDepth */
+  uint8_t  UserEvtFlowOff;    /**< UserEventFlow currently disabled */
+  uint32_t FlowOffCount;      /**< Times UserEventFlow was disabled */
+  uint64_t FlowOffCycles;     /**< Disabled until hci_resume_flow(), completed periods */
+  uint32_t FlowOffMax;
+} HCI_TL_Stats_t;
+
+/**
+ * @brief Packet direction reported to hci_trace_packet()
+ */
+typedef enum
+{
+  HCI_TL_TRACE_CMD,           /**< ACI/HCI command sent to CPU2 */
+  HCI_TL_TRACE_EVT,           /**< ACI/HCI event received from CPU2 */
+} HCI_TL_TraceType_t;
+
 /**
  * @brief  Register IO bus services.
  * @param  fops The HCI IO structure managing the IO BUS
@@ -137,6 +161,19 @@ void hci_cmd_resp_wait(uint32_t timeout);
  */
 void hci_cmd_resp_release(uint32_t flag);
 
+/**
+ * @brief  This function is called for each ACI/HCI command sent to the CPU2 and each event received,
+ *         when CFG_HCI_TRACE is set.
+ *         Commands are reported from the context they are sent from, events from the IPCC RX interrupt.
+ *         A weak empty implementation is available in hci_tl.c
+ *
+ * @param  type: Command or event
+ * @param  p_pckt: Packet without the packet type byte (opcode or event code first)
+ * @param  len: Packet length
+ * @retval None
+ */
+void hci_trace_packet(HCI_TL_TraceType_t type, const uint8_t *p_pckt, uint16_t len);
+
 
 
 /**
@@ -184,6 +221,22 @@ void hci_user_evt_proc(void);
  */
 void hci_init(void(* UserEvtRx)(void* pData), void* pConf);
 
+/**
+ * @brief  Get the asynchronous event queue statistics
+ *
+ * @param  None
+ * @retval Statistics
+ */
+const HCI_TL_Stats_t * hci_get_stats(void);
+
+/**
+ * @brief  Reset the asynchronous event queue statistics (current depth and flow state are kept)
+ *
+ * @param  None
+ * @retval None
+ */
+void hci_clear_stats(void);
+
 /**
  * END OF SECTION - INTERFACES USED BY THE BLE DRIVER
  *********************************************************************************************************************
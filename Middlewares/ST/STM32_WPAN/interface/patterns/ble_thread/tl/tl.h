@@ -181,6 +181,20 @@ typedef struct
   uint32_t TracesEvtPoolSize;
 } TL_MM_Config_t;
 
+/**
+ * Event buffer statistics, filled when CFG_TL_STATS is set (times in DWT CPU cycles)
+ */
+typedef struct
+{
+  uint32_t PoolSize;          /**< Asynchronous event pool given to CPU2, in bytes */
+  uint8_t  Held;              /**< Event buffers received and not yet returned to CPU2 */
+  uint8_t  HeldMax;           /**< High-water mark of Held */
+  uint8_t  LocalFreeMax;      /**< High-water mark of buffers waiting for the release channel */
+  uint32_t Returned;          /**< Timed event buffers returned to CPU2 */
+  uint64_t ReturnCycles;      /**< Receive to return, all timed buffers */
+  uint32_t ReturnMax;
+} TL_MM_Stats_t;
+
 typedef struct
 {
   uint8_t *p_ThreadOtCmdRspBuffer;
@@ -337,6 +351,8 @@ void TL_BLE_LLD_SendRspAck( void );
  ******************************************************************************/
 void TL_MM_Init( TL_MM_Config_t *p_Config );
 void TL_MM_EvtDone( TL_EvtPacket_t * hcievt );
+const TL_MM_Stats_t * TL_MM_GetStats( void );
+void TL_MM_ClearStats( void );
 
 /******************************************************************************
  * TRACES
@@ -38,7 +38,15 @@ typedef enum
 } TL_MB_PacketType_t;
 
 /* Private defines -----------------------------------------------------------*/
+/**
+ * Event buffers timed from reception to return at the same time
+ */
+#define TL_MM_STATS_SLOTS  16
+
 /* Private macros ------------------------------------------------------------*/
+#if (CFG_TL_STATS != 0)
+#define TL_MM_STATS_CYCLES()  (DWT->CYCCNT)
+#endif
 /* Private variables ---------------------------------------------------------*/
 
 /**< reference table */
@@ -68,11 +76,21 @@ static void (* BLE_IoBusAclDataTxAck) ( void );
 static void (* SYS_CMD_IoBusCallBackFunction) (TL_EvtPacket_t *phcievt);
 static void (* SYS_EVT_IoBusCallBackFunction) (TL_EvtPacket_t *phcievt);
 
+static TL_MM_Stats_t MM_Stats;
+#if (CFG_TL_STATS != 0)
+static TL_EvtPacket_t * MM_StatsBuffer[TL_MM_STATS_SLOTS];
+static uint32_t MM_StatsStamp[TL_MM_STATS_SLOTS];
+static uint8_t MM_LocalFree;
+#endif
 
 /* Global variables ----------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 static void SendFreeBuf( void );
 static void OutputDbgTrace(TL_MB_PacketType_t packet_type, uint8_t* buffer);
+#if (CFG_TL_STATS != 0)
+static void MM_StatsReceived(TL_EvtPacket_t * p_evt);
+static void MM_StatsReturned(TL_EvtPacket_t * p_evt);
+#endif
 
 /* Public Functions Definition ------------------------------------------------------*/
 
@@ -159,6 +177,9 @@ void HW_IPCC_BLE_RxEvtNot(void)
     else
     {
       OutputDbgTrace(TL_MB_BLE_ASYNCH_EVT, (uint8_t*)phcievt);
+#if (CFG_TL_STATS != 0)
+      MM_StatsReceived(phcievt);
+#endif
     }
 
     BLE_IoBusEvtCallBackFunction(phcievt);
@@ -240,6 +261,9 @@ void HW_IPCC_SYS_EvtNot( void )
     LST_remove_head (&SystemEvtQueue, (tListNode **)&p_evt);
 
     OutputDbgTrace(TL_MB_SYS_ASYNCH_EVT, (uint8_t*)p_evt );
+#if (CFG_TL_STATS != 0)
+    MM_StatsReceived(p_evt);
+#endif
 
     SYS_EVT_IoBusCallBackFunction( p_evt );
   }
@@ -605,12 +629,33 @@ void TL_MM_Init( TL_MM_Config_t *p_Config )
   p_mem_manager_table->traces_evt_pool = p_Config->p_TracesEvtPool;
   p_mem_manager_table->tracespoolsize = p_Config->TracesEvtPoolSize;
 
+  MM_Stats.PoolSize = p_Config->AsynchEvtPoolSize;
+#if (CFG_TL_STATS != 0)
+  /**< Free-running CPU cycle counter for the statistics */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
   return;
 }
 
 void TL_MM_EvtDone(TL_EvtPacket_t * phcievt)
 {
   LST_insert_tail(&LocalFreeBufQueue, (tListNode *)phcievt);
+#if (CFG_TL_STATS != 0)
+  {
+    uint32_t primask_bit;
+
+    primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+    __disable_irq();                  /**< SendFreeBuf() may run from the IPCC interrupt */
+    MM_LocalFree++;
+    if(MM_LocalFree > MM_Stats.LocalFreeMax)
+    {
+      MM_Stats.LocalFreeMax = MM_LocalFree;
+    }
+    __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+  }
+#endif
 
   OutputDbgTrace(TL_MB_MM_RELEASE_BUFFER, (uint8_t*)phcievt);
 
@@ -627,11 +672,105 @@ static void SendFreeBuf( void )
   {
     LST_remove_head( &LocalFreeBufQueue, (tListNode **)&p_node );
     LST_insert_tail( (tListNode*)(TL_RefTable.p_mem_manager_table->pevt_free_buffer_queue), p_node );
+#if (CFG_TL_STATS != 0)
+    MM_StatsReturned((TL_EvtPacket_t *)p_node);
+#endif
   }
 
   return;
 }
 
+const TL_MM_Stats_t * TL_MM_GetStats( void )
+{
+  return &MM_Stats;
+}
+
+void TL_MM_ClearStats( void )
+{
+  uint32_t primask_bit;
+
+  primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+  __disable_irq();                  /**< Disable all interrupts by setting PRIMASK bit on Cortex*/
+  MM_Stats.HeldMax = MM_Stats.Held;
+  MM_Stats.LocalFreeMax = 0;
+  MM_Stats.Returned = 0;
+  MM_Stats.ReturnCycles = 0;
+  MM_Stats.ReturnMax = 0;
+  __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+
+  return;
+}
+
+#if (CFG_TL_STATS != 0)
+/**
+ * An event buffer is handed to CPU1: remember when, to time its return
+ */
+static void MM_StatsReceived(TL_EvtPacket_t * p_evt)
+{
+  uint32_t primask_bit;
+  uint8_t slot;
+
+  primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+  __disable_irq();                  /**< BLE and system channels use different interrupts */
+  MM_Stats.Held++;
+  if(MM_Stats.Held > MM_Stats.HeldMax)
+  {
+    MM_Stats.HeldMax = MM_Stats.Held;
+  }
+  for(slot = 0; slot < TL_MM_STATS_SLOTS; slot++)
+  {
+    if(MM_StatsBuffer[slot] == 0)
+    {
+      MM_StatsBuffer[slot] = p_evt;
+      MM_StatsStamp[slot] = TL_MM_STATS_CYCLES();
+      break;
+    }
+  }
+  __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+
+  return;
+}
+
+/**
+ * An event buffer is back in the CPU2 free buffer queue
+ */
+static void MM_StatsReturned(TL_EvtPacket_t * p_evt)
+{
+  uint32_t primask_bit;
+  uint32_t return_cycles;
+  uint8_t slot;
+
+  primask_bit = __get_PRIMASK();  /**< backup PRIMASK bit */
+  __disable_irq();                  /**< Disable all interrupts by setting PRIMASK bit on Cortex*/
+  if(MM_Stats.Held != 0)
+  {
+    MM_Stats.Held--;
+  }
+  if(MM_LocalFree != 0)
+  {
+    MM_LocalFree--;
+  }
+  for(slot = 0; slot < TL_MM_STATS_SLOTS; slot++)
+  {
+    if(MM_StatsBuffer[slot] == p_evt)
+    {
+      return_cycles = TL_MM_STATS_CYCLES() - MM_StatsStamp[slot];
+      MM_StatsBuffer[slot] = 0;
+      MM_Stats.Returned++;
+      MM_Stats.ReturnCycles += return_cycles;
+      if(return_cycles > MM_Stats.ReturnMax)
+      {
+        MM_Stats.ReturnMax = return_cycles;
+      }
+      break;
+    }
+  }
+  __set_PRIMASK(primask_bit);     /**< Restore PRIMASK bit*/
+
+  return;
+}
+#endif
+
 /******************************************************************************
  * TRACES
  ******************************************************************************/
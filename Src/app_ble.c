@@ -39,7 +39,8 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "ble_connection.h"
-#include "ble_event_handler.h"
+#include "ble_event_bus.h"
+#include "ble_evt_dispatch.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -155,18 +156,6 @@ typedef struct
   uint8_t DeviceServerFound;
 } BleApplicationContext_t;
 
-#if OOB_DEMO != 0
-typedef struct
-{
-  uint8_t Identifier;
-  uint16_t L2CAP_Length;
-  uint16_t Interval_Min;
-  uint16_t Interval_Max;
-  uint16_t Latency;
-  uint16_t Timeout_Multiplier;
-} APP_BLE_p2p_Conn_Update_req_t;
-#endif
-
 /* USER CODE BEGIN PTD */
 
 /* USER CODE END PTD */
@@ -215,14 +204,11 @@ P2PC_APP_ConnHandle_Not_evt_t handleNotification;
 
 static BleApplicationContext_t BleApplicationContext;
 
-#if OOB_DEMO != 0
-APP_BLE_p2p_Conn_Update_req_t APP_BLE_p2p_Conn_Update_req;
-#endif
-
 extern RNG_HandleTypeDef hrng;
 
 /* USER CODE BEGIN PV */
-
+static uint32_t BleReadyTick;
+static uint32_t BleSvcInitTicks;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -236,6 +222,10 @@ static void Connect_Request(void);
 static void Switch_OFF_GPIO(void);
 
 /* USER CODE BEGIN PFP */
+static void Ble_EvtGapProcComplete(void *evt);
+static void Ble_EvtDisconnComplete(void *evt);
+static void Ble_EvtConnComplete(void *evt);
+static void Ble_EvtAdvReport(void *evt);
 
 /* USER CODE END PFP */
 
@@ -350,13 +340,25 @@ void APP_BLE_Init(void)
   }
   APP_DBG_MSG("\n");
 #endif
+  /**
+   * Legacy P2P client context, kept up to date through the event dispatcher
+   * after the BLE Gateway handlers registered in module_ble_init()
+   */
+  BLE_EvtDispatch_Register(HCI_DISCONNECTION_COMPLETE_EVT_CODE, 0, Ble_EvtDisconnComplete);
+  BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE, Ble_EvtConnComplete);
+  BLE_EvtDispatch_Register(HCI_LE_META_EVT_CODE, HCI_LE_ADVERTISING_REPORT_SUBEVT_CODE, Ble_EvtAdvReport);
+  BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ACI_GAP_PROC_COMPLETE_VSEVT_CODE, Ble_EvtGapProcComplete);
+
   /**
    * Initialize P2P Client Application
    */
   P2PC_APP_Init();
 
   /* USER CODE BEGIN APP_BLE_Init_3 */
-
+  BleReadyTick = HAL_GetTick();
+  APP_DBG_MSG("BLE ready %lu ms after reset (services %lu ms), GATT database %u bytes, %u reclaimed\n",
+              (unsigned long)BleReadyTick, (unsigned long)BleSvcInitTicks,
+              (unsigned int)CFG_BLE_GATT_DB_SIZE, (unsigned int)CFG_BLE_GATT_DB_RECLAIMED);
   /* USER CODE END APP_BLE_Init_3 */
 
 #if (OOB_DEMO != 0)
@@ -367,7 +369,7 @@ void APP_BLE_Init(void)
   /**
    * Start scanning
    */
-  UTIL_SEQ_SetTask(1 << CFG_TASK_START_SCAN_ID, CFG_SCH_PRIO_0);
+  UTIL_SEQ_SetTask(1 << CFG_TASK_START_SCAN_ID, CFG_SCH_PRIO_HOST);
 #endif
   /* USER CODE BEGIN APP_BLE_Init_2 */
 
@@ -377,353 +379,9 @@ void APP_BLE_Init(void)
 
 SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification(void *pckt)
 {
-  hci_event_pckt *event_pckt;
-  evt_le_meta_event *meta_evt;
-  hci_le_connection_complete_event_rp0 *connection_complete_event;
-  evt_blecore_aci *blecore_evt;
-  hci_le_advertising_report_event_rp0 *le_advertising_event;
-  event_pckt = (hci_event_pckt *)((hci_uart_pckt *)pckt)->data;
-  hci_disconnection_complete_event_rp0 *cc = (void *)event_pckt->data;
-  uint8_t result;
-  uint8_t event_type, event_data_size;
-  int k = 0;
-  uint8_t adtype, adlength;
-#if (OOB_DEMO != 0)
-  tBleStatus ret = BLE_STATUS_INVALID_PARAMS;
-#endif
-
-  switch (event_pckt->evt)
-  {
-  /* USER CODE BEGIN evt */
-  /* USER CODE END evt */
-  case HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE:
-  {
-    handleNotification.P2P_Evt_Opcode = PEER_DISCON_HANDLE_EVT;
-    blecore_evt = (evt_blecore_aci *)event_pckt->data;
-    /* USER CODE BEGIN EVT_VENDOR */
-
-    /* USER CODE END EVT_VENDOR */
-    switch (blecore_evt->ecode)
-    {
-      /* USER CODE BEGIN ecode */
-
-      /* USER CODE END ecode */
-
-    case ACI_GAP_PROC_COMPLETE_VSEVT_CODE:
-    {
-      /* USER CODE BEGIN EVT_BLUE_GAP_PROCEDURE_COMPLETE */
-
-      /* USER CODE END EVT_BLUE_GAP_PROCEDURE_COMPLETE */
-      aci_gap_proc_complete_event_rp0 *gap_evt_proc_complete = (void *)blecore_evt->data;
-      /* CHECK GAP GENERAL DISCOVERY PROCEDURE COMPLETED & SUCCEED */
-      if (gap_evt_proc_complete->Procedure_Code == GAP_GENERAL_DISCOVERY_PROC && gap_evt_proc_complete->Status == 0x00)
-      {
-        /* USER CODE BEGIN GAP_GENERAL_DISCOVERY_PROC */
-
-        /* USER CODE END GAP_GENERAL_DISCOVERY_PROC */
-        APP_DBG_MSG("-- GAP GENERAL DISCOVERY PROCEDURE_COMPLETED\n\r");
-        /*if a device found, connect to it, device 1 being chosen first if both found*/
-        if (BleApplicationContext.DeviceServerFound == 0x01 && BleApplicationContext.Device_Connection_Status != APP_BLE_CONNECTED_CLIENT)
-        {
-          UTIL_SEQ_SetTask(1 << CFG_TASK_CONN_DEV_1_ID, CFG_SCH_PRIO_0);
-        }
-      }
-    }
-    break;
-
-#if (OOB_DEMO != 0)
-    case ACI_L2CAP_CONNECTION_UPDATE_REQ_VSEVT_CODE:
-    {
-      /* USER CODE BEGIN EVT_BLUE_L2CAP_CONNECTION_UPDATE_REQ */
-
-      /* USER CODE END EVT_BLUE_L2CAP_CONNECTION_UPDATE_REQ */
-      aci_l2cap_connection_update_req_event_rp0 *pr = (aci_l2cap_connection_update_req_event_rp0 *)blecore_evt->data;
-      ret = aci_hal_set_radio_activity_mask(0x0000);
-      if (ret != BLE_STATUS_SUCCESS)
-      {
-        APP_DBG_MSG("  Fail   : aci_hal_set_radio_activity_mask command, result: 0x%x \n\r", ret);
-      }
-      else
-      {
-        APP_DBG_MSG("  Success: aci_hal_set_radio_activity_mask command\n\r");
-      }
-
-      APP_BLE_p2p_Conn_Update_req.Identifier = pr->Identifier;
-      APP_BLE_p2p_Conn_Update_req.L2CAP_Length = pr->L2CAP_Length;
-      APP_BLE_p2p_Conn_Update_req.Interval_Min = pr->Interval_Min;
-      APP_BLE_p2p_Conn_Update_req.Interval_Max = pr->Interval_Max;
-      APP_BLE_p2p_Conn_Update_req.Latency = pr->Latency;
-      APP_BLE_p2p_Conn_Update_req.Timeout_Multiplier = pr->Timeout_Multiplier;
-
-      ret = aci_l2cap_connection_parameter_update_resp(BleApplicationContext.BleApplicationContext_legacy.connectionHandle,
-                                                       APP_BLE_p2p_Conn_Update_req.Interval_Min,
-                                                       APP_BLE_p2p_Conn_Update_req.Interval_Max,
-                                                       APP_BLE_p2p_Conn_Update_req.Latency,
-                                                       APP_BLE_p2p_Conn_Update_req.Timeout_Multiplier,
-                                                       CONN_L1,
-                                                       CONN_L2,
-                                                       APP_BLE_p2p_Conn_Update_req.Identifier,
-                                                       0x01);
-      if (ret != BLE_STATUS_SUCCESS)
-      {
-        APP_DBG_MSG("  Fail   : aci_l2cap_connection_parameter_update_resp command, result: 0x%x \n\r", ret);
-        /* USER CODE BEGIN BLE_STATUS_SUCCESS */
-
-        /* USER CODE END BLE_STATUS_SUCCESS */
-      }
-      else
-      {
-        APP_DBG_MSG("  Success: aci_l2cap_connection_parameter_update_resp command\n\r");
-      }
-
-      ret = aci_hal_set_radio_activity_mask(0x0020);
-      if (ret != BLE_STATUS_SUCCESS)
-      {
-        APP_DBG_MSG("  Fail   : aci_hal_set_radio_activity_mask command, result: 0x%x \n\r", ret);
-      }
-      else
-      {
-        APP_DBG_MSG("  Success: aci_hal_set_radio_activity_mask command\n\r");
-      }
-    }
-    break;
-
-    case ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE:
-    {
-      /* USER CODE BEGIN RADIO_ACTIVITY_EVENT */
-
-      /* USER CODE END RADIO_ACTIVITY_EVENT */
-    }
-    break; /* ACI_HAL_END_OF_RADIO_ACTIVITY_VSEVT_CODE */
-#endif
-
-      /* USER CODE BEGIN BLUE_EVT */
-
-      /* USER CODE END BLUE_EVT */
-
-    default:
-      /* USER CODE BEGIN ecode_default */
-
-      /* USER CODE END ecode_default */
-      break;
-    }
-  }
-  break;
-
-  case HCI_DISCONNECTION_COMPLETE_EVT_CODE:
-  {
-    /* USER CODE BEGIN EVT_DISCONN_COMPLETE */
-    BLE_Connection_OnDisconnected(cc->Connection_Handle, cc->Reason);
-    /* USER CODE END EVT_DISCONN_COMPLETE */
-    if (cc->Connection_Handle == BleApplicationContext.BleApplicationContext_legacy.connectionHandle)
-    {
-      BleApplicationContext.BleApplicationContext_legacy.connectionHandle = 0;
-      BleApplicationContext.Device_Connection_Status = APP_BLE_IDLE;
-      APP_DBG_MSG("\r\n\r** DISCONNECTION EVENT WITH SERVER \n\r");
-      handleNotification.P2P_Evt_Opcode = PEER_DISCON_HANDLE_EVT;
-      handleNotification.ConnectionHandle = BleApplicationContext.BleApplicationContext_legacy.connectionHandle;
-      P2PC_APP_Notification(&handleNotification);
-    }
-  }
-  break; /* HCI_DISCONNECTION_COMPLETE_EVT_CODE */
-
-  case HCI_LE_META_EVT_CODE:
-  {
-    /* USER CODE BEGIN EVT_LE_META_EVENT */
-
-    /* USER CODE END EVT_LE_META_EVENT */
-    meta_evt = (evt_le_meta_event *)event_pckt->data;
-
-    switch (meta_evt->subevent)
-    {
-      /* USER CODE BEGIN subevent */
-
-      /* USER CODE END subevent */
-
-    case HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE:
-      /* USER CODE BEGIN EVT_LE_CONN_COMPLETE */
-      {
-        /* Forward to BLE Gateway */
-        hci_le_connection_complete_event_rp0 *conn_evt = (hci_le_connection_complete_event_rp0 *)meta_evt->data;
-        BLE_Connection_OnConnected(conn_evt->Peer_Address, conn_evt->Connection_Handle, conn_evt->Status);
-      }
-      /* USER CODE END EVT_LE_CONN_COMPLETE */
-      /**
-       * The connection is done,
-       */
-      connection_complete_event = (hci_le_connection_complete_event_rp0 *)meta_evt->data;
-      BleApplicationContext.BleApplicationContext_legacy.connectionHandle = connection_complete_event->Connection_Handle;
-      BleApplicationContext.Device_Connection_Status = APP_BLE_CONNECTED_CLIENT;
-
-      /* CONNECTION WITH CLIENT */
-      APP_DBG_MSG("\r\n\r**  CONNECTION COMPLETE EVENT WITH SERVER \n\r");
-      handleNotification.P2P_Evt_Opcode = PEER_CONN_HANDLE_EVT;
-      handleNotification.ConnectionHandle = BleApplicationContext.BleApplicationContext_legacy.connectionHandle;
-      P2PC_APP_Notification(&handleNotification);
-
-      result = aci_gatt_disc_all_primary_services(BleApplicationContext.BleApplicationContext_legacy.connectionHandle);
-      if (result == BLE_STATUS_SUCCESS)
-      {
-        APP_DBG_MSG("\r\n\r** GATT SERVICES & CHARACTERISTICS DISCOVERY  \n\r");
-        APP_DBG_MSG("* GATT :  Start Searching Primary Services \r\n\r");
-      }
-      else
-      {
-        APP_DBG_MSG("BLE_CTRL_App_Notification(), All services discovery Failed \r\n\r");
-      }
-      break; /* HCI_LE_CONNECTION_COMPLETE_SUBEVT_CODE */
-
-    case HCI_LE_ADVERTISING_REPORT_SUBEVT_CODE:
-    {
-      uint8_t *adv_report_data;
-      uint8_t ad_length, ad_type;
-      
-      /* USER CODE BEGIN EVT_LE_ADVERTISING_REPORT - Forward scan report to BLE Gateway */
-      int8_t rssi;
-      char device_name[32] = {0}; /* Buffer for extracted name */
-      uint8_t name_found = 0;
-      uint8_t addr_type;
-
-      le_advertising_event = (hci_le_advertising_report_event_rp0 *)meta_evt->data;
-
-      /* Extract basic info */
-      event_type = le_advertising_event->Advertising_Report[0].Event_Type;
-      event_data_size = le_advertising_event->Advertising_Report[0].Length_Data;
-      addr_type = le_advertising_event->Advertising_Report[0].Address_Type;
-
-      /* Calculate pointers */
-      adv_report_data = (uint8_t *)(&le_advertising_event->Advertising_Report[0].Length_Data) + 1;
-      rssi = (int8_t)adv_report_data[event_data_size];
-
-      /* Parse advertising data for device name (AD Type 0x08 or 0x09) */
-      uint8_t i = 0;
-      while (i < event_data_size && !name_found)
-      {
-        uint8_t length = adv_report_data[i];
-        if (length == 0)
-          break;
-
-        uint8_t type = adv_report_data[i + 1];
-        /* 0x08 = Shortened Local Name, 0x09 = Complete Local Name */
-        if (type == 0x08 || type == 0x09)
-        {
-          uint8_t name_len = length - 1; /* Exclude type byte */
-          if (name_len > 31)
-            name_len = 31;
-          memcpy(device_name, &adv_report_data[i + 2], name_len);
-          device_name[name_len] = '\0';
-          name_found = 1;
-        }
-        i += (length + 1);
-      }
-
-      /* Forward to BLE Gateway with all parameters */
-      BLE_Connection_OnScanReport(
-          le_advertising_event->Advertising_Report[0].Address,
-          rssi,
-          name_found ? device_name : NULL,
-          addr_type);
-      /* USER CODE END EVT_LE_ADVERTISING_REPORT */
-
-      /* Rest of original code for P2P server detection */
-      le_advertising_event = (hci_le_advertising_report_event_rp0 *)meta_evt->data;
-      event_type = le_advertising_event->Advertising_Report[0].Event_Type;
-      event_data_size = le_advertising_event->Advertising_Report[0].Length_Data;
-
-      /* WARNING be careful when decoding advertising report... */
-      /* RSSI */
-      adv_report_data = (uint8_t *)(&le_advertising_event->Advertising_Report[0].Length_Data) + 1;
-      k = 0;
-
-      /* search AD TYPE 0x09 (Complete Local Name) */
-      /* search AD Type 0x02 (16 bits UUIDS) */
-      if (event_type == ADV_IND)
-      {
-        /* ISOLATION OF BD ADDRESS AND LOCAL NAME */
-        while (k < event_data_size)
-        {
-          ad_length = adv_report_data[k];
-          ad_type = adv_report_data[k + 1];
-          switch (ad_type)
-          {
-          case AD_TYPE_FLAGS: /* now get flags */
-            /* USER CODE BEGIN AD_TYPE_FLAGS */
-            /* USER CODE END AD_TYPE_FLAGS */
-            break;
-
-          case AD_TYPE_TX_POWER_LEVEL: /* Tx power level */
-            /* USER CODE BEGIN AD_TYPE_TX_POWER_LEVEL */
-            /* USER CODE END AD_TYPE_TX_POWER_LEVEL */
-            break;
-
-          case AD_TYPE_MANUFACTURER_SPECIFIC_DATA: /* Manufacturer Specific */
-            /* USER CODE BEGIN AD_TYPE_MANUFACTURER_SPECIFIC_DATA */
-            /* USER CODE END AD_TYPE_MANUFACTURER_SPECIFIC_DATA */
-            if (ad_length >= 7 && adv_report_data[k + 2] == 0x01)
-            { /* ST VERSION ID 01 */
-              APP_DBG_MSG("--- ST MANUFACTURER ID --- \n\r");
-              switch (adv_report_data[k + 3])
-              {                            /* Demo ID */
-              case CFG_DEV_ID_P2P_SERVER1: /* (End Device 1) */
-                APP_DBG_MSG("-- SERVER DETECTED -- VIA MAN ID\n\r");
-                BleApplicationContext.DeviceServerFound = 0x01;
-                SERVER_REMOTE_ADDR_TYPE = le_advertising_event->Advertising_Report[0].Address_Type;
-                SERVER_REMOTE_BDADDR[0] = le_advertising_event->Advertising_Report[0].Address[0];
-                SERVER_REMOTE_BDADDR[1] = le_advertising_event->Advertising_Report[0].Address[1];
-                SERVER_REMOTE_BDADDR[2] = le_advertising_event->Advertising_Report[0].Address[2];
-                SERVER_REMOTE_BDADDR[3] = le_advertising_event->Advertising_Report[0].Address[3];
-                SERVER_REMOTE_BDADDR[4] = le_advertising_event->Advertising_Report[0].Address[4];
-                SERVER_REMOTE_BDADDR[5] = le_advertising_event->Advertising_Report[0].Address[5];
-                break;
-
-              default:
-                break;
-              }
-            }
-            break;
-
-          case AD_TYPE_SERVICE_DATA: /* service data 16 bits */
-            /* USER CODE BEGIN AD_TYPE_SERVICE_DATA */
-            /* USER CODE END AD_TYPE_SERVICE_DATA */
-            break;
-
-          default:
-            /* USER CODE BEGIN ad_type_default */
-            /* USER CODE END ad_type_default */
-            break;
-          } /* end switch ad_type */
-          k += ad_length + 1;
-        } /* end while */
-      } /* end if ADV_IND */
-
-      /* USER CODE BEGIN EVT_LE_ADVERTISING_REPORT_2 */
-      /* USER CODE END EVT_LE_ADVERTISING_REPORT_2 */
-    }
-    break;
-
-      /* USER CODE BEGIN META_EVT */
-
-      /* USER CODE END META_EVT */
-
-    default:
-      /* USER CODE BEGIN subevent_default */
-
-      /* USER CODE END subevent_default */
-      break;
-    }
-  }
-  break; /* HCI_LE_META_EVT_CODE */
-
-    /* USER CODE BEGIN EVENT_PCKT */
-
-    /* USER CODE END EVENT_PCKT */
-
-  default:
-    /* USER CODE BEGIN evt_default */
-
-    /* USER CODE END evt_default */
-    break;
-  }
+  /* Events are routed per key by the BLE Gateway dispatcher (ble_evt_dispatch.c),
+   * which replaces SVCCTL_UserEvtRx: nothing reaches this function any more */
+  (void)pckt;
 
   return (SVCCTL_UserEvtFlowEnable);
 }
@@ -737,7 +395,46 @@ APP_BLE_ConnStatus_t APP_BLE_Get_Client_Connection_Status(uint16_t Connection_Ha
   return APP_BLE_IDLE;
 }
 /* USER CODE BEGIN FD */
+/**
+ * @brief  Gateway GATT server service set, replaces the weak svc_ctl.c version
+ *         that adds every ST service
+ * @note   Services are chosen with CFG_GATT_SVC_* in app_conf.h. A service that
+ *         handles GATT events registers them with BLE_EvtDispatch_Register():
+ *         the svc_ctl handler tables are not used
+ */
+void SVCCTL_SvcInit(void)
+{
+  uint32_t start;
+#if (CFG_GATT_SVC_DIS != 0)
+  static const char manufacturer[] = "STMicroelectronics";
+  static const char model[] = "WB55 BLE Gateway";
+  DIS_Data_t dis_data;
+#endif /* CFG_GATT_SVC_DIS != 0 */
+
+  start = HAL_GetTick();
+#if (CFG_GATT_SVC_DIS != 0)
+  DIS_Init();
+  dis_data.pPayload = (uint8_t *)manufacturer;
+  dis_data.Length = sizeof(manufacturer) - 1;
+  DIS_UpdateChar(MANUFACTURER_NAME_UUID, &dis_data);
+  dis_data.pPayload = (uint8_t *)model;
+  dis_data.Length = sizeof(model) - 1;
+  DIS_UpdateChar(MODEL_NUMBER_UUID, &dis_data);
+#endif /* CFG_GATT_SVC_DIS != 0 */
+
+  BleSvcInitTicks = HAL_GetTick() - start;
+  return;
+}
 
+uint32_t APP_BLE_GetReadyTime(void)
+{
+  return BleReadyTick;
+}
+
+uint32_t APP_BLE_GetSvcInitTime(void)
+{
+  return BleSvcInitTicks;
+}
 /* USER CODE END FD */
 /*************************************************************
  *
@@ -1101,7 +798,95 @@ const uint8_t *BleGetBdAddress(void)
 }
 
 /* USER CODE BEGIN FD_LOCAL_FUNCTIONS */
+static void Ble_EvtGapProcComplete(void *evt)
+{
+  aci_gap_proc_complete_event_rp0 *gap_evt_proc_complete = evt;
+
+  /* CHECK GAP GENERAL DISCOVERY PROCEDURE COMPLETED & SUCCEED */
+  if (gap_evt_proc_complete->Procedure_Code == GAP_GENERAL_DISCOVERY_PROC && gap_evt_proc_complete->Status == 0x00)
+  {
+    APP_DBG_MSG("-- GAP GENERAL DISCOVERY PROCEDURE_COMPLETED\n\r");
+    /*if a device found, connect to it, device 1 being chosen first if both found*/
+    if (BleApplicationContext.DeviceServerFound == 0x01 && BleApplicationContext.Device_Connection_Status != APP_BLE_CONNECTED_CLIENT)
+    {
+      UTIL_SEQ_SetTask(1 << CFG_TASK_CONN_DEV_1_ID, CFG_SCH_PRIO_HOST);
+    }
+  }
+}
+
+static void Ble_EvtDisconnComplete(void *evt)
+{
+  hci_disconnection_complete_event_rp0 *cc = evt;
+
+  if (cc->Connection_Handle == BleApplicationContext.BleApplicationContext_legacy.connectionHandle)
+  {
+    BleApplicationContext.BleApplicationContext_legacy.connectionHandle = 0;
+    BleApplicationContext.Device_Connection_Status = APP_BLE_IDLE;
+    APP_DBG_MSG("\r\n\r** DISCONNECTION EVENT WITH SERVER \n\r");
+    handleNotification.P2P_Evt_Opcode = PEER_DISCON_HANDLE_EVT;
+    handleNotification.ConnectionHandle = BleApplicationContext.BleApplicationContext_legacy.connectionHandle;
+    P2PC_APP_Notification(&handleNotification);
+  }
+}
+
+static void Ble_EvtConnComplete(void *evt)
+{
+  hci_le_connection_complete_event_rp0 *connection_complete_event = evt;
+
+  /**
+   * The connection is done,
+   */
+  BleApplicationContext.BleApplicationContext_legacy.connectionHandle = connection_complete_event->Connection_Handle;
+  BleApplicationContext.Device_Connection_Status = APP_BLE_CONNECTED_CLIENT;
+
+  /* CONNECTION WITH CLIENT */
+  APP_DBG_MSG("\r\n\r**  CONNECTION COMPLETE EVENT WITH SERVER \n\r");
+  handleNotification.P2P_Evt_Opcode = PEER_CONN_HANDLE_EVT;
+  handleNotification.ConnectionHandle = BleApplicationContext.BleApplicationContext_legacy.connectionHandle;
+  P2PC_APP_Notification(&handleNotification);
+
+  /* Service discovery is started by the host (AT+DISC) through the
+   * gateway discovery engine; no automatic P2P discovery here */
+}
+
+static void Ble_EvtAdvReport(void *evt)
+{
+  hci_le_advertising_report_event_rp0 *le_advertising_event = evt;
+  uint8_t *adv_report_data;
+  uint8_t event_type, event_data_size;
+  uint8_t ad_length, ad_type;
+  int k = 0;
+
+  /* P2P server detection */
+  event_type = le_advertising_event->Advertising_Report[0].Event_Type;
+  event_data_size = le_advertising_event->Advertising_Report[0].Length_Data;
 
+  /* WARNING be careful when decoding advertising report... */
+  adv_report_data = (uint8_t *)(&le_advertising_event->Advertising_Report[0].Length_Data) + 1;
+
+  /* search AD Type Manufacturer Specific (ST demo ID) */
+  if (event_type == ADV_IND)
+  {
+    /* ISOLATION OF BD ADDRESS AND LOCAL NAME */
+    while (k < event_data_size)
+    {
+      ad_length = adv_report_data[k];
+      ad_type = adv_report_data[k + 1];
+      if (ad_type == AD_TYPE_MANUFACTURER_SPECIFIC_DATA && ad_length >= 7 && adv_report_data[k + 2] == 0x01)
+      { /* ST VERSION ID 01 */
+        APP_DBG_MSG("--- ST MANUFACTURER ID --- \n\r");
+        if (adv_report_data[k + 3] == CFG_DEV_ID_P2P_SERVER1)
+        { /* (End Device 1) */
+          APP_DBG_MSG("-- SERVER DETECTED -- VIA MAN ID\n\r");
+          BleApplicationContext.DeviceServerFound = 0x01;
+          SERVER_REMOTE_ADDR_TYPE = le_advertising_event->Advertising_Report[0].Address_Type;
+          memcpy(SERVER_REMOTE_BDADDR, le_advertising_event->Advertising_Report[0].Address, 6);
+        }
+      }
+      k += ad_length + 1;
+    } /* end while */
+  } /* end if ADV_IND */
+}
 /* USER CODE END FD_LOCAL_FUNCTIONS */
 
 /*************************************************************
@@ -1111,7 +896,7 @@ const uint8_t *BleGetBdAddress(void)
  *************************************************************/
 void hci_notify_asynch_evt(void *pdata)
 {
-  UTIL_SEQ_SetTask(1 << CFG_TASK_HCI_ASYNCH_EVT_ID, CFG_SCH_PRIO_0);
+  UTIL_SEQ_SetTask(1 << CFG_TASK_HCI_ASYNCH_EVT_ID, CFG_SCH_PRIO_HCI);
   return;
 }
 
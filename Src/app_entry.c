@@ -49,6 +49,9 @@ extern RTC_HandleTypeDef hrtc;
 #define POOL_SIZE (CFG_TLBLE_EVT_QUEUE_LENGTH*4U*DIVC((sizeof(TL_PacketHeader_t) + TL_BLE_EVENT_FRAME_SIZE), 4U))
 
 /* USER CODE BEGIN PD */
+/* Pool sized from the expected link count and ATT MTU, see app_conf.h */
+#undef POOL_SIZE
+#define POOL_SIZE (CFG_TLBLE_EVT_POOL_SIZE)
 
 /* USER CODE END PD */
 
@@ -127,6 +130,8 @@ void MX_APPE_Init(void)
    * This system event is received with APPE_SysUserEvtRx()
    */
 /* USER CODE BEGIN APPE_Init_2 */
+  printf("TL event pool: %lu bytes, MB_MEM2: %lu bytes\r\n",
+         (unsigned long)POOL_SIZE, (unsigned long)APPE_GetMbMem2Size());
 
 /* USER CODE END APPE_Init_2 */
 
@@ -160,6 +165,13 @@ void Init_Exti(void)
 }
 
 /* USER CODE BEGIN FD */
+uint32_t APPE_GetMbMem2Size(void)
+{
+  extern uint8_t _sMB_MEM2[];
+  extern uint8_t _eMB_MEM2[];
+
+  return (uint32_t)(_eMB_MEM2 - _sMB_MEM2);
+}
 
 /* USER CODE END FD */
 
@@ -565,7 +577,7 @@ void UTIL_SEQ_Idle(void)
 
 void shci_notify_asynch_evt(void* pdata)
 {
-  UTIL_SEQ_SetTask(1<<CFG_TASK_SYSTEM_HCI_ASYNCH_EVT_ID, CFG_SCH_PRIO_0);
+  UTIL_SEQ_SetTask(1<<CFG_TASK_SYSTEM_HCI_ASYNCH_EVT_ID, CFG_SCH_PRIO_HCI);
   return;
 }
 
@@ -24,6 +24,7 @@
 /* USER CODE BEGIN Includes */
 #include "usbd_cdc_if.h"
 #include "module_execute.h"
+#include "ble_hci_trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -76,6 +77,11 @@ static void MX_RF_Init(void);
 /* USER CODE BEGIN 0 */
 int _write(int file , char *ptr, int len)
 {
+  // USB CDC carries a btsnoop stream: debug text would corrupt it
+  if (BLE_HciTrace_IsExporting())
+  {
+    return len;
+  }
   // Only transmit if USB is configured
   CDC_Transmit_FS((uint8_t *)ptr, len);
   return len;
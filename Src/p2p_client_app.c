@@ -32,7 +32,7 @@
 #include "app_ble.h"
 
 /* USER CODE BEGIN Includes */
-#include "ble_event_handler.h"
+#include "ble_evt_dispatch.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -138,7 +138,10 @@ static P2P_ClientContext_t aP2PClientContext[BLE_CFG_CLT_MAX_NBR_CB];
 
 /* Private function prototypes -----------------------------------------------*/
 static void Gatt_Notification(P2P_Client_App_Notification_evt_t *pNotification);
-static SVCCTL_EvtAckStatus_t Event_Handler(void *Event);
+static void P2PC_EvtServices(void *evt);
+static void P2PC_EvtChars(void *evt);
+static void P2PC_EvtFindInfo(void *evt);
+static void P2PC_EvtNotification(void *evt);
 /* USER CODE BEGIN PFP */
 
 /* USER CODE END PFP */
@@ -161,9 +164,13 @@ void P2PC_APP_Init(void)
   }
 
   /**
-   *  Register the event handler to the BLE controller
+   *  Register the event handlers to the BLE Gateway event dispatcher,
+   *  after the gateway's own handlers of the same events
    */
-  SVCCTL_RegisterCltHandler(Event_Handler);
+  BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ACI_ATT_READ_BY_GROUP_TYPE_RESP_VSEVT_CODE, P2PC_EvtServices);
+  BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ACI_ATT_READ_BY_TYPE_RESP_VSEVT_CODE, P2PC_EvtChars);
+  BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ACI_ATT_FIND_INFO_RESP_VSEVT_CODE, P2PC_EvtFindInfo);
+  BLE_EvtDispatch_Register(HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE, ACI_GATT_NOTIFICATION_VSEVT_CODE, P2PC_EvtNotification);
 
 #if(CFG_DEBUG_APP_TRACE != 0)
   APP_DBG_MSG("-- P2P CLIENT INITIALIZED \n");
@@ -220,302 +227,246 @@ void P2PC_APP_Notification(P2PC_APP_ConnHandle_Not_evt_t *pNotification)
  *************************************************************/
 
 /**
- * @brief  Event handler
- * @param  Event: Address of the buffer holding the Event
- * @retval Ack: Return whether the Event has been managed or not
+ * @brief  Primary services found: look for the P2P service
+ * @param  evt: aci_att_read_by_group_type_resp_event_rp0
  */
-static SVCCTL_EvtAckStatus_t Event_Handler(void *Event)
+static void P2PC_EvtServices(void *evt)
 {
-  SVCCTL_EvtAckStatus_t return_value;
-  hci_event_pckt *event_pckt;
-  evt_blecore_aci *blecore_evt;
-
-  P2P_Client_App_Notification_evt_t Notification;
-
-  return_value = SVCCTL_EvtNotAck;
-  event_pckt = (hci_event_pckt *)(((hci_uart_pckt*)Event)->data);
-
-  switch(event_pckt->evt)
+  aci_att_read_by_group_type_resp_event_rp0 *pr = evt;
+  uint8_t numServ, i, idx;
+  uint16_t uuid, handle;
+  uint8_t index;
+
+  handle = pr->Connection_Handle;
+  index = 0;
+  while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
+          (aP2PClientContext[index].state != APP_BLE_IDLE))
   {
-    case HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE:
-    {
-      blecore_evt = (evt_blecore_aci*)event_pckt->data;
-      switch(blecore_evt->ecode)
-      {
+    APP_BLE_ConnStatus_t status;
 
-        case ACI_ATT_READ_BY_GROUP_TYPE_RESP_VSEVT_CODE:
-        {
-          aci_att_read_by_group_type_resp_event_rp0 *pr = (void*)blecore_evt->data;
-          uint8_t numServ, i, idx;
-          uint16_t uuid, handle;
-
-          uint8_t index;
-          handle = pr->Connection_Handle;
-          index = 0;
-          while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
-                  (aP2PClientContext[index].state != APP_BLE_IDLE))
-          {
-            APP_BLE_ConnStatus_t status;
-
-            status = APP_BLE_Get_Client_Connection_Status(aP2PClientContext[index].connHandle);
+    status = APP_BLE_Get_Client_Connection_Status(aP2PClientContext[index].connHandle);
 
-            if((aP2PClientContext[index].state == APP_BLE_CONNECTED_CLIENT)&&
-                    (status == APP_BLE_IDLE))
-            {
-              /* Handle deconnected */
+    if((aP2PClientContext[index].state == APP_BLE_CONNECTED_CLIENT)&&
+            (status == APP_BLE_IDLE))
+    {
+      /* Handle deconnected */
 
-              aP2PClientContext[index].state = APP_BLE_IDLE;
-              aP2PClientContext[index].connHandle = 0xFFFF;
-              break;
-            }
-            index++;
-          }
+      aP2PClientContext[index].state = APP_BLE_IDLE;
+      aP2PClientContext[index].connHandle = 0xFFFF;
+      break;
+    }
+    index++;
+  }
 
-          if(index < BLE_CFG_CLT_MAX_NBR_CB)
-          {
-            aP2PClientContext[index].connHandle= handle;
+  if(index < BLE_CFG_CLT_MAX_NBR_CB)
+  {
+    aP2PClientContext[index].connHandle= handle;
 
-            numServ = (pr->Data_Length) / pr->Attribute_Data_Length;
+    numServ = (pr->Data_Length) / pr->Attribute_Data_Length;
 
-            /* the event data will be
-             * 2bytes start handle
-             * 2bytes end handle
-             * 2 or 16 bytes data
-             * we are interested only if the UUID is 16 bit.
-             * So check if the data length is 6
-             */
+    /* the event data will be
+     * 2bytes start handle
+     * 2bytes end handle
+     * 2 or 16 bytes data
+     * we are interested only if the UUID is 16 bit.
+     * So check if the data length is 6
+     */
 #if (UUID_128BIT_FORMAT==1)
-          if (pr->Attribute_Data_Length == 20)
-          {
-            idx = 16;
+    if (pr->Attribute_Data_Length == 20)
+    {
+      idx = 16;
 #else
-          if (pr->Attribute_Data_Length == 6)
-          {
-            idx = 4;
+    if (pr->Attribute_Data_Length == 6)
+    {
+      idx = 4;
 #endif
-              for (i=0; i<numServ; i++)
-              {
-                uuid = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx]);
-                if(uuid == P2P_SERVICE_UUID)
-                {
+      for (i=0; i<numServ; i++)
+      {
+        uuid = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx]);
+        if(uuid == P2P_SERVICE_UUID)
+        {
 #if(CFG_DEBUG_APP_TRACE != 0)
-                  APP_DBG_MSG("-- GATT : P2P_SERVICE_UUID FOUND - connection handle 0x%x \n", aP2PClientContext[index].connHandle);
+          APP_DBG_MSG("-- GATT : P2P_SERVICE_UUID FOUND - connection handle 0x%x \n", aP2PClientContext[index].connHandle);
 #endif
 #if (UUID_128BIT_FORMAT==1)
-                aP2PClientContext[index].P2PServiceHandle = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx-16]);
-                aP2PClientContext[index].P2PServiceEndHandle = UNPACK_2_BYTE_PARAMETER (&pr->Attribute_Data_List[idx-14]);
+          aP2PClientContext[index].P2PServiceHandle = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx-16]);
+          aP2PClientContext[index].P2PServiceEndHandle = UNPACK_2_BYTE_PARAMETER (&pr->Attribute_Data_List[idx-14]);
 #else
-                aP2PClientContext[index].P2PServiceHandle = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx-4]);
-                aP2PClientContext[index].P2PServiceEndHandle = UNPACK_2_BYTE_PARAMETER (&pr->Attribute_Data_List[idx-2]);
+          aP2PClientContext[index].P2PServiceHandle = UNPACK_2_BYTE_PARAMETER(&pr->Attribute_Data_List[idx-4]);
+          aP2PClientContext[index].P2PServiceEndHandle = UNPACK_2_BYTE_PARAMETER (&pr->Attribute_Data_List[idx-2]);
 #endif
-                  aP2PClientContext[index].state = APP_BLE_DISCOVER_CHARACS ;
-                }
-                idx += 6;
-              }
-            }
-          }
+          aP2PClientContext[index].state = APP_BLE_DISCOVER_CHARACS ;
         }
-        break;
-
-        case ACI_ATT_READ_BY_TYPE_RESP_VSEVT_CODE:
-        {
-
-          aci_att_read_by_type_resp_event_rp0 *pr = (void*)blecore_evt->data;
-          uint8_t idx;
-          uint16_t uuid, handle;
-
-          /* the event data will be
-           * 2 bytes start handle
-           * 1 byte char properties
-           * 2 bytes handle
-           * 2 or 16 bytes data
-           */
+        idx += 6;
+      }
+    }
+  }
+}
 
-          uint8_t index;
+/**
+ * @brief  Characteristics found: look for the P2P write and notify characteristics
+ * @param  evt: aci_att_read_by_type_resp_event_rp0
+ */
+static void P2PC_EvtChars(void *evt)
+{
+  aci_att_read_by_type_resp_event_rp0 *pr = evt;
+  uint8_t idx;
+  uint16_t uuid, handle;
+  uint16_t data_length;
+  uint8_t index;
+
+  /* the event data will be
+   * 2 bytes start handle
+   * 1 byte char properties
+   * 2 bytes handle
+   * 2 or 16 bytes data
+   */
 
-          index = 0;
-          while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
-                  (aP2PClientContext[index].connHandle != pr->Connection_Handle))
-            index++;
+  index = 0;
+  while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
+          (aP2PClientContext[index].connHandle != pr->Connection_Handle))
+    index++;
 
-          if(index < BLE_CFG_CLT_MAX_NBR_CB)
-          {
+  if(index < BLE_CFG_CLT_MAX_NBR_CB)
+  {
 
-            /* we are interested in only 16 bit UUIDs */
+    /* we are interested in only 16 bit UUIDs */
 #if (UUID_128BIT_FORMAT==1)
-            idx = 17;
-            if (pr->Handle_Value_Pair_Length == 21)
+    idx = 17;
+    if (pr->Handle_Value_Pair_Length == 21)
 #else
-              idx = 5;
-            if (pr->Handle_Value_Pair_Length == 7)
+    idx = 5;
+    if (pr->Handle_Value_Pair_Length == 7)
 #endif
-            {
-              pr->Data_Length -= 1;
-              while(pr->Data_Length > 0)
-              {
-                uuid = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx]);
-                /* store the characteristic handle not the attribute handle */
+    {
+      /* Local count: the event is shared with the gateway discovery engine */
+      data_length = pr->Data_Length - 1;
+      while(data_length > 0)
+      {
+        uuid = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx]);
+        /* store the characteristic handle not the attribute handle */
 #if (UUID_128BIT_FORMAT==1)
-                handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx-14]);
+        handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx-14]);
 #else
-                handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx-2]);
+        handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_Value_Pair_Data[idx-2]);
 #endif
-                if(uuid == P2P_WRITE_CHAR_UUID)
-                {
+        if(uuid == P2P_WRITE_CHAR_UUID)
+        {
 #if(CFG_DEBUG_APP_TRACE != 0)
-                  APP_DBG_MSG("-- GATT : WRITE_UUID FOUND - connection handle 0x%x\n", aP2PClientContext[index].connHandle);
+          APP_DBG_MSG("-- GATT : WRITE_UUID FOUND - connection handle 0x%x\n", aP2PClientContext[index].connHandle);
 #endif
-                  aP2PClientContext[index].state = APP_BLE_DISCOVER_WRITE_DESC;
-                  aP2PClientContext[index].P2PWriteToServerCharHdle = handle;
-                }
+          aP2PClientContext[index].state = APP_BLE_DISCOVER_WRITE_DESC;
+          aP2PClientContext[index].P2PWriteToServerCharHdle = handle;
+        }
 
-                else if(uuid == P2P_NOTIFY_CHAR_UUID)
-                {
+        else if(uuid == P2P_NOTIFY_CHAR_UUID)
+        {
 #if(CFG_DEBUG_APP_TRACE != 0)
-                  APP_DBG_MSG("-- GATT : NOTIFICATION_CHAR_UUID FOUND  - connection handle 0x%x\n", aP2PClientContext[index].connHandle);
+          APP_DBG_MSG("-- GATT : NOTIFICATION_CHAR_UUID FOUND  - connection handle 0x%x\n", aP2PClientContext[index].connHandle);
 #endif
-                  aP2PClientContext[index].state = APP_BLE_DISCOVER_NOTIFICATION_CHAR_DESC;
-                  aP2PClientContext[index].P2PNotificationCharHdle = handle;
-                }
+          aP2PClientContext[index].state = APP_BLE_DISCOVER_NOTIFICATION_CHAR_DESC;
+          aP2PClientContext[index].P2PNotificationCharHdle = handle;
+        }
 #if (UUID_128BIT_FORMAT==1)
-                pr->Data_Length -= 21;
-                idx += 21;
+        data_length = (data_length > 21) ? (data_length - 21) : 0;
+        idx += 21;
 #else
-                pr->Data_Length -= 7;
-                idx += 7;
+        data_length = (data_length > 7) ? (data_length - 7) : 0;
+        idx += 7;
 #endif
-              }
-            }
-          }
-        }
-        break;
-
-        case ACI_ATT_FIND_INFO_RESP_VSEVT_CODE:
-        {
-          aci_att_find_info_resp_event_rp0 *pr = (void*)blecore_evt->data;
-
-          uint8_t numDesc, idx, i;
-          uint16_t uuid, handle;
+      }
+    }
+  }
+}
 
-          /*
-           * event data will be of the format
-           * 2 bytes handle
-           * 2 bytes UUID
-           */
+/**
+ * @brief  Descriptors found: look for the P2P notification CCCD
+ * @param  evt: aci_att_find_info_resp_event_rp0
+ */
+static void P2PC_EvtFindInfo(void *evt)
+{
+  aci_att_find_info_resp_event_rp0 *pr = evt;
+  uint8_t numDesc, idx, i;
+  uint16_t uuid, handle;
+  uint8_t index;
+
+  /*
+   * event data will be of the format
+   * 2 bytes handle
+   * 2 bytes UUID
+   */
 
-          uint8_t index;
+  index = 0;
+  while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
+          (aP2PClientContext[index].connHandle != pr->Connection_Handle))
 
-          index = 0;
-          while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
-                  (aP2PClientContext[index].connHandle != pr->Connection_Handle))
+    index++;
 
-            index++;
+  if(index < BLE_CFG_CLT_MAX_NBR_CB)
+  {
 
-          if(index < BLE_CFG_CLT_MAX_NBR_CB)
-          {
+    numDesc = (pr->Event_Data_Length) / 4;
+    /* we are interested only in 16 bit UUIDs */
+    idx = 0;
+    if (pr->Format == UUID_TYPE_16)
+    {
+      for (i=0; i<numDesc; i++)
+      {
+        handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_UUID_Pair[idx]);
+        uuid = UNPACK_2_BYTE_PARAMETER(&pr->Handle_UUID_Pair[idx+2]);
 
-            numDesc = (pr->Event_Data_Length) / 4;
-            /* we are interested only in 16 bit UUIDs */
-            idx = 0;
-            if (pr->Format == UUID_TYPE_16)
-            {
-              for (i=0; i<numDesc; i++)
-              {
-                handle = UNPACK_2_BYTE_PARAMETER(&pr->Handle_UUID_Pair[idx]);
-                uuid = UNPACK_2_BYTE_PARAMETER(&pr->Handle_UUID_Pair[idx+2]);
-
-                if(uuid == CLIENT_CHAR_CONFIG_DESCRIPTOR_UUID)
-                {
+        if(uuid == CLIENT_CHAR_CONFIG_DESCRIPTOR_UUID)
+        {
 #if(CFG_DEBUG_APP_TRACE != 0)
-                  APP_DBG_MSG("-- GATT : CLIENT_CHAR_CONFIG_DESCRIPTOR_UUID- connection handle 0x%x\n", aP2PClientContext[index].connHandle);
+          APP_DBG_MSG("-- GATT : CLIENT_CHAR_CONFIG_DESCRIPTOR_UUID- connection handle 0x%x\n", aP2PClientContext[index].connHandle);
 #endif
-                  if( aP2PClientContext[index].state == APP_BLE_DISCOVER_NOTIFICATION_CHAR_DESC)
-                  {
-
-                    aP2PClientContext[index].P2PNotificationDescHandle = handle;
-                    aP2PClientContext[index].state = APP_BLE_ENABLE_NOTIFICATION_DESC;
-
-                  }
-                }
-                idx += 4;
-              }
-            }
-          }
-        }
-        break; /*ACI_ATT_FIND_INFO_RESP_VSEVT_CODE*/
-
-        case ACI_GATT_NOTIFICATION_VSEVT_CODE:
-        {
-          aci_gatt_notification_event_rp0 *pr = (void*)blecore_evt->data;
-          uint8_t index;
-
-          /* Forward ALL notifications to BLE Gateway */
-          BLE_EventHandler_OnNotification(pr->Connection_Handle, 
-                                          pr->Attribute_Handle,
-                                          pr->Attribute_Value, 
-                                          pr->Attribute_Value_Length);
-
-          index = 0;
-          while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
-                  (aP2PClientContext[index].connHandle != pr->Connection_Handle))
-            index++;
-
-          if(index < BLE_CFG_CLT_MAX_NBR_CB)
+          if( aP2PClientContext[index].state == APP_BLE_DISCOVER_NOTIFICATION_CHAR_DESC)
           {
 
-            if ( (pr->Attribute_Handle == aP2PClientContext[index].P2PNotificationCharHdle) &&
-                    (pr->Attribute_Value_Length == (2)) )
-            {
-
-              Notification.P2P_Client_Evt_Opcode = P2P_NOTIFICATION_INFO_RECEIVED_EVT;
-              Notification.DataTransfered.Length = pr->Attribute_Value_Length;
-              Notification.DataTransfered.pPayload = &pr->Attribute_Value[0];
-
-              Gatt_Notification(&Notification);
+            aP2PClientContext[index].P2PNotificationDescHandle = handle;
+            aP2PClientContext[index].state = APP_BLE_ENABLE_NOTIFICATION_DESC;
 
-              /* INFORM APPLICATION BUTTON IS PUSHED BY END DEVICE */
-
-            }
           }
         }
-        break;/* end ACI_GATT_NOTIFICATION_VSEVT_CODE */
+        idx += 4;
+      }
+    }
+  }
+}
 
-        case ACI_GATT_PROC_COMPLETE_VSEVT_CODE:
-        {
-          aci_gatt_proc_complete_event_rp0 *pr = (void*)blecore_evt->data;
-#if(CFG_DEBUG_APP_TRACE != 0)
-          APP_DBG_MSG("-- GATT : ACI_GATT_PROC_COMPLETE_VSEVT_CODE \n");
-          APP_DBG_MSG("\n");
-#endif
+/**
+ * @brief  Notification received: P2P button state
+ * @param  evt: aci_gatt_notification_event_rp0
+ */
+static void P2PC_EvtNotification(void *evt)
+{
+  aci_gatt_notification_event_rp0 *pr = evt;
+  P2P_Client_App_Notification_evt_t Notification;
+  uint8_t index;
 
-          uint8_t index;
+  index = 0;
+  while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
+          (aP2PClientContext[index].connHandle != pr->Connection_Handle))
+    index++;
 
-          index = 0;
-          while((index < BLE_CFG_CLT_MAX_NBR_CB) &&
-                  (aP2PClientContext[index].connHandle != pr->Connection_Handle))
-            index++;
+  if(index < BLE_CFG_CLT_MAX_NBR_CB)
+  {
 
-          if(index < BLE_CFG_CLT_MAX_NBR_CB)
-          {
+    if ( (pr->Attribute_Handle == aP2PClientContext[index].P2PNotificationCharHdle) &&
+            (pr->Attribute_Value_Length == (2)) )
+    {
 
-            UTIL_SEQ_SetTask( 1<<CFG_TASK_SEARCH_SERVICE_ID, CFG_SCH_PRIO_0);
+      Notification.P2P_Client_Evt_Opcode = P2P_NOTIFICATION_INFO_RECEIVED_EVT;
+      Notification.DataTransfered.Length = pr->Attribute_Value_Length;
+      Notification.DataTransfered.pPayload = &pr->Attribute_Value[0];
 
-          }
-        }
-        break; /*ACI_GATT_PROC_COMPLETE_VSEVT_CODE*/
-        default:
-          break;
-      }
-    }
+      Gatt_Notification(&Notification);
 
-    break; /* HCI_VENDOR_SPECIFIC_DEBUG_EVT_CODE */
+      /* INFORM APPLICATION BUTTON IS PUSHED BY END DEVICE */
 
-    default:
-      break;
+    }
   }
-
-  return(return_value);
-}/* end BLE_CTRL_Event_Acknowledged_Status_t */
+}
 
 void Gatt_Notification(P2P_Client_App_Notification_evt_t *pNotification)
 {
@@ -530,7 +481,7 @@ void Gatt_Notification(P2P_Client_App_Notification_evt_t *pNotification)
 
     case P2P_NOTIFICATION_INFO_RECEIVED_EVT:
 /* USER CODE BEGIN P2P_NOTIFICATION_INFO_RECEIVED_EVT */
-      /* Notification already forwarded to BLE Gateway in Event_Handler */
+      /* Notification already forwarded to BLE Gateway by its own handler */
 /* USER CODE END P2P_NOTIFICATION_INFO_RECEIVED_EVT */
       break;
 
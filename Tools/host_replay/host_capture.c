@@ -0,0 +1,237 @@
+/**
+  ******************************************************************************
+  * @file    host_capture.c
+  * @brief   Host replay: btsnoop and raw H4 capture parsing
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "host_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* btsnoop: 16-byte file header, 24-byte record header, big endian */
+#define BTSNOOP_HDR                 16U
+#define BTSNOOP_REC_HDR             24U
+#define BTSNOOP_LINK_HCI            1001U   /* No packet type byte, direction in flags */
+#define BTSNOOP_LINK_H4             1002U   /* Packet type byte first */
+#define BTSNOOP_FLAG_RX             0x01U
+#define BTSNOOP_FLAG_CMD_EVT        0x02U
+
+/* H4 packet types */
+#define H4_CMD                      0x01U
+#define H4_ACL                      0x02U
+#define H4_SCO                      0x03U
+#define H4_ISO                      0x05U
+
+/* Command responses stay in the transport layer, never reach SVCCTL_UserEvtRx */
+#define HCI_EVT_CMD_COMPLETE        0x0EU
+#define HCI_EVT_CMD_STATUS          0x0FU
+
+static const uint8_t btsnoop_magic[8] = { 'b', 't', 's', 'n', 'o', 'o', 'p', 0 };
+
+static uint32_t Capture_Be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t Capture_Be64(const uint8_t *p)
+{
+    return ((uint64_t)Capture_Be32(p) << 32) | Capture_Be32(p + 4);
+}
+
+static int Capture_Grow(void **buf, size_t *cap, size_t need, size_t elem)
+{
+    size_t n = (*cap != 0U) ? *cap : 256U;
+    void *p;
+
+    if (need <= *cap) {
+        return 0;
+    }
+    while (n < need) {
+        n *= 2U;
+    }
+    p = realloc(*buf, n * elem);
+    if (p == NULL) {
+        return -1;
+    }
+    *buf = p;
+    *cap = n;
+    return 0;
+}
+
+int HOST_Capture_Add(HOST_Capture_t *cap, const uint8_t *pkt, uint32_t len, uint64_t time_us)
+{
+    size_t evt_cap = cap->cap;
+    HOST_CaptureEvt_t *e;
+
+    if (len < HOST_H4_EVT_HDR || pkt[0] != HOST_H4_EVT || len != HOST_H4_EVT_HDR + pkt[2]) {
+        cap->skipped_other++;
+        return 1;
+    }
+    if (pkt[1] == HCI_EVT_CMD_COMPLETE || pkt[1] == HCI_EVT_CMD_STATUS) {
+        cap->skipped_cmd_rsp++;
+        return 1;
+    }
+    if (Capture_Grow((void **)&cap->data, &cap->data_cap, cap->data_len + len, 1U) != 0 ||
+        Capture_Grow((void **)&cap->evt, &evt_cap, (size_t)cap->count + 1U, sizeof(*cap->evt)) != 0) {
+        return -1;
+    }
+    cap->cap = (uint32_t)evt_cap;
+
+    e = &cap->evt[cap->count++];
+    e->offset = (uint32_t)cap->data_len;
+    e->len = (uint16_t)len;
+    e->time_us = time_us;
+    memcpy(cap->data + cap->data_len, pkt, len);
+    cap->data_len += len;
+    return 0;
+}
+
+static int Capture_ParseBtsnoop(HOST_Capture_t *cap, const uint8_t *buf, size_t len)
+{
+    uint8_t pkt[HOST_H4_EVT_MAX];
+    uint32_t link = Capture_Be32(buf + 12);
+    uint32_t orig_len;
+    uint32_t incl_len;
+    uint32_t flags;
+    uint64_t ts;
+    uint64_t ts0 = 0;
+    uint8_t first = 1;
+    size_t pos = BTSNOOP_HDR;
+    const uint8_t *rec;
+
+    if (link != BTSNOOP_LINK_HCI && link != BTSNOOP_LINK_H4) {
+        fprintf(stderr, "btsnoop: unsupported datalink %lu\n", (unsigned long)link);
+        return -1;
+    }
+
+    while (pos + BTSNOOP_REC_HDR <= len) {
+        orig_len = Capture_Be32(buf + pos);
+        incl_len = Capture_Be32(buf + pos + 4);
+        flags = Capture_Be32(buf + pos + 8);
+        ts = Capture_Be64(buf + pos + 16);
+        rec = buf + pos + BTSNOOP_REC_HDR;
+        pos += BTSNOOP_REC_HDR + incl_len;
+        if (pos > len) {
+            cap->skipped_other++;
+            break;
+        }
+        if (first) {
+            ts0 = ts;
+            first = 0;
+        }
+        /* Truncated by the recorder snap length: parameters are incomplete */
+        if (incl_len != orig_len) {
+            cap->skipped_other++;
+            continue;
+        }
+        if (link == BTSNOOP_LINK_H4) {
+            if (HOST_Capture_Add(cap, rec, incl_len, ts - ts0) < 0) {
+                return -1;
+            }
+        } else {
+            if ((flags & (BTSNOOP_FLAG_RX | BTSNOOP_FLAG_CMD_EVT)) !=
+                (BTSNOOP_FLAG_RX | BTSNOOP_FLAG_CMD_EVT) || incl_len > HOST_H4_EVT_MAX - 1U) {
+                cap->skipped_other++;
+                continue;
+            }
+            pkt[0] = HOST_H4_EVT;
+            memcpy(pkt + 1, rec, incl_len);
+            if (HOST_Capture_Add(cap, pkt, incl_len + 1U, ts - ts0) < 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int Capture_ParseH4(HOST_Capture_t *cap, const uint8_t *buf, size_t len, uint32_t gap_us)
+{
+    size_t pos = 0;
+    size_t pkt_len;
+    uint64_t t = 0;
+
+    while (pos < len) {
+        switch (buf[pos]) {
+        case HOST_H4_EVT:
+            pkt_len = (pos + 3U <= len) ? 3U + buf[pos + 2] : 0U;
+            break;
+        case H4_CMD:
+            pkt_len = (pos + 4U <= len) ? 4U + buf[pos + 3] : 0U;
+            break;
+        case H4_ACL:
+        case H4_ISO:
+            pkt_len = (pos + 5U <= len) ? 5U + (size_t)(buf[pos + 3] | ((buf[pos + 4] & 0x3FU) << 8)) : 0U;
+            break;
+        case H4_SCO:
+            pkt_len = (pos + 4U <= len) ? 4U + buf[pos + 3] : 0U;
+            break;
+        default:
+            pkt_len = 0;
+            break;
+        }
+        if (pkt_len == 0U || pos + pkt_len > len) {
+            fprintf(stderr, "h4: bad packet at offset %lu\n", (unsigned long)pos);
+            cap->skipped_other++;
+            break;
+        }
+        if (HOST_Capture_Add(cap, buf + pos, (uint32_t)pkt_len, t) < 0) {
+            return -1;
+        }
+        t += gap_us;
+        pos += pkt_len;
+    }
+    return 0;
+}
+
+int HOST_Capture_Load(HOST_Capture_t *cap, const char *path, HOST_CaptureFmt_t fmt, uint32_t gap_us)
+{
+    FILE *f;
+    uint8_t *buf;
+    long size;
+    int ret;
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = malloc((size > 0) ? (size_t)size : 1U);
+    if (buf == NULL || (size > 0 && fread(buf, 1, (size_t)size, f) != (size_t)size)) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(buf);
+        return -1;
+    }
+    fclose(f);
+
+    if (fmt == HOST_FMT_AUTO) {
+        fmt = ((size_t)size >= BTSNOOP_HDR && memcmp(buf, btsnoop_magic, sizeof(btsnoop_magic)) == 0) ?
+              HOST_FMT_BTSNOOP : HOST_FMT_H4;
+    }
+    cap->fmt = fmt;
+    if (fmt == HOST_FMT_BTSNOOP) {
+        ret = ((size_t)size >= BTSNOOP_HDR) ? Capture_ParseBtsnoop(cap, buf, (size_t)size) : -1;
+    } else {
+        ret = Capture_ParseH4(cap, buf, (size_t)size, gap_us);
+    }
+    free(buf);
+    return ret;
+}
+
+const uint8_t* HOST_Capture_Packet(const HOST_Capture_t *cap, uint32_t idx)
+{
+    return cap->data + cap->evt[idx].offset;
+}
+
+void HOST_Capture_Free(HOST_Capture_t *cap)
+{
+    free(cap->data);
+    free(cap->evt);
+    memset(cap, 0, sizeof(*cap));
+}
@@ -0,0 +1,69 @@
+/**
+  ******************************************************************************
+  * @file    host_capture.h
+  * @brief   Host replay: HCI event captures loaded into memory
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef HOST_CAPTURE_H
+#define HOST_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* H4 event packet: type, event code, length, parameters */
+#define HOST_H4_EVT                 0x04U
+#define HOST_H4_EVT_HDR             3U
+#define HOST_H4_EVT_MAX             (HOST_H4_EVT_HDR + 255U)
+
+typedef enum {
+    HOST_FMT_AUTO = 0,              /* btsnoop if the file starts with its magic, H4 otherwise */
+    HOST_FMT_BTSNOOP,
+    HOST_FMT_H4,                    /* Raw H4 packets back to back */
+} HOST_CaptureFmt_t;
+
+/* One event: H4 packet in the capture buffer and its capture time */
+typedef struct {
+    uint32_t offset;
+    uint16_t len;
+    uint64_t time_us;               /* From the first event */
+} HOST_CaptureEvt_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t data_len;
+    size_t data_cap;
+    HOST_CaptureEvt_t *evt;
+    uint32_t count;
+    uint32_t cap;
+    /* Packets not replayed */
+    uint32_t skipped_cmd_rsp;       /* Command complete / status, consumed by the transport layer */
+    uint32_t skipped_other;         /* Commands, ACL, truncated or malformed records */
+    HOST_CaptureFmt_t fmt;
+} HOST_Capture_t;
+
+/**
+  * @brief Load a capture file
+  * @param gap_us Time between events of captures without timestamps (H4)
+  * @return 0 on success, -1 if the file cannot be read or has no known format
+  */
+int HOST_Capture_Load(HOST_Capture_t *cap, const char *path, HOST_CaptureFmt_t fmt, uint32_t gap_us);
+
+/**
+  * @brief Append one H4 packet; only events other than command responses are kept
+  * @return 0 if kept, 1 if skipped, -1 if out of memory
+  */
+int HOST_Capture_Add(HOST_Capture_t *cap, const uint8_t *pkt, uint32_t len, uint64_t time_us);
+
+/**
+  * @brief Get the H4 packet of an event
+  */
+const uint8_t* HOST_Capture_Packet(const HOST_Capture_t *cap, uint32_t idx);
+
+/**
+  * @brief Free capture memory
+  */
+void HOST_Capture_Free(HOST_Capture_t *cap);
+
+#endif /* HOST_CAPTURE_H */
@@ -0,0 +1,409 @@
+/**
+  ******************************************************************************
+  * @file    host_main.c
+  * @brief   Host replay harness: feeds recorded HCI events to the gateway as
+  *          fast as possible and reports throughput and per-event cost
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "host_port.h"
+#include "host_capture.h"
+#include "module_execute.h"
+#include "at_command.h"
+#include "app_ble.h"
+#include "ble_adv_storm.h"
+#include "ble_connection.h"
+#include "seq_profile.h"
+#include "svc_ctl.h"
+#include "app_conf.h"
+#include "stm32_seq.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_MAX_AT_CMDS          16U
+
+/* Simulated time before the first event: lets the init tasks and timers settle */
+#define REPLAY_START_US             100000ULL
+
+typedef struct {
+    const char *capture;
+    HOST_CaptureFmt_t fmt;
+    const char *at_cmd[REPLAY_MAX_AT_CMDS];
+    uint8_t at_cmd_count;
+    const char *at_path;
+    const char *debug_path;
+    uint32_t repeat;
+    uint32_t gap_us;
+    uint8_t storm;                  /* Generated advertising storm instead of a capture */
+    BLE_AdvStormConfig_t storm_cfg;
+    uint32_t burst;                 /* Events delivered between sequencer runs */
+    const char *inject_cmd;         /* AT command received on LPUART1 during the replay */
+    uint32_t inject_every;
+} Replay_Opts_t;
+
+static uint64_t Replay_NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Run sequencer tasks until none is pending
+ */
+static void Replay_Drain(void)
+{
+    UTIL_SEQ_Run(UTIL_SEQ_DEFAULT);
+    HOST_Port_Poll();
+    UTIL_SEQ_Run(UTIL_SEQ_DEFAULT);
+}
+
+static int Replay_CmpU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void Replay_Usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] <capture>\n"
+            "  -f btsnoop|h4   Capture format (default: detect)\n"
+            "  -c <AT cmd>     AT command run before the replay, repeatable\n"
+            "  -o <file>       Write AT output to file\n"
+            "  -l <file>       Write debug text to file\n"
+            "  -n <count>      Replay the capture count times (default 1)\n"
+            "  -g <us>         Time between H4 events (default 1000)\n"
+            "  -s <devices>,<rate>,<batch>,<count>[,<ad_len>]\n"
+            "                  Replay a generated advertising storm, no capture file\n"
+            "  -b <events>     Events delivered between sequencer runs (default 1)\n"
+            "  -i <events>:<AT cmd>\n"
+            "                  Receive the AT command on LPUART1 every <events> events\n",
+            prog);
+}
+
+/**
+ * @brief Parse -s: same parameters as AT+ADVSTORM
+ */
+static int Replay_ParseStorm(const char *arg, BLE_AdvStormConfig_t *cfg)
+{
+    unsigned int v[5] = { 0, 0, 0, 0, ADVSTORM_AD_DEFAULT };
+    int n = sscanf(arg, "%u,%u,%u,%u,%u", &v[0], &v[1], &v[2], &v[3], &v[4]);
+
+    if (n < 4 || v[0] > 0xFFFFU || v[1] > 0xFFFFU || v[2] > 0xFFU || v[3] == 0U ||
+        v[3] > 0xFFFFU || v[4] > 0xFFU) {
+        return -1;
+    }
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->devices = (uint16_t)v[0];
+    cfg->rate = (uint16_t)v[1];
+    cfg->batch = (uint8_t)v[2];
+    cfg->count = (uint16_t)v[3];
+    cfg->ad_len = (uint8_t)v[4];
+    return BLE_AdvStorm_CheckConfig(cfg);
+}
+
+/**
+ * @brief Fill a capture with storm events, timed by the rate (gap_us for rate 0)
+ */
+static int Replay_BuildStorm(HOST_Capture_t *cap, const BLE_AdvStormConfig_t *cfg, uint32_t gap_us)
+{
+    uint8_t pkt[ADVSTORM_PKT_MAX];
+    BLE_AdvStormGen_t gen;
+    uint64_t t;
+    uint16_t len;
+
+    BLE_AdvStorm_GenInit(&gen, cfg);
+    for (;;) {
+        t = (cfg->rate != 0U) ? (uint64_t)gen.events * 1000000ULL / cfg->rate :
+                                (uint64_t)gen.events * gap_us;
+        len = BLE_AdvStorm_GenEvent(&gen, pkt);
+        if (len == 0U) {
+            return 0;
+        }
+        if (HOST_Capture_Add(cap, pkt, len, t) < 0) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Feed a command line to the LPUART1 receive path, as the RX interrupt does
+ */
+static void Replay_ReceiveLine(const char *cmd)
+{
+    while (*cmd != '\0') {
+        AT_Command_ReceiveByte((uint8_t)*cmd++);
+    }
+    AT_Command_ReceiveByte('\r');
+}
+
+static int Replay_ParseArgs(int argc, char **argv, Replay_Opts_t *o)
+{
+    int c;
+    char *end;
+
+    memset(o, 0, sizeof(*o));
+    o->repeat = 1;
+    o->gap_us = 1000;
+    o->burst = 1;
+    while ((c = getopt(argc, argv, "f:c:o:l:n:g:s:b:i:h")) != -1) {
+        switch (c) {
+        case 'f':
+            if (strcmp(optarg, "btsnoop") == 0) {
+                o->fmt = HOST_FMT_BTSNOOP;
+            } else if (strcmp(optarg, "h4") == 0) {
+                o->fmt = HOST_FMT_H4;
+            } else {
+                return -1;
+            }
+            break;
+        case 'c':
+            if (o->at_cmd_count >= REPLAY_MAX_AT_CMDS) {
+                return -1;
+            }
+            o->at_cmd[o->at_cmd_count++] = optarg;
+            break;
+        case 'o':
+            o->at_path = optarg;
+            break;
+        case 'l':
+            o->debug_path = optarg;
+            break;
+        case 'n':
+            o->repeat = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            o->gap_us = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            if (Replay_ParseStorm(optarg, &o->storm_cfg) != 0) {
+                return -1;
+            }
+            o->storm = 1;
+            break;
+        case 'b':
+            o->burst = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            o->inject_every = (uint32_t)strtoul(optarg, &end, 0);
+            if (*end != ':' || o->inject_every == 0U) {
+                return -1;
+            }
+            o->inject_cmd = end + 1;
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (optind != argc - (o->storm ? 0 : 1) || o->repeat == 0U || o->burst == 0U) {
+        return -1;
+    }
+    o->capture = o->storm ? "storm" : argv[optind];
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    /* SVCCTL_UserEvtRx reads the packet through hci_uart_pckt: keep it aligned */
+    static uint8_t pkt[HOST_H4_EVT_MAX + 1U] __attribute__((aligned(4)));
+    Replay_Opts_t opts;
+    HOST_Capture_t cap;
+    const HOST_Output_t *out;
+    const BLE_ScanStats_t *scan;
+    const AT_LatencyStats_t *lat;
+    const UTIL_SEQ_TaskStats_t *ts;
+    BLE_ScanStats_t scan0;
+    FILE *report;
+    FILE *at_file = NULL;
+    FILE *debug_file = NULL;
+    uint32_t *cost;
+    uint64_t total;
+    uint64_t base_us;
+    uint64_t span_us;
+    uint64_t at_bytes0;
+    uint64_t at_lines0;
+    uint64_t debug_bytes0;
+    uint64_t hci_cmds0;
+    uint64_t t_start;
+    uint64_t t_end;
+    uint64_t t0;
+    uint64_t sum = 0;
+    uint64_t flow_off = 0;
+    uint64_t n = 0;
+    double secs;
+    uint32_t r;
+    uint32_t i;
+    uint32_t heavy;
+    uint32_t waited;
+    uint8_t k;
+
+    if (Replay_ParseArgs(argc, argv, &opts) != 0) {
+        Replay_Usage(argv[0]);
+        return 2;
+    }
+
+    memset(&cap, 0, sizeof(cap));
+    if (opts.storm) {
+        if (Replay_BuildStorm(&cap, &opts.storm_cfg, opts.gap_us) != 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    } else if (HOST_Capture_Load(&cap, opts.capture, opts.fmt, opts.gap_us) != 0) {
+        return 1;
+    }
+    if (cap.count == 0U) {
+        fprintf(stderr, "%s: no events to replay\n", opts.capture);
+        return 1;
+    }
+    total = (uint64_t)cap.count * opts.repeat;
+    cost = malloc(total * sizeof(*cost));
+    if (cost == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (opts.at_path != NULL && (at_file = fopen(opts.at_path, "wb")) == NULL) {
+        perror(opts.at_path);
+        return 1;
+    }
+    if (opts.debug_path != NULL && (debug_file = fopen(opts.debug_path, "wb")) == NULL) {
+        perror(opts.debug_path);
+        return 1;
+    }
+
+    /* Report on the real stdout, firmware printf goes to the debug sink */
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    HOST_Port_Init(at_file, debug_file);
+
+    /* Same order as the firmware: gateway modules, then the BLE application */
+    UTIL_SEQ_Init();
+    module_ble_init();
+    APP_BLE_Init();
+    Replay_Drain();
+    for (k = 0; k < opts.at_cmd_count; k++) {
+        AT_Command_Process(opts.at_cmd[k]);
+        Replay_Drain();
+    }
+    HOST_SetTimeUs(REPLAY_START_US);
+    Replay_Drain();
+
+    out = HOST_GetOutput();
+    at_bytes0 = out->at_bytes;
+    at_lines0 = out->at_lines;
+    debug_bytes0 = out->debug_bytes;
+    hci_cmds0 = out->hci_cmds;
+    scan0 = *BLE_Connection_GetScanStats();
+    AT_Command_ClearLatency();
+    SEQ_Profile_Clear();
+    span_us = cap.evt[cap.count - 1U].time_us + opts.gap_us;
+    base_us = HOST_GetTimeUs();
+
+    t_start = Replay_NowNs();
+    for (r = 0; r < opts.repeat; r++) {
+        for (i = 0; i < cap.count; i++) {
+            memcpy(pkt, HOST_Capture_Packet(&cap, i), cap.evt[i].len);
+
+            t0 = Replay_NowNs();
+            HOST_SetTimeUs(base_us + (uint64_t)r * span_us + cap.evt[i].time_us);
+            /* Flow off: the transport layer keeps the event until the tasks run */
+            while (SVCCTL_UserEvtRx(pkt) == SVCCTL_UserEvtFlowDisable) {
+                flow_off++;
+                Replay_Drain();
+            }
+            /* Command arrives behind the queued events, before the tasks run */
+            if (opts.inject_cmd != NULL && (n + 1U) % opts.inject_every == 0U) {
+                Replay_ReceiveLine(opts.inject_cmd);
+            }
+            if ((n + 1U) % opts.burst == 0U || n + 1U == total) {
+                Replay_Drain();
+            }
+            cost[n] = (uint32_t)(Replay_NowNs() - t0);
+            sum += cost[n];
+            n++;
+        }
+    }
+    t_end = Replay_NowNs();
+
+    out = HOST_GetOutput();
+    scan = BLE_Connection_GetScanStats();
+    lat = AT_Command_GetLatency();
+    secs = (double)(t_end - t_start) / 1e9;
+    qsort(cost, (size_t)n, sizeof(*cost), Replay_CmpU32);
+
+    fprintf(report, "Replay %s: %s, %lu events x%lu, skipped %lu command responses, %lu other\n",
+            opts.capture, opts.storm ? "generated" : (cap.fmt == HOST_FMT_BTSNOOP) ? "btsnoop" : "h4",
+            (unsigned long)cap.count, (unsigned long)opts.repeat,
+            (unsigned long)cap.skipped_cmd_rsp, (unsigned long)cap.skipped_other);
+    fprintf(report, "  Throughput : %lu events in %.3f s, %.0f events/s\n",
+            (unsigned long)n, secs, (secs > 0.0) ? (double)n / secs : 0.0);
+    fprintf(report, "  Cost/event : avg %lu ns, p50 %lu ns, p99 %lu ns, max %lu ns\n",
+            (unsigned long)(sum / n), (unsigned long)cost[n / 2U],
+            (unsigned long)cost[(n * 99U) / 100U], (unsigned long)cost[n - 1U]);
+    fprintf(report, "  AT output  : %lu bytes, %lu lines (%.1f bytes/event)\n",
+            (unsigned long)(out->at_bytes - at_bytes0), (unsigned long)(out->at_lines - at_lines0),
+            (double)(out->at_bytes - at_bytes0) / (double)n);
+    fprintf(report, "  Debug text : %lu bytes\n", (unsigned long)(out->debug_bytes - debug_bytes0));
+    fprintf(report, "  Scan path  : %lu reports (%.0f reports/s), %lu new devices, %lu table full, %lu +SCAN lines\n",
+            (unsigned long)(scan->reports - scan0.reports),
+            (secs > 0.0) ? (double)(scan->reports - scan0.reports) / secs : 0.0,
+            (unsigned long)(scan->new_devices - scan0.new_devices),
+            (unsigned long)(scan->table_full - scan0.table_full),
+            (unsigned long)(scan->host_reports - scan0.host_reports));
+    if (lat->commands > 0U) {
+        fprintf(report, "  AT latency : %lu commands, wait avg %.1f us max %.1f us, run avg %.1f us max %.1f us\n",
+                (unsigned long)lat->commands,
+                (double)lat->wait_cycles / (double)lat->commands * 1e6 / (double)HOST_CPU_HZ,
+                (double)lat->wait_max * 1e6 / (double)HOST_CPU_HZ,
+                (double)lat->run_cycles / (double)lat->commands * 1e6 / (double)HOST_CPU_HZ,
+                (double)lat->run_max * 1e6 / (double)HOST_CPU_HZ);
+    }
+    /* Task with the most run time and task with the longest wait: the first to saturate */
+    heavy = 0;
+    waited = 0;
+    for (i = 1; i < CFG_TASK_NBR; i++) {
+        if (UTIL_SEQ_GetTaskStats(i)->RunCycles > UTIL_SEQ_GetTaskStats(heavy)->RunCycles) {
+            heavy = i;
+        }
+        if (UTIL_SEQ_GetTaskStats(i)->WaitMax > UTIL_SEQ_GetTaskStats(waited)->WaitMax) {
+            waited = i;
+        }
+    }
+    ts = UTIL_SEQ_GetTaskStats(heavy);
+    if (ts->RunCount > 0U) {
+        fprintf(report, "  Sequencer  : %.1f%% in tasks, most run %s %lu runs avg %.1f us max %.1f us, "
+                "longest wait %s %.1f us\n",
+                (double)SEQ_Profile_GetLoad(NULL, NULL) / 10.0, SEQ_Profile_TaskName(heavy),
+                (unsigned long)ts->RunCount,
+                (double)ts->RunCycles / (double)ts->RunCount * 1e6 / (double)HOST_CPU_HZ,
+                (double)ts->RunMax * 1e6 / (double)HOST_CPU_HZ, SEQ_Profile_TaskName(waited),
+                (double)UTIL_SEQ_GetTaskStats(waited)->WaitMax * 1e6 / (double)HOST_CPU_HZ);
+    }
+    fprintf(report, "  Stack      : %lu commands, %lu flow-off retries, %lu timer callbacks, %.3f s simulated\n",
+            (unsigned long)(out->hci_cmds - hci_cmds0), (unsigned long)flow_off,
+            (unsigned long)out->timer_fires, (double)HOST_GetTimeUs() / 1e6);
+    /* One line for benchmark scripts */
+    fprintf(report, "BENCH events=%lu eps=%.0f avg_ns=%lu p99_ns=%lu max_ns=%lu at_bytes=%lu debug_bytes=%lu "
+            "hci_cmds=%lu flow_off=%lu\n",
+            (unsigned long)n, (secs > 0.0) ? (double)n / secs : 0.0, (unsigned long)(sum / n),
+            (unsigned long)cost[(n * 99U) / 100U], (unsigned long)cost[n - 1U],
+            (unsigned long)(out->at_bytes - at_bytes0), (unsigned long)(out->debug_bytes - debug_bytes0),
+            (unsigned long)(out->hci_cmds - hci_cmds0), (unsigned long)flow_off);
+    fclose(report);
+
+    if (at_file != NULL) {
+        fclose(at_file);
+    }
+    if (debug_file != NULL) {
+        fclose(debug_file);
+    }
+    free(cost);
+    HOST_Capture_Free(&cap);
+    return 0;
+}
@@ -0,0 +1,328 @@
+/**
+  ******************************************************************************
+  * @file    host_port.c
+  * @brief   Host replay port: HAL, timer server, USB CDC and LPUART stubs
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+#include "host_port.h"
+#include "main.h"
+#include "app_conf.h"
+#include "hw_if.h"
+#include "usbd_cdc_if.h"
+#include "ble_hci_trace.h"
+#include "ble_gatt_cache.h"
+#include <string.h>
+#include <time.h>
+
+/* Timer server tick, in nanoseconds (RTC clock / CFG_RTCCLK_DIV) */
+#define HOST_TS_TICK_NS             ((uint64_t)CFG_RTCCLK_DIV * 1000000000ULL / LSE_VALUE)
+
+/* LPUART1 line rate: AT output blocks the CPU for 10 bit times per byte */
+#define HOST_LPUART_BAUD            921600ULL
+
+typedef struct {
+    uint8_t used;
+    uint8_t running;
+    HW_TS_Mode_t mode;
+    HW_TS_pTimerCb_t cb;
+    uint64_t period_ns;
+    uint64_t due_ns;
+} HOST_Timer_t;
+
+/* Handles declared by CubeMX code */
+UART_HandleTypeDef hlpuart1;
+RNG_HandleTypeDef hrng;
+
+/* Register blocks */
+SCB_Type host_scb;
+CoreDebug_Type host_core_debug;
+FLASH_TypeDef host_flash;
+HSEM_TypeDef host_hsem;
+uint32_t host_uid64[2] = { 0xFFFFFFFFU, 0xFFFFFFFFU };
+
+/* GATT cache pages, normally placed by the linker script */
+uint8_t __gatt_cache_start[GATT_CACHE_PAGES * GATT_CACHE_PAGE_SIZE] __attribute__((aligned(FLASH_PAGE_SIZE)));
+
+static DWT_Type host_dwt;
+static SysTick_Type host_systick;
+static uint32_t host_primask;
+
+static uint64_t sim_ns;
+static uint64_t uart_busy_ns;       /* Blocking LPUART1 writes, added to CYCCNT */
+static HOST_Timer_t host_timer[CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER];
+static HOST_Output_t host_out;
+static FILE *at_sink;
+static FILE *debug_sink;
+static uint8_t cdc_tx_pending;
+
+/*============================================================================
+ * Core
+ *============================================================================*/
+DWT_Type* HOST_Dwt(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    host_dwt.CYCCNT = (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec + uart_busy_ns) *
+                                 (HOST_CPU_HZ / 1000000ULL) / 1000ULL);
+    return &host_dwt;
+}
+
+SysTick_Type* HOST_SysTick(void)
+{
+    host_systick.LOAD = (uint32_t)(HOST_CPU_HZ / 1000ULL) - 1U;
+    host_systick.VAL = host_systick.LOAD;
+    return &host_systick;
+}
+
+void HOST_DisableIrq(void)
+{
+    host_primask = 1;
+}
+
+void HOST_EnableIrq(void)
+{
+    host_primask = 0;
+}
+
+uint32_t HOST_GetPrimask(void)
+{
+    return host_primask;
+}
+
+void HOST_SetPrimask(uint32_t primask)
+{
+    host_primask = primask;
+}
+
+/*============================================================================
+ * Output sinks
+ *============================================================================*/
+static ssize_t HOST_DebugWrite(void *cookie, const char *buf, size_t size)
+{
+    (void)cookie;
+    host_out.debug_bytes += size;
+    if (debug_sink != NULL) {
+        fwrite(buf, 1, size, debug_sink);
+    }
+    return (ssize_t)size;
+}
+
+void HOST_Port_Init(FILE *at_file, FILE *debug_file)
+{
+    static const cookie_io_functions_t debug_io = { NULL, HOST_DebugWrite, NULL, NULL };
+    FILE *debug_stream;
+
+    at_sink = at_file;
+    debug_sink = debug_file;
+    memset(&host_out, 0, sizeof(host_out));
+    memset(host_timer, 0, sizeof(host_timer));
+    memset(__gatt_cache_start, 0xFF, sizeof(__gatt_cache_start));
+    sim_ns = 0;
+
+    /* Firmware printf goes to USB CDC: count it, copy it only if asked */
+    debug_stream = fopencookie(NULL, "w", debug_io);
+    if (debug_stream != NULL) {
+        setvbuf(debug_stream, NULL, _IOFBF, 4096);
+        stdout = debug_stream;
+    }
+}
+
+const HOST_Output_t* HOST_GetOutput(void)
+{
+    fflush(stdout);
+    return &host_out;
+}
+
+void HOST_CountHciCmd(void)
+{
+    host_out.hci_cmds++;
+}
+
+/*============================================================================
+ * Simulated time and timer server
+ *============================================================================*/
+uint64_t HOST_GetTimeUs(void)
+{
+    return sim_ns / 1000ULL;
+}
+
+void HOST_SetTimeUs(uint64_t us)
+{
+    uint64_t target = us * 1000ULL;
+    HOST_Timer_t *t;
+    HOST_Timer_t *next;
+    uint8_t i;
+
+    if (target <= sim_ns) {
+        return;
+    }
+
+    /* Fire timers in deadline order, each at its own time */
+    for (;;) {
+        next = NULL;
+        for (i = 0; i < CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER; i++) {
+            t = &host_timer[i];
+            if (t->running && t->due_ns <= target && (next == NULL || t->due_ns < next->due_ns)) {
+                next = t;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        sim_ns = next->due_ns;
+        if (next->mode == hw_ts_Repeated) {
+            next->due_ns += next->period_ns;
+        } else {
+            next->running = 0;
+        }
+        host_out.timer_fires++;
+        next->cb();
+    }
+    sim_ns = target;
+}
+
+HW_TS_ReturnStatus_t HW_TS_Create(uint32_t TimerProcessID, uint8_t *pTimerId, HW_TS_Mode_t TimerMode,
+                                  HW_TS_pTimerCb_t pTimerCallBack)
+{
+    uint8_t i;
+
+    (void)TimerProcessID;
+    for (i = 0; i < CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER; i++) {
+        if (!host_timer[i].used) {
+            memset(&host_timer[i], 0, sizeof(host_timer[i]));
+            host_timer[i].used = 1;
+            host_timer[i].mode = TimerMode;
+            host_timer[i].cb = pTimerCallBack;
+            *pTimerId = i;
+            return hw_ts_Successful;
+        }
+    }
+    return hw_ts_Failed;
+}
+
+void HW_TS_Start(uint8_t TimerID, uint32_t timeout_ticks)
+{
+    HOST_Timer_t *t;
+
+    if (TimerID >= CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER || !host_timer[TimerID].used) {
+        return;
+    }
+    t = &host_timer[TimerID];
+    t->period_ns = (uint64_t)(timeout_ticks ? timeout_ticks : 1U) * HOST_TS_TICK_NS;
+    t->due_ns = sim_ns + t->period_ns;
+    t->running = 1;
+}
+
+void HW_TS_Stop(uint8_t TimerID)
+{
+    if (TimerID < CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER) {
+        host_timer[TimerID].running = 0;
+    }
+}
+
+void HW_TS_Delete(uint8_t TimerID)
+{
+    if (TimerID < CFG_HW_TS_MAX_NBR_CONCURRENT_TIMER) {
+        host_timer[TimerID].used = 0;
+        host_timer[TimerID].running = 0;
+    }
+}
+
+/*============================================================================
+ * HAL
+ *============================================================================*/
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(sim_ns / 1000000ULL);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    HOST_SetTimeUs(HOST_GetTimeUs() + (uint64_t)Delay * 1000ULL);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size,
+                                    uint32_t Timeout)
+{
+    uint16_t i;
+
+    (void)huart;
+    (void)Timeout;
+    host_out.at_bytes += Size;
+    uart_busy_ns += (uint64_t)Size * 10U * 1000000000ULL / HOST_LPUART_BAUD;
+    for (i = 0; i < Size; i++) {
+        if (pData[i] == '\n') {
+            host_out.at_lines++;
+        }
+    }
+    if (at_sink != NULL) {
+        fwrite(pData, 1, Size, at_sink);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    return HAL_OK;
+}
+
+/* Flash writes land in the host copy of the cache pages */
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    (void)TypeProgram;
+    memcpy((void *)(uintptr_t)Address, &Data, sizeof(Data));
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    /* Page numbers are relative to FLASH_BASE in 32-bit arithmetic, as on target */
+    memset((void *)(uintptr_t)(uint32_t)(FLASH_BASE + pEraseInit->Page * FLASH_PAGE_SIZE), 0xFF,
+           pEraseInit->NbPages * FLASH_PAGE_SIZE);
+    *PageError = 0xFFFFFFFFU;
+    return HAL_OK;
+}
+
+void Error_Handler(void)
+{
+    fprintf(stderr, "Error_Handler called\n");
+}
+
+/*============================================================================
+ * USB CDC
+ *============================================================================*/
+uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len)
+{
+    (void)Buf;
+    if (cdc_tx_pending) {
+        return USBD_BUSY;
+    }
+    host_out.cdc_bytes += Len;
+    cdc_tx_pending = 1;
+    return USBD_OK;
+}
+
+void HOST_Port_Poll(void)
+{
+    if (cdc_tx_pending) {
+        cdc_tx_pending = 0;
+        BLE_HciTrace_OnUsbTxDone();
+    }
+}
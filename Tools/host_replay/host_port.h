@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    host_port.h
+  * @brief   Host replay port: simulated clock, timer server, registers and
+  *          captured gateway output
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include "stm32wbxx.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/* Gateway output counters */
+typedef struct {
+    uint64_t at_bytes;              /* AT responses (LPUART1) */
+    uint64_t at_lines;
+    uint64_t debug_bytes;           /* printf text (USB CDC) */
+    uint64_t cdc_bytes;             /* Binary USB CDC transfers (trace export) */
+    uint64_t hci_cmds;              /* ACI/HCI commands sent to the stub controller */
+    uint64_t timer_fires;           /* Timer server callbacks */
+} HOST_Output_t;
+
+/**
+  * @brief Open output sinks and reset the simulated clock
+  * @param at_file AT output copy, or NULL
+  * @param debug_file Debug text copy, or NULL to drop it
+  */
+void HOST_Port_Init(FILE *at_file, FILE *debug_file);
+
+/**
+  * @brief Get simulated time since reset, in microseconds
+  */
+uint64_t HOST_GetTimeUs(void);
+
+/**
+  * @brief Move simulated time forward, firing due timer server callbacks
+  * @note  Time never goes backwards; earlier values are ignored
+  */
+void HOST_SetTimeUs(uint64_t us);
+
+/**
+  * @brief Complete pending USB CDC transfers (transfer complete interrupt)
+  */
+void HOST_Port_Poll(void);
+
+/**
+  * @brief Get output counters
+  */
+const HOST_Output_t* HOST_GetOutput(void);
+
+/**
+  * @brief Count a command sent to the stub controller
+  */
+void HOST_CountHciCmd(void);
+
+#endif /* HOST_PORT_H */
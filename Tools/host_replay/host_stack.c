@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    host_stack.c
+  * @brief   Host replay port: stub controller behind the ACI/HCI command
+  *          encoders, transport layer and coprocessor system commands
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#include "host_port.h"
+#include "ble.h"
+#include "hci_tl.h"
+#include "tl.h"
+#include "shci.h"
+#include "svc_ctl.h"
+#include "stm32_lpm.h"
+#include "app_entry.h"
+#include <string.h>
+
+uint32_t SystemCoreClock = (uint32_t)HOST_CPU_HZ;
+
+static HCI_TL_Stats_t host_hci_stats;
+static TL_MM_Stats_t host_mm_stats;
+
+/*============================================================================
+ * Controller: every command completes at once with success
+ *============================================================================*/
+int hci_send_req(struct hci_request *p_cmd, uint8_t async)
+{
+    (void)async;
+    HOST_CountHciCmd();
+    /* Zeroed return parameters: status BLE_STATUS_SUCCESS, handles 0 */
+    if (p_cmd->rparam != 0 && p_cmd->rlen > 0) {
+        memset(p_cmd->rparam, 0, (size_t)p_cmd->rlen);
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Transport layer: events are fed to SVCCTL_UserEvtRx by the replay
+ *============================================================================*/
+void hci_init(void(* UserEvtRx)(void* pData), void* pConf)
+{
+    (void)UserEvtRx;
+    (void)pConf;
+}
+
+void hci_user_evt_proc(void)
+{
+}
+
+void hci_resume_flow(void)
+{
+}
+
+const HCI_TL_Stats_t * hci_get_stats(void)
+{
+    return &host_hci_stats;
+}
+
+void hci_clear_stats(void)
+{
+    memset(&host_hci_stats, 0, sizeof(host_hci_stats));
+}
+
+const TL_MM_Stats_t * TL_MM_GetStats(void)
+{
+    return &host_mm_stats;
+}
+
+void TL_MM_ClearStats(void)
+{
+    memset(&host_mm_stats, 0, sizeof(host_mm_stats));
+}
+
+uint32_t APPE_GetMbMem2Size(void)
+{
+    return 0;
+}
+
+void SVCCTL_Init(void)
+{
+}
+
+/*============================================================================
+ * Coprocessor and board
+ *============================================================================*/
+SHCI_CmdStatus_t SHCI_C2_BLE_Init(SHCI_C2_Ble_Init_Cmd_Packet_t *pCmdPacket)
+{
+    (void)pCmdPacket;
+    return SHCI_Success;
+}
+
+SHCI_CmdStatus_t SHCI_C2_FLASH_EraseActivity(SHCI_EraseActivity_t erase_activity)
+{
+    (void)erase_activity;
+    return SHCI_Success;
+}
+
+uint8_t * OTP_Read(uint8_t id)
+{
+    (void)id;
+    return 0;
+}
+
+void UTIL_LPM_SetOffMode(UTIL_LPM_bm_t lpm_id_bm, UTIL_LPM_State_t state)
+{
+    (void)lpm_id_bm;
+    (void)state;
+}
+
+const char *DbgTraceGetFileName(const char *fullpath)
+{
+    const char *name = strrchr(fullpath, '/');
+
+    return (name != 0) ? name + 1 : fullpath;
+}
@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    host_regs.h
+  * @brief   Host replay shim: core and peripheral register blocks in host memory
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef HOST_REGS_H
+#define HOST_REGS_H
+
+#include <stdint.h>
+
+/* Cycle counter rate reported by DWT->CYCCNT, matches the CPU1 clock */
+#define HOST_CPU_HZ                 64000000ULL
+
+/* Register blocks the firmware reaches through the device macros */
+extern SCB_Type host_scb;
+extern CoreDebug_Type host_core_debug;
+extern FLASH_TypeDef host_flash;
+extern HSEM_TypeDef host_hsem;
+extern uint32_t host_uid64[2];
+
+/**
+  * @brief DWT with CYCCNT following the host monotonic clock, plus the time
+  *        blocking LPUART1 writes would take on target
+  */
+DWT_Type* HOST_Dwt(void);
+
+/**
+  * @brief SysTick at the start of a 1 ms period
+  */
+SysTick_Type* HOST_SysTick(void);
+
+void HOST_DisableIrq(void);
+void HOST_EnableIrq(void);
+uint32_t HOST_GetPrimask(void);
+void HOST_SetPrimask(uint32_t primask);
+
+#endif /* HOST_REGS_H */
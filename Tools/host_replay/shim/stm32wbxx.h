@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file    stm32wbxx.h
+  * @brief   Host replay shim: STM32WB device header with core and peripheral
+  *          registers moved to host memory
+  * @author  BLE Gateway
+  ******************************************************************************
+  */
+
+#ifndef HOST_SHIM_STM32WBXX_H
+#define HOST_SHIM_STM32WBXX_H
+
+#include <stdint.h>
+
+/* Device definitions first, HAL afterwards so its inline functions see the
+ * host register blocks below */
+#if defined(USE_HAL_DRIVER)
+#define HOST_SHIM_USE_HAL_DRIVER
+#undef USE_HAL_DRIVER
+#endif
+
+#include_next "stm32wbxx.h"
+
+#include "host_regs.h"
+
+/* Core registers */
+#undef DWT
+#define DWT                 (HOST_Dwt())
+#undef SysTick
+#define SysTick             (HOST_SysTick())
+#undef SCB
+#define SCB                 (&host_scb)
+#undef CoreDebug
+#define CoreDebug           (&host_core_debug)
+
+/* Peripherals reached by the gateway modules */
+#undef FLASH
+#define FLASH               (&host_flash)
+#undef HSEM
+#define HSEM                (&host_hsem)
+#undef UID64_BASE
+#define UID64_BASE          ((uintptr_t)host_uid64)
+
+/* Interrupt masking: the replay is single-threaded */
+#define __disable_irq()     HOST_DisableIrq()
+#define __enable_irq()      HOST_EnableIrq()
+#define __get_PRIMASK()     HOST_GetPrimask()
+#define __set_PRIMASK(x)    HOST_SetPrimask(x)
+
+#if defined(HOST_SHIM_USE_HAL_DRIVER)
+#define USE_HAL_DRIVER
+#include "stm32wbxx_hal.h"
+#endif
+
+#endif /* HOST_SHIM_STM32WBXX_H */
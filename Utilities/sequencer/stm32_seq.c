@@ -101,6 +101,17 @@ typedef struct
   #define UTIL_SEQ_CONF_PRIO_NBR  (2)
 #endif
 
+/**
+ * @brief task profiling and load accounting, disabled by default
+ */
+#ifndef UTIL_SEQ_CONF_PROFILE
+  #define UTIL_SEQ_CONF_PROFILE  (0)
+#endif
+
+#if (UTIL_SEQ_CONF_PROFILE != 0) && !defined(UTIL_SEQ_PROFILE_CYCLES)
+#error "UTIL_SEQ_PROFILE_CYCLES() shall be defined in utilities_conf.h when UTIL_SEQ_CONF_PROFILE is set"
+#endif
+
 /**
  * @brief default memset function.
  */
@@ -158,6 +169,35 @@ static void (*TaskCb[UTIL_SEQ_CONF_TASK_NBR])( void );
  */
 static volatile UTIL_SEQ_Priority_t TaskPrio[UTIL_SEQ_CONF_PRIO_NBR];
 
+/**
+ * @brief returned for tasks without statistics.
+ */
+static const UTIL_SEQ_TaskStats_t SeqNoStats;
+
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+/**
+ * @brief task profiles.
+ */
+static UTIL_SEQ_TaskStats_t TaskStats[UTIL_SEQ_CONF_TASK_NBR];
+
+/**
+ * @brief time of the UTIL_SEQ_SetTask() that made each task pending.
+ */
+static volatile uint32_t TaskSetStamp[UTIL_SEQ_CONF_TASK_NBR];
+
+/**
+ * @brief run time of all tasks, nested ones included, to compute the own time of a task that waits for an event.
+ */
+static uint64_t SeqNestedCycles;
+
+/**
+ * @brief load accounting.
+ */
+static UTIL_SEQ_Load_t SeqLoad;
+static uint32_t SeqLastStamp;
+static uint32_t SeqDepth;
+#endif
+
 /**
  * @}
  */
@@ -167,6 +207,11 @@ static volatile UTIL_SEQ_Priority_t TaskPrio[UTIL_SEQ_CONF_PRIO_NBR];
  *  @{
  */
 uint8_t SEQ_BitPosition(uint32_t Value);
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+static void SEQ_ProfileElapsed(uint32_t Now);
+static uint32_t SEQ_ProfileStart(uint32_t TaskIdx, uint64_t *NestedBase);
+static void SEQ_ProfileEnd(uint32_t TaskIdx, uint32_t Start, uint64_t NestedBase);
+#endif
 
 /**
  * @}
@@ -192,6 +237,7 @@ void UTIL_SEQ_Init( void )
       TaskPrio[index].round_robin = 0;
   }
   UTIL_SEQ_INIT_CRITICAL_SECTION( );
+  UTIL_SEQ_ClearStats( );
 }
 
 void UTIL_SEQ_DeInit( void )
@@ -213,6 +259,11 @@ void UTIL_SEQ_Run( UTIL_SEQ_bm_t Mask_bm )
   UTIL_SEQ_bm_t local_evtset;
   UTIL_SEQ_bm_t local_taskmask;
   UTIL_SEQ_bm_t local_evtwaited;
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  uint32_t task_idx;
+  uint32_t start_cycles;
+  uint64_t nested_base;
+#endif
 
   /*
    * When this function is nested, the mask to be applied cannot be larger than the first call
@@ -287,7 +338,14 @@ void UTIL_SEQ_Run( UTIL_SEQ_bm_t Mask_bm )
     UTIL_SEQ_EXIT_CRITICAL_SECTION( );
 
     /* Execute the task */
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+    task_idx = CurrentTaskIdx;
+    start_cycles = SEQ_ProfileStart(task_idx, &nested_base);
+    TaskCb[task_idx]( );
+    SEQ_ProfileEnd(task_idx, start_cycles, nested_base);
+#else
     TaskCb[CurrentTaskIdx]( );
+#endif
 
     local_taskset = TaskSet;
     local_evtset = EvtSet;
@@ -314,6 +372,10 @@ void UTIL_SEQ_Run( UTIL_SEQ_bm_t Mask_bm )
 
   UTIL_SEQ_PostIdle( );
 
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  SEQ_ProfileElapsed(UTIL_SEQ_PROFILE_CYCLES( ));
+#endif
+
   /* restore the mask from UTIL_SEQ_Run() */
   SuperMask = super_mask_backup;
 
@@ -334,8 +396,25 @@ void UTIL_SEQ_RegTask(UTIL_SEQ_bm_t TaskId_bm, uint32_t Flags, void (*Task)( voi
 
 void UTIL_SEQ_SetTask( UTIL_SEQ_bm_t TaskId_bm , uint32_t Task_Prio )
 {
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  UTIL_SEQ_bm_t new_bm;
+  uint32_t now;
+  uint8_t idx;
+#endif
+
   UTIL_SEQ_ENTER_CRITICAL_SECTION( );
 
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  /* the wait is measured from the first request, a task already pending keeps its stamp */
+  new_bm = TaskId_bm & ~TaskSet;
+  now = UTIL_SEQ_PROFILE_CYCLES( );
+  while (new_bm != 0U)
+  {
+    idx = SEQ_BitPosition(new_bm);
+    TaskSetStamp[idx] = now;
+    new_bm &= ~(1U << idx);
+  }
+#endif
   TaskSet |= TaskId_bm;
   TaskPrio[Task_Prio].priority |= TaskId_bm;
 
@@ -472,6 +551,40 @@ UTIL_SEQ_bm_t UTIL_SEQ_IsEvtPend( void )
   return (EvtSet & local_evtwaited);
 }
 
+const UTIL_SEQ_TaskStats_t * UTIL_SEQ_GetTaskStats( uint32_t TaskIdx )
+{
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  if (TaskIdx < UTIL_SEQ_CONF_TASK_NBR)
+  {
+    return &TaskStats[TaskIdx];
+  }
+#else
+  (void)TaskIdx;
+#endif
+  return &SeqNoStats;
+}
+
+void UTIL_SEQ_GetLoad( UTIL_SEQ_Load_t *Load )
+{
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  SEQ_ProfileElapsed(UTIL_SEQ_PROFILE_CYCLES( ));
+  *Load = SeqLoad;
+#else
+  Load->TotalCycles = 0U;
+  Load->BusyCycles = 0U;
+#endif
+}
+
+void UTIL_SEQ_ClearStats( void )
+{
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+  (void)UTIL_SEQ_MEMSET8((uint8_t *)TaskStats, 0, sizeof(TaskStats));
+  SeqLoad.TotalCycles = 0U;
+  SeqLoad.BusyCycles = 0U;
+  SeqLastStamp = UTIL_SEQ_PROFILE_CYCLES( );
+#endif
+}
+
 __WEAK void UTIL_SEQ_EvtIdle( UTIL_SEQ_bm_t TaskId_bm, UTIL_SEQ_bm_t EvtWaited_bm )
 {
   (void)EvtWaited_bm;
@@ -508,6 +621,73 @@ __WEAK void UTIL_SEQ_PostIdle( void )
  *  @{
  */
 
+#if (UTIL_SEQ_CONF_PROFILE != 0)
+/**
+ * @brief add the time since the previous call to the elapsed time
+ * @note  called at least at each task end and each idle pass, so the cycle counter cannot wrap in between
+ * @param Now cycle counter
+ */
+static void SEQ_ProfileElapsed(uint32_t Now)
+{
+  SeqLoad.TotalCycles += (uint32_t)(Now - SeqLastStamp);
+  SeqLastStamp = Now;
+}
+
+/**
+ * @brief account the wait of a task about to run
+ * @param TaskIdx task number
+ * @param NestedBase filled with the nested run time so far
+ * @retval start time of the run
+ */
+static uint32_t SEQ_ProfileStart(uint32_t TaskIdx, uint64_t *NestedBase)
+{
+  UTIL_SEQ_TaskStats_t *stats = &TaskStats[TaskIdx];
+  uint32_t now = UTIL_SEQ_PROFILE_CYCLES( );
+  uint32_t wait = now - TaskSetStamp[TaskIdx];
+
+  stats->WaitCycles += wait;
+  if (wait > stats->WaitMax)
+  {
+    stats->WaitMax = wait;
+  }
+  *NestedBase = SeqNestedCycles;
+  SeqDepth++;
+  return now;
+}
+
+/**
+ * @brief account the run of a task
+ * @note  tasks run from UTIL_SEQ_WaitEvt() during the run are charged to themselves, not to this task
+ * @param TaskIdx task number
+ * @param Start start time of the run
+ * @param NestedBase nested run time at the start
+ */
+static void SEQ_ProfileEnd(uint32_t TaskIdx, uint32_t Start, uint64_t NestedBase)
+{
+  UTIL_SEQ_TaskStats_t *stats = &TaskStats[TaskIdx];
+  uint32_t now = UTIL_SEQ_PROFILE_CYCLES( );
+  uint32_t run = now - Start;
+  uint32_t own = run - (uint32_t)(SeqNestedCycles - NestedBase);
+
+  SeqNestedCycles = NestedBase + run;
+  SeqDepth--;
+
+  stats->RunCount++;
+  stats->RunCycles += own;
+  stats->RunLast = own;
+  if (own > stats->RunMax)
+  {
+    stats->RunMax = own;
+  }
+
+  if (SeqDepth == 0U)
+  {
+    SeqLoad.BusyCycles += run;
+    SEQ_ProfileElapsed(now);
+  }
+}
+#endif
+
 #if( __CORTEX_M == 0)
 const uint8_t SEQ_clz_table_4bit[16U] = { 4U, 3U, 2U, 2U, 1U, 1U, 1U, 1U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U };
 /**
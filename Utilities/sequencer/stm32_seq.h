@@ -43,6 +43,28 @@ extern "C" {
 
 typedef uint32_t UTIL_SEQ_bm_t;
 
+/**
+ *  @brief  task profile, filled when UTIL_SEQ_CONF_PROFILE is set (times in UTIL_SEQ_PROFILE_CYCLES() units)
+ */
+typedef struct
+{
+  uint32_t RunCount;      /*!< Runs of the task                                                  */
+  uint64_t RunCycles;     /*!< Execution time, tasks run while it waits for an event excluded   */
+  uint32_t RunMax;
+  uint32_t RunLast;
+  uint64_t WaitCycles;    /*!< UTIL_SEQ_SetTask() on an idle task to the start of its run      */
+  uint32_t WaitMax;
+} UTIL_SEQ_TaskStats_t;
+
+/**
+ *  @brief  processor load, filled when UTIL_SEQ_CONF_PROFILE is set
+ */
+typedef struct
+{
+  uint64_t TotalCycles;   /*!< Time since the statistics were cleared                           */
+  uint64_t BusyCycles;    /*!< Time in tasks (outermost UTIL_SEQ_Run() only), the rest is idle  */
+} UTIL_SEQ_Load_t;
+
 /**
   * @}
  */
@@ -344,6 +366,31 @@ UTIL_SEQ_bm_t UTIL_SEQ_IsEvtPend( void );
  */
 void UTIL_SEQ_EvtIdle( UTIL_SEQ_bm_t TaskId_bm, UTIL_SEQ_bm_t EvtWaited_bm );
 
+/**
+ * @brief This function returns the profile of a task
+ *
+ * @param TaskIdx The number assigned to the task, not its bit mapping
+ * @retval Task statistics, all zero when UTIL_SEQ_CONF_PROFILE is 0
+ *
+ */
+const UTIL_SEQ_TaskStats_t * UTIL_SEQ_GetTaskStats( uint32_t TaskIdx );
+
+/**
+ * @brief This function returns the processor load since the statistics were cleared
+ *
+ * @param Load Filled with the elapsed and busy times
+ *
+ * @note  Time spent with the cycle counter stopped (low power modes) is not seen.
+ *
+ */
+void UTIL_SEQ_GetLoad( UTIL_SEQ_Load_t *Load );
+
+/**
+ * @brief This function clears the task profiles and restarts the load measurement
+ *
+ */
+void UTIL_SEQ_ClearStats( void );
+
 /**
   * @}
  */